@@ -0,0 +1,93 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "testing/Benchmark.h"
+#include "utils/DataCache.h"
+#include "utils/StringUtil.h"
+#include "utils/WatsonException.h"
+
+class BenchDataCache : Benchmark
+{
+public:
+	//! Construction
+	BenchDataCache() : Benchmark("BenchDataCache"), m_nNext(0)
+	{}
+
+	virtual void RunBenchmark()
+	{
+		m_Data.resize(4 * 1024);
+		for (size_t i = 0; i < m_Data.size(); ++i)
+			m_Data[i] = (char)('a' + (i % 26));
+
+		Initialize();
+		m_Cache.FlushAll();
+
+		Measure("save_4k", 2000, DELEGATE(BenchDataCache, Save, boost::uint64_t, this), m_Data.size());
+		Save(ITEMS);		// make sure every item exists, however small the scale
+		Measure("find_in_memory", 200000, DELEGATE(BenchDataCache, FindInMemory, boost::uint64_t, this), m_Data.size());
+		Measure("load_from_disk", ITEMS, DELEGATE(BenchDataCache, LoadFromDisk, boost::uint64_t, this), m_Data.size());
+
+		m_Cache.FlushAll();
+		m_Cache.Uninitialize();
+	}
+
+	void Save(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+			m_Cache.Save(GetID(m_nNext++), m_Data);
+	}
+
+	void FindInMemory(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+			Find(i);
+	}
+
+	//! Re-open the cache and load items from disk, this includes scanning the cache directory.
+	void LoadFromDisk(boost::uint64_t a_nOps)
+	{
+		m_Cache.Uninitialize();
+		Initialize();
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+			Find(i);
+	}
+
+	void Initialize()
+	{
+		if (!m_Cache.Initialize("./cache/bench/", 1024 * 1024 * 1024))
+			throw WatsonException("Failed to initialize cache.");
+	}
+
+	void Find(boost::uint64_t a_nItem)
+	{
+		if (m_Cache.Find(GetID(a_nItem)) == NULL)
+			throw WatsonException("Failed to find item.");
+	}
+
+	static std::string GetID(boost::uint64_t a_nItem)
+	{
+		return StringUtil::Format("item%u", (unsigned int)(a_nItem % ITEMS));
+	}
+
+	static const int ITEMS = 1000;
+
+	DataCache			m_Cache;
+	std::string			m_Data;
+	boost::uint64_t		m_nNext;
+};
+
+BenchDataCache BENCH_DATA_CACHE;
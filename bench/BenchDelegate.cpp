@@ -0,0 +1,124 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "testing/Benchmark.h"
+#include "utils/Delegate.h"
+#include "utils/Signal.h"
+#include "utils/WatsonException.h"
+
+#include "boost/enable_shared_from_this.hpp"
+
+//! Delegates are made and copied for every request, timer & callback, and invoked for every response. Results
+//! that go to several consumers are sent through a DelegateList or a Signal.
+class BenchDelegate : Benchmark
+{
+public:
+	//! Types
+	struct Receiver : public boost::enable_shared_from_this<Receiver>
+	{
+		Receiver() : m_nCount(0)
+		{}
+
+		void OnValue(int a_nValue)
+		{
+			m_nCount += a_nValue;
+		}
+
+		int m_nCount;
+	};
+
+	//! Construction
+	BenchDelegate() : Benchmark("BenchDelegate")
+	{}
+
+	virtual void RunBenchmark()
+	{
+		m_spReceiver.reset(new Receiver());
+
+		m_Delegate = DELEGATE(Receiver, OnValue, int, m_spReceiver.get());
+		Measure("copy_raw", 1000000, DELEGATE(BenchDelegate, Copy, boost::uint64_t, this));
+		Measure("invoke_raw", 1000000, DELEGATE(BenchDelegate, Invoke, boost::uint64_t, this));
+
+		m_Delegate = DELEGATE(Receiver, OnValue, int, m_spReceiver);
+		Measure("create_weak", 1000000, DELEGATE(BenchDelegate, CreateWeak, boost::uint64_t, this));
+		Measure("copy_weak", 1000000, DELEGATE(BenchDelegate, Copy, boost::uint64_t, this));
+		Measure("invoke_weak", 1000000, DELEGATE(BenchDelegate, Invoke, boost::uint64_t, this));
+
+		for (int i = 0; i < FAN_OUT; ++i)
+		{
+			m_List.Add(DELEGATE(Receiver, OnValue, int, m_spReceiver));
+			m_Signal.Connect(DELEGATE(Receiver, OnValue, int, m_spReceiver));
+		}
+		Measure("invoke_list_4", 1000000, DELEGATE(BenchDelegate, InvokeList, boost::uint64_t, this));
+		Measure("emit_signal_4", 1000000, DELEGATE(BenchDelegate, EmitSignal, boost::uint64_t, this));
+
+		m_List.Clear();
+		m_Signal.Clear();
+		m_Delegate.Reset();
+		m_spReceiver.reset();
+	}
+
+	void CreateWeak(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			Delegate<int> d = DELEGATE(Receiver, OnValue, int, m_spReceiver);
+			if (!d.IsValid())
+				throw WatsonException("Invalid delegate.");
+		}
+	}
+
+	void Copy(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			Delegate<int> copy(m_Delegate);
+			if (!copy.IsValid())
+				throw WatsonException("Invalid delegate.");
+		}
+	}
+
+	void Invoke(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			if (!m_Delegate(1))
+				throw WatsonException("Failed to invoke delegate.");
+		}
+	}
+
+	void InvokeList(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+			m_List.Invoke(1);
+	}
+
+	void EmitSignal(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+			m_Signal.Emit(1);
+	}
+
+	static const int FAN_OUT = 4;
+
+	boost::shared_ptr<Receiver>		m_spReceiver;
+	Delegate<int>					m_Delegate;
+	DelegateList<int>				m_List;
+	Signal<int>						m_Signal;
+};
+
+BenchDelegate BENCH_DELEGATE;
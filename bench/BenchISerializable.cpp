@@ -0,0 +1,173 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "testing/Benchmark.h"
+#include "utils/Cbor.h"
+#include "utils/JsonFields.h"
+#include "utils/JsonParser.h"
+#include "utils/StringUtil.h"
+#include "utils/WatsonException.h"
+#include "services/SpeechToText/DataModels.h"
+
+//! Serializes the results of a speech to text request, these arrive many times a second while the user is talking.
+class BenchISerializable : Benchmark
+{
+public:
+	//! Construction
+	BenchISerializable() : Benchmark("BenchISerializable")
+	{}
+
+	virtual void RunBenchmark()
+	{
+		SpeechResult result;
+		result.m_Final = true;
+		for (int a = 0; a < 3; ++a)
+		{
+			SpeechAlt alt;
+			alt.m_Confidence = 0.9 - (a * 0.1);
+			for (int w = 0; w < 12; ++w)
+			{
+				TimeStamp stamp;
+				stamp.m_Word = StringUtil::Format("word%d", w);
+				stamp.m_Start = w * 0.25;
+				stamp.m_End = stamp.m_Start + 0.2;
+				alt.m_Timestamps.push_back(stamp);
+
+				WordConfidence confidence;
+				confidence.m_Word = stamp.m_Word;
+				confidence.m_Confidence = alt.m_Confidence;
+				alt.m_WordConfidence.push_back(confidence);
+
+				alt.m_Transcript += stamp.m_Word + " ";
+			}
+			result.m_Alternatives.push_back(alt);
+		}
+		m_Results.m_Results.push_back(result);
+		m_Results.m_Language = "en-US";
+		m_Json = Json::FastWriter().write(ISerializable::SerializeObject(&m_Results, false));
+
+		Measure("serialize_recognize_results", 20000, DELEGATE(BenchISerializable, Serialize, boost::uint64_t, this), m_Json.size());
+		Measure("deserialize_recognize_results", 20000, DELEGATE(BenchISerializable, Deserialize, boost::uint64_t, this), m_Json.size());
+		Measure("round_trip_recognize_results", 10000, DELEGATE(BenchISerializable, RoundTrip, boost::uint64_t, this), m_Json.size());
+		Measure("parse_json_reader", 20000, DELEGATE(BenchISerializable, ParseReader, boost::uint64_t, this), m_Json.size());
+		Measure("parse_json_parser", 20000, DELEGATE(BenchISerializable, ParseParser, boost::uint64_t, this), m_Json.size());
+		m_Root = ISerializable::SerializeObject(&m_Results, false);
+		m_Cbor = Cbor::Write(m_Root);
+		Measure("write_cbor", 20000, DELEGATE(BenchISerializable, WriteCbor, boost::uint64_t, this), m_Cbor.size());
+		Measure("read_cbor", 20000, DELEGATE(BenchISerializable, ReadCbor, boost::uint64_t, this), m_Cbor.size());
+		Measure("serialize_recognize_results_fields", 20000, DELEGATE(BenchISerializable, SerializeFields, boost::uint64_t, this), m_Json.size());
+		Measure("deserialize_recognize_results_fields", 20000, DELEGATE(BenchISerializable, DeserializeFields, boost::uint64_t, this), m_Json.size());
+	}
+
+	void Serialize(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			std::string json(Json::FastWriter().write(ISerializable::SerializeObject(&m_Results, false)));
+			if (json.size() != m_Json.size())
+				throw WatsonException("Serialized size changed.");
+		}
+	}
+
+	void Deserialize(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			RecognizeResults results;
+			if (ISerializable::DeserializeObject(m_Json, &results) == NULL || !results.HasFinalResult())
+				throw WatsonException("Failed to deserialize results.");
+		}
+	}
+
+	void RoundTrip(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			RecognizeResults results;
+			ISerializable::DeserializeObject(Json::FastWriter().write(ISerializable::SerializeObject(&m_Results, false)), &results);
+			if (!results.HasFinalResult())
+				throw WatsonException("Failed to round trip results.");
+		}
+	}
+
+	void ParseReader(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			Json::Value root;
+			if (!Json::Reader(Json::Features::strictMode()).parse(m_Json, root))
+				throw WatsonException("Failed to parse results.");
+		}
+	}
+
+	void ParseParser(boost::uint64_t a_nOps)
+	{
+		JsonParser parser;
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			Json::Value root;
+			if (!parser.Parse(m_Json, root))
+				throw WatsonException("Failed to parse results.");
+		}
+	}
+
+	void SerializeFields(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			std::string json(JsonFields<RecognizeResults>::ToJson(m_Results));
+			if (json.size() != m_Json.size() - 1)		// no trailing new line
+				throw WatsonException("Serialized size changed.");
+		}
+	}
+
+	void DeserializeFields(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			RecognizeResults results;
+			if (!JsonFields<RecognizeResults>::FromJson(m_Json, results) || !results.HasFinalResult())
+				throw WatsonException("Failed to deserialize results.");
+		}
+	}
+
+	void WriteCbor(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			if (Cbor::Write(m_Root).size() != m_Cbor.size())
+				throw WatsonException("Serialized size changed.");
+		}
+	}
+
+	void ReadCbor(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			Json::Value root;
+			if (!Cbor::Read(m_Cbor, root))
+				throw WatsonException("Failed to read results.");
+		}
+	}
+
+	RecognizeResults	m_Results;
+	std::string			m_Json;
+	Json::Value			m_Root;
+	std::string			m_Cbor;
+};
+
+BenchISerializable BENCH_ISERIALIZABLE;
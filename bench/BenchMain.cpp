@@ -0,0 +1,107 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testing/Benchmark.h"
+#include "utils/Log.h"
+#include "utils/Library.h"
+
+#include <iostream>
+
+int main( int argc, char ** argv )
+{
+	std::vector<std::string> benchmarks;
+	std::list<Library> libs;
+	std::string format( "json" );
+	std::string output;
+	std::string label;
+	bool bVerbose = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i][0] == '-' && (i + 1) < argc)
+		{
+			switch (argv[i][1])
+			{
+			case 'B':
+				benchmarks.push_back(argv[++i]);
+				continue;
+			case 'L':
+				libs.push_back(Library(argv[++i]));
+				continue;
+			case 'r':
+				Benchmark::SetRepetitions(atoi(argv[++i]));
+				continue;
+			case 's':
+				Benchmark::SetScale(atof(argv[++i]));
+				continue;
+			case 'f':
+				format = argv[++i];
+				continue;
+			case 'o':
+				output = argv[++i];
+				continue;
+			case 'l':
+				label = argv[++i];
+				continue;
+			}
+		}
+		else if (strcmp(argv[i], "-v") == 0)
+		{
+			bVerbose = true;
+			continue;
+		}
+
+		std::cout << "Usage: wdc_bench [options]\r\n"
+			"-B <benchmark> .. Run benchmark, may be given more than once\r\n"
+			"-L <library> .. Load dynamic library\r\n"
+			"-r <count> .. Timed repetitions of each case (default 5)\r\n"
+			"-s <scale> .. Multiply the operations of each case, e.g. 0.1 for a quick run\r\n"
+			"-f <json|csv> .. Output format (default json)\r\n"
+			"-o <file> .. Write the results to a file instead of stdout\r\n"
+			"-l <label> .. Label written with the results, e.g. the version being measured\r\n"
+			"-v .. Log progress to the console\r\n";
+		return 1;
+	}
+
+	// results go to stdout, so keep the console quiet unless asked..
+	Log::RegisterReactor( new ConsoleReactor( bVerbose ? LL_STATUS : LL_ERROR ) );
+	Log::RegisterReactor( new FileReactor( "Benchmark.log", LL_STATUS ) );
+
+	Benchmark::ResultList results;
+	int failed = Benchmark::RunBenchmarks( benchmarks, results );
+
+	std::string formatted( format == "csv" ? Benchmark::FormatCSV( results, label ) : Benchmark::FormatJson( results, label ) );
+	if ( output.size() > 0 )
+	{
+		FILE * pFile = fopen( output.c_str(), "wb" );
+		if ( pFile == NULL )
+		{
+			printf( "ERROR: Failed to open %s for writing.\r\n", output.c_str() );
+			return 1;
+		}
+		fwrite( formatted.data(), 1, formatted.size(), pFile );
+		fclose( pFile );
+	}
+	else
+		fwrite( formatted.data(), 1, formatted.size(), stdout );
+
+	return failed;
+}
@@ -0,0 +1,105 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "testing/Benchmark.h"
+#include "utils/Config.h"
+#include "utils/ISerializable.h"
+#include "utils/WatsonException.h"
+#include "services/Alchemy/Alchemy.h"
+#include "services/Conversation/Conversation.h"
+#include "services/LanguageTranslator/LanguageTranslator.h"
+#include "services/NaturalLanguageClassifier/NaturalLanguageClassifier.h"
+#include "services/PersonalityInsights/PersonalityInsights.h"
+#include "services/SpeechToText/SpeechToText.h"
+#include "services/TextToSpeech/TextToSpeech.h"
+#include "services/ToneAnalyzer/ToneAnalyzer.h"
+
+//! Type lookups made for every object that is serialized with its type or created by name, and
+//! when a service is found by its type.
+class BenchRTTI : Benchmark
+{
+public:
+	//! Construction
+	BenchRTTI() : Benchmark("BenchRTTI"), m_TypeName("ConversationResponse"), m_pConfig(NULL)
+	{}
+
+	virtual void RunBenchmark()
+	{
+		Measure("find_creator", 1000000, DELEGATE(BenchRTTI, FindCreator, boost::uint64_t, this));
+		Measure("write_type", 1000000, DELEGATE(BenchRTTI, WriteType, boost::uint64_t, this));
+		Measure("dynamic_cast", 1000000, DELEGATE(BenchRTTI, Cast, boost::uint64_t, this));
+
+		// the services an application typically has, the one found is last..
+		Config config;
+		config.AddService(new Alchemy());
+		config.AddService(new Conversation());
+		config.AddService(new LanguageTranslator());
+		config.AddService(new NaturalLanguageClassifier());
+		config.AddService(new PersonalityInsights());
+		config.AddService(new ToneAnalyzer());
+		config.AddService(new SpeechToText());
+		config.AddService(new TextToSpeech());
+		m_pConfig = &config;
+		Measure("find_service", 1000000, DELEGATE(BenchRTTI, FindService, boost::uint64_t, this));
+		m_pConfig = NULL;
+	}
+
+	void FindCreator(boost::uint64_t a_nOps)
+	{
+		Factory<ISerializable> & factory = ISerializable::GetSerializableFactory();
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			if (factory.FindCreator(m_TypeName) == NULL)
+				throw WatsonException("Failed to find creator.");
+		}
+	}
+
+	void WriteType(boost::uint64_t a_nOps)
+	{
+		const RTTI * pType = &m_Response.GetRTTI();
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			if (ISerializable::GetWriteType(pType) != pType)
+				throw WatsonException("Wrong write type.");
+		}
+	}
+
+	void Cast(boost::uint64_t a_nOps)
+	{
+		ISerializable * pObject = &m_Response;
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			if (DynamicCast<ConversationResponse>(pObject) == NULL)
+				throw WatsonException("Failed to cast.");
+		}
+	}
+
+	void FindService(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			if (m_pConfig->FindService<TextToSpeech>() == NULL)
+				throw WatsonException("Failed to find service.");
+		}
+	}
+
+	std::string				m_TypeName;
+	ConversationResponse	m_Response;
+	Config *				m_pConfig;
+};
+
+BenchRTTI BENCH_RTTI;
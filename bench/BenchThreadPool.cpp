@@ -0,0 +1,90 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "testing/Benchmark.h"
+#include "utils/ThreadPool.h"
+
+#include "boost/atomic.hpp"
+#include "boost/thread.hpp"
+
+class BenchThreadPool : Benchmark
+{
+public:
+	//! Construction
+	BenchThreadPool() : Benchmark("BenchThreadPool"), m_pPool(NULL), m_nDone(0)
+	{}
+
+	virtual void RunBenchmark()
+	{
+		ThreadPool pool(4);
+		m_pPool = &pool;
+
+		Measure("invoke_on_thread", 200000, DELEGATE(BenchThreadPool, InvokeOnThread, boost::uint64_t, this));
+		Measure("invoke_on_main", 200000, DELEGATE(BenchThreadPool, InvokeOnMain, boost::uint64_t, this));
+		Measure("thread_to_main", 100000, DELEGATE(BenchThreadPool, ThreadToMain, boost::uint64_t, this));
+
+		m_pPool = NULL;
+	}
+
+	//! Submit to the pool threads and wait for all of them to run
+	void InvokeOnThread(boost::uint64_t a_nOps)
+	{
+		m_nDone = 0;
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+			m_pPool->InvokeOnThread(VOID_DELEGATE(BenchThreadPool, OnInvoke, this));
+		while (m_nDone < a_nOps)
+			boost::this_thread::yield();
+	}
+
+	//! Queue for the main thread, then dispatch them all
+	void InvokeOnMain(boost::uint64_t a_nOps)
+	{
+		m_nDone = 0;
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+			m_pPool->InvokeOnMain(VOID_DELEGATE(BenchThreadPool, OnInvoke, this));
+		m_pPool->ProcessMainThread();
+	}
+
+	//! The usual path of a completed request, a pool thread hands a result back to the main thread
+	void ThreadToMain(boost::uint64_t a_nOps)
+	{
+		m_nDone = 0;
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+			m_pPool->InvokeOnThread(VOID_DELEGATE(BenchThreadPool, OnThread, this));
+		while (m_nDone < a_nOps)
+		{
+			m_pPool->ProcessMainThread();
+			boost::this_thread::yield();
+		}
+	}
+
+	void OnInvoke()
+	{
+		++m_nDone;
+	}
+
+	void OnThread()
+	{
+		m_pPool->InvokeOnMain(VOID_DELEGATE(BenchThreadPool, OnInvoke, this));
+	}
+
+	ThreadPool *				m_pPool;
+	boost::atomic<boost::uint64_t>
+								m_nDone;
+};
+
+BenchThreadPool BENCH_THREAD_POOL;
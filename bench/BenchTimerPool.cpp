@@ -0,0 +1,84 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "testing/Benchmark.h"
+#include "utils/ThreadPool.h"
+#include "utils/TimerPool.h"
+
+#include "boost/atomic.hpp"
+#include "boost/thread.hpp"
+
+class BenchTimerPool : Benchmark
+{
+public:
+	//! Construction
+	BenchTimerPool() : Benchmark("BenchTimerPool"), m_pTimers(NULL), m_nFired(0)
+	{}
+
+	virtual void RunBenchmark()
+	{
+		ThreadPool pool(4);
+		TimerPool timers;
+		m_pTimers = &timers;
+
+		Measure("start_stop", 100000, DELEGATE(BenchTimerPool, StartStop, boost::uint64_t, this));
+
+		// the same with other timers already waiting, as there are in a running application..
+		std::vector<TimerPool::ITimer::SP> pending;
+		for (int i = 0; i < 1000; ++i)
+			pending.push_back(timers.StartTimer(VOID_DELEGATE(BenchTimerPool, OnTimer, this), 3600.0 + i, false, false));
+		Measure("start_stop_1000_pending", 10000, DELEGATE(BenchTimerPool, StartStop, boost::uint64_t, this));
+		timers.StopAllTimers();
+		pending.clear();
+
+		Measure("fire_on_thread", 20000, DELEGATE(BenchTimerPool, Fire, boost::uint64_t, this));
+
+		m_pTimers = NULL;
+	}
+
+	void StartStop(boost::uint64_t a_nOps)
+	{
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			TimerPool::ITimer::SP spTimer = m_pTimers->StartTimer(VOID_DELEGATE(BenchTimerPool, OnTimer, this), 60.0, false, false);
+			m_pTimers->StopTimer(spTimer);
+		}
+	}
+
+	//! Start timers that are already due and wait for all of them to fire
+	void Fire(boost::uint64_t a_nOps)
+	{
+		m_nFired = 0;
+		std::vector<TimerPool::ITimer::SP> timers;
+		timers.reserve((size_t)a_nOps);
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+			timers.push_back(m_pTimers->StartTimer(VOID_DELEGATE(BenchTimerPool, OnTimer, this), 0.0, false, false));
+		while (m_nFired < a_nOps)
+			boost::this_thread::yield();
+	}
+
+	void OnTimer()
+	{
+		++m_nFired;
+	}
+
+	TimerPool *				m_pTimers;
+	boost::atomic<boost::uint64_t>
+							m_nFired;
+};
+
+BenchTimerPool BENCH_TIMER_POOL;
@@ -0,0 +1,105 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "testing/Benchmark.h"
+#include "utils/WebSocketFramer.h"
+#include "utils/WatsonException.h"
+
+class BenchWebSocketFramer : Benchmark
+{
+public:
+	//! Construction
+	BenchWebSocketFramer() : Benchmark("BenchWebSocketFramer"), m_nStreamFrames(0)
+	{}
+
+	virtual void RunBenchmark()
+	{
+		// a small text message and an audio sized binary message..
+		SetPayload(64);
+		Measure("create_masked_64b", 500000, DELEGATE(BenchWebSocketFramer, Create, boost::uint64_t, this), m_Payload.size());
+		Measure("parse_masked_64b", 500000, DELEGATE(BenchWebSocketFramer, Parse, boost::uint64_t, this), m_Payload.size());
+
+		SetPayload(16 * 1024);
+		Measure("create_masked_16k", 20000, DELEGATE(BenchWebSocketFramer, Create, boost::uint64_t, this), m_Payload.size());
+		Measure("parse_masked_16k", 20000, DELEGATE(BenchWebSocketFramer, Parse, boost::uint64_t, this), m_Payload.size());
+
+		// many frames arriving in a single read, each one is parsed from the front of the same buffer..
+		SetPayload(1024);
+		m_nStreamFrames = 64;
+		Measure("parse_stream_64x1k", 2000, DELEGATE(BenchWebSocketFramer, ParseStream, boost::uint64_t, this),
+			m_Payload.size() * m_nStreamFrames);
+	}
+
+	void SetPayload(size_t a_nBytes)
+	{
+		m_Payload.resize(a_nBytes);
+		for (size_t i = 0; i < m_Payload.size(); ++i)
+			m_Payload[i] = (char)(i & 0xff);
+
+		m_Frame.clear();
+		WebSocketFramer::CreateFrame(m_Frame, IWebSocket::BINARY_FRAME, m_Payload, true);
+	}
+
+	void Create(boost::uint64_t a_nOps)
+	{
+		std::string output;
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			output.clear();
+			WebSocketFramer::CreateFrame(output, IWebSocket::BINARY_FRAME, m_Payload, true);
+		}
+	}
+
+	void Parse(boost::uint64_t a_nOps)
+	{
+		std::string input;
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			input = m_Frame;
+			delete ParseFrame(input);
+		}
+	}
+
+	void ParseStream(boost::uint64_t a_nOps)
+	{
+		std::string stream;
+		for (size_t i = 0; i < m_nStreamFrames; ++i)
+			stream += m_Frame;
+
+		std::string input;
+		for (boost::uint64_t i = 0; i < a_nOps; ++i)
+		{
+			input = stream;
+			for (size_t k = 0; k < m_nStreamFrames; ++k)
+				delete ParseFrame(input);
+		}
+	}
+
+	IWebSocket::Frame * ParseFrame(std::string & a_Input)
+	{
+		IWebSocket::Frame * pFrame = WebSocketFramer::ParseFrame(a_Input);
+		if (pFrame == NULL || pFrame->m_Data.size() != m_Payload.size())
+			throw WatsonException("Failed to parse frame.");
+		return pFrame;
+	}
+
+	std::string		m_Payload;
+	std::string		m_Frame;
+	size_t			m_nStreamFrames;
+};
+
+BenchWebSocketFramer BENCH_WEB_SOCKET_FRAMER;
@@ -50,12 +50,13 @@ bool Alchemy::Start()
 	if (!IService::Start())
 		return false;
 
-	if (!StringUtil::EndsWith(m_pConfig->m_URL, "calls"))
+	ServiceConfig::SP spConfig = GetConfig();
+	if (!StringUtil::EndsWith(spConfig->m_URL, "calls"))
 	{
 		Log::Error("Alchemy", "Configured URL not ended with calls");
 		return false;
 	}
-	if (m_pConfig->m_User.size() == 0)
+	if (spConfig->m_User.size() == 0)
 		Log::Warning("Alchemy", "API-Key expected in user field.");
 
 	return true;
@@ -63,7 +64,7 @@ bool Alchemy::Start()
 
 void Alchemy::GetServiceStatus( ServiceStatusCallback a_Callback )
 {
-	if (m_pConfig != NULL)
+	if (HasConfig())
 		new ServiceStatusChecker(this, a_Callback);
 	else
 		a_Callback(ServiceStatus(m_ServiceId, false));
@@ -92,7 +93,7 @@ void Alchemy::GetChunkTags(const std::string & a_Text,
 	Delegate<const Json::Value &> a_Callback )
 {
 	std::string parameters = "/text/TextGetChunkTags";
-	parameters += "?apikey=" + m_pConfig->m_User;
+	parameters += "?apikey=" + GetConfig()->m_User;
 	parameters += "&outputMode=json";
 	parameters += "&text=" + StringUtil::UrlEscape( a_Text );
 
@@ -104,7 +105,7 @@ void Alchemy::GetPosTags(const std::string & a_Text,
 	Delegate<const Json::Value &> a_Callback )
 {
 	std::string parameters = "/text/TextGetPOSTags";
-	parameters += "?apikey=" + m_pConfig->m_User;
+	parameters += "?apikey=" + GetConfig()->m_User;
 	parameters += "&outputMode=json";
 	parameters += "&text=" + StringUtil::UrlEscape( a_Text );
 
@@ -115,7 +116,7 @@ void Alchemy::GetPosTags(const std::string & a_Text,
 void Alchemy::GetEntities(const std::string & a_Text, Delegate<const Json::Value &> a_Callback)
 {
 	std::string parameters = "/text/TextGetRankedNamedEntities";
-	parameters += "?apikey=" + m_pConfig->m_User;
+	parameters += "?apikey=" + GetConfig()->m_User;
 	parameters += "&outputMode=json";
 	parameters += "&text=" + StringUtil::UrlEscape( a_Text );
 
@@ -133,7 +134,7 @@ void Alchemy::GetNews(const std::string & a_Subject, time_t a_StartDate, time_t
 	searchCriteria = searchCriteria.substr(0, searchCriteria.size() - 1);
 
 	std::string parameters = "/data/GetNews";
-	parameters += "?apikey=" + m_pConfig->m_User;
+	parameters += "?apikey=" + GetConfig()->m_User;
 	parameters += "&return=" + searchCriteria;
 	parameters += "&start=" + StringUtil::Format("%u", a_StartDate);
 	parameters += "&end=" + StringUtil::Format("%u", a_EndDate);
@@ -16,6 +16,7 @@
 */
 
 #include "Conversation.h"
+#include "utils/Cbor.h"
 #include "utils/JsonHelpers.h"
 
 REG_SERIALIZABLE( Conversation );
@@ -48,7 +49,7 @@ bool Conversation::Start()
     if (! IService::Start() )
         return false;
 
-    if (! StringUtil::EndsWith( m_pConfig->m_URL, "conversation/api" ) )
+    if (! StringUtil::EndsWith( GetConfig()->m_URL, "conversation/api" ) )
     {
         Log::Error( "Conversation", "Configured URL not ended with conversation/api" );
         return false;
@@ -101,7 +102,7 @@ Conversation::MessageReq::MessageReq(Conversation * a_pConversation,
 	if (a_bUseCache && m_pConversation->GetCachedResponse(a_WorkspaceId, m_InputHash, response))
 	{
 		Json::Value items;
-		if (Json::Reader(Json::Features::strictMode()).parse(response, items) && items.size() > 0)
+		if (Cbor::ParseData(response, items) && items.size() > 0)
 		{
 			ConversationResponse * pResponse = ISerializable::DeserializeObject<ConversationResponse>( items[rand() % items.size()]["response"] );
 			if ( pResponse != NULL )
@@ -157,7 +158,7 @@ void Conversation::MessageReq::OnResponse(ConversationResponse * a_pResponse)
 			DataCache::CacheItem * pItem = pCache->Find(m_InputHash);
 			if (pItem != NULL)
 			{
-				if (!Json::Reader(Json::Features::strictMode()).parse(pItem->m_Data, items))
+				if (!Cbor::ParseData(pItem->m_Data, items))
 					Log::Warning("Dialog", "Failed to parse dialog cache item %8.8x.", m_InputHash.c_str() );
 
 				// check for an existing match, if found then don't push it..
@@ -195,7 +196,7 @@ void Conversation::MessageReq::OnResponse(ConversationResponse * a_pResponse)
 				items.append( newItem );
 			}
 
-			pCache->Save(m_InputHash, items.toStyledString());
+			pCache->Save(m_InputHash, Cbor::Write(items));
 		}
 	}
 
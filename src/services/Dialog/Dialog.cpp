@@ -18,6 +18,7 @@
 #include <fstream>
 
 #include "Dialog.h"
+#include "utils/Cbor.h"
 #include "utils/Form.h"
 #include "utils/Path.h"
 
@@ -51,7 +52,7 @@ bool Dialog::Start()
 	if (! IService::Start() )
 		return false;
 
-	if (! StringUtil::EndsWith( m_pConfig->m_URL, "dialog/api" ) )
+	if (! StringUtil::EndsWith( GetConfig()->m_URL, "dialog/api" ) )
 	{
 		Log::Error( "Dialog", "Configured URL not ended with dialog/api" );
 		return false;
@@ -62,7 +63,7 @@ bool Dialog::Start()
 
 void Dialog::GetServiceStatus( ServiceStatusCallback a_Callback )
 {
-	if (m_pConfig != NULL)
+	if (HasConfig())
 		new ServiceStatusChecker(this, a_Callback);
 	else
 		a_Callback(ServiceStatus(m_ServiceId, false));
@@ -174,7 +175,7 @@ Dialog::ConverseReq::ConverseReq(Dialog * a_pDialog,
 	if (m_bUseCache && m_pDialog->GetCachedResponse(m_DialogId, m_InputHash, response))
 	{
 		Json::Value items;
-		if (Json::Reader(Json::Features::strictMode()).parse(response, items) && items.size() > 0)
+		if (Cbor::ParseData(response, items) && items.size() > 0)
 		{
 			// pick a random result and provide that via the callback..
 			m_Callback(items[rand() % items.size()]);
@@ -223,7 +224,7 @@ void Dialog::ConverseReq::OnResponse(const Json::Value & a_Response)
 			DataCache::CacheItem * pItem = pCache->Find(m_InputHash);
 			if (pItem != NULL)
 			{
-				if (!Json::Reader(Json::Features::strictMode()).parse(pItem->m_Data, items))
+				if (!Cbor::ParseData(pItem->m_Data, items))
 					Log::Warning("Dialog", "Failed to parse dialog cache item %8.8x.", m_InputHash);
 
 				// check for an existing match, if found then don't push it..
@@ -259,7 +260,7 @@ void Dialog::ConverseReq::OnResponse(const Json::Value & a_Response)
 				items[items.size() - 1]["timestamp"] = now.GetEpochTime();
 			}
 
-			pCache->Save(m_InputHash, items.toStyledString());
+			pCache->Save(m_InputHash, Cbor::Write(items));
 		}
 	}
 
@@ -65,7 +65,7 @@ bool Graph::Start()
 	if ( pTimers != NULL )
 		m_spLogStatus = pTimers->StartTimer( VOID_DELEGATE( Graph, OnLogStatus, this ), LOG_STATUS_INTERVAL, true, true );
 
-	Log::Debug("Graph", "Graph service running: %s", m_pConfig->m_URL.c_str() );
+	Log::Debug("Graph", "Graph service running: %s", GetConfig()->m_URL.c_str() );
 	return true;
 }
 
@@ -472,6 +472,7 @@ void Graph::OnSessionToken( const Json::Value & a_Result )
 	{
 		Log::Status( "Graph", "Gremlin Session Token: %s", a_Result["gds-token"].asCString() );
 		m_Headers["Authorization"] = std::string("gds-token " ) + a_Result["gds-token"].asString();
+		UpdateTemplate();
 
 		GetGraphs( DELEGATE( Graph, OnGraphs, const Json::Value &, this ) );
 	}
@@ -15,11 +15,15 @@
 *
 */
 
+#include <ctype.h>
+
 #include "IService.h"
 #include "base64/encode.h"
 #include "utils/Config.h"
+#include "utils/Metrics.h"
 #include "utils/StringUtil.h"
 #include "utils/Time.h"
+#include "utils/TrafficCapture.h"
 #include "utils/WebClientService.h"
 
 #undef MAX
@@ -43,9 +47,14 @@ IService::Request::Request(const std::string & a_URL,
 	m_Callback(a_Callback),
 	m_CreateTime(Time().GetEpochTime()),
 	m_StartTime(0.0),
+	m_ConnectTime(0.0),
+	m_HeaderTime(0.0),
 	m_bDelete(false),
-	m_pCachedReq(NULL)
+	m_pCachedReq(NULL),
+	m_RequestType(a_RequestType)
 {
+	m_MetricEndPoint = "/" + m_spClient->GetURL().GetEndPoint();
+
 	m_spClient->SetURL( a_URL );
 	m_spClient->SetRequestType( a_RequestType );
 	m_spClient->SetStateReceiver( DELEGATE( Request, OnState, IWebClient *, this ) );
@@ -53,22 +62,18 @@ IService::Request::Request(const std::string & a_URL,
 	m_spClient->SetHeaders( a_Headers );
 	m_spClient->SetBody( a_Body );
 
+	m_TraceParent = Trace::GetContext();
+	m_TraceSpan = Trace::NewSpan( m_TraceParent );
+
 	//Log::Debug( "Request", "Sending request '%s'", a_URL.c_str() );
-	if (! m_spClient->Send() )
+	if (! SendRequest() )
 	{
 		m_Error = true;
 		Log::Error("Request", "Failed to send web request.");
 		ThreadPool::Instance()->InvokeOnMain(VOID_DELEGATE(Request, OnLocalResponse, this));
 	}
-	else if ( TimerPool::Instance() != NULL )
-	{
-		m_spTimeoutTimer = TimerPool::Instance()->StartTimer( 
-			VOID_DELEGATE( Request, OnTimeout, this ), a_fTimeout, true, false );
-	}
 	else
-	{
-		Log::Warning( "IService", "No TimerPool instance, timeouts are disabled." );
-	}
+		OnSent( a_fTimeout );
 }
 
 IService::Request::Request( IService * a_pService,
@@ -86,10 +91,16 @@ IService::Request::Request( IService * a_pService,
 	m_Callback( a_Callback ),
 	m_CreateTime( Time().GetEpochTime() ),
 	m_StartTime( 0.0 ),
+	m_ConnectTime( 0.0 ),
+	m_HeaderTime( 0.0 ),
 	m_bDelete(false),
-	m_pCachedReq(a_CacheReq)
+	m_pCachedReq(a_CacheReq),
+	m_RequestType(a_RequestType),
+	m_MetricEndPoint(a_EndPoint)
 {
 	m_pService->m_RequestsPending += 1;
+	m_TraceParent = Trace::GetContext();
+	m_TraceSpan = Trace::NewSpan( m_TraceParent );
 
 	// firstly, check for a cached response, invoke the callback immediately if one is found.
 	if (m_pCachedReq != NULL && m_pService->GetCachedResponse(m_pCachedReq->m_CacheName, m_pCachedReq->m_Id, m_Response))
@@ -106,8 +117,17 @@ IService::Request::Request( IService * a_pService,
 	m_spClient->SetRequestType( a_RequestType );
 	m_spClient->SetStateReceiver( DELEGATE( Request, OnState, IWebClient *, this ) );
 	m_spClient->SetDataReceiver( DELEGATE( Request, OnResponseData, IWebClient::RequestData *, this ) );
-	m_spClient->SetHeaders( a_pService->GetHeaders() );
-	m_spClient->SetHeaders( a_Headers, true );
+
+	// the default headers of the service are already serialized, the client only adds ours..
+	IWebClient::RequestTemplate::SP spTemplate = a_pService->GetTemplate();
+	m_spClient->SetTemplate( spTemplate );
+	if ( spTemplate )
+		m_spClient->SetHeaders( a_Headers );
+	else
+	{
+		m_spClient->SetHeaders( a_pService->GetHeaders() );
+		m_spClient->SetHeaders( a_Headers, true );
+	}
 	m_spClient->SetBody( a_Body );
 
 	// if our connection is already connected, then go ahead and set the start time to now..
@@ -115,22 +135,24 @@ IService::Request::Request( IService * a_pService,
 		m_StartTime = Time().GetEpochTime();
 
 	//Log::Debug( "Request", "Sending request '%s'", a_pService->GetConfig()->m_URL + a_EndPoint.c_str() );
-	if (! m_spClient->Send() )
+	if (! SendRequest() )
 	{
 		m_Error = true;
 		Log::Error( "Request", "Failed to send web request." );
 		ThreadPool::Instance()->InvokeOnMain(VOID_DELEGATE(Request, OnLocalResponse, this));
 	}
-	else if ( TimerPool::Instance() != NULL )
-	{
-		float fTimeout = MAX(a_fTimeout, m_pService->m_RequestTimeout);
-		m_spTimeoutTimer = TimerPool::Instance()->StartTimer( 
-			VOID_DELEGATE( Request, OnTimeout, this ), fTimeout, true, false );
-	}
 	else
-	{
-		Log::Warning( "IService", "No TimerPool instance, timeouts are disabled." );
-	}
+		OnSent( MAX(a_fTimeout, m_pService->m_RequestTimeout) );
+}
+
+void IService::Request::Cancel()
+{
+	// a cached response or failed send has already been queued..
+	if ( m_Complete || !m_spClient || m_Error )
+		return;
+
+	Log::DebugMed( "Request", "REST request %s canceled.", m_spClient->GetURL().GetURL().c_str() );
+	Abort( "canceled" );
 }
 
 void IService::Request::OnState( IWebClient * a_pClient )
@@ -139,9 +161,15 @@ void IService::Request::OnState( IWebClient * a_pClient )
 	{
 		m_StartTime = Time().GetEpochTime();
 	}
+	else if ( a_pClient->GetState() == IWebClient::CONNECTED )
+	{
+		m_ConnectTime = Time().GetEpochTime();
+	}
 	else if ( a_pClient->GetState() == IWebClient::DISCONNECTED )
 	{
 		Log::Error( "Request", "Request failed to connect." );
+		if ( !m_Complete )
+			RecordComplete( "error" );
 		m_Error = true;
 		m_bDelete = true;
 		if ( m_Callback.IsValid() )
@@ -167,10 +195,12 @@ void IService::Request::OnResponseData( IWebClient::RequestData * a_pResponse )
 		m_Error = a_pResponse->m_StatusCode < 200 || a_pResponse->m_StatusCode >= 300;
 		m_SetCookies = a_pResponse->m_SetCookies;
 		m_RespHeaders = a_pResponse->m_Headers;
+		m_HeaderTime = a_pResponse->m_HeaderTime;
 
 		double end = Time().GetEpochTime();
 		Log::DebugMed( "Request", "REST request %s completed in %g seconds. Queued for %g seconds. Status: %d.", 
 			m_spClient->GetURL().GetURL().c_str(), end - m_StartTime, m_StartTime - m_CreateTime, a_pResponse->m_StatusCode );
+		RecordComplete( StringUtil::Format( "%u", a_pResponse->m_StatusCode ) );
 
 		if (m_pCachedReq != NULL && m_pService != NULL && !m_Error)
 		{
@@ -185,28 +215,16 @@ void IService::Request::OnResponseData( IWebClient::RequestData * a_pResponse )
 
 		if ( m_Error )
 		{
-			Log::Error( "Request", "Request Error %u: %s, URL: %s", 
-				a_pResponse->m_StatusCode, m_Response.c_str(), m_spClient->GetURL().GetURL().c_str() );
+			Log::Write( LogEntry( LL_ERROR, "Request", "Request Error" )
+				.Add( "status", (int)a_pResponse->m_StatusCode )
+				.Add( "url", m_spClient->GetURL().GetURL() )
+				.AddBody( "response", m_Response ) );
 		}
 
 		if ( m_Callback.IsValid() )
 		{
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-			double startTime = Time().GetEpochTime();
-#endif
+			Profiler::Scope profile( m_Callback.GetFile(), m_Callback.GetLine() );
 			m_Callback(this);
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-			double elapsed = Time().GetEpochTime() - startTime;
-			if(elapsed > WARNING_DELEGATE_TIME)
-			{
-				if ( elapsed > ERROR_DELEGATE_TIME )
-					Log::Error("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-						m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-				else
-					Log::Warning("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-						m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-			}
-#endif
 			m_Callback.Reset();
 			if ( m_pService != NULL )
 				m_pService->m_RequestsPending -= 1;
@@ -218,25 +236,12 @@ void IService::Request::OnResponseData( IWebClient::RequestData * a_pResponse )
 
 void IService::Request::OnLocalResponse()
 {
+	RecordComplete( m_Error ? "error" : "cached" );
 	m_Complete = true;
 	if (m_Callback.IsValid())
 	{
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-		double startTime = Time().GetEpochTime();
-#endif
+		Profiler::Scope profile( m_Callback.GetFile(), m_Callback.GetLine() );
 		m_Callback(this);
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-		double elapsed = Time().GetEpochTime() - startTime;
-		if(elapsed > WARNING_DELEGATE_TIME)
-		{
-			if ( elapsed > ERROR_DELEGATE_TIME )
-				Log::Error("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-					m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-			else
-				Log::Warning("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-					m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-		}
-#endif
 		m_Callback.Reset();
 
 		if ( m_pService != NULL )
@@ -250,27 +255,174 @@ void IService::Request::OnTimeout()
 	Log::Error( "Request", "REST request %s timed out.", m_spClient->GetURL().GetURL().c_str() );
 
 	sm_Timeouts += 1;
+	Abort( "timeout" );
+}
+
+void IService::Request::OnSent( float a_fTimeout )
+{
+	if ( TimerPool::Instance() != NULL )
+	{
+		m_spTimeoutTimer = TimerPool::Instance()->StartTimer( 
+			VOID_DELEGATE( Request, OnTimeout, this ), a_fTimeout, true, false );
+	}
+	else
+	{
+		Log::Warning( "IService", "No TimerPool instance, timeouts are disabled." );
+	}
+
+	FutureState * pFuture = FutureState::GetCurrent();
+	if ( pFuture != NULL )
+	{
+		m_spCanceler.reset( new Canceler( this ) );
+		pFuture->AddCanceler( VOID_DELEGATE( Canceler, OnCancel, m_spCanceler ), FutureState::MAIN_THREAD );
+	}
+}
+
+void IService::Request::Abort( const std::string & a_Status )
+{
+	RecordComplete( a_Status );
 	m_Complete = true;
 	m_Error = true;
 	m_spTimeoutTimer.reset();
+	m_spCanceler.reset();
 
-	// closing will call OnState() which will actually take care of deleteing this object.
-	if ( m_spClient->Close() )
+	// the client may never report CLOSED if it wasn't connected yet or was already closing, so detach from it
+	// and delete ourselves once the main thread gets back to its queue.
+	m_spClient->Close();
+	m_spClient->ClearDelegates();
+	if (m_Callback.IsValid())
 	{
-		if (m_Callback.IsValid())
-		{
-			m_Callback(this);
-			m_Callback.Reset();
+		m_Callback(this);
+		m_Callback.Reset();
 
-			if ( m_pService != NULL )
-				m_pService->m_RequestsPending -= 1;
-		}
+		if ( m_pService != NULL )
+			m_pService->m_RequestsPending -= 1;
+	}
+	ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE( Request, OnAborted, this ) );
+}
+
+void IService::Request::OnAborted()
+{
+	delete this;
+}
+
+bool IService::Request::SendRequest()
+{
+	// send in the span of this request, so the web client records its phases as children of that span
+	Trace::Scope scope( m_TraceSpan );
+	return m_spClient->Send();
+}
+
+void IService::Request::RecordComplete(const std::string & a_Status)
+{
+	// requests made without a service share one set of series, never deleted since requests may complete during shutdown
+	static RequestMetrics * pNoService = new RequestMetrics();
+
+	const RequestSeries & series = m_pService != NULL ?
+		m_pService->m_RequestMetrics.GetSeries( m_pService->GetServiceId(), m_MetricEndPoint, m_RequestType, a_Status ) :
+		pNoService->GetSeries( "none", m_MetricEndPoint, m_RequestType, a_Status );
+	series.m_pRequests->Increment();
+
+	double end = Time().GetEpochTime();
+	if ( m_TraceSpan.IsValid() )
+		Trace::AddSpan( "request", "IService", m_CreateTime, Trace::Now(), m_TraceParent, m_TraceSpan, series.m_Label );
+	series.m_pRequestTime->Record( end - m_CreateTime );
+	if ( m_StartTime > 0.0 )
+		series.m_pQueueTime->Record( m_StartTime - m_CreateTime );
+	if ( m_StartTime > 0.0 && m_ConnectTime > 0.0 )
+		series.m_pConnectTime->Record( m_ConnectTime - m_StartTime );
+	if ( m_StartTime > 0.0 && m_HeaderTime > 0.0 )
+		series.m_pFirstByteTime->Record( m_HeaderTime - MAX( m_StartTime, m_ConnectTime ) );
+
+	if ( TrafficCapture::IsCapturing( TrafficCapture::SOURCE_SERVICE ) && m_spClient && a_Status != "cached" )
+	{
+		TrafficCapture::Record record;
+		record.m_eSource = TrafficCapture::SOURCE_SERVICE;
+		record.m_fTime = m_CreateTime;
+		record.m_fDuration = end - m_CreateTime;
+		record.m_nStatusCode = (unsigned int)atoi( a_Status.c_str() );		// 0 for an error or timeout
+		record.m_ServiceId = m_pService != NULL ? m_pService->GetServiceId() : std::string();
+		record.m_RequestType = m_RequestType;
+		record.m_URL = m_spClient->GetURL().GetURL();
+		record.m_RequestHeaders = m_spClient->GetRequestHeaders();
+		record.m_RequestBody = m_Body;
+		record.m_ResponseHeaders = m_RespHeaders;
+		record.m_ResponseBody = m_Response;
+		TrafficCapture::Capture( record );
+	}
+}
+
+const IService::RequestSeries & IService::RequestMetrics::GetSeries( const std::string & a_ServiceId,
+	const std::string & a_EndPoint, const std::string & a_Method, const std::string & a_Status )
+{
+	std::string endPoint( NormalizeEndPoint( a_EndPoint ) );
+	std::string key( a_Method + " " + endPoint + " " + a_Status );
+
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	SeriesMap::iterator iSeries = m_Series.find( key );
+	if ( iSeries != m_Series.end() )
+		return iSeries->second;
+
+	if ( m_EndPoints.find( endPoint ) == m_EndPoints.end() )
+	{
+		if ( m_EndPoints.size() < MAX_END_POINTS )
+			m_EndPoints.insert( endPoint );
+		else
+			endPoint = "other";
+	}
+
+	Metrics::Tags tags;
+	tags["service"] = a_ServiceId;
+	tags["endpoint"] = endPoint;
+	tags["method"] = a_Method;
+	tags["status"] = a_Status;
+
+	Metrics * pMetrics = Metrics::Instance();
+	RequestSeries & series = m_Series[ key ];
+	series.m_Label = a_ServiceId + " " + a_Method + " " + endPoint + " " + a_Status;
+	series.m_pRequests = pMetrics->GetCounter( "wdc_service_requests_total", tags );
+	series.m_pRequestTime = pMetrics->GetHistogram( "wdc_service_request_seconds", tags );
+	series.m_pQueueTime = pMetrics->GetHistogram( "wdc_service_queue_seconds", tags );
+	series.m_pConnectTime = pMetrics->GetHistogram( "wdc_service_connect_seconds", tags );
+	series.m_pFirstByteTime = pMetrics->GetHistogram( "wdc_service_ttfb_seconds", tags );
+	return series;
+}
+
+std::string IService::RequestMetrics::NormalizeEndPoint( const std::string & a_EndPoint )
+{
+	size_t nEnd = a_EndPoint.find( '?' );
+	if ( nEnd == std::string::npos )
+		nEnd = a_EndPoint.size();
+
+	std::string endPoint;
+	endPoint.reserve( nEnd );
+	for( size_t nStart = 0; nStart < nEnd; )
+	{
+		size_t nSlash = a_EndPoint.find( '/', nStart );
+		if ( nSlash == std::string::npos || nSlash > nEnd )
+			nSlash = nEnd;
+
+		bool bDigit = false;
+		for( size_t i = nStart; i < nSlash && !bDigit; ++i )
+			bDigit = isdigit( (unsigned char)a_EndPoint[i] ) != 0;
+		bool bVersion = bDigit && a_EndPoint[nStart] == 'v';
+		for( size_t i = nStart + 1; i < nSlash && bVersion; ++i )
+			bVersion = isdigit( (unsigned char)a_EndPoint[i] ) != 0;
+
+		if ( bDigit && !bVersion )
+			endPoint += ":id";
+		else
+			endPoint.append( a_EndPoint, nStart, nSlash - nStart );
+		if ( nSlash < nEnd )
+			endPoint += '/';
+		nStart = nSlash + 1;
 	}
+
+	return endPoint;
 }
 
 IService::IService(const std::string & a_ServiceId) : 
 	m_ServiceId(a_ServiceId), 
-	m_pConfig(NULL),
 	m_bCacheEnabled(true),
 	m_MaxCacheSize( 5 * 1024 * 1024 ),
 	m_MaxCacheAge( 7 * 24 ),
@@ -287,13 +439,14 @@ bool IService::Start()
 		return false;
 	}
 
-	m_pConfig = pConfig->FindServiceConfig( m_ServiceId );
-	if ( m_pConfig == NULL )
+	ServiceConfig::SP spConfig = pConfig->FindServiceConfig( m_ServiceId );
+	if (! spConfig )
 	{
 		Log::Error( "IService", "No credentials found for service %s.", m_ServiceId.c_str() );
 		return false;
 	}
 
+	boost::atomic_store( &m_spConfig, spConfig );
 	AddAuthenticationHeader();
 	return true;
 }
@@ -343,29 +496,56 @@ void IService::GetServiceStatus(ServiceStatusCallback a_Callback)
 		a_Callback(ServiceStatus(m_ServiceId, true));
 }
 
+ServiceConfig::SP IService::GetConfig() const
+{
+	ServiceConfig::SP spConfig = boost::atomic_load( &m_spConfig );
+	if (! spConfig )
+		throw WatsonException( "Service config is NULL, make sure you invoke Start()." );
+	return spConfig;
+}
+
+bool IService::IsConfigured( AuthType a_AuthType /*= AUTH_BASIC*/ ) const
+{
+	ServiceConfig::SP spConfig = boost::atomic_load( &m_spConfig );
+	return spConfig && spConfig->IsConfigured( a_AuthType );
+}
+
 void IService::OnConfigModified()
 {
-	// update our authorization header on config changes.
-	ServiceConfig * pConfig = Config::Instance()->FindServiceConfig( m_ServiceId );
-	if ( pConfig != NULL )
+	// update our authorization header on config changes, a removed config leaves the last one in place.
+	Config * pConfig = Config::Instance();
+	if ( pConfig == NULL )
+		return;
+	ServiceConfig::SP spConfig = pConfig->FindServiceConfig( m_ServiceId );
+	if ( spConfig )
 	{
-		m_pConfig = pConfig;
+		boost::atomic_store( &m_spConfig, spConfig );
 		AddAuthenticationHeader();
 	}
 }
 
 void IService::AddAuthenticationHeader()
 {
-	if ( m_pConfig != NULL &&
-		m_pConfig->m_User.size() > 0 && 
-		m_pConfig->m_Password.size() > 0 )
+	ServiceConfig::SP spConfig = boost::atomic_load( &m_spConfig );
+	if ( spConfig &&
+		spConfig->m_User.size() > 0 && 
+		spConfig->m_Password.size() > 0 )
 	{
 		// add the Authorization header..
-		std::string encoded( StringUtil::EncodeBase64( m_pConfig->m_User + ":" + m_pConfig->m_Password) );
+		std::string encoded( StringUtil::EncodeBase64( spConfig->m_User + ":" + spConfig->m_Password) );
 		StringUtil::Replace( encoded, "\n", "" );		// remove any newlines otherwise they will mess up the headers
 
 		m_Headers["Authorization"] = StringUtil::Format( "Basic %s", encoded.c_str() );
 	}
+	UpdateTemplate();
+}
+
+void IService::UpdateTemplate()
+{
+	// the Host header comes from the URL of the config, until we're started there's no template..
+	ServiceConfig::SP spConfig = boost::atomic_load( &m_spConfig );
+	if ( spConfig )
+		boost::atomic_store( &m_spTemplate, IWebClient::CreateTemplate( m_Headers, URL( spConfig->m_URL ).GetHost() ) );
 }
 
 DataCache * IService::GetDataCache(const std::string & a_Type)
@@ -21,23 +21,27 @@
 #include "boost/enable_shared_from_this.hpp"
 #include "boost/shared_ptr.hpp"
 #include "boost/atomic.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/unordered_map.hpp"
+#include "boost/unordered_set.hpp"
 #include "tinyxml/tinyxml.h"
 
 #include "utils/DataCache.h"
 #include "utils/ISerializable.h"
+#include "utils/JsonFields.h"
+#include "utils/JsonParser.h"
 #include "utils/Delegate.h"
+#include "utils/Metrics.h"
+#include "utils/Future.h"
 #include "utils/ThreadPool.h"
 #include "utils/TimerPool.h"
 #include "utils/ServiceConfig.h"
 #include "utils/WatsonException.h"
 #include "utils/IWebClient.h"
+#include "utils/Trace.h"
+#include "utils/Profiler.h"
 #include "WDCLib.h"			// include last always
 
-#if ENABLE_DELEGATE_DEBUG
-#define WARNING_DELEGATE_TIME (0.1)
-#define ERROR_DELEGATE_TIME	(0.5)
-#endif
-
 //! This is the base class for a remote service.
 class WDC_API IService : public ISerializable, public boost::enable_shared_from_this<IService>
 {
@@ -135,13 +139,44 @@ public:
 			return m_Response;
 		}
 
+		//! Close the request, the callback is invoked as an error. This must be called on the main thread.
+		void Cancel();
+
 	protected:
+		//! Types
+		//! Cancels the request when the FutureState it was made for is canceled, it's destroyed
+		//! with the request so a late cancel does nothing.
+		struct Canceler
+		{
+			Canceler( Request * a_pRequest ) : m_pRequest( a_pRequest )
+			{}
+			void OnCancel()
+			{
+				m_pRequest->Cancel();
+			}
+
+			Request *		m_pRequest;
+		};
+
 		//! HTTP callbacks
 		void OnState( IWebClient * a_pClient );
 		void OnResponseData( IWebClient::RequestData * a_pResponse );
 		void OnLocalResponse();
 		void OnTimeout();
 
+		//! Start the timeout & link to the current FutureState once the request is sent.
+		void OnSent( float a_fTimeout );
+		//! Close the connection & invoke the callback as an error, a_Status is recorded in the metrics.
+		//! This request is deleted by OnAborted() on the main thread.
+		void Abort( const std::string & a_Status );
+		void OnAborted();
+
+		//! Send the request in the trace span of this request.
+		bool SendRequest();
+		//! Record the timings of this request into the metrics registry, the trace and the traffic capture,
+		//! a_Status is the HTTP status code or the reason the request failed.
+		void RecordComplete(const std::string & a_Status);
+
 		//! Data
 		IService *			m_pService;
 		IWebClient::SP		m_spClient;
@@ -156,10 +191,18 @@ public:
 
 		TimerPool::ITimer::SP
 							m_spTimeoutTimer;
+		boost::shared_ptr<Canceler>
+							m_spCanceler;
 		bool				m_bDelete;
 
 		double				m_CreateTime;
 		double				m_StartTime;
+		double				m_ConnectTime;		// time the connection was established, 0 if an open connection was used
+		double				m_HeaderTime;		// time the response headers were received
+		std::string			m_RequestType;
+		std::string			m_MetricEndPoint;	// end-point without the query string, used to tag metrics
+		Trace::Context		m_TraceParent;		// trace of the thread that made this request
+		Trace::Context		m_TraceSpan;		// span covering this request, the parent of the web client spans
 	};
 
 	//! This class can be used when the expected response will be JSON..
@@ -196,31 +239,19 @@ public:
 			Json::Value root;
 			if (! a_pRequest->IsError() )
 			{
-				if (!Json::Reader(Json::Features::strictMode()).parse(m_Response, root))
+				TraceSpan span( "parse", "IService" );
+				if (!JsonParser::ParseJson(m_Response, root))
 				{
-					Log::Error("RequestJson", "Failed to parse JSON response: %s", m_Response.c_str());
+					Log::Write( LogEntry( LL_ERROR, "RequestJson", "Failed to parse JSON response" ).AddBody( "response", m_Response ) );
 					root.clear();
 				}
 			}
 
 			if (m_Callback.IsValid())
 			{
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-				double startTime = Time().GetEpochTime();
-#endif
+				TraceSpan span( "callback", "IService" );
+				Profiler::Scope profile( m_Callback.GetFile(), m_Callback.GetLine() );
 				m_Callback(root);
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-				double elapsed = Time().GetEpochTime() - startTime;
-				if(elapsed > WARNING_DELEGATE_TIME)
-				{
-					if ( elapsed > ERROR_DELEGATE_TIME )
-						Log::Error("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-							m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-					else
-						Log::Warning("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-							m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-				}
-#endif
 				m_Callback.Reset();
 			}
 		}
@@ -261,30 +292,18 @@ public:
 			TiXmlDocument xml;
 			if (! a_pRequest->IsError() && m_Response.size() > 0 )
 			{
+				TraceSpan span( "parse", "IService" );
 				xml.Parse( m_Response.c_str() );
 
 				if ( xml.Error() )
-					Log::Error("RequestXml", "Failed to parse XML response: %s", m_Response.c_str());
+					Log::Write( LogEntry( LL_ERROR, "RequestXml", "Failed to parse XML response" ).AddBody( "response", m_Response ) );
 			}
 
 			if (m_Callback.IsValid())
 			{
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-				double startTime = Time().GetEpochTime();
-#endif
+				TraceSpan span( "callback", "IService" );
+				Profiler::Scope profile( m_Callback.GetFile(), m_Callback.GetLine() );
 				m_Callback(xml);
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-				double elapsed = Time().GetEpochTime() - startTime;
-				if(elapsed > WARNING_DELEGATE_TIME)
-				{
-					if ( elapsed > ERROR_DELEGATE_TIME )
-						Log::Error("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-							m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-					else
-						Log::Warning("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-							m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-				}
-#endif
 				m_Callback.Reset();
 			}
 		}
@@ -327,22 +346,9 @@ public:
 
 			if (m_Callback.IsValid())
 			{
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-				double startTime = Time().GetEpochTime();
-#endif
+				TraceSpan span( "callback", "IService" );
+				Profiler::Scope profile( m_Callback.GetFile(), m_Callback.GetLine() );
 				m_Callback(m_Response);
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-				double elapsed = Time().GetEpochTime() - startTime;
-				if(elapsed > WARNING_DELEGATE_TIME)
-				{
-					if ( elapsed > ERROR_DELEGATE_TIME )
-						Log::Error("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-							m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-					else
-						Log::Warning("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-							m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-				}
-#endif
 				m_Callback.Reset();
 			}
 		}
@@ -385,10 +391,11 @@ public:
 			T * pObject = NULL;
 			if (! a_pRequest->IsError() )
 			{
+				TraceSpan span( "parse", "IService" );
 				pObject = new T();
-				if ( ISerializable::DeserializeObject( m_Response, pObject) == NULL )
+				if (! JsonDeserializer<T>::Deserialize( m_Response, *pObject ) )
 				{
-					Log::Error( "RequestObj", "Failed to deserialize object: %s", m_Response.c_str() );
+					Log::Write( LogEntry( LL_ERROR, "RequestObj", "Failed to deserialize object" ).AddBody( "response", m_Response ) );
 					delete pObject;
 					pObject = NULL;
 				}
@@ -396,22 +403,9 @@ public:
 
 			if (m_Callback.IsValid())
 			{
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-				double startTime = Time().GetEpochTime();
-#endif
+				TraceSpan span( "callback", "IService" );
+				Profiler::Scope profile( m_Callback.GetFile(), m_Callback.GetLine() );
 				m_Callback(pObject);
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-				double elapsed = Time().GetEpochTime() - startTime;
-				if(elapsed > WARNING_DELEGATE_TIME)
-				{
-					if ( elapsed > ERROR_DELEGATE_TIME )
-						Log::Error("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-							m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-					else
-						Log::Warning("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-							m_Callback.GetFile(), m_Callback.GetLine(), elapsed );
-				}
-#endif
 				m_Callback.Reset();
 			}
 		}
@@ -446,18 +440,16 @@ public:
 	{
 		return m_ServiceId;
 	}
-	const ServiceConfig * GetConfig() const
+	//! Returns the config this service was started with, or the one swapped in by OnConfigModified(). This
+	//! may be called from any thread, hold on to the returned pointer to read several fields from the same config.
+	//! A service that isn't in the Config must be started again to pick up a change.
+	ServiceConfig::SP GetConfig() const;
+	//! Returns true once this service has been started with a config.
+	bool HasConfig() const
 	{
-		if (m_pConfig == NULL )
-			throw WatsonException( "Service config is NULL, make sure you invoke Start()." );
-		return m_pConfig;
-	}
-	bool IsConfigured( AuthType a_AuthType = AUTH_BASIC )
-	{
-		if ( m_pConfig != NULL )
-			return m_pConfig->IsConfigured( a_AuthType );
-		return false;
+		return boost::atomic_load( &m_spConfig ).get() != NULL;
 	}
+	bool IsConfigured( AuthType a_AuthType = AUTH_BASIC ) const;
 	bool IsCacheEnabled() const
 	{
 		return m_bCacheEnabled;
@@ -478,12 +470,21 @@ public:
 	void SetHeaders( const Headers & a_Headers )
 	{
 		m_Headers = a_Headers;
+		UpdateTemplate();
+	}
+	//! Returns the serialized default headers sent with each request of this service, this is empty until
+	//! the service is started. This may be called from any thread.
+	IWebClient::RequestTemplate::SP GetTemplate() const
+	{
+		return boost::atomic_load( &m_spTemplate );
 	}
+	//! This must be called after m_Headers is changed
+	void UpdateTemplate();
 
 	//! Check if the service is up or down, and invoke the callback with the current
 	//! state of the service once determined.
 	virtual void GetServiceStatus(ServiceStatusCallback a_Callback);
-	//! This is invoked when the ServiceConfig object has been modified for this service
+	//! This is invoked on the main thread when the ServiceConfig object has been modified for this service
 	virtual void OnConfigModified();
 	//! This adds the basic authentication header to this services headers
 	void AddAuthenticationHeader();
@@ -492,11 +493,59 @@ protected:
 	//! Types
 	typedef std::map<std::string, DataCache::SP>		DataCacheMap;
 
+	//! The metric series a request is recorded into
+	struct RequestSeries
+	{
+		RequestSeries() : m_pRequests(NULL), m_pRequestTime(NULL), m_pQueueTime(NULL),
+			m_pConnectTime(NULL), m_pFirstByteTime(NULL)
+		{}
+
+		std::string			m_Label;			// service, method, end-point & status for the trace span
+		Metrics::Counter *	m_pRequests;
+		Metrics::Histogram *
+							m_pRequestTime;
+		Metrics::Histogram *
+							m_pQueueTime;
+		Metrics::Histogram *
+							m_pConnectTime;
+		Metrics::Histogram *
+							m_pFirstByteTime;
+	};
+
+	//! Caches the metric series of the requests made by a service, so a request takes a single lock to find
+	//! them. The end-point tag is bounded, at most MAX_END_POINTS are tagged and any others are tagged "other".
+	class RequestMetrics : private boost::noncopyable
+	{
+	public:
+		//! Returns the series of a request, this may be called from any thread. The returned reference is
+		//! valid for the life of this object.
+		const RequestSeries & GetSeries( const std::string & a_ServiceId, const std::string & a_EndPoint,
+			const std::string & a_Method, const std::string & a_Status );
+
+		//! Returns the end-point without the query string, any path segment that contains a digit (other
+		//! than a version such as v1) is replaced with ":id".
+		static std::string NormalizeEndPoint( const std::string & a_EndPoint );
+
+		static const size_t MAX_END_POINTS = 64;
+
+	private:
+		//! Types
+		typedef boost::unordered_map<std::string, RequestSeries>	SeriesMap;
+		typedef boost::unordered_set<std::string>					EndPointSet;
+
+		//! Data
+		boost::mutex		m_Lock;
+		SeriesMap			m_Series;			// by method, end-point & status
+		EndPointSet			m_EndPoints;
+	};
+
 	//! Data
 	std::string		m_ServiceId;
-	const ServiceConfig *	
-					m_pConfig;
+	ServiceConfig::SP
+					m_spConfig;				// current config, use boost::atomic_load()/atomic_store()
 	Headers			m_Headers;				// default headers for this service
+	IWebClient::RequestTemplate::SP
+					m_spTemplate;			// m_Headers serialized, use boost::atomic_load()/atomic_store()
 	
 	bool			m_bCacheEnabled;
 	unsigned int	m_MaxCacheSize;
@@ -506,6 +555,7 @@ protected:
 
 	boost::atomic<int>
 					m_RequestsPending;
+	RequestMetrics	m_RequestMetrics;
 
 	DataCache *		GetDataCache(const std::string & a_Type);
 	bool			GetCachedResponse(const std::string & a_CacheName, const std::string & a_Id,std::string & a_Response);
@@ -111,8 +111,9 @@ bool KafkaConsumer::Consume( Subscription * a_pSub )
 
 	rd_kafka_conf_t * pConfig = rd_kafka_conf_new();
 
-	for( ServiceConfig::CustomMap::const_iterator iConfig = m_pConfig->m_CustomMap.begin(); 
-		iConfig != m_pConfig->m_CustomMap.end(); ++iConfig )
+	ServiceConfig::SP spServiceConfig = GetConfig();
+	for( ServiceConfig::CustomMap::const_iterator iConfig = spServiceConfig->m_CustomMap.begin(); 
+		iConfig != spServiceConfig->m_CustomMap.end(); ++iConfig )
 	{
 		if (rd_kafka_conf_set(pConfig, iConfig->first.c_str(), iConfig->second.c_str(),	error, sizeof(error)) != RD_KAFKA_CONF_OK)
 			Log::Warning("Kafka", "Failed to set %s to %s: %s", iConfig->first.c_str(), iConfig->second.c_str(), error);
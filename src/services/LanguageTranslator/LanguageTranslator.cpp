@@ -46,7 +46,7 @@ bool LanguageTranslator::Start()
     if (! IService::Start() )
         return false;
 
-    if (! StringUtil::EndsWith( m_pConfig->m_URL, "language-translator/api" ) )
+    if (! StringUtil::EndsWith( GetConfig()->m_URL, "language-translator/api" ) )
     {
         Log::Error( "LanguageTranslator", "Configured URL not ended with language-translatore/api" );
         return false;
@@ -18,7 +18,7 @@
 #ifndef WDC_NLC_MODELS_H
 #define WDC_NLC_MODELS_H
 
-#include "utils/ISerializable.h"
+#include "utils/JsonFields.h"
 
 struct WDC_API Classifier : public ISerializable
 {
@@ -32,34 +32,15 @@ struct WDC_API Classifier : public ISerializable
 	std::string m_Status;
 	std::string m_StatusDescription;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		json["name"] = m_Name;
-		json["language"] = m_Language;
-		json["url"] = m_URL;
-		json["classifier_id"] = m_ClassifierId;
-		json["created"] = m_Created;
-		json["status"] = m_Status;
-		json["status_description"] = m_StatusDescription;
-	}
-
-	virtual void Deserialize(const Json::Value & json)
-	{
-		if ( json.isMember("name") )
-			m_Name = json["name"].asString();
-		if ( json.isMember("language") )
-			m_Language = json["language"].asString();
-		if ( json.isMember("url") )
-			m_URL = json["url"].asString();
-		if ( json.isMember("classifier_id") )
-			m_ClassifierId = json["classifier_id"].asString();
-		if ( json.isMember("created") )
-			m_Created = json["created"].asString();
-		if ( json.isMember("status") )
-			m_Status = json["status"].asString();
-		if ( json.isMember("status_description") )
-			m_StatusDescription = json["status_description"].asString();
-	}
+	WDC_FIELDS_BEGIN(Classifier)
+		WDC_FIELD("name", m_Name)
+		WDC_FIELD("language", m_Language)
+		WDC_FIELD("url", m_URL)
+		WDC_FIELD("classifier_id", m_ClassifierId)
+		WDC_FIELD("created", m_Created)
+		WDC_FIELD("status", m_Status)
+		WDC_FIELD("status_description", m_StatusDescription)
+	WDC_FIELDS_END()
 };
 
 struct WDC_API Classifiers : public ISerializable
@@ -68,15 +49,9 @@ struct WDC_API Classifiers : public ISerializable
 
 	std::vector<Classifier> m_Classifiers;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		SerializeVector( "classifiers", m_Classifiers, json );
-	}
-
-	virtual void Deserialize(const Json::Value & json)
-	{
-		DeserializeVector( "classifiers", json, m_Classifiers );
-	}
+	WDC_FIELDS_BEGIN(Classifiers)
+		WDC_FIELD("classifiers", m_Classifiers)
+	WDC_FIELDS_END()
 };
 
 struct WDC_API Class : public ISerializable
@@ -86,19 +61,13 @@ struct WDC_API Class : public ISerializable
 	double m_Confidence;
 	std::string m_ClassName;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		json["confidence"] = m_Confidence;
-		json["class_name"] = m_ClassName;
-	}
+	Class() : m_Confidence(0.0)
+	{}
 
-	virtual void Deserialize(const Json::Value & json)
-	{
-		if ( json.isMember("confidence") )
-			m_Confidence = json["confidence"].asDouble();
-		if ( json.isMember("class_name") )
-			m_ClassName = json["class_name"].asString();
-	}
+	WDC_FIELDS_BEGIN(Class)
+		WDC_FIELD("confidence", m_Confidence)
+		WDC_FIELD("class_name", m_ClassName)
+	WDC_FIELDS_END()
 };
 
 struct WDC_API ClassifyResult : public ISerializable
@@ -111,29 +80,13 @@ struct WDC_API ClassifyResult : public ISerializable
 	std::string m_TopClass;
 	std::vector<Class> m_Classes;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		json["classifier_id"] = m_ClassifierId;
-		json["url"] = m_URL;
-		json["text"] = m_Text;
-		json["top_class"] = m_TopClass;
-
-		SerializeVector( "classes", m_Classes, json );
-	}
-
-	virtual void Deserialize(const Json::Value & json)
-	{
-		if ( json.isMember("classifier_id") )
-			m_ClassifierId = json["classifier_id"].asString();
-		if ( json.isMember("url") )
-			m_URL = json["url"].asString();
-		if ( json.isMember("text") )
-			m_Text = json["text"].asString();
-		if ( json.isMember("top_class") )
-			m_TopClass = json["top_class"].asString();
-
-		DeserializeVector( "classes", json, m_Classes );
-	}
+	WDC_FIELDS_BEGIN(ClassifyResult)
+		WDC_FIELD("classifier_id", m_ClassifierId)
+		WDC_FIELD("url", m_URL)
+		WDC_FIELD("text", m_Text)
+		WDC_FIELD("top_class", m_TopClass)
+		WDC_FIELD("classes", m_Classes)
+	WDC_FIELDS_END()
 
 	double GetTopConfidence() const
 	{
@@ -17,6 +17,8 @@
 
 #include <fstream>
 
+#include "boost/bind.hpp"
+
 #include "NaturalLanguageClassifier.h"
 #include "utils/Form.h"
 
@@ -47,7 +49,7 @@ bool NaturalLanguageClassifier::Start()
 	if (! IService::Start() )
 		return false;
 
-	if (! StringUtil::EndsWith( m_pConfig->m_URL, "natural-language-classifier/api" ) )
+	if (! StringUtil::EndsWith( GetConfig()->m_URL, "natural-language-classifier/api" ) )
 	{
 		Log::Error( "NaturalLanguageClassifier", "Configured URL not ended with natural-language-classifier/api" );
 		return false;
@@ -90,7 +92,14 @@ void NaturalLanguageClassifier::GetClassifiers(OnGetClassifiers a_Callback)
 
 void NaturalLanguageClassifier::FindClassifiers(const std::string & a_Find, OnGetClassifiers a_Callback)
 {
-	new FindRequest(this, a_Find, a_Callback);
+	FindClassifiers( a_Find ).Then( FUNCTOR_DELEGATE( const Future<ClassifiersSP> &, 
+		boost::bind( &NaturalLanguageClassifier::OnFoundClassifiers, a_Callback, _1 ) ) );
+}
+
+Future<NaturalLanguageClassifier::ClassifiersSP> NaturalLanguageClassifier::FindClassifiers(const std::string & a_Find)
+{
+	return Promise<ClassifiersSP>::Start( boost::bind( &NaturalLanguageClassifier::GetClassifiers, this, _1 ) )
+		.Then<ClassifiersSP>( boost::bind( &NaturalLanguageClassifier::OnFindClassifiers, this, a_Find, _1, _2 ) );
 }
 
 //! Request a specific classifier.
@@ -164,68 +173,54 @@ void NaturalLanguageClassifier::DeleteClassifer( const std::string & a_Classifie
 
 //-------------------------------------------------------
 
-NaturalLanguageClassifier::FindRequest::FindRequest(NaturalLanguageClassifier * a_pService, const std::string & a_Find, OnGetClassifiers a_Callback) :
-	m_pService(a_pService), m_Find(a_Find), m_Callback(a_Callback), m_nPendingRequests( 0 ), m_pClassifiers( NULL )
-{
-	m_nPendingRequests += 1;
-	m_pService->GetClassifiers(DELEGATE(FindRequest, OnClassifiers, Classifiers *, this));
-}
-
-void NaturalLanguageClassifier::FindRequest::OnClassifiers(Classifiers * a_pClassifiers)
+void NaturalLanguageClassifier::OnFindClassifiers( const std::string & a_Find, const Future<ClassifiersSP> & a_Classifiers, 
+	Promise<ClassifiersSP> & a_Result )
 {
-	m_nPendingRequests -= 1;
-	m_pClassifiers = a_pClassifiers;
-
-	if (m_pClassifiers != NULL)
+	if (! a_Classifiers.IsReady() )
 	{
-		std::vector<Classifier> & list = m_pClassifiers->m_Classifiers;
-		for (size_t i = 0; i < list.size(); ++i)
-		{
-			if (m_Find.size() > 0 && !StringUtil::WildMatch(m_Find.c_str(), list[i].m_Name.c_str()))
-			{
-				// replace with the last element, then pop the back..
-				if (i < (list.size() - 1))
-					list[i] = list[list.size() - 1];
-				list.pop_back();
-
-				i -= 1;
-				continue;
-			}
-
-			m_nPendingRequests += 1;
-			m_pService->GetClassifier(list[i].m_ClassifierId, DELEGATE(FindRequest, OnClassifier, Classifier *, this));
-		}
+		a_Result.SetError( a_Classifiers.GetError() );
+		return;
 	}
 
-	if (m_nPendingRequests == 0)
+	// request the details of every match at once..
+	ClassifiersSP spFound( new Classifiers() );
+	std::vector< Future<ClassifierSP> > details;
+
+	const std::vector<Classifier> & list = a_Classifiers.GetValue()->m_Classifiers;
+	for (size_t i = 0; i < list.size(); ++i)
 	{
-		if (m_Callback.IsValid())
-			m_Callback(m_pClassifiers);
-		delete this;
+		if (a_Find.size() > 0 && !StringUtil::WildMatch(a_Find.c_str(), list[i].m_Name.c_str()))
+			continue;
+
+		spFound->m_Classifiers.push_back( list[i] );
+		details.push_back( Promise<ClassifierSP>::Start( 
+			boost::bind( &NaturalLanguageClassifier::GetClassifier, this, list[i].m_ClassifierId, _1 ) ) );
 	}
+
+	WhenAll( details ).Then( FUNCTOR_DELEGATE( const Future< std::vector< Future<ClassifierSP> > > &,
+		boost::bind( &NaturalLanguageClassifier::OnFindDetails, spFound, a_Result, _1 ) ) );
 }
 
-void NaturalLanguageClassifier::FindRequest::OnClassifier(Classifier * a_pClassifier)
+void NaturalLanguageClassifier::OnFindDetails( ClassifiersSP a_spFound, Promise<ClassifiersSP> a_Result, 
+	const Future< std::vector< Future<ClassifierSP> > > & a_Details )
 {
-	m_nPendingRequests -= 1;
-	if ( a_pClassifier != NULL )
+	if ( a_Details.IsReady() )
 	{
-		std::vector<Classifier> & list = m_pClassifiers->m_Classifiers;
-		for (size_t i = 0; i < list.size(); ++i)
+		const std::vector< Future<ClassifierSP> > & details = a_Details.GetValue();
+		for (size_t i = 0; i < details.size(); ++i)
 		{
-			if (list[i].m_ClassifierId == a_pClassifier->m_ClassifierId)
-				list[i] = *a_pClassifier;
+			if ( details[i].IsReady() )
+				a_spFound->m_Classifiers[i] = *details[i].GetValue();
+			else
+				Log::Error( "NaturalLanguageClassifier", "Failed to find classifier." );
 		}
 	}
-	else
-	{
-		Log::Error( "NaturalLanguageClassifier", "Failed to find classifier." );
-	}
 
-	if (m_nPendingRequests == 0)
-	{
-		if (m_Callback.IsValid())
-			m_Callback(m_pClassifiers);
-		delete this;
-	}
+	a_Result.SetValue( a_spFound );
+}
+
+void NaturalLanguageClassifier::OnFoundClassifiers( OnGetClassifiers a_Callback, const Future<ClassifiersSP> & a_Found )
+{
+	if ( a_Callback.IsValid() )
+		a_Callback( a_Found.IsReady() ? new Classifiers( *a_Found.GetValue() ) : NULL );
 }
@@ -35,6 +35,8 @@ public:
 	typedef Delegate<Classifier *>			OnTrainClassifier;
 	typedef Delegate<const Json::Value &>	OnClassify;	
 	typedef Delegate<const Json::Value &>	OnDeleteClassifier;
+	typedef boost::shared_ptr<Classifiers>	ClassifiersSP;
+	typedef boost::shared_ptr<Classifier>	ClassifierSP;
 
 	//! Construction 
 	NaturalLanguageClassifier();
@@ -51,6 +53,7 @@ public:
 	void GetClassifiers(OnGetClassifiers a_Callback);
 	//! Request all classifiers matching a given name and collect all classifier info 
 	void FindClassifiers( const std::string & a_Find, OnGetClassifiers a_Callback);
+	Future<ClassifiersSP> FindClassifiers( const std::string & a_Find );
 	//! Request a specific classifier.
 	void GetClassifier( const std::string & a_ClassifierId,
 		OnGetClassifier a_Callback );
@@ -84,22 +87,12 @@ private:
         void OnCheckService(Classifiers *a_pClassifiers);
     };
 
-	class FindRequest
-	{
-	public:
-		FindRequest(NaturalLanguageClassifier * a_pService, const std::string & a_Find, OnGetClassifiers a_Callback);
-
-	private:
-		NaturalLanguageClassifier * m_pService;
-		OnGetClassifiers m_Callback;
-		std::string m_Find;
-		int m_nPendingRequests;
-		Classifiers * m_pClassifiers;
-
-		void OnClassifiers(Classifiers * a_pClassifiers);
-		void OnClassifier(Classifier * a_pClassifier);
-	};
-
+	//! FindClassifiers() steps
+	void OnFindClassifiers( const std::string & a_Find, const Future<ClassifiersSP> & a_Classifiers, 
+		Promise<ClassifiersSP> & a_Result );
+	static void OnFindDetails( ClassifiersSP a_spFound, Promise<ClassifiersSP> a_Result, 
+		const Future< std::vector< Future<ClassifierSP> > > & a_Details );
+	static void OnFoundClassifiers( OnGetClassifiers a_Callback, const Future<ClassifiersSP> & a_Found );
 };
 
 #endif
@@ -58,15 +58,16 @@ bool NaturalLanguageUnderstanding::Start()
     if (!IService::Start())
         return false;
 
-    if (!StringUtil::EndsWith(m_pConfig->m_URL, "api"))
+    ServiceConfig::SP spConfig = GetConfig();
+    if (!StringUtil::EndsWith(spConfig->m_URL, "api"))
     {
         Log::Error("NaturalLanguageUnderstanding", "Configured URL not ended with api");
         return false;
     }
-    if (m_pConfig->m_User.size() == 0)
+    if (spConfig->m_User.size() == 0)
         Log::Warning("NaturalLanguageUnderstanding", "User id expected in user field.");
 
-    if (m_pConfig->m_Password.size() == 0)
+    if (spConfig->m_Password.size() == 0)
         Log::Warning("NaturalLanguageUnderstanding", "Password expected in password field");
 
     return true;
@@ -44,7 +44,7 @@ bool PersonalityInsights::Start()
     if (! IService::Start() )
         return false;
 
-    if (! StringUtil::EndsWith( m_pConfig->m_URL, "personality-insights/api" ) )
+    if (! StringUtil::EndsWith( GetConfig()->m_URL, "personality-insights/api" ) )
     {
         Log::Error( "PersonalityInsights", "Configured URL not ended with personality-insights/api" );
         return false;
@@ -43,7 +43,7 @@ bool RelationshipExtraction::Start()
 	if (!IService::Start())
 		return false;
 
-	if (!StringUtil::EndsWith(m_pConfig->m_URL, "relationship-extraction-beta/api"))
+	if (!StringUtil::EndsWith(GetConfig()->m_URL, "relationship-extraction-beta/api"))
 	{
 		Log::Error("RelationshipExtraction", "Configured URL not ended with relationship-extraction-beta/api");
 		return false;
@@ -54,7 +54,7 @@ bool RelationshipExtraction::Start()
 
 void RelationshipExtraction::GetServiceStatus(ServiceStatusCallback a_Callback)
 {
-	if (m_pConfig != NULL)
+	if (HasConfig())
 		new ServiceStatusChecker(this, a_Callback);
 	else
 		a_Callback(ServiceStatus(m_ServiceId, false));
@@ -45,7 +45,7 @@ bool RetrieveAndRank::Start()
     if (! IService::Start() )
         return false;
 
-    if (! StringUtil::EndsWith( m_pConfig->m_URL, "retrieve-and-rank/api" ) )
+    if (! StringUtil::EndsWith( GetConfig()->m_URL, "retrieve-and-rank/api" ) )
     {
         Log::Error( "RetrieveAndRank", "Configured URL not ended with retrieve-and-rank/api" );
         return false;
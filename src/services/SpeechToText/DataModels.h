@@ -18,7 +18,7 @@
 #ifndef WDC_SPEECH_TO_TEXT_MODELS_H
 #define WDC_SPEECH_TO_TEXT_MODELS_H
 
-#include "utils/ISerializable.h"
+#include "utils/JsonFields.h"
 
 struct SpeechModel : public ISerializable
 {
@@ -30,23 +30,16 @@ struct SpeechModel : public ISerializable
 	std::string m_Description;
 	std::string m_URL;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		json["name"] = m_Name;
-		json["rate"] = m_Rate;
-		json["language"] = m_Language;
-		json["description"] = m_Description;
-		json["url"] = m_URL;
-	}
+	SpeechModel() : m_Rate( 0 )
+	{}
 
-	virtual void Deserialize(const Json::Value & json) 
-	{
-		m_Name = json["name"].asString();
-		m_Rate = json["rate"].asInt();
-		m_Language = json["language"].asString();
-		m_Description = json["description"].asString();
-		m_URL = json["url"].asString();
-	}
+	WDC_FIELDS_BEGIN(SpeechModel)
+		WDC_FIELD("name", m_Name)
+		WDC_FIELD("rate", m_Rate)
+		WDC_FIELD("language", m_Language)
+		WDC_FIELD("description", m_Description)
+		WDC_FIELD("url", m_URL)
+	WDC_FIELDS_END()
 };
 
 struct SpeechModels : ISerializable
@@ -55,15 +48,9 @@ struct SpeechModels : ISerializable
 
 	std::vector<SpeechModel>	m_Models;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		SerializeVector( "models", m_Models, json );
-	}
-
-	virtual void Deserialize(const Json::Value & json) 
-	{
-		DeserializeVector( "models", json, m_Models );
-	}
+	WDC_FIELDS_BEGIN(SpeechModels)
+		WDC_FIELD("models", m_Models)
+	WDC_FIELDS_END()
 };
 
 struct WordConfidence : public ISerializable
@@ -73,17 +60,13 @@ struct WordConfidence : public ISerializable
 	std::string m_Word;
 	double		m_Confidence;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		json[0] = m_Word;
-		json[1] = m_Confidence;
-	}
+	WordConfidence() : m_Confidence( 0.0 )
+	{}
 
-	virtual void Deserialize(const Json::Value & json) 
-	{
-		m_Word = json[0].asString();
-		m_Confidence = json[1].asDouble();
-	}
+	WDC_TUPLE_BEGIN(WordConfidence)
+		WDC_FIELD("word", m_Word)
+		WDC_FIELD("confidence", m_Confidence)
+	WDC_FIELDS_END()
 };
 
 struct TimeStamp : public ISerializable
@@ -94,19 +77,14 @@ struct TimeStamp : public ISerializable
 	double		m_Start;
 	double		m_End;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		json[0] = m_Word;
-		json[1] = m_Start;
-		json[2] = m_End;
-	}
+	TimeStamp() : m_Start( 0.0 ), m_End( 0.0 )
+	{}
 
-	virtual void Deserialize(const Json::Value & json) 
-	{
-		m_Word = json[0].asString();
-		m_Start = json[1].asDouble();
-		m_End = json[2].asDouble();
-	}
+	WDC_TUPLE_BEGIN(TimeStamp)
+		WDC_FIELD("word", m_Word)
+		WDC_FIELD("start", m_Start)
+		WDC_FIELD("end", m_End)
+	WDC_FIELDS_END()
 };
 
 struct SpeechAlt : public ISerializable
@@ -120,23 +98,15 @@ struct SpeechAlt : public ISerializable
 	std::vector<WordConfidence> 
 				m_WordConfidence;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		json["transcript"] = m_Transcript;
-		json["confidence"] = m_Confidence;
-		
-		SerializeVector( "timestamps", m_Timestamps, json );
-		SerializeVector( "word_confidence", m_WordConfidence, json );
-	}
-
-	virtual void Deserialize(const Json::Value & json) 
-	{
-		m_Transcript = json["transcript"].asString();
-		m_Confidence = json["confidence"].asDouble();
+	SpeechAlt() : m_Confidence( 0.0 )
+	{}
 
-		DeserializeVector( "timestamps", json, m_Timestamps );
-		DeserializeVector( "word_confidence", json, m_WordConfidence );
-	}
+	WDC_FIELDS_BEGIN(SpeechAlt)
+		WDC_FIELD("transcript", m_Transcript)
+		WDC_FIELD("confidence", m_Confidence)
+		WDC_FIELD("timestamps", m_Timestamps)
+		WDC_FIELD("word_confidence", m_WordConfidence)
+	WDC_FIELDS_END()
 };
 
 struct SpeechResult : public ISerializable
@@ -147,18 +117,13 @@ struct SpeechResult : public ISerializable
 	std::vector<SpeechAlt> 
 			m_Alternatives;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		json["final"] = m_Final;
-		SerializeVector( "alternatives", m_Alternatives, json );
-	}
-
-	virtual void Deserialize(const Json::Value & json) 
-	{
-		m_Final = json["final"].asBool();
-		DeserializeVector( "alternatives", json, m_Alternatives );
-	}
+	SpeechResult() : m_Final( false )
+	{}
 
+	WDC_FIELDS_BEGIN(SpeechResult)
+		WDC_FIELD("final", m_Final)
+		WDC_FIELD("alternatives", m_Alternatives)
+	WDC_FIELDS_END()
 };
 
 struct RecognizeResults : public ISerializable
@@ -200,17 +165,10 @@ struct RecognizeResults : public ISerializable
 		return m_Language;
 	}
 
-	virtual void Serialize(Json::Value & json)
-	{
-		json["result_index"] = m_ResultIndex;
-		SerializeVector( "results", m_Results, json );
-	}
-
-	virtual void Deserialize(const Json::Value & json) 
-	{
-		m_ResultIndex = json["result_index"].asInt();
-		DeserializeVector( "results", json, m_Results );
-	}
+	WDC_FIELDS_BEGIN(RecognizeResults)
+		WDC_FIELD("result_index", m_ResultIndex)
+		WDC_FIELD("results", m_Results)
+	WDC_FIELDS_END()
 };
 
 struct SpeechAudioData : public ISerializable
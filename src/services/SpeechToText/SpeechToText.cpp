@@ -113,7 +113,7 @@ bool SpeechToText::Start()
 	if (! IService::Start() )
 		return false;
 
-	if (! StringUtil::EndsWith( m_pConfig->m_URL, "speech-to-text/api" ) )
+	if (! StringUtil::EndsWith( GetConfig()->m_URL, "speech-to-text/api" ) )
 	{
 		Log::Error( "SpeechToText", "Configured URL not ended with speech-to-text/api" );
 		return false;
@@ -131,7 +131,7 @@ bool SpeechToText::Stop()
 //! Check the status of the service and call the passed function with the result
 void SpeechToText::GetServiceStatus( ServiceStatusCallback a_Callback )
 {
-	if (m_pConfig != NULL)
+	if (HasConfig())
 		new ServiceStatusChecker(this, a_Callback);
 	else
 		a_Callback(ServiceStatus(m_ServiceId, false));
@@ -18,7 +18,7 @@
 #ifndef WDC_TEXT_TO_SPEECH_MODELS_H
 #define WDC_TEXT_TO_SPEECH_MODELS_H
 
-#include "utils/ISerializable.h"
+#include "utils/JsonFields.h"
 
 enum AudioFormatType
 {
@@ -36,21 +36,12 @@ struct Voice : public ISerializable
 	std::string m_Gender;
 	std::string m_URL;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		json["name"] = m_Name;
-		json["language"] = m_Language;
-		json["gender"] = m_Gender;
-		json["url"] = m_URL;
-	}
-
-	virtual void Deserialize(const Json::Value & json)
-	{
-		m_Name = json["name"].asString();
-		m_Language = json["language"].asString();
-		m_Gender = json["gender"].asString();
-		m_URL = json["url"].asString();
-	}
+	WDC_FIELDS_BEGIN(Voice)
+		WDC_FIELD("name", m_Name)
+		WDC_FIELD("language", m_Language)
+		WDC_FIELD("gender", m_Gender)
+		WDC_FIELD("url", m_URL)
+	WDC_FIELDS_END()
 };
 
 struct Voices : public ISerializable
@@ -59,15 +50,9 @@ struct Voices : public ISerializable
 
 	std::vector< Voice > m_Voices;
 
-	virtual void Serialize(Json::Value & json)
-	{
-		SerializeVector( "voices", m_Voices, json );
-	}
-
-	virtual void Deserialize(const Json::Value & json)
-	{
-		DeserializeVector( "voices", json, m_Voices );
-	}
+	WDC_FIELDS_BEGIN(Voices)
+		WDC_FIELD("voices", m_Voices)
+	WDC_FIELDS_END()
 };
 
 struct Words : public boost::enable_shared_from_this<Words>
@@ -45,7 +45,7 @@ bool TextToSpeech::Start()
 	if (! IService::Start() )
 		return false;
 
-	if (! StringUtil::EndsWith( m_pConfig->m_URL, "text-to-speech/api" ) )
+	if (! StringUtil::EndsWith( GetConfig()->m_URL, "text-to-speech/api" ) )
 	{
 		Log::Error( "TextToSpeech", "Configured URL not ended with text-to-speech/api" );
 		return false;
@@ -57,7 +57,7 @@ bool TextToSpeech::Start()
 //! Check the status of the service and call the passed function with the result
 void TextToSpeech::GetServiceStatus(ServiceStatusCallback a_Callback)
 {
-	if (m_pConfig != NULL)
+	if (HasConfig())
 		new ServiceStatusChecker(this, a_Callback);
 	else
 		a_Callback(ServiceStatus(m_ServiceId, false));
@@ -44,7 +44,7 @@ bool ToneAnalyzer::Start()
     if (! IService::Start() )
         return false;
 
-    if (! StringUtil::EndsWith( m_pConfig->m_URL, "tone-analyzer/api" ) )
+    if (! StringUtil::EndsWith( GetConfig()->m_URL, "tone-analyzer/api" ) )
     {
         Log::Error( "ToneAnalyzer", "Configured URL not ended with tone-analyzer/api" );
         return false;
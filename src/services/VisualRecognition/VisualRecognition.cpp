@@ -53,12 +53,13 @@ bool VisualRecognition::Start()
 {
 	if (!IService::Start())
 		return false;
-	if (!StringUtil::EndsWith(m_pConfig->m_URL, "visual-recognition/api"))
+	ServiceConfig::SP spConfig = GetConfig();
+	if (!StringUtil::EndsWith(spConfig->m_URL, "visual-recognition/api"))
 	{
 		Log::Error("VisualRecognition", "Configured URL not ended with visual-recognition/api");
 		return false;
 	}	
-	if (m_pConfig->m_User.size() == 0)
+	if (spConfig->m_User.size() == 0)
 		Log::Warning("VisualRecognition", "API-Key expected in user field.");
 
 	return true;
@@ -66,7 +67,7 @@ bool VisualRecognition::Start()
 
 void VisualRecognition::GetServiceStatus(ServiceStatusCallback a_Callback)
 {
-	if (m_pConfig != NULL)
+	if (HasConfig())
 		new ServiceStatusChecker(this, a_Callback);
 	else
 		a_Callback(ServiceStatus(m_ServiceId, false));
@@ -75,7 +76,7 @@ void VisualRecognition::GetServiceStatus(ServiceStatusCallback a_Callback)
 void VisualRecognition::GetClassifiers( OnGetClassifier a_Callback )
 {
 	std::string params = "/v3/classifiers";
-	params += "?apikey=" + m_pConfig->m_User;
+	params += "?apikey=" + GetConfig()->m_User;
 	params += "&version=" + m_APIVersion;
 
 	new RequestJson(this, params, "GET", NULL_HEADERS, EMPTY_STRING, a_Callback );
@@ -85,7 +86,7 @@ void VisualRecognition::GetClassifier( const std::string & a_ClassifierId,
 	OnGetClassifier a_Callback )
 {
 	std::string params = "/v3/classifiers/" + a_ClassifierId;
-	params += "?apikey=" + m_pConfig->m_User;
+	params += "?apikey=" + GetConfig()->m_User;
 	params += "&version=" + m_APIVersion;
 
 	new RequestJson(this, params, "GET", NULL_HEADERS, EMPTY_STRING, a_Callback );
@@ -97,7 +98,7 @@ void VisualRecognition::ClassifyImage(const std::string & a_ImageData,
 	bool a_bKnowledgeGraph /*= false*/ )
 {
 	std::string parameters = "/v3/classify";
-	parameters += "?apikey=" + m_pConfig->m_User;
+	parameters += "?apikey=" + GetConfig()->m_User;
 	parameters += "&version=" + m_APIVersion;
 	parameters += "&threshold=" + StringUtil::Format( "%f", m_ClassifyThreshold );
 	if (a_bKnowledgeGraph)
@@ -123,7 +124,7 @@ void VisualRecognition::ClassifyImage(const std::string & a_ImageData,
 void VisualRecognition::DetectFaces(const std::string & a_ImageData, OnDetectFaces a_Callback )
 {
 	std::string parameters = "/v3/detect_faces";
-	parameters += "?apikey=" + m_pConfig->m_User;
+	parameters += "?apikey=" + GetConfig()->m_User;
 	parameters += "&version=" + m_APIVersion;
 
 	Form form;
@@ -144,7 +145,7 @@ void VisualRecognition::CreateClassifier(
 	OnCreateClassifier a_Callback )
 {
 	std::string parameters = "/v3/classifiers";
-	parameters += "?apikey=" + m_pConfig->m_User;
+	parameters += "?apikey=" + GetConfig()->m_User;
 	parameters += "&version=" + m_APIVersion;
 
 	Form form;
@@ -173,7 +174,7 @@ void VisualRecognition::UpdateClassifier(
 {
 	std::string parameters = "/v3/classifiers/";
 	parameters += a_ClassifierId;
-	parameters += "?apikey=" + m_pConfig->m_User;
+	parameters += "?apikey=" + GetConfig()->m_User;
 	parameters += "&version=" + m_APIVersion;
 
 	Form form;
@@ -198,7 +199,7 @@ void VisualRecognition::DeleteClassifier( const std::string & a_ClassifierId,
 {
 	std::string parameters = "/v3/classifiers/";
 	parameters += a_ClassifierId;
-	parameters += "?apikey=" + m_pConfig->m_User;
+	parameters += "?apikey=" + GetConfig()->m_User;
 	parameters += "&version=" + m_APIVersion;
 
 	new Request(this, parameters, "DELETE", NULL_HEADERS, EMPTY_STRING, a_Callback );
@@ -55,7 +55,7 @@ bool WeatherCompanyData::Start()
     if ( !IService::Start() )
         return false;
 
-    if (! StringUtil::EndsWith( m_pConfig->m_URL, "api/weather" ) )
+    if (! StringUtil::EndsWith( GetConfig()->m_URL, "api/weather" ) )
     {
         Log::Error( "WeatherCompanyData", "Configured URL not ended with api/weather" );
         return false;
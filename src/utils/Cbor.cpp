@@ -0,0 +1,467 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <limits>
+
+#include "Cbor.h"
+#include "JsonParser.h"
+#include "StringUtil.h"
+
+#include "boost/cstdint.hpp"
+
+namespace {
+
+enum MajorType
+{
+	MAJOR_UINT = 0,
+	MAJOR_NEGATIVE = 1,
+	MAJOR_BYTES = 2,
+	MAJOR_TEXT = 3,
+	MAJOR_ARRAY = 4,
+	MAJOR_MAP = 5,
+	MAJOR_TAG = 6,
+	MAJOR_SIMPLE = 7
+};
+
+const unsigned int INDEFINITE = 31;
+const unsigned char BREAK = 0xff;
+const int MAX_DEPTH = 1000;
+
+// tag 55799, self-describe CBOR
+const char SELF_DESCRIBE[] = { (char)0xd9, (char)0xd9, (char)0xf7 };
+
+void WriteHead(unsigned int a_nMajor, boost::uint64_t a_nValue, std::string & a_Data)
+{
+	unsigned char head[9];
+	size_t nSize = 1;
+	if (a_nValue < 24)
+		head[0] = (unsigned char)((a_nMajor << 5) | a_nValue);
+	else if (a_nValue <= 0xff)
+	{
+		head[0] = (unsigned char)((a_nMajor << 5) | 24);
+		nSize = 2;
+	}
+	else if (a_nValue <= 0xffff)
+	{
+		head[0] = (unsigned char)((a_nMajor << 5) | 25);
+		nSize = 3;
+	}
+	else if (a_nValue <= 0xffffffffULL)
+	{
+		head[0] = (unsigned char)((a_nMajor << 5) | 26);
+		nSize = 5;
+	}
+	else
+	{
+		head[0] = (unsigned char)((a_nMajor << 5) | 27);
+		nSize = 9;
+	}
+
+	// big endian..
+	for (size_t i = nSize - 1; i > 0; --i, a_nValue >>= 8)
+		head[i] = (unsigned char)(a_nValue & 0xff);
+	a_Data.append((const char *)head, nSize);
+}
+
+void WriteReal(double a_fValue, std::string & a_Data)
+{
+	if (fabs(a_fValue) <= FLT_MAX && (double)(float)a_fValue == a_fValue)
+	{
+		float fValue = (float)a_fValue;
+		boost::uint32_t nBits;
+		memcpy(&nBits, &fValue, sizeof(nBits));
+		a_Data += (char)0xfa;
+		for (int i = 3; i >= 0; --i)
+			a_Data += (char)((nBits >> (i * 8)) & 0xff);
+	}
+	else
+	{
+		boost::uint64_t nBits;
+		memcpy(&nBits, &a_fValue, sizeof(nBits));
+		a_Data += (char)0xfb;
+		for (int i = 7; i >= 0; --i)
+			a_Data += (char)((nBits >> (i * 8)) & 0xff);
+	}
+}
+
+void WriteValue(const Json::Value & a_Value, std::string & a_Data)
+{
+	switch (a_Value.type())
+	{
+	case Json::nullValue:
+		a_Data += (char)0xf6;
+		break;
+	case Json::booleanValue:
+		a_Data += (char)(a_Value.asBool() ? 0xf5 : 0xf4);
+		break;
+	case Json::intValue:
+		{
+			Json::LargestInt nValue = a_Value.asLargestInt();
+			if (nValue >= 0)
+				WriteHead(MAJOR_UINT, (boost::uint64_t)nValue, a_Data);
+			else
+				WriteHead(MAJOR_NEGATIVE, (boost::uint64_t)(-(nValue + 1)), a_Data);
+		}
+		break;
+	case Json::uintValue:
+		WriteHead(MAJOR_UINT, a_Value.asLargestUInt(), a_Data);
+		break;
+	case Json::realValue:
+		WriteReal(a_Value.asDouble(), a_Data);
+		break;
+	case Json::stringValue:
+		{
+			const char * pBegin = NULL;
+			const char * pEnd = NULL;
+			a_Value.getString(&pBegin, &pEnd);
+			WriteHead(MAJOR_TEXT, (boost::uint64_t)(pEnd - pBegin), a_Data);
+			a_Data.append(pBegin, pEnd - pBegin);
+		}
+		break;
+	case Json::arrayValue:
+		WriteHead(MAJOR_ARRAY, a_Value.size(), a_Data);
+		for (Json::ArrayIndex i = 0; i < a_Value.size(); ++i)
+			WriteValue(a_Value[i], a_Data);
+		break;
+	case Json::objectValue:
+		WriteHead(MAJOR_MAP, a_Value.size(), a_Data);
+		for (Json::ValueConstIterator iMember = a_Value.begin(); iMember != a_Value.end(); ++iMember)
+		{
+			const char * pEnd = NULL;
+			const char * pName = iMember.memberName(&pEnd);
+			WriteHead(MAJOR_TEXT, (boost::uint64_t)(pEnd - pName), a_Data);
+			a_Data.append(pName, pEnd - pName);
+			WriteValue(*iMember, a_Data);
+		}
+		break;
+	}
+}
+
+double HalfToDouble(unsigned int a_nHalf)
+{
+	unsigned int nExp = (a_nHalf >> 10) & 0x1f;
+	unsigned int nMantissa = a_nHalf & 0x3ff;
+
+	double fValue;
+	if (nExp == 0)
+		fValue = ldexp((double)nMantissa, -24);
+	else if (nExp != 31)
+		fValue = ldexp((double)(nMantissa + 1024), (int)nExp - 25);
+	else
+		fValue = nMantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+	return (a_nHalf & 0x8000) != 0 ? -fValue : fValue;
+}
+
+class CborReader
+{
+public:
+	CborReader(const char * a_pBegin, const char * a_pEnd) :
+		m_pBegin((const unsigned char *)a_pBegin),
+		m_pEnd((const unsigned char *)a_pEnd),
+		m_pPos(m_pBegin),
+		m_nDepth(0)
+	{}
+
+	const std::string & GetError() const
+	{
+		return m_Error;
+	}
+
+	bool Read(Json::Value & a_Value)
+	{
+		if (!ReadValue(a_Value))
+			return false;
+		if (m_pPos != m_pEnd)
+			return Error("Unexpected data after the root value");
+		return true;
+	}
+
+private:
+	//! Data
+	const unsigned char *	m_pBegin;
+	const unsigned char *	m_pEnd;
+	const unsigned char *	m_pPos;
+	int						m_nDepth;
+	std::string				m_Key;
+	std::string				m_Error;
+
+	bool ReadHead(unsigned int & a_nMajor, unsigned int & a_nInfo, boost::uint64_t & a_nValue)
+	{
+		if (m_pPos >= m_pEnd)
+			return Error("Unexpected end of data");
+
+		unsigned char head = *m_pPos++;
+		a_nMajor = head >> 5;
+		a_nInfo = head & 0x1f;
+		a_nValue = a_nInfo;
+		if (a_nInfo < 24 || a_nInfo == INDEFINITE)
+			return true;
+		if (a_nInfo > 27)
+			return Error("Invalid additional information");
+
+		size_t nSize = (size_t)1 << (a_nInfo - 24);
+		if ((size_t)(m_pEnd - m_pPos) < nSize)
+			return Error("Unexpected end of data");
+		a_nValue = 0;
+		for (size_t i = 0; i < nSize; ++i)
+			a_nValue = (a_nValue << 8) | *m_pPos++;
+		return true;
+	}
+
+	//! Read a text or byte string into a_String, a_bAppend is used for the chunks of an indefinite string
+	bool ReadString(unsigned int a_nMajor, unsigned int a_nInfo, boost::uint64_t a_nSize, std::string & a_String,
+		bool a_bAppend = false)
+	{
+		if (a_nInfo == INDEFINITE)
+		{
+			if (a_bAppend)
+				return Error("Nested indefinite length string");
+
+			a_String.clear();
+			for (;;)
+			{
+				if (m_pPos >= m_pEnd)
+					return Error("Unexpected end of data");
+				if (*m_pPos == BREAK)
+				{
+					++m_pPos;
+					return true;
+				}
+
+				unsigned int nMajor, nInfo;
+				boost::uint64_t nSize;
+				if (!ReadHead(nMajor, nInfo, nSize))
+					return false;
+				if (nMajor != a_nMajor)
+					return Error("Invalid chunk in indefinite length string");
+				if (!ReadString(nMajor, nInfo, nSize, a_String, true))
+					return false;
+			}
+		}
+
+		if (a_nSize > (boost::uint64_t)(m_pEnd - m_pPos))
+			return Error("Unexpected end of data");
+		if (!a_bAppend)
+			a_String.clear();
+		a_String.append((const char *)m_pPos, (size_t)a_nSize);
+		m_pPos += a_nSize;
+		return true;
+	}
+
+	bool IsBreak(unsigned int a_nInfo, boost::uint64_t a_nIndex, boost::uint64_t a_nCount, bool & a_bError)
+	{
+		a_bError = false;
+		if (a_nInfo != INDEFINITE)
+			return a_nIndex >= a_nCount;
+		if (m_pPos >= m_pEnd)
+		{
+			a_bError = !Error("Unexpected end of data");
+			return true;
+		}
+		if (*m_pPos != BREAK)
+			return false;
+		++m_pPos;
+		return true;
+	}
+
+	bool ReadValue(Json::Value & a_Value)
+	{
+		unsigned int nMajor, nInfo;
+		boost::uint64_t nValue;
+		if (!ReadHead(nMajor, nInfo, nValue))
+			return false;
+		if (nInfo == INDEFINITE && (nMajor < MAJOR_BYTES || nMajor > MAJOR_MAP))
+			return Error(nMajor == MAJOR_SIMPLE ? "Unexpected break" : "Invalid indefinite length");
+
+		switch (nMajor)
+		{
+		case MAJOR_UINT:
+			if (nValue <= (boost::uint64_t)Json::Value::maxLargestInt)
+				a_Value = Json::Value((Json::LargestInt)nValue);
+			else
+				a_Value = Json::Value((Json::LargestUInt)nValue);
+			return true;
+		case MAJOR_NEGATIVE:
+			if (nValue <= (boost::uint64_t)Json::Value::maxLargestInt)
+				a_Value = Json::Value(-(Json::LargestInt)nValue - 1);
+			else
+				a_Value = Json::Value(-(double)nValue - 1.0);
+			return true;
+		case MAJOR_BYTES:
+		case MAJOR_TEXT:
+			if (nInfo != INDEFINITE)
+			{
+				if (nValue > (boost::uint64_t)(m_pEnd - m_pPos))
+					return Error("Unexpected end of data");
+				a_Value = Json::Value((const char *)m_pPos, (const char *)m_pPos + nValue);
+				m_pPos += nValue;
+			}
+			else
+			{
+				std::string value;
+				if (!ReadString(nMajor, nInfo, nValue, value))
+					return false;
+				a_Value = Json::Value(value.data(), value.data() + value.size());
+			}
+			return true;
+		case MAJOR_ARRAY:
+			{
+				if (++m_nDepth > MAX_DEPTH)
+					return Error("Nested too deep");
+
+				Json::Value array(Json::arrayValue);
+				bool bError = false;
+				for (boost::uint64_t i = 0; !IsBreak(nInfo, i, nValue, bError); ++i)
+				{
+					if (!ReadValue(array[(Json::ArrayIndex)i]))
+						return false;
+				}
+				if (bError)
+					return false;
+
+				a_Value.swapPayload(array);
+				--m_nDepth;
+			}
+			return true;
+		case MAJOR_MAP:
+			{
+				if (++m_nDepth > MAX_DEPTH)
+					return Error("Nested too deep");
+
+				Json::Value object(Json::objectValue);
+				bool bError = false;
+				for (boost::uint64_t i = 0; !IsBreak(nInfo, i, nValue, bError); ++i)
+				{
+					unsigned int nKeyMajor, nKeyInfo;
+					boost::uint64_t nKeySize;
+					if (!ReadHead(nKeyMajor, nKeyInfo, nKeySize))
+						return false;
+					if (nKeyMajor != MAJOR_TEXT)
+						return Error("Object key is not a string");
+					if (!ReadString(nKeyMajor, nKeyInfo, nKeySize, m_Key))
+						return false;
+					if (!ReadValue(object[m_Key]))
+						return false;
+				}
+				if (bError)
+					return false;
+
+				a_Value.swapPayload(object);
+				--m_nDepth;
+			}
+			return true;
+		case MAJOR_TAG:
+			// no tags change how a value reads into JSON..
+			return ReadValue(a_Value);
+		case MAJOR_SIMPLE:
+			switch (nInfo)
+			{
+			case 20:
+				a_Value = Json::Value(false);
+				return true;
+			case 21:
+				a_Value = Json::Value(true);
+				return true;
+			case 22:
+			case 23:		// undefined
+				a_Value = Json::Value();
+				return true;
+			case 25:
+				a_Value = Json::Value(HalfToDouble((unsigned int)nValue));
+				return true;
+			case 26:
+				{
+					boost::uint32_t nBits = (boost::uint32_t)nValue;
+					float fValue;
+					memcpy(&fValue, &nBits, sizeof(fValue));
+					a_Value = Json::Value((double)fValue);
+				}
+				return true;
+			case 27:
+				{
+					double fValue;
+					memcpy(&fValue, &nValue, sizeof(fValue));
+					a_Value = Json::Value(fValue);
+				}
+				return true;
+			}
+			return Error("Unsupported simple value");
+		}
+
+		return Error("Invalid major type");
+	}
+
+	bool Error(const char * a_pError)
+	{
+		if (m_Error.size() == 0)
+			m_Error = StringUtil::Format("%s at offset %u", a_pError, (unsigned int)(m_pPos - m_pBegin));
+		return false;
+	}
+};
+
+}
+
+void Cbor::Write(const Json::Value & a_Value, std::string & a_Data)
+{
+	a_Data.append(SELF_DESCRIBE, sizeof(SELF_DESCRIBE));
+	WriteValue(a_Value, a_Data);
+}
+
+std::string Cbor::Write(const Json::Value & a_Value)
+{
+	std::string data;
+	Write(a_Value, data);
+	return data;
+}
+
+bool Cbor::Read(const char * a_pBegin, const char * a_pEnd, Json::Value & a_Value, std::string * a_pError /*= NULL*/)
+{
+	CborReader reader(a_pBegin, a_pEnd);
+
+	Json::Value value;
+	if (!reader.Read(value))
+	{
+		a_Value = Json::Value();
+		if (a_pError != NULL)
+			*a_pError = reader.GetError();
+		return false;
+	}
+
+	a_Value.swapPayload(value);
+	return true;
+}
+
+bool Cbor::Read(const std::string & a_Data, Json::Value & a_Value, std::string * a_pError /*= NULL*/)
+{
+	return Read(a_Data.data(), a_Data.data() + a_Data.size(), a_Value, a_pError);
+}
+
+bool Cbor::IsCbor(const std::string & a_Data)
+{
+	return a_Data.size() >= sizeof(SELF_DESCRIBE) && memcmp(a_Data.data(), SELF_DESCRIBE, sizeof(SELF_DESCRIBE)) == 0;
+}
+
+bool Cbor::ParseData(const std::string & a_Data, Json::Value & a_Value, std::string * a_pError /*= NULL*/)
+{
+	if (IsCbor(a_Data))
+		return Read(a_Data, a_Value, a_pError);
+	return JsonParser::ParseJson(a_Data, a_Value, a_pError);
+}
@@ -0,0 +1,51 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_CBOR_H
+#define WDC_CBOR_H
+
+#include <string>
+
+#include "jsoncpp/json/json.h"
+#include "WDCLib.h"		// include last always
+
+//! Reads and writes a Json::Value as CBOR (RFC 7049), a compact binary form of JSON used for the data we
+//! store locally like the DataCache items & config snapshots.
+//!
+//! Numbers are stored with their type, so a real stays a real even when it has no fraction, and integers
+//! read back as they would from JSON text. Reals that fit in a float without losing precision are stored
+//! in 4 bytes. Write() starts the data with the CBOR self-describe tag, which can never be the start
+//! of JSON text, so ParseData() can read both the binary form and JSON text saved by older versions.
+class WDC_API Cbor
+{
+public:
+	//! Append the CBOR for a_Value to a_Data
+	static void Write(const Json::Value & a_Value, std::string & a_Data);
+	static std::string Write(const Json::Value & a_Value);
+
+	//! Read the CBOR data into a_Value, returns false if the data isn't valid CBOR. On failure the
+	//! reason is written into a_pError if it's not NULL.
+	static bool Read(const char * a_pBegin, const char * a_pEnd, Json::Value & a_Value, std::string * a_pError = NULL);
+	static bool Read(const std::string & a_Data, Json::Value & a_Value, std::string * a_pError = NULL);
+
+	//! Returns true if the data starts with the tag written by Write()
+	static bool IsCbor(const std::string & a_Data);
+	//! Read data that is either CBOR from Write() or JSON text.
+	static bool ParseData(const std::string & a_Data, Json::Value & a_Value, std::string * a_pError = NULL);
+};
+
+#endif
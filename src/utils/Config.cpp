@@ -17,6 +17,12 @@
 
 #include "Config.h"
 
+#include <fstream>
+
+#include "boost/filesystem.hpp"
+
+#include "ThreadPool.h"
+
 RTTI_IMPL( Config, ISerializable );
 RTTI_IMPL( ServiceConfig, ISerializable );
 
@@ -33,8 +39,8 @@ void Config::Serialize(Json::Value & json)
 	for( LibraryList::iterator iLib = m_Libs.begin(); iLib != m_Libs.end(); ++iLib )
 		json["m_Libs"][index++] = *iLib;
 
-
-	SerializeVector( "m_ServiceConfigs", m_ServiceConfigs, json, false );
+	ServiceConfigs configs( GetSnapshot()->m_ServiceConfigs );
+	SerializeVector( "m_ServiceConfigs", configs, json, false );
 	SerializeList("m_Services", m_Services, json);
 }
 
@@ -46,53 +52,193 @@ void Config::Deserialize(const Json::Value & json)
 
 	LoadLibs();
 
-	DeserializeVectorNoType( "m_ServiceConfigs", json, m_ServiceConfigs );
+	if ( json.isMember( "m_ServiceConfigs" ) )
+		ReloadServiceConfigs( json );
 	DeserializeList("m_Services", json, m_Services);
+	UpdateServiceTypes();
 }
 
 bool Config::AddServiceConfig( const ServiceConfig & a_Credential, bool a_bUpdateOnly/* = false*/ )
 {
-	for(size_t i=0;i<m_ServiceConfigs.size();++i)
-		if ( m_ServiceConfigs[i]->m_ServiceId == a_Credential.m_ServiceId )
-		{
-			if ( *m_ServiceConfigs[i] != a_Credential )
-			{
-				*m_ServiceConfigs[i] = a_Credential;
-
-				// notify all services using this ID that the configuration has been modified
-				for( ServiceList::iterator iService = m_Services.begin(); 
-					iService != m_Services.end(); ++iService )
-				{
-					const IService::SP & spService = *iService;
-					if (! spService )
-						continue;
-					if ( spService->GetServiceId() == a_Credential.m_ServiceId )
-						(*iService)->OnConfigModified();
-				}
-				return true;
-			}
+	std::vector<std::string> modified;
+	{
+		boost::mutex::scoped_lock lock( m_ConfigLock );
+
+		ServiceConfigs configs( GetSnapshot()->m_ServiceConfigs );
+		size_t i = 0;
+		while( i < configs.size() && configs[i]->m_ServiceId != a_Credential.m_ServiceId )
+			++i;
 
+		if ( i < configs.size() )
+		{
 			// no changes...
-			return false;
+			if ( *configs[i] == a_Credential )
+				return false;
+			configs[i].reset( new ServiceConfig( a_Credential ) );
 		}
+		else if ( a_bUpdateOnly )
+			return false;
+		else
+			configs.push_back( ServiceConfig::SP( new ServiceConfig( a_Credential ) ) );
 
-	if ( a_bUpdateOnly )
-		return false;
-	m_ServiceConfigs.push_back( ServiceConfig::SP( new ServiceConfig( a_Credential ) ) );
+		Publish( configs, modified );
+	}
+
+	NotifyServices( modified );
 	return true;
 }
 
 bool Config::RemoveServiceConfig( const std::string & a_ServiceId )
 {
-	for(size_t i=0;i<m_ServiceConfigs.size();++i)
+	std::vector<std::string> modified;
+	{
+		boost::mutex::scoped_lock lock( m_ConfigLock );
+
+		ServiceConfigs configs( GetSnapshot()->m_ServiceConfigs );
+		size_t i = 0;
+		while( i < configs.size() && configs[i]->m_ServiceId != a_ServiceId )
+			++i;
+		if ( i == configs.size() )
+			return false;
+
+		configs.erase( configs.begin() + i );
+		Publish( configs, modified );
+	}
+
+	NotifyServices( modified );
+	return true;
+}
+
+int Config::ReloadServiceConfigs( const Json::Value & a_Json )
+{
+	// a config without the list is most likely a bad edit, keep the configs we have rather than remove them all
+	if (! a_Json.isMember( "m_ServiceConfigs" ) || !a_Json["m_ServiceConfigs"].isArray() )
+	{
+		Log::Error( "Config", "Ignoring reload, m_ServiceConfigs is missing or isn't an array." );
+		return -1;
+	}
+
+	ServiceConfigs configs;
+	DeserializeVectorNoType( "m_ServiceConfigs", a_Json, configs );
+
+	std::vector<std::string> modified;
+	{
+		boost::mutex::scoped_lock lock( m_ConfigLock );
+		Publish( configs, modified );
+	}
+
+	NotifyServices( modified );
+	return (int)modified.size();
+}
+
+int Config::ReloadServiceConfigs( const std::string & a_File )
+{
+	std::ifstream input( a_File.c_str(), std::ios::in | std::ios::binary );
+	if (! input.is_open() )
+	{
+		Log::Error( "Config", "Failed to open %s.", a_File.c_str() );
+		return -1;
+	}
+
+	Json::Value json;
+	Json::Reader reader;
+	if (! reader.parse( input, json ) )
+	{
+		Log::Error( "Config", "Failed to parse %s: %s", a_File.c_str(), reader.getFormattedErrorMessages().c_str() );
+		return -1;
+	}
+
+	return ReloadServiceConfigs( json );
+}
+
+bool Config::WatchFile( const std::string & a_File, float a_fInterval /*= 1.0f*/ )
+{
+	TimerPool * pTimers = TimerPool::Instance();
+	if ( pTimers == NULL )
+	{
+		Log::Error( "Config", "No TimerPool instance to watch %s.", a_File.c_str() );
+		return false;
+	}
+
+	boost::system::error_code ec;
+	m_WatchFile = a_File;
+	m_WatchTime = boost::filesystem::last_write_time( a_File, ec );
+	m_WatchSize = ec ? 0 : boost::filesystem::file_size( a_File, ec );
+	m_spWatchTimer = pTimers->StartTimer( VOID_DELEGATE( Config, OnWatchTimer, this ), a_fInterval, true, true );
+	return true;
+}
+
+void Config::StopWatching()
+{
+	m_spWatchTimer.reset();
+}
+
+int Config::Publish( const ServiceConfigs & a_Configs, std::vector<std::string> & a_Modified )
+{
+	SnapshotSP spPrevious = GetSnapshot();
+
+	boost::shared_ptr<Snapshot> spSnapshot( new Snapshot() );
+	for(size_t i=0;i<a_Configs.size();++i)
 	{
-		if ( m_ServiceConfigs[i]->m_ServiceId == a_ServiceId )
+		const ServiceConfig::SP & spConfig = a_Configs[i];
+		if (! spConfig || !spSnapshot->m_ServiceConfigMap.insert( std::make_pair( spConfig->m_ServiceId, spConfig ) ).second )
+			continue;		// ignore duplicate IDs like FindServiceConfig() used to
+		spSnapshot->m_ServiceConfigs.push_back( spConfig );
+
+		ServiceConfigMap::const_iterator iPrevious = spPrevious->m_ServiceConfigMap.find( spConfig->m_ServiceId );
+		if ( iPrevious == spPrevious->m_ServiceConfigMap.end() || *iPrevious->second != *spConfig )
+			a_Modified.push_back( spConfig->m_ServiceId );
+	}
+	for(size_t i=0;i<spPrevious->m_ServiceConfigs.size();++i)
+	{
+		const std::string & serviceId = spPrevious->m_ServiceConfigs[i]->m_ServiceId;
+		if ( spSnapshot->m_ServiceConfigMap.find( serviceId ) == spSnapshot->m_ServiceConfigMap.end() )
+			a_Modified.push_back( serviceId );
+	}
+
+	boost::atomic_store( &m_spSnapshot, SnapshotSP( spSnapshot ) );
+	return (int)a_Modified.size();
+}
+
+void Config::NotifyServices( const std::vector<std::string> & a_Modified )
+{
+	// notify all services using these IDs that the configuration has been modified, a service changes its
+	// headers in OnConfigModified() so that's done on the main thread like the rest of its work.
+	ThreadPool * pPool = ThreadPool::Instance();
+	for(size_t i=0;i<a_Modified.size();++i)
+	{
+		for( ServiceList::iterator iService = m_Services.begin(); 
+			iService != m_Services.end(); ++iService )
 		{
-			m_ServiceConfigs.erase( m_ServiceConfigs.begin() + i );
-			return true;
+			const IService::SP & spService = *iService;
+			if (! spService )
+				continue;
+			if ( spService->GetServiceId() != a_Modified[i] )
+				continue;
+			if ( pPool != NULL )
+				pPool->InvokeOnMain( VOID_DELEGATE( IService, OnConfigModified, spService ) );
+			else
+				spService->OnConfigModified();
 		}
 	}
-	return false;
+}
+
+void Config::OnWatchTimer()
+{
+	boost::system::error_code ec;
+	std::time_t modified = boost::filesystem::last_write_time( m_WatchFile, ec );
+	if ( ec )
+		return;
+	boost::uintmax_t size = boost::filesystem::file_size( m_WatchFile, ec );
+	if ( ec || (modified == m_WatchTime && size == m_WatchSize) )
+		return;
+
+	m_WatchTime = modified;
+	m_WatchSize = size;
+
+	int changed = ReloadServiceConfigs( m_WatchFile );
+	if ( changed > 0 )
+		Log::Status( "Config", "Reloaded %d service configs from %s.", changed, m_WatchFile.c_str() );
 }
 
 void Config::LoadLibs()
@@ -167,6 +313,22 @@ bool Config::AddServiceInternal(IService * a_pService)
 	}
 
 	m_Services.push_back(IService::SP(a_pService));
+	UpdateServiceTypes();
 	return true;
 }
 
+void Config::UpdateServiceTypes()
+{
+	m_ServiceTypes.clear();
+	for (ServiceList::const_iterator iService = m_Services.begin(); iService != m_Services.end(); ++iService)
+	{
+		IService * pService = (*iService).get();
+		if (pService == NULL)
+			continue;
+
+		const RTTI::TypeList & types = pService->GetRTTI().GetTypes();
+		for (size_t i = 0; i < types.size(); ++i)
+			m_ServiceTypes[types[i]].push_back(pService);
+	}
+}
+
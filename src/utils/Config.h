@@ -18,12 +18,21 @@
 #ifndef WDC_CONFIG_H
 #define WDC_CONFIG_H
 
+#include <map>
+
+#include "boost/thread/mutex.hpp"
+#include "boost/unordered_map.hpp"
+
 #include "services/IService.h"
 #include "ISerializable.h"
 #include "Library.h"
 #include "ServiceConfig.h"
+#include "TimerPool.h"
 #include "WDCLib.h"
 
+//! The service configs are kept in an immutable snapshot that's swapped atomically, so any thread can look up
+//! a config while another thread adds, removes or reloads them. A ServiceConfig object is never modified once
+//! it's in a snapshot, changing a config replaces it with a new object.
 class WDC_API Config : public ISerializable
 {
 public:
@@ -32,6 +41,16 @@ public:
 	//! Types
 	typedef std::list<std::string>						LibraryList;
 	typedef std::list<boost::shared_ptr<IService> >		ServiceList;
+	typedef std::vector<ServiceConfig::SP>				ServiceConfigs;
+	typedef boost::unordered_map<std::string, ServiceConfig::SP>
+														ServiceConfigMap;
+
+	struct Snapshot
+	{
+		ServiceConfigs		m_ServiceConfigs;		// in the order they were added
+		ServiceConfigMap	m_ServiceConfigMap;		// the same configs by service ID
+	};
+	typedef boost::shared_ptr<const Snapshot>			SnapshotSP;
 
 	//! Singleton
 	static Config * Instance();
@@ -40,12 +59,16 @@ public:
 		const std::string & a_InstanceDataPath = "./" ) : 
 		m_StaticDataPath( a_staticDataPath ),
 		m_InstanceDataPath( a_InstanceDataPath ),
-		m_bServicesActive( false )
+		m_bServicesActive( false ),
+		m_spSnapshot( new Snapshot() ),
+		m_WatchTime( 0 ),
+		m_WatchSize( 0 )
 	{
 		sm_pInstance = this;
 	}
 	~Config()
 	{
+		StopWatching();
 		if ( sm_pInstance == this )
 			sm_pInstance = NULL;
 	}
@@ -73,37 +96,44 @@ public:
 	{
 		return m_Services;
 	}
-	ServiceConfig * FindServiceConfig( const std::string & a_ServiceId ) const
+	//! Returns the current service configs, this may be called from any thread.
+	SnapshotSP GetSnapshot() const
 	{
-		for(size_t i=0;i<m_ServiceConfigs.size();++i)
-			if ( m_ServiceConfigs[i]->m_ServiceId == a_ServiceId )
-				return m_ServiceConfigs[i].get();
-		return NULL;
+		return boost::atomic_load( &m_spSnapshot );
+	}
+	//! Returns the config for the given service ID, or an empty pointer. The returned config stays valid
+	//! after it's been replaced or removed.
+	ServiceConfig::SP FindServiceConfig( const std::string & a_ServiceId ) const
+	{
+		SnapshotSP spSnapshot = GetSnapshot();
+		ServiceConfigMap::const_iterator iConfig = spSnapshot->m_ServiceConfigMap.find( a_ServiceId );
+		if ( iConfig != spSnapshot->m_ServiceConfigMap.end() )
+			return iConfig->second;
+		return ServiceConfig::SP();
 	}
 
 	bool IsConfigured( const std::string & a_ServiceId, AuthType a_AuthType = AUTH_BASIC ) const
 	{
-		ServiceConfig * pConfig = FindServiceConfig( a_ServiceId );
-		if ( pConfig != NULL )
-			return pConfig->IsConfigured( a_AuthType );
+		ServiceConfig::SP spConfig = FindServiceConfig( a_ServiceId );
+		if ( spConfig )
+			return spConfig->IsConfigured( a_AuthType );
 		return false;
 	}
 
-	//! Returns the given service by it's type.
+	//! Returns the given service by it's type. This is a lookup of the type, so it's cheap enough to call
+	//! on a hot path.
 	template<typename T>
 	T * FindService( const std::string & a_ServiceId = EMPTY_STRING ) const
 	{
-		for (ServiceList::const_iterator iService = m_Services.begin(); iService != m_Services.end(); ++iService)
+		ServiceTypeMap::const_iterator iType = m_ServiceTypes.find( &T::GetStaticRTTI() );
+		if ( iType == m_ServiceTypes.end() )
+			return NULL;
+
+		const TypeServices & services = iType->second;
+		for(size_t i=0;i<services.size();++i)
 		{
-			IService * pService = (*iService).get();
-			if ( pService == NULL )
-				continue;
-			if ( a_ServiceId[0] != 0 && a_ServiceId != pService->GetServiceId() )
-				continue;		// service ID doesn't match
-
-			T * pServiceT = DynamicCast<T>(pService);
-			if (pServiceT != NULL)
-				return pServiceT;
+			if ( a_ServiceId[0] == 0 || a_ServiceId == services[i]->GetServiceId() )
+				return static_cast<T *>( services[i] );
 		}
 
 		return NULL;
@@ -113,11 +143,12 @@ public:
 	template<typename T>
 	int FindServices(std::vector<T*> & a_Services)
 	{
-		for (ServiceList::const_iterator iService = m_Services.begin(); iService != m_Services.end(); ++iService)
+		ServiceTypeMap::const_iterator iType = m_ServiceTypes.find( &T::GetStaticRTTI() );
+		if ( iType != m_ServiceTypes.end() )
 		{
-			T * pService = DynamicCast<T>((*iService).get());
-			if (pService != NULL)
-				a_Services.push_back(pService);
+			const TypeServices & services = iType->second;
+			for(size_t i=0;i<services.size();++i)
+				a_Services.push_back( static_cast<T *>( services[i] ) );
 		}
 
 		return a_Services.size();
@@ -154,6 +185,7 @@ public:
 					return false;
 
 				m_Services.erase( iService );
+				UpdateServiceTypes();
 				return true;
 			}
 		}
@@ -164,6 +196,17 @@ public:
 	//! Mutators
 	bool AddServiceConfig( const ServiceConfig & a_Credential, bool a_bUpdateOnly = false );
 	bool RemoveServiceConfig( const std::string & a_ServiceId );
+	//! Replace all the service configs with the "m_ServiceConfigs" of the given config json, the services
+	//! and libraries are left as they are. Returns the number of configs that were added, changed or removed, or
+	//! -1 if the json has no "m_ServiceConfigs" array, in which case nothing is changed.
+	int ReloadServiceConfigs( const Json::Value & a_Json );
+	//! Reload the service configs from the given file, e.g. config.json. Returns -1 if it can't be read.
+	int ReloadServiceConfigs( const std::string & a_File );
+
+	//! Check the given file every a_fInterval seconds, reloading the service configs when it's modified.
+	//! The reload and the OnConfigModified() of the services happen on the main thread.
+	bool WatchFile( const std::string & a_File, float a_fInterval = 1.0f );
+	void StopWatching();
 
 	//! load all dynamic libs
 	void LoadLibs();
@@ -176,9 +219,19 @@ public:
 protected:
 	//! Types
 	typedef std::list<Library>	LoadedLibraryList;
-	typedef std::vector<ServiceConfig::SP> ServiceConfigs;
+	typedef std::vector<IService *>						TypeServices;
+	typedef std::map<const RTTI *, TypeServices>		ServiceTypeMap;
 
 	bool AddServiceInternal(IService * a_pService);
+	//! This must be called after m_Services is changed
+	void UpdateServiceTypes();
+	//! Publish a new snapshot of the given configs, adding the IDs of the added, changed or removed configs
+	//! to a_Modified. The caller must hold m_ConfigLock.
+	int Publish( const ServiceConfigs & a_Configs, std::vector<std::string> & a_Modified );
+	//! Queue OnConfigModified() on the main thread for the services with the given IDs, or invoke it now if
+	//! there is no ThreadPool. This is done without holding m_ConfigLock.
+	void NotifyServices( const std::vector<std::string> & a_Modified );
+	void OnWatchTimer();
 
 	//! Data
 	std::string		m_StaticDataPath;
@@ -186,9 +239,18 @@ protected:
 	LibraryList		m_Libs;				// list of libraries to load dynamically
 	ServiceList		m_Services;			// list of available services
 	bool			m_bServicesActive;
-	ServiceConfigs	m_ServiceConfigs;
+	boost::mutex	m_ConfigLock;		// serializes changes to the service configs
+	SnapshotSP		m_spSnapshot;		// current snapshot, use boost::atomic_load()/atomic_store()
 	LoadedLibraryList
 					m_LoadedLibs;
+	ServiceTypeMap	m_ServiceTypes;		// services by each class in their hierarchy, in the order of m_Services
+
+	std::string		m_WatchFile;
+	std::time_t		m_WatchTime;		// last modified time & size of m_WatchFile
+	boost::uintmax_t
+					m_WatchSize;
+	TimerPool::ITimer::SP
+					m_spWatchTimer;
 
 	static Config *	sm_pInstance;
 };
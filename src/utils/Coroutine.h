@@ -0,0 +1,438 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_COROUTINE_H
+#define WDC_COROUTINE_H
+
+//! An optional C++20 coroutine layer over Future & Promise. The library itself is built as C++03, this header
+//! only defines WDC_HAS_COROUTINES & the types below when it's included by code built with coroutine support,
+//! and WDC_DISABLE_COROUTINES isn't defined.
+//!
+//! A function returning Future<T> can be written as a coroutine:
+//!
+//! Future<int> CountClassifiers( NaturalLanguageClassifier * a_pNLC )
+//! {
+//!		NaturalLanguageClassifier::ClassifiersSP spList = co_await a_pNLC->FindClassifiers( "*" );
+//!		co_await Coroutine::Sleep( 1.0 );
+//!		co_return (int)spList->m_Classifiers.size();
+//! }
+//!
+//! Awaiting a Future returns its value, or throws a WatsonException if it failed or was canceled. Any service
+//! call that takes a callback is awaited with Promise<T>::Start(). An exception that leaves the coroutine fails
+//! its future. Canceling the future of a coroutine cancels the future it's awaiting, & the coroutine stops at
+//! its next co_await.
+//!
+//! A coroutine resumes on the thread that completed what it awaited, for a service request that's the main
+//! thread. Coroutine::SwitchTo() moves it onto the main thread or the ThreadPool. The frames are allocated
+//! from CoroutineFramePool.
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && !defined(WDC_DISABLE_COROUTINES)
+#define WDC_HAS_COROUTINES		1
+#endif
+
+#if defined(WDC_HAS_COROUTINES)
+
+#include <coroutine>
+#include <cstdlib>
+#include <exception>
+#include <string>
+
+#include "boost/thread.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include "Future.h"
+#include "IWebClient.h"
+#include "StringUtil.h"
+#include "ThreadPool.h"
+#include "TimerPool.h"
+#include "WatsonException.h"
+#include "WDCLib.h"		// include last always
+
+//! Keeps the freed coroutine frames in free lists by size, so a coroutine started for each request doesn't
+//! go to the heap. Frames are freed on whichever thread the coroutine finished on, so each list has a lock.
+class CoroutineFramePool
+{
+public:
+	static void * Allocate(size_t a_nSize)
+	{
+		SizeClass * pClass = GetClass(a_nSize);
+		if (pClass != NULL)
+		{
+			boost::mutex::scoped_lock lock(pClass->m_Lock);
+			Block * pBlock = pClass->m_pFree;
+			if (pBlock != NULL)
+			{
+				pClass->m_pFree = pBlock->m_pNext;
+				pClass->m_nFree -= 1;
+				return pBlock;
+			}
+			a_nSize = RoundUp(a_nSize);
+		}
+
+		void * pFrame = malloc(a_nSize);
+		if (pFrame == NULL)
+			throw std::bad_alloc();
+		return pFrame;
+	}
+
+	static void Free(void * a_pFrame, size_t a_nSize)
+	{
+		SizeClass * pClass = GetClass(a_nSize);
+		if (pClass != NULL)
+		{
+			boost::mutex::scoped_lock lock(pClass->m_Lock);
+			if (pClass->m_nFree < MAX_FREE)
+			{
+				Block * pBlock = static_cast<Block *>(a_pFrame);
+				pBlock->m_pNext = pClass->m_pFree;
+				pClass->m_pFree = pBlock;
+				pClass->m_nFree += 1;
+				return;
+			}
+		}
+		free(a_pFrame);
+	}
+
+	//! Returns the number of frames of the given size waiting to be reused
+	static size_t GetFreeCount(size_t a_nSize)
+	{
+		SizeClass * pClass = GetClass(a_nSize);
+		if (pClass == NULL)
+			return 0;
+
+		boost::mutex::scoped_lock lock(pClass->m_Lock);
+		return pClass->m_nFree;
+	}
+
+private:
+	//! Types
+	struct Block
+	{
+		Block *		m_pNext;
+	};
+	struct SizeClass
+	{
+		SizeClass() : m_pFree(NULL), m_nFree(0)
+		{}
+
+		boost::mutex	m_Lock;
+		Block *			m_pFree;
+		size_t			m_nFree;
+	};
+
+	static const size_t GRANULE = 64;
+	static const size_t CLASS_COUNT = 32;		// frames up to 2K are pooled
+	static const size_t MAX_FREE = 256;			// frames kept per size
+
+	static size_t RoundUp(size_t a_nSize)
+	{
+		return (a_nSize + GRANULE - 1) & ~(GRANULE - 1);
+	}
+	static SizeClass * GetClass(size_t a_nSize)
+	{
+		static SizeClass CLASSES[CLASS_COUNT];
+
+		size_t nClass = (a_nSize + GRANULE - 1) / GRANULE;
+		if (nClass == 0 || nClass > CLASS_COUNT)
+			return NULL;
+		return &CLASSES[nClass - 1];
+	}
+};
+
+//! Awaitables for the thread & timer pools, and for an IWebClient.
+class Coroutine
+{
+public:
+	//! Types
+	//! Resumes a coroutine, used as the callback of a delegate
+	struct Resume
+	{
+		Resume(std::coroutine_handle<> a_Handle) : m_Handle(a_Handle)
+		{}
+		void operator()()
+		{
+			m_Handle.resume();
+		}
+
+		std::coroutine_handle<>		m_Handle;
+	};
+
+	struct SleepAwaiter
+	{
+		SleepAwaiter(double a_fSeconds, bool a_bInvokeOnMain) : m_fSeconds(a_fSeconds), m_bInvokeOnMain(a_bInvokeOnMain)
+		{}
+
+		//! with no TimerPool the thread sleeps instead
+		bool await_ready() const
+		{
+			if (m_fSeconds <= 0.0)
+				return true;
+			if (TimerPool::Instance() != NULL)
+				return false;
+			boost::this_thread::sleep(boost::posix_time::microseconds((boost::int64_t)(m_fSeconds * 1000000.0)));
+			return true;
+		}
+		void await_suspend(std::coroutine_handle<> a_Handle)
+		{
+			// the pool only holds a weak pointer to the timer, the awaiter keeps it until the coroutine resumes
+			m_spTimer = TimerPool::Instance()->StartTimer(VOID_FUNCTOR_DELEGATE(Resume(a_Handle)), m_fSeconds, m_bInvokeOnMain, false);
+		}
+		void await_resume() const
+		{}
+
+		double					m_fSeconds;
+		bool					m_bInvokeOnMain;
+		TimerPool::ITimer::SP	m_spTimer;
+	};
+
+	struct SwitchAwaiter
+	{
+		SwitchAwaiter(FutureState::Executor a_eExecutor) : m_eExecutor(a_eExecutor)
+		{}
+
+		bool await_ready() const
+		{
+			return m_eExecutor == FutureState::INLINE || ThreadPool::Instance() == NULL;
+		}
+		void await_suspend(std::coroutine_handle<> a_Handle)
+		{
+			FutureState::Invoke(VOID_FUNCTOR_DELEGATE(Resume(a_Handle)), m_eExecutor);
+		}
+		void await_resume() const
+		{}
+
+		FutureState::Executor	m_eExecutor;
+	};
+
+	//! Resume after a_fSeconds, on the main thread or a pool thread.
+	static SleepAwaiter Sleep(double a_fSeconds, bool a_bInvokeOnMain = true)
+	{
+		return SleepAwaiter(a_fSeconds, a_bInvokeOnMain);
+	}
+
+	//! Resume on the main thread or a pool thread.
+	static SwitchAwaiter SwitchTo(FutureState::Executor a_eExecutor)
+	{
+		return SwitchAwaiter(a_eExecutor);
+	}
+
+	//! Send the request of a_spClient, the future is ready with the response body once it's complete, or
+	//! fails on an error status or lost connection. Canceling it closes the client.
+	static Future<std::string> Send(const IWebClient::SP & a_spClient)
+	{
+		Promise<std::string> promise;
+		boost::shared_ptr<std::string> spResponse(new std::string());
+		a_spClient->SetDataReceiver(FUNCTOR_DELEGATE(IWebClient::RequestData *, OnData(promise, spResponse)));
+		a_spClient->SetStateReceiver(FUNCTOR_DELEGATE(IWebClient *, OnState(promise)));
+		promise.GetState()->AddCanceler(VOID_FUNCTOR_DELEGATE(Close(a_spClient)), FutureState::MAIN_THREAD);
+
+		if (!a_spClient->Send())
+			promise.SetError("Failed to send.");
+		return promise.GetFuture();
+	}
+
+	//! Connect a_spClient, e.g. a web socket. The future is ready with the state once the client is
+	//! CONNECTED, CLOSED or DISCONNECTED, the caller then sets its own state & data receivers.
+	static Future<IWebClient::SocketState> Connect(const IWebClient::SP & a_spClient)
+	{
+		Promise<IWebClient::SocketState> promise;
+		a_spClient->SetStateReceiver(FUNCTOR_DELEGATE(IWebClient *, OnConnect(promise)));
+		promise.GetState()->AddCanceler(VOID_FUNCTOR_DELEGATE(Close(a_spClient)), FutureState::MAIN_THREAD);
+
+		if (!a_spClient->Send())
+			promise.SetValue(IWebClient::DISCONNECTED);
+		return promise.GetFuture();
+	}
+
+private:
+	//! Types
+	struct OnData
+	{
+		OnData(const Promise<std::string> & a_Promise, const boost::shared_ptr<std::string> & a_spResponse) :
+			m_Promise(a_Promise), m_spResponse(a_spResponse)
+		{}
+		void operator()(IWebClient::RequestData * a_pData)
+		{
+			*m_spResponse += a_pData->m_Content;
+			if (!a_pData->m_bDone)
+				return;
+
+			if (a_pData->m_StatusCode >= 200 && a_pData->m_StatusCode < 300)
+				m_Promise.SetValue(*m_spResponse);
+			else
+				m_Promise.SetError(StringUtil::Format("Request failed with status %u.", a_pData->m_StatusCode));
+		}
+
+		Promise<std::string>				m_Promise;
+		boost::shared_ptr<std::string>		m_spResponse;
+	};
+	struct OnState
+	{
+		OnState(const Promise<std::string> & a_Promise) : m_Promise(a_Promise)
+		{}
+		void operator()(IWebClient * a_pClient)
+		{
+			if (a_pClient->GetState() == IWebClient::DISCONNECTED)
+				m_Promise.SetError("Connection lost.");
+		}
+
+		Promise<std::string>		m_Promise;
+	};
+	struct OnConnect
+	{
+		OnConnect(const Promise<IWebClient::SocketState> & a_Promise) : m_Promise(a_Promise)
+		{}
+		void operator()(IWebClient * a_pClient)
+		{
+			IWebClient::SocketState eState = a_pClient->GetState();
+			if (eState == IWebClient::CONNECTED || eState == IWebClient::CLOSED || eState == IWebClient::DISCONNECTED)
+				m_Promise.SetValue(eState);
+		}
+
+		Promise<IWebClient::SocketState>	m_Promise;
+	};
+	struct Close
+	{
+		Close(const IWebClient::SP & a_spClient) : m_spClient(a_spClient)
+		{}
+		void operator()()
+		{
+			m_spClient->Close();
+		}
+
+		IWebClient::SP		m_spClient;
+	};
+};
+
+//! Waits on a Future from a coroutine, see operator co_await below.
+template<typename T>
+struct FutureAwaiter
+{
+	FutureAwaiter(const Future<T> & a_Future) : m_Future(a_Future)
+	{}
+
+	bool await_ready() const
+	{
+		return !m_Future.IsPending();
+	}
+	void await_suspend(std::coroutine_handle<> a_Handle)
+	{
+		m_Future.GetState()->AddCallback(VOID_FUNCTOR_DELEGATE(Coroutine::Resume(a_Handle)));
+	}
+	const T & await_resume() const
+	{
+		if (!m_Future.IsReady())
+			throw WatsonException(m_Future.GetError().c_str());
+		return m_Future.GetValue();
+	}
+
+	Future<T>	m_Future;
+};
+
+template<typename T>
+FutureAwaiter<T> operator co_await(const Future<T> & a_Future)
+{
+	return FutureAwaiter<T>(a_Future);
+}
+
+//! The promise_type of a coroutine that returns Future<T>.
+template<typename T>
+struct FutureCoroutine
+{
+	Promise<T>		m_Promise;
+
+	Future<T> get_return_object()
+	{
+		return m_Promise.GetFuture();
+	}
+	std::suspend_never initial_suspend() noexcept
+	{
+		return std::suspend_never();
+	}
+	std::suspend_never final_suspend() noexcept
+	{
+		return std::suspend_never();
+	}
+	void return_value(const T & a_Value)
+	{
+		m_Promise.SetValue(a_Value);
+	}
+	void unhandled_exception()
+	{
+		try {
+			throw;
+		}
+		catch (const std::exception & ex)
+		{
+			m_Promise.SetError(ex.what());
+		}
+		catch (...)
+		{
+			m_Promise.SetError("Unknown exception.");
+		}
+	}
+
+	//! Stop at the next co_await once canceled, & pass a cancel on to the future being awaited.
+	template<typename A>
+	A && await_transform(A && a_Awaitable)
+	{
+		CheckCanceled();
+		return static_cast<A &&>(a_Awaitable);
+	}
+	template<typename U>
+	FutureAwaiter<U> await_transform(const Future<U> & a_Future)
+	{
+		CheckCanceled();
+		m_Promise.GetState()->AddCanceler(VOID_FUNCTOR_DELEGATE(FutureState::Canceler(a_Future.GetState())));
+		return FutureAwaiter<U>(a_Future);
+	}
+	template<typename U>
+	FutureAwaiter<U> await_transform(Future<U> & a_Future)
+	{
+		return await_transform(static_cast<const Future<U> &>(a_Future));
+	}
+	template<typename U>
+	FutureAwaiter<U> await_transform(Future<U> && a_Future)
+	{
+		return await_transform(static_cast<const Future<U> &>(a_Future));
+	}
+
+	void CheckCanceled() const
+	{
+		if (m_Promise.GetFuture().IsCanceled())
+			throw WatsonException("Canceled.");
+	}
+
+	static void * operator new(size_t a_nSize)
+	{
+		return CoroutineFramePool::Allocate(a_nSize);
+	}
+	static void operator delete(void * a_pFrame, size_t a_nSize)
+	{
+		CoroutineFramePool::Free(a_pFrame, a_nSize);
+	}
+};
+
+template<typename T, typename... ARGS>
+struct std::coroutine_traits< Future<T>, ARGS... >
+{
+	typedef FutureCoroutine<T>		promise_type;
+};
+
+#endif // WDC_HAS_COROUTINES
+
+#endif
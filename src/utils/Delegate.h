@@ -19,19 +19,13 @@
 #define WDC_DELEGATE_H
 
 #include <list>
+#include <new>
 #include <boost/shared_ptr.hpp>
-#include <boost/any.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/type_traits/alignment_of.hpp>
 
 #include "WDCLib.h"
 
-#ifndef ENABLE_DELEGATE_DEBUG
-#if defined(_DEBUG) || !defined(__OPTIMIZE__)
-#define ENABLE_DELEGATE_DEBUG 1
-#else
-#define ENABLE_DELEGATE_DEBUG 0
-#endif
-#endif
-
 //! This delegate class allows you to store a function call to object. This is useful for passing a callback
 //! around through functions or storing that callback as a data member in a class.
 //!
@@ -39,244 +33,404 @@
 //! 
 //! d( 42 );		// invoke the delegate function
 //!
+//! A delegate can also call a copy of a function object, e.g. the result of boost::bind():
+//!
+//! Delegate<int> d = FUNCTOR_DELEGATE( int, boost::bind( &MyObject::Func2, pObject, _1, "extra" ) );
+//!
+
+//! The storage shared by Delegate & VoidDelegate. The object, the weak pointer to it for a delegate made from a
+//! shared_ptr, or a function object of up to three pointers are kept inline so making or copying a delegate
+//! never allocates. A larger function object is copied onto the heap.
+class DelegateBase
+{
+public:
+	bool IsObject(void * obj) const
+	{
+		return obj == m_pObject;
+	}
+
+	//! Returns true if this delegate was made from a shared_ptr and that object has been destroyed.
+	bool IsExpired() const
+	{
+		return m_pManager == &ManageWeak
+			&& reinterpret_cast<const WeakObject *>(&m_Storage)->m_WeakPtr.expired();
+	}
+
+	//! The file & line the delegate was made at, used by the Profiler.
+	const char * GetFile() const
+	{
+		return m_pFile;
+	}
+
+	int GetLine() const
+	{
+		return m_nLine;
+	}
+
+protected:
+	//! Types
+	union Storage
+	{
+		void *		m_pPointers[3];
+		double		m_fAlign;
+	};
+	struct WeakObject
+	{
+		template<typename T>
+		WeakObject(const boost::shared_ptr<T> & a_spObject) : m_pObject(a_spObject.get()), m_WeakPtr(a_spObject)
+		{}
+
+		void *					m_pObject;
+		boost::weak_ptr<void>	m_WeakPtr;
+	};
+	//! Copies the contents of a_pSource into a_Dest, or destroys the contents of a_Dest if a_pSource is NULL
+	typedef void (*manager_type)(Storage & a_Dest, const Storage * a_pSource);
+
+	//! Construction
+	DelegateBase() : m_pObject(0), m_pManager(0), m_pFile(""), m_nLine(0)
+	{
+		m_Storage.m_pPointers[0] = m_Storage.m_pPointers[1] = m_Storage.m_pPointers[2] = 0;
+	}
+	DelegateBase(const DelegateBase & a_Copy) : m_pObject(0), m_pManager(0), m_pFile(""), m_nLine(0)
+	{
+		Copy(a_Copy);
+	}
+	~DelegateBase()
+	{
+		Clear();
+	}
+
+	DelegateBase & operator=(const DelegateBase & a_Copy)
+	{
+		if (this != &a_Copy)
+		{
+			Clear();
+			Copy(a_Copy);
+		}
+		return *this;
+	}
+
+	void SetObject(void * a_pObject, const char * a_pFile, int a_nLine)
+	{
+		m_pObject = a_pObject;
+		m_Storage.m_pPointers[0] = a_pObject;
+		m_pFile = a_pFile;
+		m_nLine = a_nLine;
+	}
+
+	template<typename T>
+	void SetWeakObject(const boost::shared_ptr<T> & a_spObject, const char * a_pFile, int a_nLine)
+	{
+		m_pObject = a_spObject.get();
+		new (&m_Storage) WeakObject(a_spObject);
+		m_pManager = &ManageWeak;
+		m_pFile = a_pFile;
+		m_nLine = a_nLine;
+	}
+
+	template<typename F>
+	void SetFunctor(const F & a_Functor, const char * a_pFile, int a_nLine)
+	{
+		FunctorStorage<F, IsSmall<F>::value>::Set(m_Storage, a_Functor);
+		m_pManager = &FunctorStorage<F, IsSmall<F>::value>::Manage;
+		m_pFile = a_pFile;
+		m_nLine = a_nLine;
+	}
+
+	void Clear()
+	{
+		if (m_pManager != 0)
+			(*m_pManager)(m_Storage, 0);
+		m_pManager = 0;
+		m_pObject = 0;
+	}
+
+	//! Returns the object, or NULL if the object of a weak delegate has been destroyed. a_spLock keeps
+	//! the object alive until it goes out of scope.
+	static void * LockObject(const Storage & a_Storage, boost::shared_ptr<void> & a_spLock)
+	{
+		const WeakObject & weak = *reinterpret_cast<const WeakObject *>(&a_Storage);
+		a_spLock = weak.m_WeakPtr.lock();
+		return a_spLock ? weak.m_pObject : 0;
+	}
+
+	template<typename F>
+	static F * GetFunctor(const Storage & a_Storage)
+	{
+		return FunctorStorage<F, IsSmall<F>::value>::Get(const_cast<Storage &>(a_Storage));
+	}
+
+	//! Data
+	void *			m_pObject;		// NULL for a function object
+	Storage			m_Storage;
+	manager_type	m_pManager;		// NULL if m_Storage only holds a pointer
+	const char *	m_pFile;
+	int				m_nLine;
+
+private:
+	template<typename F>
+	struct IsSmall
+	{
+		static const bool value = sizeof(F) <= sizeof(Storage)
+			&& boost::alignment_of<F>::value <= boost::alignment_of<Storage>::value;
+	};
+
+	template<typename F, bool SMALL>
+	struct FunctorStorage
+	{
+		static void Set(Storage & a_Storage, const F & a_Functor)
+		{
+			new (&a_Storage) F(a_Functor);
+		}
+		static F * Get(Storage & a_Storage)
+		{
+			return reinterpret_cast<F *>(&a_Storage);
+		}
+		static void Manage(Storage & a_Dest, const Storage * a_pSource)
+		{
+			if (a_pSource != 0)
+				new (&a_Dest) F(*reinterpret_cast<const F *>(a_pSource));
+			else
+				reinterpret_cast<F *>(&a_Dest)->~F();
+		}
+	};
+	template<typename F>
+	struct FunctorStorage<F, false>
+	{
+		static void Set(Storage & a_Storage, const F & a_Functor)
+		{
+			a_Storage.m_pPointers[0] = new F(a_Functor);
+		}
+		static F * Get(Storage & a_Storage)
+		{
+			return static_cast<F *>(a_Storage.m_pPointers[0]);
+		}
+		static void Manage(Storage & a_Dest, const Storage * a_pSource)
+		{
+			if (a_pSource != 0)
+				a_Dest.m_pPointers[0] = new F(*static_cast<const F *>(a_pSource->m_pPointers[0]));
+			else
+				delete static_cast<F *>(a_Dest.m_pPointers[0]);
+		}
+	};
+
+	static void ManageWeak(Storage & a_Dest, const Storage * a_pSource)
+	{
+		if (a_pSource != 0)
+			new (&a_Dest) WeakObject(*reinterpret_cast<const WeakObject *>(a_pSource));
+		else
+			reinterpret_cast<WeakObject *>(&a_Dest)->~WeakObject();
+	}
+
+	void Copy(const DelegateBase & a_Copy)
+	{
+		if (a_Copy.m_pManager != 0)
+			(*a_Copy.m_pManager)(m_Storage, &a_Copy.m_Storage);
+		else
+			m_Storage = a_Copy.m_Storage;
+		m_pManager = a_Copy.m_pManager;
+		m_pObject = a_Copy.m_pObject;
+		m_pFile = a_Copy.m_pFile;
+		m_nLine = a_Copy.m_nLine;
+	}
+};
 
 template<typename ARG>
-class Delegate
+class Delegate : public DelegateBase
 {
 public:
-	Delegate() : m_pObject(0), m_pStub(0)
+	Delegate() : m_pStub(0)
 	{}
 
 	template <class T, void (T::*TMethod)(ARG)>
-#if !ENABLE_DELEGATE_DEBUG
-	static Delegate Create(T* object_ptr)
-#else
 	static Delegate Create(T* object_ptr, const char * a_pFile, int a_nLine )
-#endif
 	{
 		Delegate d;
 		if ( object_ptr != 0 )
 		{
-			d.m_pObject = object_ptr;
+			d.SetObject( object_ptr, a_pFile, a_nLine );
 			d.m_pStub = &method_stub<T, TMethod>; // #1
-#if ENABLE_DELEGATE_DEBUG
-			d.m_pFile = a_pFile;
-			d.m_nLine = a_nLine;
-#endif
 		}
 		return d;
 	}
 
 	template <class T, void (T::*TMethod)(ARG)>
-#if !ENABLE_DELEGATE_DEBUG
-	static Delegate Create( boost::shared_ptr<T> object_ptr )
-#else
-	static Delegate Create( boost::shared_ptr<T> object_ptr, const char * a_pFile, int a_nLine )
-#endif
+	static Delegate Create( const boost::shared_ptr<T> & object_ptr, const char * a_pFile, int a_nLine )
 	{
 		Delegate d;
 		if ( object_ptr != 0 )
 		{
-			d.m_pObject = object_ptr.get();
-			d.m_WeakPtr = boost::weak_ptr<T>( object_ptr );
-			d.m_pStub = &method_stub<T, TMethod>; // #1
-#if ENABLE_DELEGATE_DEBUG
-			d.m_pFile = a_pFile;
-			d.m_nLine = a_nLine;
-#endif
+			d.SetWeakObject( object_ptr, a_pFile, a_nLine );
+			d.m_pStub = &weak_method_stub<T, TMethod>; // #1
 		}
 		return d;
 	}
 
+	//! Make a delegate that calls a copy of the given function object
+	template <class F>
+	static Delegate Create( const F & a_Functor, const char * a_pFile, int a_nLine )
+	{
+		Delegate d;
+		d.SetFunctor( a_Functor, a_pFile, a_nLine );
+		d.m_pStub = &functor_stub<F>;
+		return d;
+	}
+
 	bool operator()(ARG a1) const
 	{
 		if (m_pStub != 0) 
-			return (*m_pStub)(m_pObject, m_WeakPtr, a1);
+			return (*m_pStub)(m_Storage, a1);
 		return false;
 	}
 
 	void Reset()
 	{
-		m_pObject = 0;
-		m_WeakPtr.clear();
+		Clear();
 		m_pStub = 0;
 	}
 
 	bool IsValid() const
 	{
-		return m_pObject != 0 && m_pStub != 0;
+		return m_pStub != 0;
 	}
 
-	bool IsObject(void * obj) const
-	{
-		return obj == m_pObject;
-	}
+private:
+	typedef bool (*stub_type)(const Storage & a_Storage, ARG);
 
-#if ENABLE_DELEGATE_DEBUG
-	const char * GetFile() const
-	{
-		return m_pFile;
-	}
+	stub_type		m_pStub;
 
-	int GetLine() const
+	template <class T, void (T::*TMethod)(ARG)>
+	static bool method_stub(const Storage & a_Storage, ARG a1)
 	{
-		return m_nLine;
+		T* p = reinterpret_cast<T*>(a_Storage.m_pPointers[0]);
+		(p->*TMethod)(a1); // #2
+		return true;
 	}
-#endif
-
-private:
-	typedef bool (*stub_type)(void* object_ptr, const boost::any & weak_ptr, ARG);
-
-	void *			m_pObject;
-	boost::any		m_WeakPtr;
-	stub_type		m_pStub;
-#if ENABLE_DELEGATE_DEBUG
-	const char *	m_pFile;
-	int				m_nLine;
-#endif
 
 	template <class T, void (T::*TMethod)(ARG)>
-	static bool method_stub(void* object_ptr, const boost::any & weak_ptr, ARG a1)
+	static bool weak_method_stub(const Storage & a_Storage, ARG a1)
 	{
-		if (! weak_ptr.empty() )
-			object_ptr = boost::any_cast< boost::weak_ptr<T> >( weak_ptr ).lock().get();
-		if ( object_ptr == 0 )
+		boost::shared_ptr<void> spLock;
+		T* p = reinterpret_cast<T*>(LockObject(a_Storage, spLock));
+		if ( p == 0 )
 			return false;
 
-		T* p = reinterpret_cast<T*>(object_ptr);
 		(p->*TMethod)(a1); // #2
 		return true;
 	}
+
+	template <class F>
+	static bool functor_stub(const Storage & a_Storage, ARG a1)
+	{
+		(*GetFunctor<F>(a_Storage))(a1);
+		return true;
+	}
 };
 
 //! Helper macro for making a delegate a little bit less wordy, e.g.
 //! Delegate<int> d = DELEGATE( int, MyObject, Func, pObject );
-#if !ENABLE_DELEGATE_DEBUG
-#define DELEGATE( CLASS, FUNC, ARG, OBJ )		Delegate<ARG>::Create<CLASS,&CLASS::FUNC>( OBJ )
-#else
 #define DELEGATE( CLASS, FUNC, ARG, OBJ )		Delegate<ARG>::Create<CLASS,&CLASS::FUNC>( OBJ, __FILE__, __LINE__ )
-#endif
+//! Make a delegate that calls a copy of a function object, e.g.
+//! Delegate<int> d = FUNCTOR_DELEGATE( int, boost::bind( &MyObject::Func2, pObject, _1, 3.0f ) );
+#define FUNCTOR_DELEGATE( ARG, FUNCTOR )		Delegate<ARG>::Create( FUNCTOR, __FILE__, __LINE__ )
 
 //! Delegate for a function that doesn't take any arguments.
-class VoidDelegate
+class VoidDelegate : public DelegateBase
 {
 public:
-	VoidDelegate() : m_pObject(0),
-		m_pStub(0)
+	VoidDelegate() : m_pStub(0)
 	{}
 
 	template <class T, void (T::*TMethod)()>
-#if !ENABLE_DELEGATE_DEBUG
-	static VoidDelegate Create(T* object_ptr)
-#else
 	static VoidDelegate Create(T* object_ptr, const char * a_pFile, int a_nLine)
-#endif
 	{
 		VoidDelegate d;
 		if ( object_ptr != 0 )
 		{
-			d.m_pObject = object_ptr;
+			d.SetObject( object_ptr, a_pFile, a_nLine );
 			d.m_pStub = &method_stub<T, TMethod>; // #1
-#if ENABLE_DELEGATE_DEBUG
-			d.m_pFile = a_pFile;
-			d.m_nLine = a_nLine;
-#endif
 		}
 		return d;
 	}
 
 	template <class T, void (T::*TMethod)()>
-#if !ENABLE_DELEGATE_DEBUG
-	static VoidDelegate Create(boost::shared_ptr<T> object_ptr)
-#else
-	static VoidDelegate Create(boost::shared_ptr<T> object_ptr, const char * a_pFile, int a_nLine)
-#endif
+	static VoidDelegate Create(const boost::shared_ptr<T> & object_ptr, const char * a_pFile, int a_nLine)
 	{
 		VoidDelegate d;
 		if ( object_ptr != 0 )
 		{
-			d.m_pObject = object_ptr.get();
-			d.m_WeakPtr = boost::weak_ptr<T>( object_ptr );
-			d.m_pStub = &method_stub<T, TMethod>; // #1
-#if ENABLE_DELEGATE_DEBUG
-			d.m_pFile = a_pFile;
-			d.m_nLine = a_nLine;
-#endif
+			d.SetWeakObject( object_ptr, a_pFile, a_nLine );
+			d.m_pStub = &weak_method_stub<T, TMethod>; // #1
 		}
 		return d;
 	}
 
+	//! Make a delegate that calls a copy of the given function object
+	template <class F>
+	static VoidDelegate Create( const F & a_Functor, const char * a_pFile, int a_nLine )
+	{
+		VoidDelegate d;
+		d.SetFunctor( a_Functor, a_pFile, a_nLine );
+		d.m_pStub = &functor_stub<F>;
+		return d;
+	}
+
 	bool operator()() const
 	{
 		if ( m_pStub != 0 )
-			return (*m_pStub)(m_pObject, m_WeakPtr);
+			return (*m_pStub)(m_Storage);
 		return false;
 	}
 
 	void Reset()
 	{
-		m_pObject = 0;
-		m_WeakPtr.clear();
+		Clear();
 		m_pStub = 0;
 	}
 
 	bool IsValid() const
 	{
-		return m_pObject != 0 && m_pStub != 0;
+		return m_pStub != 0;
 	}
 
-	bool IsObject(void * obj) const
-	{
-		return obj == m_pObject;
-	}
+private:
+	typedef bool (*stub_type)(const Storage & a_Storage);
 
-#if ENABLE_DELEGATE_DEBUG
-	const char * GetFile() const
-	{
-		return m_pFile;
-	}
+	stub_type	m_pStub;
 
-	int GetLine() const
+	template <class T, void (T::*TMethod)()>
+	static bool method_stub(const Storage & a_Storage)
 	{
-		return m_nLine;
+		T * p = reinterpret_cast<T*>(a_Storage.m_pPointers[0]);
+		(p->*TMethod)(); // #2
+		return true;
 	}
-#endif
-private:
-	typedef bool (*stub_type)(void* object_ptr, const boost::any & );
-
-	void*		m_pObject;
-	boost::any	m_WeakPtr;
-	stub_type	m_pStub;
-#if ENABLE_DELEGATE_DEBUG
-	const char * m_pFile;
-	int			m_nLine;
-#endif
 
 	template <class T, void (T::*TMethod)()>
-	static bool method_stub(void* object_ptr, const boost::any & weak_ptr )
+	static bool weak_method_stub(const Storage & a_Storage)
 	{
-		boost::shared_ptr<T> sp;
-		if (! weak_ptr.empty() )
-		{
-			sp = boost::any_cast< boost::weak_ptr<T> >( weak_ptr ).lock();
-			object_ptr = sp.get();
-		}
-		if ( object_ptr == 0 )
+		boost::shared_ptr<void> spLock;
+		T * p = reinterpret_cast<T*>(LockObject(a_Storage, spLock));
+		if ( p == 0 )
 			return false;
 
-		T * p = reinterpret_cast<T*>(object_ptr);
 		(p->*TMethod)(); // #2
 		return true;
 	}
+
+	template <class F>
+	static bool functor_stub(const Storage & a_Storage)
+	{
+		(*GetFunctor<F>(a_Storage))();
+		return true;
+	}
 };
 
 //! Helper macro for making a delegate a little bit less wordy, e.g.
 //! Delegate<int> d = DELEGATE( int, MyObject, Func, pObject );
-#if !ENABLE_DELEGATE_DEBUG
-#define VOID_DELEGATE( CLASS, FUNC, OBJ )		VoidDelegate::Create<CLASS,&CLASS::FUNC>( OBJ )
-#else
 #define VOID_DELEGATE( CLASS, FUNC, OBJ )		VoidDelegate::Create<CLASS,&CLASS::FUNC>( OBJ, __FILE__, __LINE__ )
-#endif
+//! Make a void delegate that calls a copy of a function object
+#define VOID_FUNCTOR_DELEGATE( FUNCTOR )		VoidDelegate::Create( FUNCTOR, __FILE__, __LINE__ )
 
 //------------------------------------------------------------
 
@@ -18,9 +18,13 @@
 #ifndef WDC_FACTORY_H
 #define WDC_FACTORY_H
 
-#include <map>
+#include <algorithm>
+#include <list>
 #include <string>
+#include <vector>
+
 #include "Log.h"
+#include "StringHash.h"
 #include "WDCLib.h"
 
 class ICreator
@@ -38,25 +42,63 @@ public:
 private:
 	bool m_bOverride;
 };
-typedef std::map<std::string, ICreator *>		CreatorMap;
 
+//! Base class for all factories, the creators are kept in a flat open addressing hash table keyed by the
+//! DJB hash of the ID. This is the same hash as RTTI::GetClassID(), so callers that have the RTTI of a
+//! class can look it up without hashing the name again.
 class WDC_API IFactory
 {
 public:
+	//! Construction
+	IFactory() : m_nCount(0), m_nVersion(0)
+	{}
+	virtual ~IFactory()
+	{}
+
+	//! Accessors
+	size_t GetCount() const
+	{
+		return m_nCount;
+	}
+	//! Returns a number that changes each time a creator is registered or unregistered, so callers can
+	//! tell when results they have cached from this factory are out of date.
+	unsigned int GetVersion() const
+	{
+		return m_nVersion;
+	}
+
 	//! Register a specific class type with this factory, it should inherit from the BASE class.
 	//! If a_bOverride is true, then we will replace any previously registered class by the same
 	//! name. If false, then we will return false if any class is already registered with the same ID.
 	bool Register(const std::string & a_ID, ICreator * a_pCreator)
 	{
-		if (m_CreatorMapping.find(a_ID) != m_CreatorMapping.end())
+		unsigned int nHash = StringHash::DJB(a_ID.c_str());
+		size_t nSlot = FindSlot(nHash, a_ID);
+		if (nSlot != NO_SLOT)
 		{
 			if (! a_pCreator->IsOverride() )
 				return false;
+
+			//Log::Debug("Factory", "Registered %s in factory.", a_ID.c_str());
+			m_Slots[nSlot].m_pCreator = a_pCreator;
+			m_nVersion += 1;
+			return true;
 		}
 
-		// This will generate a compile error if your class doesn't inherit from BASE
-		//Log::Debug("Factory", "Registered %s in factory.", a_ID.c_str());
-		m_CreatorMapping[a_ID] = a_pCreator;
+		// keep the table at most half full, so probes stay short..
+		if ((m_nCount + 1) * 2 > m_Slots.size())
+			Grow();
+
+		size_t nMask = m_Slots.size() - 1;
+		for (nSlot = nHash & nMask; m_Slots[nSlot].m_pCreator != NULL; nSlot = (nSlot + 1) & nMask)
+			;
+
+		Slot & slot = m_Slots[nSlot];
+		slot.m_nHash = nHash;
+		slot.m_ID = a_ID;
+		slot.m_pCreator = a_pCreator;
+		m_nCount += 1;
+		m_nVersion += 1;
 		return true;
 	}
 
@@ -66,39 +108,108 @@ public:
 		if (a_pCreator == NULL)
 			return false;
 
-		CreatorMap::iterator iMapping = m_CreatorMapping.find(a_ID);
-		if (iMapping != m_CreatorMapping.end())
+		size_t nSlot = FindSlot(StringHash::DJB(a_ID.c_str()), a_ID);
+		if (nSlot == NO_SLOT || m_Slots[nSlot].m_pCreator != a_pCreator)
+			return false;
+
+		// shift back any following entries that would no longer be found past the empty slot..
+		size_t nMask = m_Slots.size() - 1;
+		for (size_t nNext = (nSlot + 1) & nMask; m_Slots[nNext].m_pCreator != NULL; nNext = (nNext + 1) & nMask)
 		{
-			if (a_pCreator == iMapping->second)
+			size_t nHome = m_Slots[nNext].m_nHash & nMask;
+			if (((nNext - nHome) & nMask) >= ((nNext - nSlot) & nMask))
 			{
-				m_CreatorMapping.erase(iMapping);
-				return true;
+				m_Slots[nSlot] = m_Slots[nNext];
+				nSlot = nNext;
 			}
 		}
 
-		return false;
+		m_Slots[nSlot] = Slot();
+		m_nCount -= 1;
+		m_nVersion += 1;
+		return true;
 	}
 
-	ICreator * FindCreator( const std::string & a_ID )
+	ICreator * FindCreator( const std::string & a_ID ) const
 	{
-		CreatorMap::iterator iMapping = m_CreatorMapping.find(a_ID);
-		if (iMapping != m_CreatorMapping.end())
-			return iMapping->second;
-
-		return NULL;
+		return FindCreator( StringHash::DJB(a_ID.c_str()), a_ID );
+	}
+	//! Find a creator when the hash of the ID is already known, e.g. from RTTI::GetClassID().
+	ICreator * FindCreator( unsigned int a_nHash, const std::string & a_ID ) const
+	{
+		size_t nSlot = FindSlot( a_nHash, a_ID );
+		return nSlot != NO_SLOT ? m_Slots[nSlot].m_pCreator : NULL;
 	}
 
-	bool IsOverride( const std::string & a_ID )
+	bool IsOverride( const std::string & a_ID ) const
 	{
-		ICreator * pCreator = FindCreator( a_ID );
+		return IsOverride( StringHash::DJB(a_ID.c_str()), a_ID );
+	}
+	bool IsOverride( unsigned int a_nHash, const std::string & a_ID ) const
+	{
+		ICreator * pCreator = FindCreator( a_nHash, a_ID );
 		if ( pCreator != NULL )
 			return pCreator->IsOverride();
 		return false;
 	}
 
 protected:
+	//! Types
+	struct Slot
+	{
+		Slot() : m_nHash(0), m_pCreator(NULL)
+		{}
+
+		unsigned int	m_nHash;
+		std::string		m_ID;
+		ICreator *		m_pCreator;		// NULL if this slot is empty
+	};
+	typedef std::vector<Slot>		SlotList;
+
+	static const size_t NO_SLOT = (size_t)-1;
+
+	static bool SlotLess( const Slot * a_pLeft, const Slot * a_pRight )
+	{
+		return a_pLeft->m_ID < a_pRight->m_ID;
+	}
+
 	//! Data
-	CreatorMap		m_CreatorMapping;
+	SlotList		m_Slots;		// size is always 0 or a power of 2
+	size_t			m_nCount;
+	unsigned int	m_nVersion;
+
+	size_t FindSlot( unsigned int a_nHash, const std::string & a_ID ) const
+	{
+		if (m_Slots.size() == 0)
+			return NO_SLOT;
+
+		size_t nMask = m_Slots.size() - 1;
+		for (size_t nSlot = a_nHash & nMask; m_Slots[nSlot].m_pCreator != NULL; nSlot = (nSlot + 1) & nMask)
+		{
+			const Slot & slot = m_Slots[nSlot];
+			if (slot.m_nHash == a_nHash && slot.m_ID == a_ID)
+				return nSlot;
+		}
+		return NO_SLOT;
+	}
+
+	void Grow()
+	{
+		SlotList slots(m_Slots.size() > 0 ? m_Slots.size() * 2 : 32);
+		m_Slots.swap(slots);
+
+		size_t nMask = m_Slots.size() - 1;
+		for (size_t i = 0; i < slots.size(); ++i)
+		{
+			if (slots[i].m_pCreator == NULL)
+				continue;
+
+			size_t nSlot = slots[i].m_nHash & nMask;
+			while (m_Slots[nSlot].m_pCreator != NULL)
+				nSlot = (nSlot + 1) & nMask;
+			m_Slots[nSlot] = slots[i];
+		}
+	}
 };
 
 //! Factory pattern for making object by ID.
@@ -106,19 +217,27 @@ template<typename BASE>
 class Factory : public IFactory
 {
 public:
-	BASE * CreateObject(const std::string & a_ID)
+	BASE * CreateObject(const std::string & a_ID) const
 	{
-		CreatorMap::iterator iMapping = m_CreatorMapping.find(a_ID);
-		if (iMapping != m_CreatorMapping.end())
-			return reinterpret_cast<BASE *>( iMapping->second->Create() );
+		ICreator * pCreator = FindCreator(a_ID);
+		if (pCreator != NULL)
+			return reinterpret_cast<BASE *>( pCreator->Create() );
 
 		return NULL;
 	}
 
-	void CreateAllObjects( std::list<BASE *> & a_Objects )
+	//! Create one object of each registered class, in order of their ID.
+	void CreateAllObjects( std::list<BASE *> & a_Objects ) const
 	{
-		for (CreatorMap::iterator iObject = m_CreatorMapping.begin(); iObject != m_CreatorMapping.end(); ++iObject)
-			a_Objects.push_back( reinterpret_cast<BASE *>( iObject->second->Create() ) );
+		std::vector<const Slot *> slots;
+		slots.reserve(m_nCount);
+		for (size_t i = 0; i < m_Slots.size(); ++i)
+			if (m_Slots[i].m_pCreator != NULL)
+				slots.push_back( &m_Slots[i] );
+		std::sort( slots.begin(), slots.end(), &IFactory::SlotLess );
+
+		for (size_t i = 0; i < slots.size(); ++i)
+			a_Objects.push_back( reinterpret_cast<BASE *>( slots[i]->m_pCreator->Create() ) );
 	}
 };
 
@@ -0,0 +1,143 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "Future.h"
+#include "ThreadPool.h"
+
+#include "boost/thread/tss.hpp"
+
+namespace {
+
+	//! The scopes are on the stack, so there's nothing to clean up when a thread exits.
+	void NoCleanup(FutureState::Scope *)
+	{}
+
+	boost::thread_specific_ptr<FutureState::Scope> & GetScope()
+	{
+		static boost::thread_specific_ptr<FutureState::Scope> * SCOPE = new boost::thread_specific_ptr<FutureState::Scope>(NoCleanup);
+		return *SCOPE;
+	}
+}
+
+FutureState::Scope::Scope(const SP & a_spState) : m_spState(a_spState), m_pPrevious(GetScope().get())
+{
+	GetScope().reset(this);
+}
+
+FutureState::Scope::~Scope()
+{
+	GetScope().reset(m_pPrevious);
+}
+
+FutureState::FutureState() : m_eStatus(PENDING)
+{}
+
+FutureState::~FutureState()
+{}
+
+FutureState::Status FutureState::GetStatus() const
+{
+	boost::mutex::scoped_lock lock(m_Lock);
+	return m_eStatus;
+}
+
+bool FutureState::SetError(const std::string & a_Error)
+{
+	CallbackList callbacks;
+	{
+		boost::mutex::scoped_lock lock(m_Lock);
+		if (m_eStatus != PENDING)
+			return false;
+		m_Error = a_Error;
+		Finish(FAILED, callbacks);
+	}
+	Invoke(callbacks);
+	return true;
+}
+
+bool FutureState::Cancel()
+{
+	CallbackList cancelers;
+	CallbackList callbacks;
+	{
+		boost::mutex::scoped_lock lock(m_Lock);
+		if (m_eStatus != PENDING)
+			return false;
+		m_Error = "Canceled.";
+		cancelers.swap(m_Cancelers);
+		Finish(CANCELED, callbacks);
+	}
+	Invoke(cancelers);
+	Invoke(callbacks);
+	return true;
+}
+
+void FutureState::AddCallback(const VoidDelegate & a_Callback, Executor a_eExecutor /*= INLINE*/)
+{
+	{
+		boost::mutex::scoped_lock lock(m_Lock);
+		if (m_eStatus == PENDING)
+		{
+			m_Callbacks.push_back(Callback(a_Callback, a_eExecutor));
+			return;
+		}
+	}
+	Invoke(a_Callback, a_eExecutor);
+}
+
+void FutureState::AddCanceler(const VoidDelegate & a_Canceler, Executor a_eExecutor /*= INLINE*/)
+{
+	{
+		boost::mutex::scoped_lock lock(m_Lock);
+		if (m_eStatus == PENDING)
+			m_Cancelers.push_back(Callback(a_Canceler, a_eExecutor));
+		if (m_eStatus != CANCELED)
+			return;
+	}
+	Invoke(a_Canceler, a_eExecutor);
+}
+
+FutureState * FutureState::GetCurrent()
+{
+	Scope * pScope = GetScope().get();
+	return pScope != NULL ? pScope->GetState() : NULL;
+}
+
+void FutureState::Invoke(const VoidDelegate & a_Callback, Executor a_eExecutor)
+{
+	ThreadPool * pPool = ThreadPool::Instance();
+	if (a_eExecutor == MAIN_THREAD && pPool != NULL)
+		pPool->InvokeOnMain(a_Callback);
+	else if (a_eExecutor == THREAD_POOL && pPool != NULL)
+		pPool->InvokeOnThread(a_Callback);
+	else
+		a_Callback();
+}
+
+void FutureState::Finish(Status a_eStatus, CallbackList & a_Callbacks)
+{
+	m_eStatus = a_eStatus;
+	a_Callbacks.swap(m_Callbacks);
+	if (a_eStatus != CANCELED)
+		m_Cancelers.clear();
+}
+
+void FutureState::Invoke(const CallbackList & a_Callbacks)
+{
+	for (size_t i = 0; i < a_Callbacks.size(); ++i)
+		Invoke(a_Callbacks[i].m_Delegate, a_Callbacks[i].m_eExecutor);
+}
@@ -0,0 +1,531 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_FUTURE_H
+#define WDC_FUTURE_H
+
+#include <string>
+#include <vector>
+#include <exception>
+
+#include "boost/atomic.hpp"
+#include "boost/noncopyable.hpp"
+#include "boost/shared_ptr.hpp"
+#include "boost/weak_ptr.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include "Delegate.h"
+#include "WDCLib.h"		// include last always
+
+//! A Promise is the producer side of a result that arrives later, a Future is the consumer side. They are
+//! used to compose service calls without writing a request class for each step, e.g.
+//!
+//! Future<ClassifiersSP> f = Promise<ClassifiersSP>::Start( boost::bind( &NaturalLanguageClassifier::GetClassifiers, &nlc, _1 ) );
+//! f.Then( DELEGATE( MyObject, OnClassifiers, const Future<ClassifiersSP> &, this ), FutureState::MAIN_THREAD );
+//!
+//! Then<U>() chains another step, the function is called as F( const Future<T> &, Promise<U> & ) and
+//! resolves that promise now or when its own request returns. WhenAll() & WhenAny() wait on a set of futures.
+//!
+//! Canceling a future completes it as CANCELED, cancels the future it was chained from & closes any
+//! IService::Request started for it by Promise::Start() or inside a Then<U>() step.
+
+//! The state shared by a Promise & its Futures, without the value.
+class WDC_API FutureState : private boost::noncopyable
+{
+public:
+	//! Types
+	typedef boost::shared_ptr<FutureState>		SP;
+	typedef boost::weak_ptr<FutureState>		WP;
+
+	enum Status
+	{
+		PENDING,
+		READY,
+		FAILED,
+		CANCELED
+	};
+	//! Where a callback is invoked
+	enum Executor
+	{
+		INLINE,			// on the thread that completed the future, or now if it's already complete
+		MAIN_THREAD,	// queued with ThreadPool::InvokeOnMain()
+		THREAD_POOL		// queued with ThreadPool::InvokeOnThread()
+	};
+
+	//! While a Scope exists, any IService::Request made on the same thread is closed if this state is canceled.
+	class WDC_API Scope
+	{
+	public:
+		Scope(const SP & a_spState);
+		~Scope();
+
+		FutureState * GetState() const
+		{
+			return m_spState.get();
+		}
+
+	private:
+		SP			m_spState;
+		Scope *		m_pPrevious;
+	};
+
+	//! Cancels a state if it still exists, used to pass a cancel on to another future.
+	struct Canceler
+	{
+		Canceler(const WP & a_wpState) : m_wpState(a_wpState)
+		{}
+		void operator()()
+		{
+			SP spState = m_wpState.lock();
+			if (spState)
+				spState->Cancel();
+		}
+
+		WP		m_wpState;
+	};
+
+	//! Construction
+	FutureState();
+	virtual ~FutureState();
+
+	//! Accessors
+	Status GetStatus() const;
+	//! The reason the future failed, valid once the status isn't PENDING.
+	const std::string & GetError() const
+	{
+		return m_Error;
+	}
+
+	//! Mutators
+	//! Complete as FAILED, returns false if already complete.
+	bool SetError(const std::string & a_Error);
+	//! Complete as CANCELED & invoke the cancelers, returns false if already complete.
+	bool Cancel();
+	//! Invoke a_Callback when complete, it's invoked now if already complete.
+	void AddCallback(const VoidDelegate & a_Callback, Executor a_eExecutor = INLINE);
+	//! Invoke a_Canceler if this is canceled, it's dropped once complete.
+	void AddCanceler(const VoidDelegate & a_Canceler, Executor a_eExecutor = INLINE);
+
+	//! Returns the state of the innermost Scope on this thread, or NULL.
+	static FutureState * GetCurrent();
+	static void Invoke(const VoidDelegate & a_Callback, Executor a_eExecutor);
+
+protected:
+	//! Types
+	struct Callback
+	{
+		Callback(const VoidDelegate & a_Delegate, Executor a_eExecutor) : m_Delegate(a_Delegate), m_eExecutor(a_eExecutor)
+		{}
+
+		VoidDelegate	m_Delegate;
+		Executor		m_eExecutor;
+	};
+	typedef std::vector<Callback>	CallbackList;
+
+	//! Data
+	mutable boost::mutex	m_Lock;
+	Status					m_eStatus;
+	std::string				m_Error;
+	CallbackList			m_Callbacks;
+	CallbackList			m_Cancelers;
+
+	//! Set the status & take the callbacks to invoke, m_Lock must be held & the status PENDING.
+	void Finish(Status a_eStatus, CallbackList & a_Callbacks);
+	static void Invoke(const CallbackList & a_Callbacks);
+};
+
+//! The shared state with the value
+template<typename T>
+class FutureValue : public FutureState
+{
+public:
+	FutureValue() : m_Value()
+	{}
+
+	//! Complete as READY, returns false if already complete.
+	bool SetValue(const T & a_Value)
+	{
+		CallbackList callbacks;
+		{
+			boost::mutex::scoped_lock lock(m_Lock);
+			if (m_eStatus != PENDING)
+				return false;
+			m_Value = a_Value;
+			Finish(READY, callbacks);
+		}
+		Invoke(callbacks);
+		return true;
+	}
+
+	//! The value, valid once the status is READY.
+	const T & GetValue() const
+	{
+		return m_Value;
+	}
+
+private:
+	T		m_Value;
+};
+
+template<typename T> class Promise;
+
+//! The consumer side, copies share the same state.
+template<typename T>
+class Future
+{
+public:
+	//! Types
+	typedef boost::shared_ptr< FutureValue<T> >		StateSP;
+
+	//! Construction
+	Future()
+	{}
+	Future(const StateSP & a_spState) : m_spState(a_spState)
+	{}
+
+	//! Accessors
+	bool IsValid() const
+	{
+		return m_spState.get() != NULL;
+	}
+	FutureState::Status GetStatus() const
+	{
+		return m_spState->GetStatus();
+	}
+	bool IsPending() const
+	{
+		return GetStatus() == FutureState::PENDING;
+	}
+	bool IsReady() const
+	{
+		return GetStatus() == FutureState::READY;
+	}
+	bool IsCanceled() const
+	{
+		return GetStatus() == FutureState::CANCELED;
+	}
+	const T & GetValue() const
+	{
+		return m_spState->GetValue();
+	}
+	const std::string & GetError() const
+	{
+		return m_spState->GetError();
+	}
+	const StateSP & GetState() const
+	{
+		return m_spState;
+	}
+
+	//! Mutators
+	bool Cancel() const
+	{
+		return m_spState->Cancel();
+	}
+
+	//! Invoke a_Callback with this future once it's complete.
+	void Then(const Delegate<const Future &> & a_Callback, FutureState::Executor a_eExecutor = FutureState::INLINE) const
+	{
+		m_spState->AddCallback(VOID_FUNCTOR_DELEGATE(Notify(a_Callback, *this)), a_eExecutor);
+	}
+
+	//! Invoke a_Func( const Future<T> &, Promise<U> & ) once this future is complete, returns the future
+	//! of that promise. Canceling the returned future cancels this one. If a_Func throws, the promise fails.
+	template<typename U, typename F>
+	Future<U> Then(const F & a_Func, FutureState::Executor a_eExecutor = FutureState::INLINE) const
+	{
+		Promise<U> next;
+		next.GetState()->AddCanceler(VOID_FUNCTOR_DELEGATE(FutureState::Canceler(m_spState)));
+		m_spState->AddCallback(VOID_FUNCTOR_DELEGATE((Continue<U, F>(a_Func, *this, next))), a_eExecutor);
+		return next.GetFuture();
+	}
+
+private:
+	//! Types
+	struct Notify
+	{
+		Notify(const Delegate<const Future &> & a_Callback, const Future & a_Future) : m_Callback(a_Callback), m_Future(a_Future)
+		{}
+		void operator()()
+		{
+			m_Callback(m_Future);
+		}
+
+		Delegate<const Future &>	m_Callback;
+		Future						m_Future;
+	};
+	template<typename U, typename F>
+	struct Continue
+	{
+		Continue(const F & a_Func, const Future & a_Future, const Promise<U> & a_Next) : m_Func(a_Func), m_Future(a_Future), m_Next(a_Next)
+		{}
+		void operator()()
+		{
+			if (m_Next.GetFuture().IsCanceled())
+				return;
+
+			FutureState::Scope scope(m_Next.GetState());
+			try {
+				m_Func(m_Future, m_Next);
+			}
+			catch (const std::exception & ex)
+			{
+				m_Next.SetError(ex.what());
+			}
+		}
+
+		F			m_Func;
+		Future		m_Future;
+		Promise<U>	m_Next;
+	};
+
+	//! Data
+	StateSP		m_spState;
+};
+
+//! The services pass a pointer to a new object, or NULL if the request failed.
+template<typename T>
+struct PromiseCallback
+{
+	typedef const T &	ArgType;
+	static void Resolve(Promise<T> & a_Promise, ArgType a_Arg)
+	{
+		a_Promise.SetValue(a_Arg);
+	}
+};
+template<typename T>
+struct PromiseCallback<T *>
+{
+	typedef T *		ArgType;
+	static void Resolve(Promise<T *> & a_Promise, ArgType a_Arg)
+	{
+		if (a_Arg != NULL)
+			a_Promise.SetValue(a_Arg);
+		else
+			a_Promise.SetError("Request failed.");
+	}
+};
+//! Takes ownership of the object, so it's never leaked if the promise has already been canceled.
+template<typename T>
+struct PromiseCallback< boost::shared_ptr<T> >
+{
+	typedef T *		ArgType;
+	static void Resolve(Promise< boost::shared_ptr<T> > & a_Promise, ArgType a_Arg)
+	{
+		boost::shared_ptr<T> spObject(a_Arg);
+		if (spObject)
+			a_Promise.SetValue(spObject);
+		else
+			a_Promise.SetError("Request failed.");
+	}
+};
+
+//! The producer side, copies share the same state. If every copy is destroyed before the promise is
+//! resolved, the future fails.
+template<typename T>
+class Promise
+{
+public:
+	//! Types
+	typedef typename PromiseCallback<T>::ArgType	CallbackArg;
+	typedef Delegate<CallbackArg>					Callback;
+
+	//! Construction
+	Promise() : m_spState(new FutureValue<T>())
+	{
+		m_spBreaker.reset(static_cast<void *>(NULL), Breaker(m_spState));
+	}
+
+	//! Call a_Start with the callback for a new promise, any IService::Request it makes is closed if the
+	//! returned future is canceled, e.g.
+	//! Promise<ClassifierSP>::Start( boost::bind( &NaturalLanguageClassifier::GetClassifier, pNLC, id, _1 ) );
+	//! When called inside a Then<U>() step, the new future is also canceled with that step.
+	template<typename F>
+	static Future<T> Start(const F & a_Start)
+	{
+		Promise promise;
+		FutureState * pParent = FutureState::GetCurrent();
+		if (pParent != NULL)
+			pParent->AddCanceler(VOID_FUNCTOR_DELEGATE(FutureState::Canceler(promise.GetState())));
+		{
+			FutureState::Scope scope(promise.GetState());
+			a_Start(promise.GetCallback());
+		}
+		return promise.GetFuture();
+	}
+
+	//! Accessors
+	Future<T> GetFuture() const
+	{
+		return Future<T>(m_spState);
+	}
+	const typename Future<T>::StateSP & GetState() const
+	{
+		return m_spState;
+	}
+	//! A delegate that resolves this promise, for passing to a service.
+	Callback GetCallback() const
+	{
+		return FUNCTOR_DELEGATE(CallbackArg, Resolver(*this));
+	}
+
+	//! Mutators
+	bool SetValue(const T & a_Value) const
+	{
+		return m_spState->SetValue(a_Value);
+	}
+	bool SetError(const std::string & a_Error) const
+	{
+		return m_spState->SetError(a_Error);
+	}
+
+private:
+	//! Types
+	struct Resolver
+	{
+		Resolver(const Promise & a_Promise) : m_Promise(a_Promise)
+		{}
+		void operator()(CallbackArg a_Arg)
+		{
+			PromiseCallback<T>::Resolve(m_Promise, a_Arg);
+		}
+
+		Promise		m_Promise;
+	};
+	struct Breaker
+	{
+		Breaker(const typename Future<T>::StateSP & a_spState) : m_wpState(a_spState)
+		{}
+		void operator()(void *)
+		{
+			typename Future<T>::StateSP spState = m_wpState.lock();
+			if (spState)
+				spState->SetError("Promise was destroyed.");
+		}
+
+		boost::weak_ptr< FutureValue<T> >	m_wpState;
+	};
+
+	//! Data
+	typename Future<T>::StateSP		m_spState;
+	boost::shared_ptr<void>			m_spBreaker;	// fails the future when the last copy of this promise is destroyed
+};
+
+//! The function objects used by WhenAll() & WhenAny(). The group only holds the futures weakly until they
+//! complete, so a future that never completes doesn't keep the group & its promise alive in a cycle.
+template<typename T>
+struct FutureGroup
+{
+	typedef std::vector< Future<T> >		FutureList;
+	typedef std::vector<FutureState::WP>	StateList;
+
+	struct All
+	{
+		All(size_t a_nCount, const Promise<FutureList> & a_Promise) :
+			m_Futures(a_nCount), m_Promise(a_Promise), m_nPending(a_nCount)
+		{}
+
+		FutureList				m_Futures;		// each one is set once it completes
+		Promise<FutureList>		m_Promise;
+		boost::atomic<size_t>	m_nPending;
+	};
+	struct OnAll
+	{
+		OnAll(const boost::shared_ptr<All> & a_spAll, const typename Future<T>::StateSP & a_spState, size_t a_nIndex) :
+			m_spAll(a_spAll), m_wpState(a_spState), m_nIndex(a_nIndex)
+		{}
+		void operator()()
+		{
+			// the future is invoking us, so it still exists
+			m_spAll->m_Futures[m_nIndex] = Future<T>(m_wpState.lock());
+			if (--m_spAll->m_nPending == 0)
+				m_spAll->m_Promise.SetValue(m_spAll->m_Futures);
+		}
+
+		boost::shared_ptr<All>					m_spAll;
+		boost::weak_ptr< FutureValue<T> >		m_wpState;
+		size_t									m_nIndex;
+	};
+	struct OnAny
+	{
+		OnAny(const Promise<size_t> & a_Promise, size_t a_nIndex) : m_Promise(a_Promise), m_nIndex(a_nIndex)
+		{}
+		void operator()()
+		{
+			m_Promise.SetValue(m_nIndex);
+		}
+
+		Promise<size_t>		m_Promise;
+		size_t				m_nIndex;
+	};
+	struct CancelAll
+	{
+		CancelAll(const FutureList & a_Futures)
+		{
+			for (size_t i = 0; i < a_Futures.size(); ++i)
+				m_States.push_back(a_Futures[i].GetState());
+		}
+		void operator()()
+		{
+			for (size_t i = 0; i < m_States.size(); ++i)
+			{
+				FutureState::SP spState = m_States[i].lock();
+				if (spState)
+					spState->Cancel();
+			}
+		}
+
+		StateList		m_States;
+	};
+};
+
+//! Returns a future that's ready once every future in a_Futures is complete, its value is a_Futures.
+//! Canceling it cancels all of them.
+template<typename T>
+Future< std::vector< Future<T> > > WhenAll(const std::vector< Future<T> > & a_Futures)
+{
+	typedef FutureGroup<T>		Group;
+
+	Promise<typename Group::FutureList> promise;
+	if (a_Futures.size() == 0)
+	{
+		promise.SetValue(a_Futures);
+		return promise.GetFuture();
+	}
+
+	promise.GetState()->AddCanceler(VOID_FUNCTOR_DELEGATE(typename Group::CancelAll(a_Futures)));
+	boost::shared_ptr<typename Group::All> spAll(new typename Group::All(a_Futures.size(), promise));
+	for (size_t i = 0; i < a_Futures.size(); ++i)
+		a_Futures[i].GetState()->AddCallback(VOID_FUNCTOR_DELEGATE(typename Group::OnAll(spAll, a_Futures[i].GetState(), i)));
+	return promise.GetFuture();
+}
+
+//! Returns a future that's ready once any future in a_Futures is complete, its value is the index of that
+//! future. Canceling it cancels all of them.
+template<typename T>
+Future<size_t> WhenAny(const std::vector< Future<T> > & a_Futures)
+{
+	typedef FutureGroup<T>		Group;
+
+	Promise<size_t> promise;
+	promise.GetState()->AddCanceler(VOID_FUNCTOR_DELEGATE(typename Group::CancelAll(a_Futures)));
+	for (size_t i = 0; i < a_Futures.size(); ++i)
+		a_Futures[i].GetState()->AddCallback(VOID_FUNCTOR_DELEGATE(typename Group::OnAny(promise, i)));
+	return promise.GetFuture();
+}
+
+#endif
@@ -0,0 +1,507 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <string.h>
+#include <ctype.h>
+
+#include "HttpRequestParser.h"
+
+const size_t DEFAULT_MAX_HEADER_SIZE = 64 * 1024;
+const size_t DEFAULT_MAX_BODY_SIZE = 16 * 1024 * 1024;
+
+static bool IsTokenChar(char c)
+{
+	if (isalnum((unsigned char)c))
+		return true;
+	return c != 0 && strchr("!#$%&'*+-.^_`|~", c) != NULL;
+}
+
+static bool IsControlChar(char c)
+{
+	unsigned char u = (unsigned char)c;
+	return u <= 0x20 || u == 0x7f;
+}
+
+static int HexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+HttpRequestParser::HttpRequestParser() :
+	m_nMaxHeaderSize(DEFAULT_MAX_HEADER_SIZE),
+	m_nMaxBodySize(DEFAULT_MAX_BODY_SIZE)
+{
+	Reset();
+}
+
+void HttpRequestParser::Reset()
+{
+	m_State = METHOD;
+	m_nOffset = 0;
+	m_Method = View();
+	m_URI = View();
+	m_Protocol = View();
+	m_Headers.clear();
+	m_nHeaderSize = 0;
+	m_bChunked = false;
+	m_bExpectContinue = false;
+	m_nRemaining = 0;
+	m_nChunkDigits = 0;
+	m_nTrailerSize = 0;
+	m_Content.clear();
+	m_nErrorStatus = 0;
+	m_pErrorReason = "";
+}
+
+HttpRequestParser::Result HttpRequestParser::Parse(const char * a_pData, size_t a_nBytes)
+{
+	if (m_State < BODY)
+	{
+		if (!ParseHeader(a_pData, a_nBytes))
+			return m_State == FAILED ? INVALID : NEED_MORE;
+		if (!OnHeaderComplete(a_pData))
+			return INVALID;
+	}
+
+	if (m_State < DONE)
+		ParseBody(a_pData, a_nBytes);
+
+	if (m_State == DONE)
+		return COMPLETE;
+	if (m_State == FAILED)
+		return INVALID;
+	if (m_bExpectContinue)
+	{
+		m_bExpectContinue = false;
+		return SEND_CONTINUE;
+	}
+	return NEED_MORE;
+}
+
+const HttpRequestParser::HeaderView * HttpRequestParser::FindHeader(const char * a_pData, const char * a_pName) const
+{
+	for (size_t i = 0; i < m_Headers.size(); ++i)
+		if (Equals(a_pData, m_Headers[i].m_Name, a_pName))
+			return &m_Headers[i];
+	return NULL;
+}
+
+bool HttpRequestParser::IsKeepAlive(const char * a_pData) const
+{
+	const HeaderView * pConnection = FindHeader(a_pData, "Connection");
+	if (Equals(a_pData, m_Protocol, "HTTP/1.1"))
+		return pConnection == NULL || !HasToken(a_pData, pConnection->m_Value, "close");
+	return pConnection != NULL && HasToken(a_pData, pConnection->m_Value, "keep-alive");
+}
+
+void HttpRequestParser::GetRequest(const char * a_pData, IWebServer::Request & a_Request)
+{
+	a_Request.m_RequestType.assign(a_pData + m_Method.m_nOffset, m_Method.m_nLength);
+	a_Request.m_Protocol.assign(a_pData + m_Protocol.m_nOffset, m_Protocol.m_nLength);
+
+	for (size_t i = 0; i < m_Headers.size(); ++i)
+	{
+		const HeaderView & header = m_Headers[i];
+		a_Request.m_Headers[header.m_Name.ToString(a_pData)].assign(
+			a_pData + header.m_Value.m_nOffset, header.m_Value.m_nLength);
+	}
+
+	// add all query parameters as headers as well.
+	const char * pURI = a_pData + m_URI.m_nOffset;
+	const char * pURIEnd = pURI + m_URI.m_nLength;
+	const char * pQuery = (const char *)memchr(pURI, '?', m_URI.m_nLength);
+	if (pQuery != NULL)
+	{
+		a_Request.m_EndPoint.assign(pURI, pQuery);
+
+		const char * pParam = pQuery + 1;
+		while (pParam < pURIEnd)
+		{
+			const char * pParamEnd = (const char *)memchr(pParam, '&', pURIEnd - pParam);
+			if (pParamEnd == NULL)
+				pParamEnd = pURIEnd;
+
+			if (pParamEnd > pParam)
+			{
+				const char * pSeperator = (const char *)memchr(pParam, '=', pParamEnd - pParam);
+				if (pSeperator != NULL)
+					a_Request.m_Headers[std::string(pParam, pSeperator)].assign(pSeperator + 1, pParamEnd);
+				else
+					a_Request.m_Headers[std::string(pParam, pParamEnd)].clear();
+			}
+
+			pParam = pParamEnd + 1;
+		}
+	}
+	else
+		a_Request.m_EndPoint.assign(pURI, pURIEnd);
+
+	if (m_bChunked)
+		a_Request.m_Content.swap(m_Content);
+	else
+		a_Request.m_Content.assign(a_pData + m_nHeaderSize, m_nOffset - m_nHeaderSize);
+}
+
+bool HttpRequestParser::Equals(const char * a_pData, const View & a_View, const char * a_pText)
+{
+	const char * pView = a_pData + a_View.m_nOffset;
+	for (size_t i = 0; i < a_View.m_nLength; ++i)
+	{
+		if (a_pText[i] == 0 || tolower((unsigned char)pView[i]) != tolower((unsigned char)a_pText[i]))
+			return false;
+	}
+	return a_pText[a_View.m_nLength] == 0;
+}
+
+bool HttpRequestParser::HasToken(const char * a_pData, const View & a_View, const char * a_pToken)
+{
+	View token;
+	token.m_nOffset = a_View.m_nOffset;
+
+	size_t nEnd = a_View.m_nOffset + a_View.m_nLength;
+	for (size_t i = a_View.m_nOffset; i <= nEnd; ++i)
+	{
+		if (i == nEnd || a_pData[i] == ',')
+		{
+			if (Equals(a_pData, token, a_pToken))
+				return true;
+			token.m_nOffset = i + 1;
+			token.m_nLength = 0;
+		}
+		else if (a_pData[i] == ' ' || a_pData[i] == '\t')
+		{
+			if (token.m_nLength == 0)
+				token.m_nOffset = i + 1;
+		}
+		else
+			token.m_nLength = i - token.m_nOffset + 1;
+	}
+
+	return false;
+}
+
+//! Parse the request line & headers one byte at a time, returns true once the blank line ending
+//! the headers has been parsed.
+bool HttpRequestParser::ParseHeader(const char * a_pData, size_t a_nBytes)
+{
+	for (; m_nOffset < a_nBytes; ++m_nOffset)
+	{
+		if (m_nOffset >= m_nMaxHeaderSize)
+		{
+			Fail(431, "Request Header Fields Too Large");
+			return false;
+		}
+
+		char c = a_pData[m_nOffset];
+		switch (m_State)
+		{
+		case METHOD:
+			if (c == ' ' && m_Method.m_nLength > 0)
+			{
+				m_URI.m_nOffset = m_nOffset + 1;
+				m_State = URI;
+			}
+			else if ((c == '\r' || c == '\n') && m_Method.m_nLength == 0)
+				m_Method.m_nOffset = m_nOffset + 1;			// ignore empty lines before a request
+			else if (IsTokenChar(c))
+				m_Method.m_nLength += 1;
+			else
+			{
+				Fail(400, "Bad Request");
+				return false;
+			}
+			break;
+		case URI:
+			if (c == ' ' && m_URI.m_nLength > 0)
+			{
+				m_Protocol.m_nOffset = m_nOffset + 1;
+				m_State = PROTOCOL;
+			}
+			else if (!IsControlChar(c))
+				m_URI.m_nLength += 1;
+			else
+			{
+				Fail(400, "Bad Request");
+				return false;
+			}
+			break;
+		case PROTOCOL:
+			if (c == '\r')
+				m_State = REQUEST_LINE_LF;
+			else if (c == '\n')
+				m_State = HEADER_START;
+			else if (!IsControlChar(c))
+				m_Protocol.m_nLength += 1;
+			else
+			{
+				Fail(400, "Bad Request");
+				return false;
+			}
+			break;
+		case REQUEST_LINE_LF:
+		case HEADER_LF:
+			if (c != '\n')
+			{
+				Fail(400, "Bad Request");
+				return false;
+			}
+			m_State = HEADER_START;
+			break;
+		case HEADER_START:
+			if (c == '\r')
+				m_State = HEADERS_END_LF;
+			else if (c == '\n')
+			{
+				m_nOffset += 1;
+				return true;
+			}
+			else if (IsTokenChar(c))
+			{
+				m_Headers.push_back(HeaderView());
+				m_Headers.back().m_Name.m_nOffset = m_nOffset;
+				m_Headers.back().m_Name.m_nLength = 1;
+				m_State = HEADER_NAME;
+			}
+			else
+			{
+				// this includes obsolete line folding, which we don't support.
+				Fail(400, "Bad Request");
+				return false;
+			}
+			break;
+		case HEADER_NAME:
+			if (c == ':')
+				m_State = HEADER_VALUE_START;
+			else if (IsTokenChar(c))
+				m_Headers.back().m_Name.m_nLength += 1;
+			else
+			{
+				Fail(400, "Bad Request");
+				return false;
+			}
+			break;
+		case HEADER_VALUE_START:
+			if (c == ' ' || c == '\t')
+				break;
+			m_Headers.back().m_Value.m_nOffset = m_nOffset;
+			m_State = HEADER_VALUE;
+			// fall through
+		case HEADER_VALUE:
+			if (c == '\r')
+				m_State = HEADER_LF;
+			else if (c == '\n')
+				m_State = HEADER_START;
+			else if (c != ' ' && c != '\t')
+			{
+				// trailing white space isn't included in the value
+				View & value = m_Headers.back().m_Value;
+				value.m_nLength = m_nOffset - value.m_nOffset + 1;
+			}
+			break;
+		case HEADERS_END_LF:
+			if (c != '\n')
+			{
+				Fail(400, "Bad Request");
+				return false;
+			}
+			m_nOffset += 1;
+			return true;
+		default:
+			break;
+		}
+	}
+
+	return false;
+}
+
+//! Decide how the body is framed from the headers.
+bool HttpRequestParser::OnHeaderComplete(const char * a_pData)
+{
+	m_nHeaderSize = m_nOffset;
+
+	const HeaderView * pTransferEncoding = FindHeader(a_pData, "Transfer-Encoding");
+	const HeaderView * pContentLength = FindHeader(a_pData, "Content-Length");
+	if (pTransferEncoding != NULL)
+	{
+		// chunked must be the final encoding, we don't support anything else. Also refuse a request with
+		// both headers since the peers may not agree where this request ends.
+		const View & value = pTransferEncoding->m_Value;
+		View last;
+		last.m_nLength = 7;
+		last.m_nOffset = value.m_nOffset + value.m_nLength - last.m_nLength;
+		if (pContentLength != NULL || value.m_nLength < last.m_nLength || !Equals(a_pData, last, "chunked"))
+		{
+			Fail(400, "Bad Request");
+			return false;
+		}
+
+		m_bChunked = true;
+		m_State = CHUNK_SIZE;
+	}
+	else if (pContentLength != NULL)
+	{
+		const View & value = pContentLength->m_Value;
+		if (value.m_nLength == 0)
+		{
+			Fail(400, "Bad Request");
+			return false;
+		}
+
+		size_t nLength = 0;
+		for (size_t i = 0; i < value.m_nLength; ++i)
+		{
+			char c = a_pData[value.m_nOffset + i];
+			if (c < '0' || c > '9')
+			{
+				Fail(400, "Bad Request");
+				return false;
+			}
+			nLength = (nLength * 10) + (c - '0');
+			if (nLength > m_nMaxBodySize)
+			{
+				Fail(413, "Payload Too Large");
+				return false;
+			}
+		}
+
+		m_nRemaining = nLength;
+		m_State = nLength > 0 ? BODY_IDENTITY : DONE;
+	}
+	else
+		m_State = DONE;
+
+	if (m_State != DONE)
+	{
+		const HeaderView * pExpect = FindHeader(a_pData, "Expect");
+		m_bExpectContinue = pExpect != NULL && Equals(a_pData, pExpect->m_Value, "100-continue");
+	}
+
+	return true;
+}
+
+void HttpRequestParser::ParseBody(const char * a_pData, size_t a_nBytes)
+{
+	while (m_nOffset < a_nBytes && m_State < DONE)
+	{
+		// any body bytes mean the client didn't wait for our 100 response
+		m_bExpectContinue = false;
+
+		if (m_State == BODY_IDENTITY || m_State == CHUNK_DATA)
+		{
+			size_t nBytes = a_nBytes - m_nOffset;
+			if (nBytes > m_nRemaining)
+				nBytes = m_nRemaining;
+
+			if (m_State == CHUNK_DATA)
+				m_Content.append(a_pData + m_nOffset, nBytes);
+			m_nOffset += nBytes;
+			m_nRemaining -= nBytes;
+
+			if (m_nRemaining == 0)
+				m_State = m_State == CHUNK_DATA ? CHUNK_DATA_CR : DONE;
+			continue;
+		}
+
+		char c = a_pData[m_nOffset++];
+		switch (m_State)
+		{
+		case CHUNK_SIZE:
+			if (HexValue(c) >= 0)
+			{
+				m_nRemaining = (m_nRemaining << 4) | HexValue(c);
+				m_nChunkDigits += 1;
+				if (m_nChunkDigits > 8 || m_Content.size() + m_nRemaining > m_nMaxBodySize)
+					Fail(413, "Payload Too Large");
+			}
+			else if (m_nChunkDigits == 0)
+				Fail(400, "Bad Request");
+			else if (c == ';' || c == ' ' || c == '\t')
+				m_State = CHUNK_EXTENSION;
+			else if (c == '\r')
+				m_State = CHUNK_SIZE_LF;
+			else if (c == '\n')
+				m_State = m_nRemaining > 0 ? CHUNK_DATA : TRAILER_START;
+			else
+				Fail(400, "Bad Request");
+			break;
+		case CHUNK_EXTENSION:
+			if (c == '\r')
+				m_State = CHUNK_SIZE_LF;
+			else if (c == '\n')
+				m_State = m_nRemaining > 0 ? CHUNK_DATA : TRAILER_START;
+			break;
+		case CHUNK_SIZE_LF:
+			if (c == '\n')
+				m_State = m_nRemaining > 0 ? CHUNK_DATA : TRAILER_START;
+			else
+				Fail(400, "Bad Request");
+			break;
+		case CHUNK_DATA_CR:
+			m_nChunkDigits = 0;
+			if (c == '\r')
+				m_State = CHUNK_DATA_LF;
+			else if (c == '\n')
+				m_State = CHUNK_SIZE;
+			else
+				Fail(400, "Bad Request");
+			break;
+		case CHUNK_DATA_LF:
+			if (c == '\n')
+				m_State = CHUNK_SIZE;
+			else
+				Fail(400, "Bad Request");
+			break;
+		case TRAILER_START:
+			// trailers are ignored
+			if (c == '\r')
+				m_State = TRAILER_END_LF;
+			else if (c == '\n')
+				m_State = DONE;
+			else
+				m_State = TRAILER_LINE;
+			break;
+		case TRAILER_LINE:
+			if (c == '\n')
+				m_State = TRAILER_START;
+			break;
+		case TRAILER_END_LF:
+			if (c == '\n')
+				m_State = DONE;
+			else
+				Fail(400, "Bad Request");
+			break;
+		default:
+			break;
+		}
+
+		if (m_State >= TRAILER_START && m_State < DONE && ++m_nTrailerSize > m_nMaxHeaderSize)
+			Fail(431, "Request Header Fields Too Large");
+	}
+}
+
+void HttpRequestParser::Fail(int a_nStatus, const char * a_pReason)
+{
+	m_State = FAILED;
+	m_nErrorStatus = a_nStatus;
+	m_pErrorReason = a_pReason;
+}
@@ -0,0 +1,207 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_HTTP_REQUEST_PARSER_H
+#define WDC_HTTP_REQUEST_PARSER_H
+
+#include <string>
+#include <vector>
+
+#include "IWebServer.h"
+#include "WDCLib.h"		// include last always
+
+//! Incremental HTTP/1.1 request parser used by the web server.
+//!
+//! The caller keeps all received bytes in a single contiguous buffer and calls Parse() each time more bytes
+//! arrive, the parser resumes where it stopped last time so each byte is only looked at once. The request line
+//! and headers are recorded as offsets into the caller's buffer and are not copied until GetRequest() is called.
+//! Once Parse() returns COMPLETE, GetConsumed() is the number of bytes used by this request, any bytes after that
+//! belong to the next pipelined request.
+class WDC_API HttpRequestParser
+{
+public:
+	//! Types
+	enum Result
+	{
+		NEED_MORE,				// more bytes are needed
+		SEND_CONTINUE,			// the client sent "Expect: 100-continue" and is waiting on a 100 response before sending the body
+		COMPLETE,				// a full request has been parsed
+		INVALID					// the request is malformed or too large, see GetErrorStatus()
+	};
+
+	//! A range of bytes in the caller's buffer
+	struct View
+	{
+		View() : m_nOffset(0), m_nLength(0)
+		{}
+
+		std::string ToString(const char * a_pData) const
+		{
+			return std::string(a_pData + m_nOffset, m_nLength);
+		}
+
+		size_t		m_nOffset;
+		size_t		m_nLength;
+	};
+
+	struct HeaderView
+	{
+		View		m_Name;
+		View		m_Value;
+	};
+	typedef std::vector<HeaderView>		HeaderViewList;
+
+	//! Construction
+	HttpRequestParser();
+
+	//! Accessors
+	const View & GetMethod() const
+	{
+		return m_Method;
+	}
+	const View & GetURI() const
+	{
+		return m_URI;
+	}
+	const View & GetProtocol() const
+	{
+		return m_Protocol;
+	}
+	const HeaderViewList & GetHeaders() const
+	{
+		return m_Headers;
+	}
+	bool IsHeaderComplete() const
+	{
+		return m_State >= BODY;
+	}
+	bool IsChunked() const
+	{
+		return m_bChunked;
+	}
+	//! Returns the number of bytes used by the current request.
+	size_t GetConsumed() const
+	{
+		return m_nOffset;
+	}
+	int GetErrorStatus() const
+	{
+		return m_nErrorStatus;
+	}
+	const char * GetErrorReason() const
+	{
+		return m_pErrorReason;
+	}
+
+	size_t GetMaxHeaderSize() const
+	{
+		return m_nMaxHeaderSize;
+	}
+	size_t GetMaxBodySize() const
+	{
+		return m_nMaxBodySize;
+	}
+
+	//! Mutators
+	void SetMaxHeaderSize(size_t a_nBytes)
+	{
+		m_nMaxHeaderSize = a_nBytes;
+	}
+	void SetMaxBodySize(size_t a_nBytes)
+	{
+		m_nMaxBodySize = a_nBytes;
+	}
+
+	//! Reset this parser to start a new request, any allocated memory is kept for the next request.
+	void Reset();
+	//! Parse the request from the provided bytes, a_pData must always point at the first byte of the request
+	//! and a_nBytes is the total number of bytes received so far.
+	Result Parse(const char * a_pData, size_t a_nBytes);
+	//! Find a header by name, the name is not case sensitive. Returns NULL if the header wasn't sent.
+	const HeaderView * FindHeader(const char * a_pData, const char * a_pName) const;
+	//! Returns true if the client wants to keep this connection open after the response, this is the default
+	//! for HTTP/1.1 unless the client sent "Connection: close".
+	bool IsKeepAlive(const char * a_pData) const;
+	//! Fill in the provided request from a COMPLETE parse, the body of a chunked request is moved
+	//! into a_Request instead of being copied.
+	void GetRequest(const char * a_pData, IWebServer::Request & a_Request);
+
+	//! Returns true if the range of bytes in a_View equals a_pText, ignoring case.
+	static bool Equals(const char * a_pData, const View & a_View, const char * a_pText);
+	//! Returns true if the comma separated list in a_View contains a_pToken, ignoring case.
+	static bool HasToken(const char * a_pData, const View & a_View, const char * a_pToken);
+
+private:
+	//! Types
+	enum State
+	{
+		METHOD,
+		URI,
+		PROTOCOL,
+		REQUEST_LINE_LF,
+		HEADER_START,
+		HEADER_NAME,
+		HEADER_VALUE_START,
+		HEADER_VALUE,
+		HEADER_LF,
+		HEADERS_END_LF,
+
+		BODY,					// all states after this point are parsing the body
+		BODY_IDENTITY,
+		CHUNK_SIZE,
+		CHUNK_EXTENSION,
+		CHUNK_SIZE_LF,
+		CHUNK_DATA,
+		CHUNK_DATA_CR,
+		CHUNK_DATA_LF,
+		TRAILER_START,
+		TRAILER_LINE,
+		TRAILER_END_LF,
+
+		DONE,
+		FAILED
+	};
+
+	//! Data
+	State				m_State;
+	size_t				m_nOffset;				// offset of the next byte to parse
+	size_t				m_nMaxHeaderSize;
+	size_t				m_nMaxBodySize;
+
+	View				m_Method;
+	View				m_URI;
+	View				m_Protocol;
+	HeaderViewList		m_Headers;
+	size_t				m_nHeaderSize;			// size of the request line & headers including the final blank line
+
+	bool				m_bChunked;
+	bool				m_bExpectContinue;		// true until we've returned SEND_CONTINUE
+	size_t				m_nRemaining;			// bytes remaining in the body or current chunk
+	size_t				m_nChunkDigits;
+	size_t				m_nTrailerSize;
+	std::string			m_Content;				// de-chunked body, identity bodies are left in the caller's buffer
+
+	int					m_nErrorStatus;
+	const char *		m_pErrorReason;
+
+	bool ParseHeader(const char * a_pData, size_t a_nBytes);
+	bool OnHeaderComplete(const char * a_pData);
+	void ParseBody(const char * a_pData, size_t a_nBytes);
+	void Fail(int a_nStatus, const char * a_pReason);
+};
+
+#endif
@@ -16,6 +16,7 @@
 */
 
 #include "ISerializable.h"
+#include "Cbor.h"
 
 #include <fstream>
 #include <streambuf>
@@ -23,7 +24,6 @@
 
 RTTI_IMPL_BASE( ISerializable );
 
-
 Factory<ISerializable> & ISerializable::GetSerializableFactory()
 {
 	static Factory<ISerializable> factory;
@@ -34,11 +34,11 @@ ISerializable * ISerializable::DeserializeObject(const std::string & a_json,
 	ISerializable * a_pObject /*= NULL*/ )
 {
 	Json::Value root;
-	Json::Reader reader( Json::Features::strictMode() );
-	if (reader.parse(a_json, root))
+	std::string error;
+	if (Cbor::ParseData(a_json, root, &error))
 		return DeserializeObject(root, a_pObject);
 
-	Log::Error( "ISerializable", "Failed to parse json: %s", reader.getFormattedErrorMessages().c_str() );
+	Log::Error( "ISerializable", "Failed to parse json: %s", error.c_str() );
 	return NULL;
 }
 
@@ -56,7 +56,7 @@ ISerializable * ISerializable::DeserializeObject(const Json::Value & a_json,
 		else
 			bCreated = true;
 	}
-	else if ( a_json["Type_"].isString() )
+	else if ( a_json.isObject() && a_json["Type_"].isString() )
 	{
 		if ( a_pObject->GetRTTI().GetName() != a_json["Type_"].asString() )
 		{
@@ -78,19 +78,7 @@ Json::Value ISerializable::SerializeObject(ISerializable * a_pObject, bool a_bWr
 	{
 		if ( a_bWriteType )
 		{
-			// look to see if this type overridden a base type, if we find one, then use the overridden type name
-			const RTTI * pType = &a_pObject->GetRTTI();
-			const RTTI * pBaseType = pType;
-			while( pBaseType != NULL )
-			{
-				if ( GetSerializableFactory().IsOverride( pBaseType->GetName() ) )
-				{
-					pType = pBaseType;
-					break;
-				}
-				pBaseType = pBaseType->GetBaseClass();
-			}
-
+			const RTTI * pType = GetWriteType( &a_pObject->GetRTTI() );
 			if ( pType != NULL )
 				json["Type_"] = pType->GetName();
 		}
@@ -101,9 +89,34 @@ Json::Value ISerializable::SerializeObject(ISerializable * a_pObject, bool a_bWr
 	return json;
 }
 
+const RTTI * ISerializable::GetWriteType( const RTTI * a_pType )
+{
+	// the type is resolved once per class and kept on the RTTI until the factory changes, classes are
+	// registered before anything is serialized so there's no need to lock..
+	Factory<ISerializable> & factory = GetSerializableFactory();
+	unsigned int nVersion = factory.GetVersion() + 1;
+	if ( a_pType->m_nWriteVersion.load( boost::memory_order_acquire ) == nVersion )
+		return a_pType->m_pWriteType.load( boost::memory_order_relaxed );
+
+	// look to see if this type overridden a base type, if we find one, then use the overridden type name
+	const RTTI * pType = a_pType;
+	for( const RTTI * pBaseType = a_pType; pBaseType != NULL; pBaseType = pBaseType->GetBaseClass() )
+	{
+		if ( factory.IsOverride( pBaseType->GetClassID(), pBaseType->GetName() ) )
+		{
+			pType = pBaseType;
+			break;
+		}
+	}
+
+	a_pType->m_pWriteType.store( pType, boost::memory_order_relaxed );
+	a_pType->m_nWriteVersion.store( nVersion, boost::memory_order_release );
+	return pType;
+}
+
 ISerializable * ISerializable::DeserializeFromFile(const std::string & a_File, ISerializable * a_pObject /*= NULL*/ )
 {
-	std::ifstream input(a_File.c_str());
+	std::ifstream input(a_File.c_str(), std::ios::in | std::ios::binary);
 	if (input.is_open())
 	{
 		std::string json = std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
@@ -127,3 +140,21 @@ bool ISerializable::SerializeToFile( const std::string & a_File, ISerializable *
 	return true;
 }
 
+std::string ISerializable::SerializeToBinary( ISerializable * a_pObject, bool a_bWriteType /*= true*/ )
+{
+	return Cbor::Write( SerializeObject( a_pObject, a_bWriteType ) );
+}
+
+bool ISerializable::SerializeToBinaryFile( const std::string & a_File, ISerializable * a_pObject, bool a_bWriteType /*= true*/ )
+{
+	std::string data( SerializeToBinary( a_pObject, a_bWriteType ) );
+
+	std::ofstream output(a_File.c_str(), std::ios::out | std::ios::binary);
+	if (!output.is_open())
+		return false;
+	output.write(data.data(), data.size());
+	output.close();
+
+	return !output.fail();
+}
+
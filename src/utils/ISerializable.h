@@ -70,7 +70,7 @@ public:
 
 	//! Static factory for all classes that can be serialized/deserialized
 	static Factory<ISerializable> & GetSerializableFactory();
-	//! deserialize a object from a string, if a_pObject is provided then we try to deserialize into the provided object.
+	//! deserialize a object from a string of JSON or CBOR, if a_pObject is provided then we try to deserialize into the provided object.
 	static ISerializable * DeserializeObject( const std::string & a_json, 
 		ISerializable * a_pObject = NULL );
 	//! deserialize object from json object
@@ -79,12 +79,20 @@ public:
 	//! serialize a object into json object, if a_bWriteType is true we store the object type into the JSON for deserialization uses.
 	static Json::Value SerializeObject( ISerializable * a_pObject, 
 		bool a_bWriteType = true );
-	//! deserialize a object from a file containing json data.
+	//! Returns the type SerializeObject() writes for an object of the given type, this is the first
+	//! class up the hierarchy registered with REG_OVERRIDE_SERIALIZABLE() or the type itself.
+	static const RTTI * GetWriteType( const RTTI * a_pType );
+	//! serialize a object into CBOR, which is smaller and faster to load than JSON text. (see Cbor)
+	static std::string SerializeToBinary( ISerializable * a_pObject, bool a_bWriteType = true );
+	//! deserialize a object from a file containing json or CBOR data.
 	static ISerializable * DeserializeFromFile( const std::string & a_File, 
 		ISerializable * a_pObject = NULL );
 	//! serialize a object into a file 
 	static bool SerializeToFile( const std::string & a_File, ISerializable * a_pObject, 
 		 bool a_bWriteType = true, bool a_bFormatJson = false );
+	//! serialize a object into a file as CBOR, DeserializeFromFile() will load the file
+	static bool SerializeToBinaryFile( const std::string & a_File, ISerializable * a_pObject,
+		bool a_bWriteType = true );
 
 
 	//! Load object from file as template type.
@@ -19,6 +19,7 @@
 #define WDC_IWEBCLIENT_H
 
 #include <map>
+#include <vector>
 
 #include "boost/atomic.hpp"
 
@@ -50,7 +51,7 @@ public:
 
 	struct RequestData
 	{
-		RequestData() : m_StatusCode(0), m_bDone( false )
+		RequestData() : m_StatusCode(0), m_HeaderTime(0.0), m_bDone( false )
 		{}
 		RequestData( const RequestData & a_Copy ) : 
 			m_Version( a_Copy.m_Version ),
@@ -58,6 +59,7 @@ public:
 			m_StatusMessage( a_Copy.m_StatusMessage ),
 			m_SetCookies( a_Copy.m_SetCookies ),
 			m_Headers( a_Copy.m_Headers ),
+			m_HeaderTime( a_Copy.m_HeaderTime ),
 			m_bDone( false )
 		{}
 
@@ -67,10 +69,32 @@ public:
 		Cookies			m_SetCookies;
 		Headers			m_Headers;
 		std::string		m_Content;
+		double			m_HeaderTime;		// epoch time the response headers were received
 		bool			m_bDone;			// set to true if the socket has been closed and this is the last RequestData object
 	};
 
 
+	//! The serialized header lines shared by many requests, e.g. each request of a service sends the same
+	//! default headers with its Authorization line. This is built once by CreateTemplate() and never modified,
+	//! so it can be shared between threads. A client sends these lines followed by the headers from
+	//! SetHeaders(), any header in both is sent with the value from SetHeaders().
+	struct RequestTemplate
+	{
+		typedef boost::shared_ptr<const RequestTemplate>	SP;
+
+		struct Line
+		{
+			std::string		m_Key;
+			std::string		m_Line;			// "Key: Value\r\n"
+		};
+		typedef std::vector<Line>		LineList;
+
+		Headers			m_Headers;			// the headers this was created from, without the default headers
+		std::string		m_Host;				// the host of the default Host header, empty if m_Headers has one
+		LineList		m_Lines;			// each header, including the defaults
+		std::string		m_Block;			// all of m_Lines
+	};
+
 	// states for the internal socket object
 	enum SocketState
 	{
@@ -90,6 +114,8 @@ public:
 	static Factory<IWebClient> & GetFactory();
 	static SP Create( const URL & a_URL );
 	static void Free( const SP & a_spClient );
+	//! Serialize the given headers with the default headers of a request to a_Host.
+	static RequestTemplate::SP CreateTemplate( const Headers & a_Headers, const std::string & a_Host );
 
 	//! Destruction
 	virtual ~IWebClient()
@@ -111,6 +137,10 @@ public:
 	virtual void SetHeader(const std::string & a_Key,
 		const std::string & a_Value) = 0;
 	virtual void SetHeaders(const Headers & a_Headers, bool a_bMerge = false) = 0;
+	//! Send the header lines of the given template before those from SetHeaders(), pass an empty pointer
+	//! to stop using a template. A template created for a different host is merged into those headers instead.
+	virtual void SetTemplate(const RequestTemplate::SP & a_spTemplate) = 0;
+	virtual const RequestTemplate::SP & GetTemplate() const = 0;
 	virtual void SetRequestType(const std::string & a_ReqType) = 0;		// GET, POST, DELETE
 	virtual void SetBody(const std::string & a_Body) = 0;
 	//! Send a request, this should be the last call.
@@ -144,6 +174,16 @@ public:
 		return boost::static_pointer_cast<IWebClient>(IWebSocket::shared_from_this());
 	}
 
+	//! Returns the headers of the template merged with those from SetHeaders().
+	Headers GetRequestHeaders() const
+	{
+		Headers headers( GetHeaders() );
+		const RequestTemplate::SP & spTemplate = GetTemplate();
+		if ( spTemplate )
+			headers.insert( spTemplate->m_Headers.begin(), spTemplate->m_Headers.end() );
+		return headers;
+	}
+
 	static void SetClientId( const std::string & a_ClientId )
 	{
 		sm_ClientId = a_ClientId;
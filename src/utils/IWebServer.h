@@ -41,6 +41,7 @@ public:
 
 	typedef std::map< std::string, std::string, StringUtil::ci_less >		
 		Headers;
+	typedef std::map< std::string, std::string >	Parameters;
 
 	class IConnection : public IWebSocket
 	{
@@ -58,10 +59,28 @@ public:
 
 		virtual void SendAsync(const std::string & a_Send) = 0;
 		virtual void ReadAsync(size_t a_Bytes, Delegate< std::string * > a_ReadCallback ) = 0;
+		//! Send a response to the current request, the Content-Length & Connection headers are added if not provided.
+		//! The connection is kept open for the next request if the client supports keep-alive, unless a_bClose is true.
 		virtual void SendResponse(int a_nStatusCode, const std::string & a_Reply, const Headers & a_Headers,
-			const std::string & a_Content, bool a_bClose = true ) = 0;
+			const std::string & a_Content, bool a_bClose = false ) = 0;
 		virtual void SendResponse(int a_nStatusCode, const std::string & a_Reply, 
-			const std::string & a_Content, bool a_bClose = true ) = 0;
+			const std::string & a_Content, bool a_bClose = false ) = 0;
+		//! Start a response with a body of unknown length, the body is sent with SendChunk() using chunked
+		//! transfer encoding and must be finished with EndChunkedResponse().
+		virtual void BeginChunkedResponse(int a_nStatusCode, const std::string & a_Reply, const Headers & a_Headers) = 0;
+		//! Send the next part of the body, returns false once too much data is waiting to be sent. The caller should
+		//! then stop sending until the drain handler is invoked.
+		virtual bool SendChunk(const std::string & a_Chunk) = 0;
+		virtual void EndChunkedResponse(bool a_bClose = false) = 0;
+		//! Send a file as the response without loading it into memory (e.g. a DataCache item found with
+		//! a_bLoadIntoMemory = false), returns false if the file can't be opened and nothing was sent.
+		virtual bool SendFile(int a_nStatusCode, const std::string & a_Reply, const Headers & a_Headers,
+			const std::string & a_FilePath, bool a_bClose = false ) = 0;
+		//! Set the handler invoked on the main thread once the data waiting to be sent has drained after
+		//! SendChunk() returned false.
+		virtual void SetDrainHandler(Delegate<SP> a_Handler) = 0;
+		//! Returns the number of bytes waiting to be sent.
+		virtual size_t GetSendQueued() const = 0;
 		virtual void StartWebSocket(const std::string & a_WebSocketKey ) = 0;
 
 		SP shared_from_this()
@@ -81,6 +100,8 @@ public:
 		std::string				m_EndPoint;		// end-point in the request
 		std::string				m_Protocol;		// HTTP/1.1
 		Headers					m_Headers;		// parsed headers
+		Parameters				m_Parameters;	// named parameters from the matched end-point mask (e.g. /v1/things/:id)
+		std::string				m_Content;		// body of the request, chunked bodies have already been decoded
 		ConnectionSP			m_spConnection;	// the connection object for this request
 	};
 	typedef boost::shared_ptr<Request>			RequestSP;
@@ -97,20 +118,46 @@ public:
 		const std::string & a_Interface = std::string(),
 		int a_nPort = 443, int a_nThreads = 5, float a_fRequestTimeout = 30.0f);
 
+	//! Set how long a persistent connection may wait for the next request, and the max number
+	//! of requests on a single connection. Set a_nMaxRequests to 1 to disable keep-alive.
+	virtual void SetKeepAlive(float a_fIdleTimeout, int a_nMaxRequests) = 0;
+	//! Set how long Stop() waits for active requests to send their response.
+	virtual void SetDrainTimeout(float a_fDrainTimeout) = 0;
+	//! Set the max number of open connections and the max number from a single remote address,
+	//! any connection over the limit gets a 503 response. Use 0 for no limit.
+	virtual void SetConnectionLimits(int a_nMaxConnections, int a_nMaxPerOrigin) = 0;
+	//! Set the max size of the request headers & body, and the minimum rate in bytes per second
+	//! a client must send a request at. Use 0 for a_nMinReadRate to allow any rate.
+	virtual void SetRequestLimits(size_t a_nMaxHeaderSize, size_t a_nMaxBodySize, size_t a_nMinReadRate) = 0;
+	//! Requests for end-points invoked on the main thread get a 503 response with a Retry-After header
+	//! once queued requests have been waiting on the main thread longer than a_fMaxQueueLatency seconds.
+	//! Use 0 to never shed requests.
+	virtual void SetLoadShedding(float a_fMaxQueueLatency, int a_nRetryAfter) = 0;
+
 	//! This starts this server listening for incoming connections
 	virtual bool Start() = 0;
-	//! Invoke to shutdown this server.
+	//! Invoke to shutdown this server, no new connections are accepted and requests already received
+	//! are given time to send their response.
 	virtual bool Stop() = 0;
 
 	//! Add an end-point to this server, the provided delegate will be invoked with the 
 	//! Request object when an incoming client connections makes a request that matches 
 	//! the provided end-point mask.
 	//! If a_bInvokeOnMain is false the delegate will be invoked in a thread from this servers thread-pool.
+	//! The mask may contain named parameters (/v1/things/:id) which are returned in Request::m_Parameters,
+	//! see WebRouter for the full syntax.
 	virtual void AddEndpoint(const std::string & a_EndPointMask,
 		Delegate<RequestSP> a_RequestHandler,
 		bool a_bInvokeOnMain = true ) = 0;
+	//! Add an end-point that only handles the given request type (GET, POST, DELETE, etc..)
+	virtual void AddEndpoint(const std::string & a_RequestType,
+		const std::string & a_EndPointMask,
+		Delegate<RequestSP> a_RequestHandler,
+		bool a_bInvokeOnMain = true ) = 0;
 	//! Remove a register end-point.
 	virtual bool RemoveEndpoint(const std::string & a_EndPointMask) = 0;
+	virtual bool RemoveEndpoint(const std::string & a_RequestType, 
+		const std::string & a_EndPointMask) = 0;
 
 protected:
 	//! Accept incoming connections, this must be provided by the base class.
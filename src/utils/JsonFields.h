@@ -0,0 +1,650 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_JSON_FIELDS_H
+#define WDC_JSON_FIELDS_H
+
+#include <string.h>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "boost/shared_ptr.hpp"
+#include "boost/type_traits/is_same.hpp"
+
+#include "ISerializable.h"
+#include "JsonParser.h"
+#include "JsonWriter.h"
+#include "Log.h"
+#include "StringUtil.h"
+#include "WDCLib.h"		// include last always
+
+//! Describes the members of a class once, so it can be read & written without hand written Serialize()
+//! and Deserialize() functions:
+//!
+//!		struct Voice : public ISerializable
+//!		{
+//!			RTTI_DECL();
+//!
+//!			std::string m_Name;
+//!			std::string m_Language;
+//!
+//!			WDC_FIELDS_BEGIN(Voice)
+//!				WDC_FIELD("name", m_Name)
+//!				WDC_FIELD("language", m_Language)
+//!			WDC_FIELDS_END()
+//!		};
+//!
+//! The macros implement Serialize() & Deserialize() against a Json::Value, and FromJson() / ToJson() read
+//! and write the JSON text directly with a JsonParser & JsonWriter, with no Json::Value in between.
+//! RequestObj<T> uses FromJson() for any T with fields.
+//!
+//! Only the members found in the JSON are changed. Empty vectors are not written, the same as
+//! ISerializable::SerializeVector(). A member may be a std::string, bool, int, unsigned int, float, double,
+//! Json::Value, another class with fields, any other ISerializable (read through a Json::Value), or a
+//! std::vector of any of these. WDC_TUPLE_BEGIN() reads & writes the fields as the elements of an array
+//! instead of the members of an object.
+template<typename T>
+class JsonFields
+{
+public:
+	//! Types
+	typedef T		ClassType;
+
+	//! A member of T
+	class IField
+	{
+	public:
+		IField(const char * a_pName) : m_pName(a_pName), m_nNameSize(strlen(a_pName))
+		{}
+		virtual ~IField()
+		{}
+
+		const char * GetName() const
+		{
+			return m_pName;
+		}
+		bool IsNamed(const char * a_pName, size_t a_nSize) const
+		{
+			return m_nNameSize == a_nSize && memcmp(m_pName, a_pName, a_nSize) == 0;
+		}
+		size_t GetNameSize() const
+		{
+			return m_nNameSize;
+		}
+
+		virtual bool Read(JsonParser & a_Parser, T & a_Object) const = 0;
+		virtual void Write(JsonWriter & a_Writer, const T & a_Object) const = 0;
+		virtual void Deserialize(const Json::Value & a_Json, T & a_Object) const = 0;
+		virtual void Serialize(const T & a_Object, Json::Value & a_Json) const = 0;
+		virtual bool IsEmpty(const T & a_Object) const = 0;
+
+	private:
+		const char *	m_pName;
+		size_t			m_nNameSize;
+	};
+	typedef boost::shared_ptr<IField>		FieldSP;
+	typedef std::vector<FieldSP>			FieldList;
+
+	//! Construction
+	JsonFields(bool a_bTuple = false) : m_bTuple(a_bTuple)
+	{}
+
+	//! Accessors
+	const FieldList & GetFields() const
+	{
+		return m_Fields;
+	}
+	bool IsTuple() const
+	{
+		return m_bTuple;
+	}
+
+	//! Mutators
+	template<typename F>
+	JsonFields & Add(const char * a_pName, F T::* a_pMember)
+	{
+		m_Fields.push_back(FieldSP(new Field<F>(a_pName, a_pMember)));
+		return *this;
+	}
+
+	//! Read the next value of a_Parser into a_Object, a value of the wrong type is skipped.
+	bool Read(JsonParser & a_Parser, T & a_Object) const;
+	void Write(JsonWriter & a_Writer, const T & a_Object) const;
+	void Deserialize(const Json::Value & a_Json, T & a_Object) const;
+	void Serialize(const T & a_Object, Json::Value & a_Json) const;
+
+	//! Read the JSON text straight into a_Object, returns false if the text isn't valid JSON.
+	static bool FromJson(const std::string & a_Json, T & a_Object, std::string * a_pError = NULL);
+	//! Returns a_Object as compact JSON text.
+	static std::string ToJson(const T & a_Object);
+
+private:
+	//! Types
+	template<typename F>
+	class Field : public IField
+	{
+	public:
+		Field(const char * a_pName, F T::* a_pMember) : IField(a_pName), m_pMember(a_pMember)
+		{}
+
+		virtual bool Read(JsonParser & a_Parser, T & a_Object) const;
+		virtual void Write(JsonWriter & a_Writer, const T & a_Object) const;
+		virtual void Deserialize(const Json::Value & a_Json, T & a_Object) const;
+		virtual void Serialize(const T & a_Object, Json::Value & a_Json) const;
+		virtual bool IsEmpty(const T & a_Object) const;
+
+	private:
+		F T::*		m_pMember;
+	};
+
+	//! Data
+	FieldList		m_Fields;
+	bool			m_bTuple;
+
+	//! Find the field with the given name, a_nNext is where to start looking. Members usually arrive in
+	//! the same order as the fields, so this is normally the first field checked.
+	const IField * Find(const char * a_pName, size_t a_nSize, size_t & a_nNext) const
+	{
+		for (size_t i = 0; i < m_Fields.size(); ++i)
+		{
+			size_t nField = (a_nNext + i) % m_Fields.size();
+			if (m_Fields[nField]->IsNamed(a_pName, a_nSize))
+			{
+				a_nNext = nField + 1;
+				return m_Fields[nField].get();
+			}
+		}
+		return NULL;
+	}
+};
+
+//! Adds Serialize(), Deserialize() & GetJsonFields() to a class, this must be in a public section.
+#define WDC_FIELDS_BEGIN( CLASS )												\
+	typedef CLASS JsonFieldsClass;												\
+	typedef JsonFields<CLASS> JsonFieldsType;									\
+	virtual void Serialize(Json::Value & json)									\
+	{																			\
+		GetJsonFields().Serialize(*this, json);									\
+	}																			\
+	virtual void Deserialize(const Json::Value & json)							\
+	{																			\
+		GetJsonFields().Deserialize(json, *this);								\
+	}																			\
+	static const JsonFieldsType & GetJsonFields()								\
+	{																			\
+		static const JsonFieldsType FIELDS = JsonFieldsType(false)
+
+//! The same as WDC_FIELDS_BEGIN() for a class written as an array, e.g. ["word",0.25,0.5]
+#define WDC_TUPLE_BEGIN( CLASS )												\
+	typedef CLASS JsonFieldsClass;												\
+	typedef JsonFields<CLASS> JsonFieldsType;									\
+	virtual void Serialize(Json::Value & json)									\
+	{																			\
+		GetJsonFields().Serialize(*this, json);									\
+	}																			\
+	virtual void Deserialize(const Json::Value & json)							\
+	{																			\
+		GetJsonFields().Deserialize(json, *this);								\
+	}																			\
+	static const JsonFieldsType & GetJsonFields()								\
+	{																			\
+		static const JsonFieldsType FIELDS = JsonFieldsType(true)
+
+#define WDC_FIELD( NAME, MEMBER )												\
+			.Add(NAME, &JsonFieldsClass::MEMBER)
+
+#define WDC_FIELDS_END()														\
+			;																	\
+		return FIELDS;															\
+	}
+
+//! HasJsonFields<T>::value is true if T itself (not just a base class) was declared with WDC_FIELDS_BEGIN()
+template<typename T>
+struct HasJsonFields
+{
+private:
+	template<typename U> static char Check(typename U::JsonFieldsType *);
+	template<typename U> static long Check(...);
+
+	template<typename U, bool HAS_TYPE>
+	struct IsOwn
+	{
+		static const bool value = false;
+	};
+	template<typename U>
+	struct IsOwn<U, true>
+	{
+		static const bool value = boost::is_same<typename U::JsonFieldsType, JsonFields<U> >::value;
+	};
+
+public:
+	static const bool value = IsOwn<T, sizeof(Check<T>(0)) == sizeof(char)>::value;
+};
+
+//! How a member of type F is read & written, objects use their fields or ISerializable.
+template<typename F, bool HAS_FIELDS = HasJsonFields<F>::value>
+struct JsonFieldType
+{
+	static bool Read(JsonParser & a_Parser, F & a_Value)
+	{
+		Json::Value json;
+		if (!a_Parser.ReadValue(json))
+			return false;
+		Deserialize(json, a_Value);
+		return true;
+	}
+	static void Write(JsonWriter & a_Writer, const F & a_Value)
+	{
+		a_Writer.Write(ISerializable::SerializeObject(const_cast<F *>(&a_Value), false));
+	}
+	static void Deserialize(const Json::Value & a_Json, F & a_Value)
+	{
+		ISerializable::DeserializeObject(a_Json, &a_Value);
+	}
+	static void Serialize(const F & a_Value, Json::Value & a_Json)
+	{
+		a_Json = ISerializable::SerializeObject(const_cast<F *>(&a_Value), false);
+	}
+	static bool IsEmpty(const F &)
+	{
+		return false;
+	}
+};
+
+template<typename F>
+struct JsonFieldType<F, true>
+{
+	static bool Read(JsonParser & a_Parser, F & a_Value)
+	{
+		return F::GetJsonFields().Read(a_Parser, a_Value);
+	}
+	static void Write(JsonWriter & a_Writer, const F & a_Value)
+	{
+		F::GetJsonFields().Write(a_Writer, a_Value);
+	}
+	static void Deserialize(const Json::Value & a_Json, F & a_Value)
+	{
+		F::GetJsonFields().Deserialize(a_Json, a_Value);
+	}
+	static void Serialize(const F & a_Value, Json::Value & a_Json)
+	{
+		F::GetJsonFields().Serialize(a_Value, a_Json);
+	}
+	static bool IsEmpty(const F &)
+	{
+		return false;
+	}
+};
+
+//! Numbers & literals are read as a Json::Value, which doesn't allocate, so they convert the same way
+//! as the hand written Deserialize() functions.
+template<typename F>
+struct JsonScalarType
+{
+	static bool Read(JsonParser & a_Parser, F & a_Value)
+	{
+		Json::Value json;
+		if (!a_Parser.ReadValue(json))
+			return false;
+		JsonFieldType<F>::Deserialize(json, a_Value);
+		return true;
+	}
+	static void Write(JsonWriter & a_Writer, const F & a_Value)
+	{
+		a_Writer.Write(a_Value);
+	}
+	static void Serialize(const F & a_Value, Json::Value & a_Json)
+	{
+		a_Json = a_Value;
+	}
+	static bool IsEmpty(const F &)
+	{
+		return false;
+	}
+};
+
+template<>
+struct JsonFieldType<bool, false> : JsonScalarType<bool>
+{
+	static void Deserialize(const Json::Value & a_Json, bool & a_Value)
+	{
+		a_Value = a_Json.asBool();
+	}
+};
+
+template<>
+struct JsonFieldType<int, false> : JsonScalarType<int>
+{
+	static void Deserialize(const Json::Value & a_Json, int & a_Value)
+	{
+		a_Value = a_Json.asInt();
+	}
+};
+
+template<>
+struct JsonFieldType<unsigned int, false> : JsonScalarType<unsigned int>
+{
+	static void Deserialize(const Json::Value & a_Json, unsigned int & a_Value)
+	{
+		a_Value = a_Json.asUInt();
+	}
+};
+
+template<>
+struct JsonFieldType<float, false> : JsonScalarType<float>
+{
+	static void Deserialize(const Json::Value & a_Json, float & a_Value)
+	{
+		a_Value = a_Json.asFloat();
+	}
+	static void Write(JsonWriter & a_Writer, const float & a_Value)
+	{
+		a_Writer.Write((double)a_Value);
+	}
+};
+
+template<>
+struct JsonFieldType<double, false> : JsonScalarType<double>
+{
+	static void Deserialize(const Json::Value & a_Json, double & a_Value)
+	{
+		a_Value = a_Json.asDouble();
+	}
+};
+
+template<>
+struct JsonFieldType<std::string, false> : JsonScalarType<std::string>
+{
+	static bool Read(JsonParser & a_Parser, std::string & a_Value)
+	{
+		if (a_Parser.Peek() == Json::stringValue)
+			return a_Parser.ReadString(a_Value);
+		return JsonScalarType<std::string>::Read(a_Parser, a_Value);
+	}
+	static void Deserialize(const Json::Value & a_Json, std::string & a_Value)
+	{
+		a_Value = a_Json.asString();
+	}
+};
+
+template<>
+struct JsonFieldType<Json::Value, false>
+{
+	static bool Read(JsonParser & a_Parser, Json::Value & a_Value)
+	{
+		return a_Parser.ReadValue(a_Value);
+	}
+	static void Write(JsonWriter & a_Writer, const Json::Value & a_Value)
+	{
+		a_Writer.Write(a_Value);
+	}
+	static void Deserialize(const Json::Value & a_Json, Json::Value & a_Value)
+	{
+		a_Value = a_Json;
+	}
+	static void Serialize(const Json::Value & a_Value, Json::Value & a_Json)
+	{
+		a_Json = a_Value;
+	}
+	static bool IsEmpty(const Json::Value &)
+	{
+		return false;
+	}
+};
+
+template<typename E>
+struct JsonFieldType<std::vector<E>, false>
+{
+	static bool Read(JsonParser & a_Parser, std::vector<E> & a_Value)
+	{
+		a_Value.clear();
+		if (a_Parser.Peek() != Json::arrayValue)
+			return a_Parser.SkipValue();
+		if (!a_Parser.ReadArrayStart())
+			return false;
+		while (a_Parser.ReadArrayNext())
+		{
+			a_Value.push_back(E());
+			if (!JsonFieldType<E>::Read(a_Parser, a_Value.back()))
+				return false;
+		}
+		return !a_Parser.HasError();
+	}
+	static void Write(JsonWriter & a_Writer, const std::vector<E> & a_Value)
+	{
+		a_Writer.BeginArray();
+		for (size_t i = 0; i < a_Value.size(); ++i)
+			JsonFieldType<E>::Write(a_Writer, a_Value[i]);
+		a_Writer.EndArray();
+	}
+	static void Deserialize(const Json::Value & a_Json, std::vector<E> & a_Value)
+	{
+		a_Value.clear();
+		if (!a_Json.isArray())
+			return;
+		a_Value.resize(a_Json.size());
+		for (Json::ArrayIndex i = 0; i < a_Json.size(); ++i)
+			JsonFieldType<E>::Deserialize(a_Json[i], a_Value[i]);
+	}
+	static void Serialize(const std::vector<E> & a_Value, Json::Value & a_Json)
+	{
+		for (size_t i = 0; i < a_Value.size(); ++i)
+			JsonFieldType<E>::Serialize(a_Value[i], a_Json[(Json::ArrayIndex)i]);
+	}
+	static bool IsEmpty(const std::vector<E> & a_Value)
+	{
+		return a_Value.empty();
+	}
+};
+
+//! Deserialize JSON text into a T, straight from the text when T has fields & through ISerializable otherwise.
+template<typename T, bool HAS_FIELDS = HasJsonFields<T>::value>
+struct JsonDeserializer
+{
+	static bool Deserialize(const std::string & a_Json, T & a_Object)
+	{
+		return ISerializable::DeserializeObject(a_Json, &a_Object) != NULL;
+	}
+};
+
+template<typename T>
+struct JsonDeserializer<T, true>
+{
+	static bool Deserialize(const std::string & a_Json, T & a_Object)
+	{
+		if (!JsonParser::IsFastJson())
+			return ISerializable::DeserializeObject(a_Json, &a_Object) != NULL;
+
+		std::string error;
+		if (JsonFields<T>::FromJson(a_Json, a_Object, &error))
+			return true;
+		Log::Error("JsonFields", "Failed to read json: %s", error.c_str());
+		return false;
+	}
+};
+
+//----------------------------------------
+
+template<typename T>
+bool JsonFields<T>::Read(JsonParser & a_Parser, T & a_Object) const
+{
+	if (m_bTuple)
+	{
+		if (a_Parser.Peek() != Json::arrayValue)
+			return a_Parser.SkipValue();
+		if (!a_Parser.ReadArrayStart())
+			return false;
+		for (size_t i = 0; a_Parser.ReadArrayNext(); ++i)
+		{
+			bool bRead = i < m_Fields.size() ? m_Fields[i]->Read(a_Parser, a_Object) : a_Parser.SkipValue();
+			if (!bRead)
+				return false;
+		}
+		return !a_Parser.HasError();
+	}
+
+	if (a_Parser.Peek() != Json::objectValue)
+		return a_Parser.SkipValue();
+	if (!a_Parser.ReadObjectStart())
+		return false;
+
+	const char * pName = NULL;
+	size_t nSize = 0;
+	size_t nNext = 0;
+	while (a_Parser.ReadMember(pName, nSize))
+	{
+		const IField * pField = Find(pName, nSize, nNext);
+		bool bRead = pField != NULL ? pField->Read(a_Parser, a_Object) : a_Parser.SkipValue();
+		if (!bRead)
+			return false;
+	}
+	return !a_Parser.HasError();
+}
+
+template<typename T>
+void JsonFields<T>::Write(JsonWriter & a_Writer, const T & a_Object) const
+{
+	if (m_bTuple)
+	{
+		a_Writer.BeginArray();
+		for (size_t i = 0; i < m_Fields.size(); ++i)
+			m_Fields[i]->Write(a_Writer, a_Object);
+		a_Writer.EndArray();
+		return;
+	}
+
+	a_Writer.BeginObject();
+	for (size_t i = 0; i < m_Fields.size(); ++i)
+	{
+		const IField * pField = m_Fields[i].get();
+		if (pField->IsEmpty(a_Object))
+			continue;
+		a_Writer.Name(pField->GetName(), pField->GetNameSize());
+		pField->Write(a_Writer, a_Object);
+	}
+	a_Writer.EndObject();
+}
+
+template<typename T>
+void JsonFields<T>::Deserialize(const Json::Value & a_Json, T & a_Object) const
+{
+	if (m_bTuple)
+	{
+		if (!a_Json.isArray())
+			return;
+		for (size_t i = 0; i < m_Fields.size() && i < a_Json.size(); ++i)
+			m_Fields[i]->Deserialize(a_Json[(Json::ArrayIndex)i], a_Object);
+		return;
+	}
+
+	if (!a_Json.isObject())
+		return;
+	for (size_t i = 0; i < m_Fields.size(); ++i)
+	{
+		const IField * pField = m_Fields[i].get();
+		const Json::Value * pMember = a_Json.find(pField->GetName(), pField->GetName() + pField->GetNameSize());
+		if (pMember != NULL)
+			pField->Deserialize(*pMember, a_Object);
+	}
+}
+
+template<typename T>
+void JsonFields<T>::Serialize(const T & a_Object, Json::Value & a_Json) const
+{
+	for (size_t i = 0; i < m_Fields.size(); ++i)
+	{
+		const IField * pField = m_Fields[i].get();
+		if (m_bTuple)
+			pField->Serialize(a_Object, a_Json[(Json::ArrayIndex)i]);
+		else if (!pField->IsEmpty(a_Object))
+			pField->Serialize(a_Object, a_Json[pField->GetName()]);
+	}
+}
+
+template<typename T>
+bool JsonFields<T>::FromJson(const std::string & a_Json, T & a_Object, std::string * a_pError /*= NULL*/)
+{
+	const JsonFields<T> & fields = T::GetJsonFields();
+
+	JsonParser parser;
+	parser.Start(a_Json.data(), a_Json.data() + a_Json.size());
+
+	std::string error;
+	try {
+		if (parser.Peek() != (fields.IsTuple() ? Json::arrayValue : Json::objectValue))
+			error = fields.IsTuple() ? "Expected an array." : "Expected an object.";
+		else if (!fields.Read(parser, a_Object))
+			error = StringUtil::Format("%s at offset %u", parser.GetError().c_str(), (unsigned int)parser.GetErrorOffset());
+	}
+	catch( const std::exception & ex )
+	{
+		error = ex.what();
+	}
+
+	if (error.size() == 0)
+		return true;
+	if (a_pError != NULL)
+		*a_pError = error;
+	return false;
+}
+
+template<typename T>
+std::string JsonFields<T>::ToJson(const T & a_Object)
+{
+	std::string json;
+	JsonWriter writer(json);
+	T::GetJsonFields().Write(writer, a_Object);
+	return json;
+}
+
+template<typename T>
+template<typename F>
+bool JsonFields<T>::Field<F>::Read(JsonParser & a_Parser, T & a_Object) const
+{
+	return JsonFieldType<F>::Read(a_Parser, a_Object.*m_pMember);
+}
+
+template<typename T>
+template<typename F>
+void JsonFields<T>::Field<F>::Write(JsonWriter & a_Writer, const T & a_Object) const
+{
+	JsonFieldType<F>::Write(a_Writer, a_Object.*m_pMember);
+}
+
+template<typename T>
+template<typename F>
+void JsonFields<T>::Field<F>::Deserialize(const Json::Value & a_Json, T & a_Object) const
+{
+	JsonFieldType<F>::Deserialize(a_Json, a_Object.*m_pMember);
+}
+
+template<typename T>
+template<typename F>
+void JsonFields<T>::Field<F>::Serialize(const T & a_Object, Json::Value & a_Json) const
+{
+	JsonFieldType<F>::Serialize(a_Object.*m_pMember, a_Json);
+}
+
+template<typename T>
+template<typename F>
+bool JsonFields<T>::Field<F>::IsEmpty(const T & a_Object) const
+{
+	return JsonFieldType<F>::IsEmpty(a_Object.*m_pMember);
+}
+
+#endif
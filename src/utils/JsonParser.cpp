@@ -0,0 +1,685 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <string.h>
+#include <locale>
+#include <sstream>
+
+#include "JsonParser.h"
+#include "StringUtil.h"
+
+#include "boost/cstdint.hpp"
+
+namespace {
+
+//! Objects & arrays nested deeper than this are rejected, the same limit as Json::Reader
+const int MAX_DEPTH = 1000;
+
+//! Every power of ten that is exactly representable as a double
+const double POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+const int MAX_POW10 = 22;
+const boost::uint64_t MAX_EXACT_MANTISSA = (boost::uint64_t)1 << 53;
+
+inline bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+//! Returns false if another digit would overflow the mantissa
+inline bool AddDigit(boost::uint64_t & a_nMantissa, char c)
+{
+	static const boost::uint64_t MAX_MANTISSA = 1844674407370955161ULL;		// UINT64_MAX / 10
+	if (a_nMantissa > MAX_MANTISSA || (a_nMantissa == MAX_MANTISSA && c > '5'))
+		return false;
+	a_nMantissa = (a_nMantissa * 10) + (c - '0');
+	return true;
+}
+
+void AppendUTF8(std::string & a_String, unsigned int a_nCodePoint)
+{
+	if (a_nCodePoint < 0x80)
+		a_String += (char)a_nCodePoint;
+	else if (a_nCodePoint < 0x800)
+	{
+		a_String += (char)(0xc0 | (a_nCodePoint >> 6));
+		a_String += (char)(0x80 | (a_nCodePoint & 0x3f));
+	}
+	else if (a_nCodePoint < 0x10000)
+	{
+		a_String += (char)(0xe0 | (a_nCodePoint >> 12));
+		a_String += (char)(0x80 | ((a_nCodePoint >> 6) & 0x3f));
+		a_String += (char)(0x80 | (a_nCodePoint & 0x3f));
+	}
+	else
+	{
+		a_String += (char)(0xf0 | (a_nCodePoint >> 18));
+		a_String += (char)(0x80 | ((a_nCodePoint >> 12) & 0x3f));
+		a_String += (char)(0x80 | ((a_nCodePoint >> 6) & 0x3f));
+		a_String += (char)(0x80 | (a_nCodePoint & 0x3f));
+	}
+}
+
+}
+
+JsonParser::JsonParser() :
+	m_pBegin(NULL),
+	m_pEnd(NULL),
+	m_pPos(NULL),
+	m_nDepth(0),
+	m_bOpen(false),
+	m_nErrorOffset(0)
+{}
+
+bool JsonParser::Parse(const std::string & a_Json, Json::Value & a_Root)
+{
+	return Parse(a_Json.data(), a_Json.data() + a_Json.size(), a_Root);
+}
+
+bool JsonParser::Parse(const char * a_pBegin, const char * a_pEnd, Json::Value & a_Root)
+{
+	m_pBegin = m_pPos = a_pBegin;
+	m_pEnd = a_pEnd;
+	m_nDepth = 0;
+	m_Error.clear();
+	m_nErrorOffset = 0;
+	a_Root = Json::Value();
+
+	SkipWhitespace();
+	if (m_pPos >= m_pEnd || (*m_pPos != '{' && *m_pPos != '['))
+		return Error("A valid JSON document must be either an array or an object value.");
+	if (!ParseValue(a_Root))
+	{
+		a_Root = Json::Value();
+		return false;
+	}
+
+	return true;
+}
+
+bool JsonParser::ParseJson(const std::string & a_Json, Json::Value & a_Root, std::string * a_pError /*= NULL*/)
+{
+#if defined(WDC_DISABLE_FAST_JSON)
+	Json::Reader reader(Json::Features::strictMode());
+	if (reader.parse(a_Json, a_Root))
+		return true;
+	if (a_pError != NULL)
+		*a_pError = reader.getFormattedErrorMessages();
+#else
+	JsonParser parser;
+	if (parser.Parse(a_Json, a_Root))
+		return true;
+	if (a_pError != NULL)
+		*a_pError = StringUtil::Format("%s at offset %u", parser.GetError().c_str(), (unsigned int)parser.GetErrorOffset());
+#endif
+	return false;
+}
+
+bool JsonParser::IsFastJson()
+{
+#if defined(WDC_DISABLE_FAST_JSON)
+	return false;
+#else
+	return true;
+#endif
+}
+
+void JsonParser::Start(const char * a_pBegin, const char * a_pEnd)
+{
+	m_pBegin = m_pPos = a_pBegin;
+	m_pEnd = a_pEnd;
+	m_nDepth = 0;
+	m_bOpen = false;
+	m_Error.clear();
+	m_nErrorOffset = 0;
+}
+
+Json::ValueType JsonParser::Peek()
+{
+	SkipWhitespace();
+	if (m_pPos >= m_pEnd)
+		return Json::nullValue;
+
+	switch (*m_pPos)
+	{
+	case '{':
+		return Json::objectValue;
+	case '[':
+		return Json::arrayValue;
+	case '"':
+		return Json::stringValue;
+	case 't':
+	case 'f':
+		return Json::booleanValue;
+	default:
+		if (*m_pPos == '-' || IsDigit(*m_pPos))
+			return Json::realValue;
+		return Json::nullValue;
+	}
+}
+
+bool JsonParser::ReadObjectStart()
+{
+	if (!Expect('{', "Expected an object."))
+		return false;
+	m_bOpen = true;
+	return true;
+}
+
+bool JsonParser::ReadMember(const char *& a_pName, size_t & a_nSize)
+{
+	SkipWhitespace();
+	if (m_pPos < m_pEnd && *m_pPos == '}')
+	{
+		++m_pPos;
+		m_bOpen = false;
+		return false;
+	}
+	if (!m_bOpen && !Expect(',', "Expected ',' or '}' in object."))
+		return false;
+
+	SkipWhitespace();
+	if (m_pPos >= m_pEnd || *m_pPos != '"')
+		return Error("Expected a string for the object member name.");
+	if (!ParseString(a_pName, a_nSize))
+		return false;
+	return Expect(':', "Expected ':' after the object member name.");
+}
+
+bool JsonParser::ReadArrayStart()
+{
+	if (!Expect('[', "Expected an array."))
+		return false;
+	m_bOpen = true;
+	return true;
+}
+
+bool JsonParser::ReadArrayNext()
+{
+	SkipWhitespace();
+	if (m_pPos < m_pEnd && *m_pPos == ']')
+	{
+		++m_pPos;
+		m_bOpen = false;
+		return false;
+	}
+	if (!m_bOpen)
+		return Expect(',', "Expected ',' or ']' in array.");
+	return true;
+}
+
+bool JsonParser::ReadString(std::string & a_Value)
+{
+	SkipWhitespace();
+	if (m_pPos >= m_pEnd || *m_pPos != '"')
+		return Error("Expected a string.");
+
+	const char * pString = NULL;
+	size_t nSize = 0;
+	if (!ParseString(pString, nSize))
+		return false;
+	a_Value.assign(pString, nSize);
+	m_bOpen = false;
+	return true;
+}
+
+bool JsonParser::ReadValue(Json::Value & a_Value)
+{
+	Json::Value value;
+	if (!ParseValue(value))
+		return false;
+	a_Value.swap(value);
+	m_bOpen = false;
+	return true;
+}
+
+bool JsonParser::SkipValue()
+{
+	if (!Skip())
+		return false;
+	m_bOpen = false;
+	return true;
+}
+
+bool JsonParser::ParseValue(Json::Value & a_Value)
+{
+	SkipWhitespace();
+	if (m_pPos >= m_pEnd)
+		return Error("Expected a value.");
+
+	switch (*m_pPos)
+	{
+	case '{':
+		return ParseObject(a_Value);
+	case '[':
+		return ParseArray(a_Value);
+	case '"':
+		{
+			const char * pString = NULL;
+			size_t nSize = 0;
+			if (!ParseString(pString, nSize))
+				return false;
+			Json::Value value(pString, pString + nSize);
+			a_Value.swapPayload(value);
+			return true;
+		}
+	case 't':
+		return ParseLiteral("true", 4, Json::Value(true), a_Value);
+	case 'f':
+		return ParseLiteral("false", 5, Json::Value(false), a_Value);
+	case 'n':
+		return ParseLiteral("null", 4, Json::Value(), a_Value);
+	default:
+		if (*m_pPos == '-' || IsDigit(*m_pPos))
+			return ParseNumber(a_Value);
+		return Error("Expected a value.");
+	}
+}
+
+bool JsonParser::ParseObject(Json::Value & a_Value)
+{
+	if (++m_nDepth > MAX_DEPTH)
+		return Error("Objects & arrays are nested too deeply.");
+
+	Json::Value object(Json::objectValue);
+	a_Value.swapPayload(object);
+
+	++m_pPos;		// skip the '{'
+	SkipWhitespace();
+	if (m_pPos < m_pEnd && *m_pPos == '}')
+	{
+		++m_pPos;
+		--m_nDepth;
+		return true;
+	}
+
+	for(;;)
+	{
+		SkipWhitespace();
+		if (m_pPos >= m_pEnd || *m_pPos != '"')
+			return Error("Expected a string for the object member name.");
+
+		const char * pKey = NULL;
+		size_t nKey = 0;
+		if (!ParseString(pKey, nKey))
+			return false;
+		m_Key.assign(pKey, nKey);
+
+		SkipWhitespace();
+		if (m_pPos >= m_pEnd || *m_pPos != ':')
+			return Error("Expected ':' after the object member name.");
+		++m_pPos;
+
+		// parse straight into the member, so the value is never copied..
+		if (!ParseValue(a_Value[m_Key]))
+			return false;
+
+		SkipWhitespace();
+		if (m_pPos < m_pEnd && *m_pPos == ',')
+			++m_pPos;
+		else if (m_pPos < m_pEnd && *m_pPos == '}')
+		{
+			++m_pPos;
+			break;
+		}
+		else
+			return Error("Expected ',' or '}' in object.");
+	}
+
+	--m_nDepth;
+	return true;
+}
+
+bool JsonParser::ParseArray(Json::Value & a_Value)
+{
+	if (++m_nDepth > MAX_DEPTH)
+		return Error("Objects & arrays are nested too deeply.");
+
+	Json::Value array(Json::arrayValue);
+	a_Value.swapPayload(array);
+
+	++m_pPos;		// skip the '['
+	SkipWhitespace();
+	if (m_pPos < m_pEnd && *m_pPos == ']')
+	{
+		++m_pPos;
+		--m_nDepth;
+		return true;
+	}
+
+	for(Json::ArrayIndex nIndex = 0;; ++nIndex)
+	{
+		if (!ParseValue(a_Value[nIndex]))
+			return false;
+
+		SkipWhitespace();
+		if (m_pPos < m_pEnd && *m_pPos == ',')
+			++m_pPos;
+		else if (m_pPos < m_pEnd && *m_pPos == ']')
+		{
+			++m_pPos;
+			break;
+		}
+		else
+			return Error("Expected ',' or ']' in array.");
+	}
+
+	--m_nDepth;
+	return true;
+}
+
+bool JsonParser::ParseString(const char *& a_pString, size_t & a_nSize)
+{
+	const char * pStart = ++m_pPos;		// skip the '"'
+	const char * pQuote = (const char *)memchr(pStart, '"', m_pEnd - pStart);
+	if (pQuote == NULL)
+		return Error("Missing '\"' at the end of the string.");
+
+	// most strings have no escapes, so they are used right where they are in the text..
+	const char * pEscape = (const char *)memchr(pStart, '\\', pQuote - pStart);
+	if (pEscape == NULL)
+	{
+		a_pString = pStart;
+		a_nSize = pQuote - pStart;
+		m_pPos = pQuote + 1;
+		return true;
+	}
+
+	m_Unescaped.assign(pStart, pEscape);
+	m_pPos = pEscape;
+	for(;;)
+	{
+		if (m_pPos >= m_pEnd)
+			return Error("Missing '\"' at the end of the string.");
+
+		char c = *m_pPos++;
+		if (c == '"')
+			break;
+		if (c != '\\')
+		{
+			const char * pRun = m_pPos - 1;
+			while (m_pPos < m_pEnd && *m_pPos != '"' && *m_pPos != '\\')
+				++m_pPos;
+			m_Unescaped.append(pRun, m_pPos);
+			continue;
+		}
+
+		if (m_pPos >= m_pEnd)
+			return Error("Missing '\"' at the end of the string.");
+		switch (*m_pPos++)
+		{
+		case '"':	m_Unescaped += '"'; break;
+		case '\\':	m_Unescaped += '\\'; break;
+		case '/':	m_Unescaped += '/'; break;
+		case 'b':	m_Unescaped += '\b'; break;
+		case 'f':	m_Unescaped += '\f'; break;
+		case 'n':	m_Unescaped += '\n'; break;
+		case 'r':	m_Unescaped += '\r'; break;
+		case 't':	m_Unescaped += '\t'; break;
+		case 'u':
+			{
+				unsigned int nCodePoint = 0;
+				if (!ParseHex(nCodePoint))
+					return false;
+				if (nCodePoint >= 0xd800 && nCodePoint <= 0xdbff)
+				{
+					unsigned int nLow = 0;
+					if (m_pEnd - m_pPos < 2 || m_pPos[0] != '\\' || m_pPos[1] != 'u')
+						return Error("Expected a low surrogate after a high surrogate.");
+					m_pPos += 2;
+					if (!ParseHex(nLow))
+						return false;
+					if (nLow < 0xdc00 || nLow > 0xdfff)
+						return Error("Expected a low surrogate after a high surrogate.");
+					nCodePoint = 0x10000 + ((nCodePoint & 0x3ff) << 10) + (nLow & 0x3ff);
+				}
+				AppendUTF8(m_Unescaped, nCodePoint);
+			}
+			break;
+		default:
+			--m_pPos;
+			return Error("Bad escape sequence in string.");
+		}
+	}
+
+	a_pString = m_Unescaped.data();
+	a_nSize = m_Unescaped.size();
+	return true;
+}
+
+bool JsonParser::ParseNumber(Json::Value & a_Value)
+{
+	const char * pStart = m_pPos;
+	bool bNegative = *m_pPos == '-';
+	if (bNegative)
+		++m_pPos;
+	if (m_pPos >= m_pEnd || !IsDigit(*m_pPos))
+		return Error("Expected a digit.");
+
+	// collect the significant digits into a mantissa with a decimal exponent..
+	boost::uint64_t nMantissa = 0;
+	int nExponent = 0;
+	bool bTruncated = false;
+	bool bInteger = true;
+
+	if (*m_pPos == '0')
+		++m_pPos;
+	else
+	{
+		for (; m_pPos < m_pEnd && IsDigit(*m_pPos); ++m_pPos)
+		{
+			if (!AddDigit(nMantissa, *m_pPos))
+			{
+				bTruncated = true;
+				nExponent += 1;
+			}
+		}
+	}
+
+	if (m_pPos < m_pEnd && *m_pPos == '.')
+	{
+		bInteger = false;
+		if (++m_pPos >= m_pEnd || !IsDigit(*m_pPos))
+			return Error("Expected a digit after the decimal point.");
+		for (; m_pPos < m_pEnd && IsDigit(*m_pPos); ++m_pPos)
+		{
+			if (AddDigit(nMantissa, *m_pPos))
+				nExponent -= 1;
+			else
+				bTruncated = true;
+		}
+	}
+
+	if (m_pPos < m_pEnd && (*m_pPos == 'e' || *m_pPos == 'E'))
+	{
+		bInteger = false;
+		bool bNegativeExp = false;
+		if (++m_pPos < m_pEnd && (*m_pPos == '+' || *m_pPos == '-'))
+			bNegativeExp = *m_pPos++ == '-';
+		if (m_pPos >= m_pEnd || !IsDigit(*m_pPos))
+			return Error("Expected a digit in the exponent.");
+
+		int nExp = 0;
+		for (; m_pPos < m_pEnd && IsDigit(*m_pPos); ++m_pPos)
+			if (nExp < 100000)
+				nExp = (nExp * 10) + (*m_pPos - '0');
+		nExponent += bNegativeExp ? -nExp : nExp;
+	}
+
+	if (bInteger && !bTruncated)
+	{
+		// the same types Json::Reader would choose..
+		if (!bNegative)
+		{
+			if (nMantissa <= (boost::uint64_t)Json::Value::maxInt)
+				a_Value = Json::Value::LargestInt(nMantissa);
+			else
+				a_Value = Json::Value::LargestUInt(nMantissa);
+			return true;
+		}
+		if (nMantissa <= (boost::uint64_t)Json::Value::maxLargestInt)
+		{
+			a_Value = -Json::Value::LargestInt(nMantissa);
+			return true;
+		}
+		if (nMantissa == (boost::uint64_t)Json::Value::maxLargestInt + 1)
+		{
+			a_Value = Json::Value::minLargestInt;
+			return true;
+		}
+	}
+
+	double fValue = 0.0;
+	if (!bTruncated && nMantissa <= MAX_EXACT_MANTISSA && nExponent >= -MAX_POW10 && nExponent <= MAX_POW10)
+	{
+		// both the mantissa & the power of ten are exact, so a single operation rounds correctly..
+		fValue = (double)nMantissa;
+		if (nExponent < 0)
+			fValue /= POW10[-nExponent];
+		else
+			fValue *= POW10[nExponent];
+		if (bNegative)
+			fValue = -fValue;
+	}
+	else
+	{
+		std::istringstream input(std::string(pStart, m_pPos));
+		input.imbue(std::locale::classic());
+		if (!(input >> fValue))
+		{
+			m_pPos = pStart;
+			return Error("Number is out of range.");
+		}
+	}
+
+	a_Value = fValue;
+	return true;
+}
+
+bool JsonParser::Skip()
+{
+	SkipWhitespace();
+	if (m_pPos >= m_pEnd)
+		return Error("Expected a value.");
+
+	const char * pString = NULL;
+	size_t nSize = 0;
+	switch (*m_pPos)
+	{
+	case '{':
+		if (++m_nDepth > MAX_DEPTH)
+			return Error("Objects & arrays are nested too deeply.");
+		++m_pPos;
+		SkipWhitespace();
+		if (m_pPos < m_pEnd && *m_pPos == '}')
+			++m_pPos;
+		else
+		{
+			for(;;)
+			{
+				SkipWhitespace();
+				if (m_pPos >= m_pEnd || *m_pPos != '"')
+					return Error("Expected a string for the object member name.");
+				if (!ParseString(pString, nSize) || !Expect(':', "Expected ':' after the object member name.") || !Skip())
+					return false;
+				SkipWhitespace();
+				if (m_pPos >= m_pEnd || *m_pPos != ',')
+					break;
+				++m_pPos;
+			}
+			if (!Expect('}', "Expected ',' or '}' in object."))
+				return false;
+		}
+		--m_nDepth;
+		return true;
+	case '[':
+		if (++m_nDepth > MAX_DEPTH)
+			return Error("Objects & arrays are nested too deeply.");
+		++m_pPos;
+		SkipWhitespace();
+		if (m_pPos < m_pEnd && *m_pPos == ']')
+			++m_pPos;
+		else
+		{
+			for(;;)
+			{
+				if (!Skip())
+					return false;
+				SkipWhitespace();
+				if (m_pPos >= m_pEnd || *m_pPos != ',')
+					break;
+				++m_pPos;
+			}
+			if (!Expect(']', "Expected ',' or ']' in array."))
+				return false;
+		}
+		--m_nDepth;
+		return true;
+	case '"':
+		return ParseString(pString, nSize);
+	default:
+		{
+			// numbers & literals don't allocate..
+			Json::Value value;
+			return ParseValue(value);
+		}
+	}
+}
+
+bool JsonParser::ParseLiteral(const char * a_pLiteral, size_t a_nSize, const Json::Value & a_Value, Json::Value & a_Result)
+{
+	if ((size_t)(m_pEnd - m_pPos) < a_nSize || memcmp(m_pPos, a_pLiteral, a_nSize) != 0)
+		return Error("Expected a value.");
+
+	m_pPos += a_nSize;
+	a_Result = a_Value;
+	return true;
+}
+
+bool JsonParser::ParseHex(unsigned int & a_nValue)
+{
+	if (m_pEnd - m_pPos < 4)
+		return Error("Expected 4 hex digits after '\\u'.");
+
+	a_nValue = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		char c = *m_pPos++;
+		a_nValue <<= 4;
+		if (c >= '0' && c <= '9')
+			a_nValue |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			a_nValue |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			a_nValue |= c - 'A' + 10;
+		else
+		{
+			--m_pPos;
+			return Error("Expected 4 hex digits after '\\u'.");
+		}
+	}
+	return true;
+}
+
+bool JsonParser::Error(const char * a_pError)
+{
+	m_Error = a_pError;
+	m_nErrorOffset = m_pPos - m_pBegin;
+	return false;
+}
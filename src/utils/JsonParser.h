@@ -0,0 +1,128 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_JSON_PARSER_H
+#define WDC_JSON_PARSER_H
+
+#include <string>
+
+#include "boost/noncopyable.hpp"
+
+#include "jsoncpp/json/json.h"
+#include "WDCLib.h"		// include last always
+
+//! A single pass JSON parser that builds the Json::Value tree directly from the text, used in place of
+//! Json::Reader for service responses.
+//!
+//! Json::Reader tokenizes the text, decodes every string into a temporary and parses each real number
+//! through a std::istringstream. This parser finds the end of a string with memchr(), copies strings with
+//! no escapes straight into the tree, reuses one buffer for the strings that have escapes, and converts
+//! most real numbers with a single multiply or divide.
+//!
+//! The result is the same as Json::Reader with Json::Features::strictMode(): the root must be an object or
+//! array, comments are not allowed & any text after the root value is ignored.
+//!
+//! The pull interface reads a document one value at a time with no tree at all, JsonFields uses it to
+//! read a response straight into an object.
+class WDC_API JsonParser : private boost::noncopyable
+{
+public:
+	//! Construction
+	JsonParser();
+
+	//! Accessors
+	//! Returns the reason the last Parse() failed
+	const std::string & GetError() const
+	{
+		return m_Error;
+	}
+	//! Returns the offset into the text where the last Parse() failed
+	size_t GetErrorOffset() const
+	{
+		return m_nErrorOffset;
+	}
+
+	//! Parse the JSON text into a_Root, returns false if the text isn't valid JSON & a_Root is left null.
+	bool Parse(const std::string & a_Json, Json::Value & a_Root);
+	bool Parse(const char * a_pBegin, const char * a_pEnd, Json::Value & a_Root);
+
+	//! Parse with a JsonParser, or with Json::Reader when built with WDC_DISABLE_FAST_JSON. On failure
+	//! the reason is written into a_pError if it's not NULL.
+	static bool ParseJson(const std::string & a_Json, Json::Value & a_Root, std::string * a_pError = NULL);
+	//! Returns false if the library was built with WDC_DISABLE_FAST_JSON, this is decided in the library so
+	//! code built against it doesn't need the same definitions.
+	static bool IsFastJson();
+
+	//! Pull interface, Start() the parser on the text then read each value in turn. A read returns false
+	//! on an error, or at the end of an object or array for ReadMember() & ReadArrayNext().
+	void Start(const char * a_pBegin, const char * a_pEnd);
+	//! Returns the type of the next value without reading it, realValue is returned for any number and
+	//! nullValue for text that isn't a value.
+	Json::ValueType Peek();
+	bool ReadObjectStart();
+	//! Read the name of the next member, a_pName is valid until the next read.
+	bool ReadMember(const char *& a_pName, size_t & a_nSize);
+	bool ReadArrayStart();
+	//! Returns true if there is another element in the array to read.
+	bool ReadArrayNext();
+	bool ReadString(std::string & a_Value);
+	//! Read the next value into a tree, this is cheap for numbers & literals.
+	bool ReadValue(Json::Value & a_Value);
+	bool SkipValue();
+	bool HasError() const
+	{
+		return m_Error.size() > 0;
+	}
+
+private:
+	//! Data
+	const char *	m_pBegin;
+	const char *	m_pEnd;
+	const char *	m_pPos;
+	int				m_nDepth;
+	bool			m_bOpen;		// an object or array was just started, so no ',' is expected
+	std::string		m_Key;			// the object key being parsed
+	std::string		m_Unescaped;	// a string with escapes once they have been decoded
+	std::string		m_Error;
+	size_t			m_nErrorOffset;
+
+	bool ParseValue(Json::Value & a_Value);
+	bool ParseObject(Json::Value & a_Value);
+	bool ParseArray(Json::Value & a_Value);
+	//! Parse the string at m_pPos, a_pString & a_nSize are set to the raw text or m_Unescaped
+	bool ParseString(const char *& a_pString, size_t & a_nSize);
+	bool ParseNumber(Json::Value & a_Value);
+	bool ParseLiteral(const char * a_pLiteral, size_t a_nSize, const Json::Value & a_Value, Json::Value & a_Result);
+	bool ParseHex(unsigned int & a_nValue);
+	bool Skip();
+	bool Expect(char a_Token, const char * a_pError)
+	{
+		SkipWhitespace();
+		if (m_pPos >= m_pEnd || *m_pPos != a_Token)
+			return Error(a_pError);
+		++m_pPos;
+		return true;
+	}
+	void SkipWhitespace()
+	{
+		while (m_pPos < m_pEnd && (*m_pPos == ' ' || *m_pPos == '\n' || *m_pPos == '\r' || *m_pPos == '\t'))
+			++m_pPos;
+	}
+	bool Error(const char * a_pError);
+};
+
+#endif
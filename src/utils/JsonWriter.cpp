@@ -0,0 +1,127 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <stdio.h>
+
+#include "JsonWriter.h"
+
+#include "boost/math/special_functions/fpclassify.hpp"
+
+void JsonWriter::Name(const char * a_pName, size_t a_nSize)
+{
+	Separate();
+	WriteString(a_pName, a_nSize);
+	m_Output += ':';
+	m_bComma = false;
+}
+
+void JsonWriter::Write(int a_nValue)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%d", a_nValue);
+	Separate();
+	m_Output += buffer;
+}
+
+void JsonWriter::Write(unsigned int a_nValue)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%u", a_nValue);
+	Separate();
+	m_Output += buffer;
+}
+
+void JsonWriter::Write(Json::Int64 a_nValue)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%lld", (long long)a_nValue);
+	Separate();
+	m_Output += buffer;
+}
+
+void JsonWriter::Write(Json::UInt64 a_nValue)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)a_nValue);
+	Separate();
+	m_Output += buffer;
+}
+
+void JsonWriter::Write(double a_fValue)
+{
+	char buffer[32];
+	if (boost::math::isfinite(a_fValue))
+	{
+		int nLength = snprintf(buffer, sizeof(buffer), "%.17g", a_fValue);
+		// the decimal point of the locale is always written as a '.', the same as Json::FastWriter..
+		for (int i = 0; i < nLength; ++i)
+			if (buffer[i] == ',')
+				buffer[i] = '.';
+	}
+	else if (a_fValue != a_fValue)
+		snprintf(buffer, sizeof(buffer), "null");
+	else
+		snprintf(buffer, sizeof(buffer), a_fValue < 0.0 ? "-1e+9999" : "1e+9999");
+
+	Separate();
+	m_Output += buffer;
+}
+
+void JsonWriter::Write(const Json::Value & a_Value)
+{
+	Separate();
+
+	std::string json(Json::FastWriter().write(a_Value));
+	if (json.size() > 0 && json[json.size() - 1] == '\n')
+		json.resize(json.size() - 1);
+	m_Output += json;
+}
+
+void JsonWriter::WriteString(const char * a_pString, size_t a_nSize)
+{
+	static const char HEX[] = "0123456789ABCDEF";
+
+	m_Output += '"';
+	const char * pRun = a_pString;
+	const char * pEnd = a_pString + a_nSize;
+	for (const char * pChar = a_pString; pChar < pEnd; ++pChar)
+	{
+		unsigned char c = (unsigned char)*pChar;
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+
+		m_Output.append(pRun, pChar);
+		pRun = pChar + 1;
+		switch (c)
+		{
+		case '"':	m_Output += "\\\""; break;
+		case '\\':	m_Output += "\\\\"; break;
+		case '\b':	m_Output += "\\b"; break;
+		case '\f':	m_Output += "\\f"; break;
+		case '\n':	m_Output += "\\n"; break;
+		case '\r':	m_Output += "\\r"; break;
+		case '\t':	m_Output += "\\t"; break;
+		default:
+			m_Output += "\\u00";
+			m_Output += HEX[c >> 4];
+			m_Output += HEX[c & 0xf];
+			break;
+		}
+	}
+	m_Output.append(pRun, pEnd);
+	m_Output += '"';
+}
@@ -0,0 +1,98 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_JSON_WRITER_H
+#define WDC_JSON_WRITER_H
+
+#include <string>
+
+#include "boost/noncopyable.hpp"
+
+#include "jsoncpp/json/json.h"
+#include "WDCLib.h"		// include last always
+
+//! Writes compact JSON straight into a string, one value at a time, without building a Json::Value.
+//! Values are formatted the same way as Json::FastWriter, the separators are added as needed.
+class WDC_API JsonWriter : private boost::noncopyable
+{
+public:
+	//! Construction
+	JsonWriter(std::string & a_Output) : m_Output(a_Output), m_bComma(false)
+	{}
+
+	void BeginObject()
+	{
+		Separate();
+		m_Output += '{';
+		m_bComma = false;
+	}
+	void EndObject()
+	{
+		m_Output += '}';
+		m_bComma = true;
+	}
+	void BeginArray()
+	{
+		Separate();
+		m_Output += '[';
+		m_bComma = false;
+	}
+	void EndArray()
+	{
+		m_Output += ']';
+		m_bComma = true;
+	}
+	//! Write the name of the next member of an object
+	void Name(const char * a_pName, size_t a_nSize);
+
+	void Write(const std::string & a_Value)
+	{
+		Separate();
+		WriteString(a_Value.data(), a_Value.size());
+	}
+	void Write(bool a_bValue)
+	{
+		Separate();
+		m_Output += a_bValue ? "true" : "false";
+	}
+	void Write(int a_nValue);
+	void Write(unsigned int a_nValue);
+	void Write(Json::Int64 a_nValue);
+	void Write(Json::UInt64 a_nValue);
+	void Write(double a_fValue);
+	void Write(const Json::Value & a_Value);
+	void WriteNull()
+	{
+		Separate();
+		m_Output += "null";
+	}
+
+private:
+	//! Data
+	std::string &	m_Output;
+	bool			m_bComma;		// a value has been written, so the next one needs a ','
+
+	void Separate()
+	{
+		if (m_bComma)
+			m_Output += ',';
+		m_bComma = true;
+	}
+	void WriteString(const char * a_pString, size_t a_nSize);
+};
+
+#endif
@@ -22,17 +22,57 @@
 #endif
 
 #include <boost/filesystem.hpp>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
 #include <string>
 #include <list>
+#include <map>
+#include <vector>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#include "zlib.h"
 #include "Log.h"
 #include "Time.h"
 #include "StringUtil.h"
 #include "ThreadPool.h"
 #include "WatsonException.h"
 
+LogEntry & LogEntry::Add(const char * a_pKey, const std::string & a_Value)
+{
+	m_Fields.push_back( LogFields::value_type( a_pKey, a_Value ) );
+	return *this;
+}
+
+LogEntry & LogEntry::Add(const char * a_pKey, const char * a_pValue)
+{
+	m_Fields.push_back( LogFields::value_type( a_pKey, a_pValue != NULL ? a_pValue : "" ) );
+	return *this;
+}
+
+LogEntry & LogEntry::Add(const char * a_pKey, int a_nValue)
+{
+	return Add( a_pKey, StringUtil::Format( "%d", a_nValue ) );
+}
+
+LogEntry & LogEntry::Add(const char * a_pKey, double a_fValue)
+{
+	return Add( a_pKey, StringUtil::Format( "%g", a_fValue ) );
+}
+
+LogEntry & LogEntry::AddBody(const char * a_pKey, const std::string & a_Body)
+{
+	size_t nMaxBody = Log::GetMaxBodySize();
+	if ( a_Body.size() <= nMaxBody )
+		return Add( a_pKey, a_Body );
+
+	m_Fields.push_back( LogFields::value_type( a_pKey, a_Body.substr( 0, nMaxBody ) ) );
+	m_Fields.back().second += StringUtil::Format( "...(%u bytes)", (unsigned int)a_Body.size() );
+	return *this;
+}
+
 void ConsoleReactor::Process(const LogRecord & a_Record)
 {
 	if (a_Record.m_Level >= m_MinLevel)
@@ -50,11 +90,14 @@ void ConsoleReactor::Process(const LogRecord & a_Record)
 				SetConsoleTextAttribute(h, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY );
 		}
 #endif
-		printf("[%s][%s][%s] %s\n",
+		std::string fields;
+		Log::FormatFields(a_Record.m_Fields, fields);
+		printf("[%s][%s][%s] %s%s\n",
 			a_Record.m_Time.c_str(),
 			Log::LevelText(a_Record.m_Level),
 			a_Record.m_SubSystem.c_str(),
-			a_Record.m_Message.c_str());
+			a_Record.m_Message.c_str(),
+			fields.c_str());
 
 #ifdef _WIN32
 		if (h)
@@ -66,28 +109,19 @@ void ConsoleReactor::Process(const LogRecord & a_Record)
 FileReactor::FileReactor(const char * a_pLogFile, LogLevel a_MinLevel /*= DEBUG*/, int a_LogHistory /*= 5*/) :
 	m_LogFile(a_pLogFile),
 	m_MinLevel(a_MinLevel),
-	m_pThread( NULL ),
+	m_LogHistory(a_LogHistory),
+	m_nMaxBytes(0),
+	m_fMaxAge(0.0f),
+	m_bCompress(false),
 	m_bStopThread(false),
-	m_bThreadStopped(false)
+	m_pThread( NULL ),
+	m_pCompressThread( NULL ),
+	m_pFile( NULL ),
+	m_nFileSize( 0 ),
+	m_fFileOpened( 0.0 )
 {
 	// rotate log files...
-	try {
-		boost::filesystem::remove( StringUtil::Format( "%s.%d", a_pLogFile, a_LogHistory - 1 ).c_str() );
-		for(int i=a_LogHistory - 1;i>0;--i)
-		{
-			std::string src = StringUtil::Format( "%s.%d", a_pLogFile, i - 1);
-			if ( boost::filesystem::exists( src ) )
-			{
-				std::string dst = StringUtil::Format( "%s.%d", a_pLogFile, i );
-				boost::filesystem::rename( src.c_str(), dst.c_str() );
-			}
-		}
-
-		if ( boost::filesystem::exists( a_pLogFile ) )
-			boost::filesystem::rename( a_pLogFile, StringUtil::Format( "%s.%d", a_pLogFile, 0 ) );
-	}
-	catch( const std::exception & )
-	{}
+	RotateFiles( false );
 
 	// start our thread for writing to files..
 	m_pThread = new boost::thread( boost::bind( &FileReactor::WriteThread, this ) );
@@ -97,65 +131,1052 @@ FileReactor::~FileReactor()
 {
 	if ( m_pThread != NULL )
 	{
+		m_OutputLock.lock();
 		m_bStopThread = true;
-		while(! m_bThreadStopped )
-			boost::this_thread::yield();
+		m_OutputReady.notify_one();
+		m_OutputLock.unlock();
 
+		m_pThread->join();
 		delete m_pThread;
 		m_pThread = NULL;
 	}
+
+	if ( m_pCompressThread != NULL )
+	{
+		m_pCompressThread->join();
+		delete m_pCompressThread;
+		m_pCompressThread = NULL;
+	}
+}
+
+void FileReactor::SetRotation(size_t a_nMaxBytes, float a_fMaxAge /*= 0.0f*/)
+{
+	boost::lock_guard<boost::mutex> lock( m_OutputLock );
+	m_nMaxBytes = a_nMaxBytes;
+	m_fMaxAge = a_fMaxAge;
+}
+
+void FileReactor::SetCompress(bool a_bCompress)
+{
+	boost::lock_guard<boost::mutex> lock( m_OutputLock );
+	m_bCompress = a_bCompress;
 }
 
 void FileReactor::Process(const LogRecord & a_Record)
 {
 	if (a_Record.m_Level >= m_MinLevel)
 	{
-		std::string log( StringUtil::Format( "[%s][%s][%s] %s\n", 
-			a_Record.m_Time.c_str(), Log::LevelText( a_Record.m_Level ), a_Record.m_SubSystem.c_str(), a_Record.m_Message.c_str() ) );
+		std::string log;
+		FormatRecord( a_Record, log );
 
 		m_OutputLock.lock();
-		m_Output.push_back( log );
+		bool bWake = m_Output.size() == 0;
+		m_Output.push_back( std::string() );
+		m_Output.back().swap( log );
 		m_OutputLock.unlock();
+
+		// the write thread only needs waking for the first record of each batch..
+		if ( bWake )
+			m_OutputReady.notify_one();
 	}
 }
 
+void FileReactor::FormatRecord(const LogRecord & a_Record, std::string & a_Output)
+{
+	a_Output.reserve( a_Output.size() + a_Record.m_Time.size() + a_Record.m_SubSystem.size() + a_Record.m_Message.size() + 16 );
+	a_Output += '[';
+	a_Output += a_Record.m_Time;
+	a_Output += "][";
+	a_Output += Log::LevelText( a_Record.m_Level );
+	a_Output += "][";
+	a_Output += a_Record.m_SubSystem;
+	a_Output += "] ";
+	a_Output += a_Record.m_Message;
+	Log::FormatFields( a_Record.m_Fields, a_Output );
+	a_Output += '\n';
+}
+
 void FileReactor::WriteThread()
 {
-	while(! m_bStopThread )
+	OpenFile();
+
+	LogList output;
+	boost::unique_lock<boost::mutex> lock( m_OutputLock );
+	while(! m_bStopThread || m_Output.size() > 0 )
 	{
-		boost::this_thread::sleep( boost::posix_time::milliseconds( 250 ) );
+		if ( m_Output.size() > 0 )
+		{
+			// take the whole batch so we don't block the logging thread while writing..
+			output.swap( m_Output );
+			lock.unlock();
 
-		m_OutputLock.lock();
-		if ( m_Output.begin() != m_Output.end() )
+			WriteOutput( output );
+			output.clear();
+
+			lock.lock();
+		}
+		else
+		{
+			// wake up once a second even if nothing is logged so age based rotation still happens
+			m_OutputReady.timed_wait( lock, boost::posix_time::seconds( 1 ) );
+		}
+
+		bool bRotate = (m_nMaxBytes > 0 && m_nFileSize >= m_nMaxBytes)
+			|| (m_fMaxAge > 0.0f && (Time().GetEpochTime() - m_fFileOpened) >= m_fMaxAge && m_nFileSize > 0);
+		if ( bRotate )
+		{
+			bool bCompress = m_bCompress;
+			lock.unlock();
+
+			CloseFile();
+			RotateFiles( bCompress );
+			OpenFile();
+
+			lock.lock();
+		}
+	}
+
+	lock.unlock();
+	CloseFile();
+}
+
+void FileReactor::WriteOutput(const LogList & a_Output)
+{
+	if ( m_pFile == NULL )
+		return;
+
+	// everything goes into the FILE buffer, which is written with as few calls as possible by the flush
+	for( LogList::const_iterator iLog = a_Output.begin(); iLog != a_Output.end(); ++iLog )
+	{
+		const std::string & log = *iLog;
+		m_nFileSize += fwrite( log.data(), sizeof(char), log.size(), m_pFile );
+	}
+	fflush( m_pFile );
+}
+
+void FileReactor::OpenFile()
+{
+	m_pFile = fopen( m_LogFile.c_str(), "ab" );
+	if ( m_pFile != NULL )
+	{
+		setvbuf( m_pFile, NULL, _IOFBF, WRITE_BUFFER_SIZE );
+		fseek( m_pFile, 0, SEEK_END );
+		m_nFileSize = (size_t)ftell( m_pFile );
+	}
+	else
+		m_nFileSize = 0;
+	m_fFileOpened = Time().GetEpochTime();
+}
+
+void FileReactor::CloseFile()
+{
+	if ( m_pFile != NULL )
+	{
+		fclose( m_pFile );
+		m_pFile = NULL;
+	}
+}
+
+void FileReactor::RotateFiles( bool a_bCompress )
+{
+	// wait for the last rotated log to be compressed before we move it..
+	if ( m_pCompressThread != NULL )
+	{
+		m_pCompressThread->join();
+		delete m_pCompressThread;
+		m_pCompressThread = NULL;
+	}
+
+	try {
+		const char * pLogFile = m_LogFile.c_str();
+		boost::filesystem::remove( StringUtil::Format( "%s.%d", pLogFile, m_LogHistory - 1 ).c_str() );
+		boost::filesystem::remove( StringUtil::Format( "%s.%d.gz", pLogFile, m_LogHistory - 1 ).c_str() );
+		for(int i=m_LogHistory - 1;i>0;--i)
+		{
+			std::string src = StringUtil::Format( "%s.%d", pLogFile, i - 1);
+			if ( boost::filesystem::exists( src ) )
+				boost::filesystem::rename( src.c_str(), StringUtil::Format( "%s.%d", pLogFile, i ).c_str() );
+			src += ".gz";
+			if ( boost::filesystem::exists( src ) )
+				boost::filesystem::rename( src.c_str(), StringUtil::Format( "%s.%d.gz", pLogFile, i ).c_str() );
+		}
+
+		if ( boost::filesystem::exists( pLogFile ) )
+		{
+			std::string dst( StringUtil::Format( "%s.%d", pLogFile, 0 ) );
+			boost::filesystem::rename( pLogFile, dst );
+			if ( a_bCompress )
+				m_pCompressThread = new boost::thread( boost::bind( &FileReactor::CompressFile, dst ) );
+		}
+	}
+	catch( const std::exception & )
+	{}
+}
+
+void FileReactor::CompressFile( const std::string & a_File )
+{
+	FILE * pInput = fopen( a_File.c_str(), "rb" );
+	if ( pInput == NULL )
+		return;
+
+	std::string compressed( a_File + ".gz" );
+	gzFile pOutput = gzopen( compressed.c_str(), "wb" );
+	if ( pOutput != NULL )
+	{
+		char buffer[ 16 * 1024 ];
+		size_t nRead = 0;
+		bool bFailed = false;
+		while( !bFailed && (nRead = fread( buffer, 1, sizeof(buffer), pInput )) > 0 )
+			bFailed = gzwrite( pOutput, buffer, (unsigned)nRead ) != (int)nRead;
+		bFailed |= gzclose( pOutput ) != Z_OK;
+		fclose( pInput );
+
+		// only remove the original once it's safely compressed..
+		if ( bFailed )
+			remove( compressed.c_str() );
+		else
+			remove( a_File.c_str() );
+	}
+	else
+		fclose( pInput );
+}
+
+static void AppendVarint( std::string & a_Output, boost::uint64_t a_nValue )
+{
+	while( a_nValue >= 0x80 )
+	{
+		a_Output += (char)((a_nValue & 0x7f) | 0x80);
+		a_nValue >>= 7;
+	}
+	a_Output += (char)a_nValue;
+}
+
+static void AppendString( std::string & a_Output, const std::string & a_Value )
+{
+	AppendVarint( a_Output, a_Value.size() );
+	a_Output += a_Value;
+}
+
+static bool ReadVarint( const std::string & a_Data, size_t & a_nOffset, size_t a_nEnd, boost::uint64_t & a_nValue )
+{
+	a_nValue = 0;
+	for( int shift = 0; a_nOffset < a_nEnd && shift < 64; shift += 7 )
+	{
+		unsigned char c = (unsigned char)a_Data[ a_nOffset++ ];
+		a_nValue |= ((boost::uint64_t)(c & 0x7f)) << shift;
+		if ( (c & 0x80) == 0 )
+			return true;
+	}
+	return false;
+}
+
+static bool ReadString( const std::string & a_Data, size_t & a_nOffset, size_t a_nEnd, std::string & a_Value )
+{
+	boost::uint64_t nLength = 0;
+	if (! ReadVarint( a_Data, a_nOffset, a_nEnd, nLength ) || nLength > a_nEnd - a_nOffset )
+		return false;
+	a_Value.assign( a_Data, a_nOffset, (size_t)nLength );
+	a_nOffset += (size_t)nLength;
+	return true;
+}
+
+void BinaryReactor::FormatRecord(const LogRecord & a_Record, std::string & a_Output)
+{
+	std::string record;
+	AppendVarint( record, a_Record.m_Level );
+	AppendVarint( record, (boost::uint64_t)a_Record.m_TimeEpoch );
+	AppendVarint( record, a_Record.m_nMilliseconds );
+	AppendString( record, a_Record.m_SubSystem );
+	AppendString( record, a_Record.m_Message );
+	AppendVarint( record, a_Record.m_Fields.size() );
+	for( LogFields::const_iterator iField = a_Record.m_Fields.begin(); iField != a_Record.m_Fields.end(); ++iField )
+	{
+		AppendString( record, iField->first );
+		AppendString( record, iField->second );
+	}
+
+	a_Output += (char)RECORD_MARKER;
+	AppendVarint( a_Output, record.size() );
+	a_Output += record;
+}
+
+bool BinaryReactor::Decode(const std::string & a_Data, size_t & a_nOffset, LogRecord & a_Record)
+{
+	while( a_nOffset < a_Data.size() )
+	{
+		if ( (unsigned char)a_Data[ a_nOffset ] != RECORD_MARKER )
 		{
-			// transfer data into a local list so we don't block the main thread for long..
-			LogList output;
-			output.splice( output.begin(), m_Output );
-			m_OutputLock.unlock();
+			a_nOffset += 1;
+			continue;
+		}
+
+		size_t nOffset = a_nOffset + 1;
+		boost::uint64_t nSize = 0;
+		if (! ReadVarint( a_Data, nOffset, a_Data.size(), nSize ) || nSize > a_Data.size() - nOffset )
+			return false;			// the rest of this record hasn't been written yet
+		size_t nEnd = nOffset + (size_t)nSize;
 
-			FILE * f = fopen(m_LogFile.c_str(), "a+");
-			if ( f != NULL )
+		boost::uint64_t nLevel = 0, nTime = 0, nMilliseconds = 0, nFields = 0;
+		bool bValid = ReadVarint( a_Data, nOffset, nEnd, nLevel ) && nLevel <= LL_CRITICAL
+			&& ReadVarint( a_Data, nOffset, nEnd, nTime )
+			&& ReadVarint( a_Data, nOffset, nEnd, nMilliseconds )
+			&& ReadString( a_Data, nOffset, nEnd, a_Record.m_SubSystem )
+			&& ReadString( a_Data, nOffset, nEnd, a_Record.m_Message )
+			&& ReadVarint( a_Data, nOffset, nEnd, nFields ) && nFields <= nEnd - nOffset;
+		if ( bValid )
+		{
+			a_Record.m_Fields.resize( (size_t)nFields );
+			for( size_t i = 0; bValid && i < a_Record.m_Fields.size(); ++i )
 			{
-				for( LogList::const_iterator iLog = output.begin(); 
-					iLog != output.end(); ++iLog )
+				bValid = ReadString( a_Data, nOffset, nEnd, a_Record.m_Fields[i].first )
+					&& ReadString( a_Data, nOffset, nEnd, a_Record.m_Fields[i].second );
+			}
+		}
+
+		if (! bValid )
+		{
+			// not a valid record, look for the next marker..
+			a_nOffset += 1;
+			continue;
+		}
+
+		a_Record.m_Level = (LogLevel)nLevel;
+		a_Record.m_TimeEpoch = (time_t)nTime;
+		a_Record.m_nMilliseconds = (unsigned short)nMilliseconds;
+		a_Record.m_Time = Time( a_Record.m_TimeEpoch ).GetFormattedTime( "%x %X" ) 
+			+ StringUtil::Format( ".%0.3d", (int)a_Record.m_nMilliseconds );
+		a_nOffset = nEnd;
+		return true;
+	}
+
+	return false;
+}
+
+bool BinaryReactor::Read(const std::string & a_LogFile, std::vector<LogRecord> & a_Records)
+{
+	FILE * pFile = fopen( a_LogFile.c_str(), "rb" );
+	if ( pFile == NULL )
+		return false;
+
+	std::string data;
+	char buffer[ 16 * 1024 ];
+	size_t nRead = 0;
+	while( (nRead = fread( buffer, 1, sizeof(buffer), pFile )) > 0 )
+		data.append( buffer, nRead );
+	fclose( pFile );
+
+	size_t nOffset = 0;
+	LogRecord record;
+	while( Decode( data, nOffset, record ) )
+		a_Records.push_back( record );
+
+	return true;
+}
+
+//! Ring of binary log records, written by a single thread and read by the log thread without any locking.
+//! Positions only ever increase, the offset into m_Data is the position modulo BUFFER_SIZE.
+class LogBuffer
+{
+public:
+	//! Types
+	struct Header
+	{
+		size_t			m_nSize;				// size of the record including this header
+		unsigned int	m_nSequence;			// used to merge the records from all threads in order
+		LogLevel		m_Level;
+		time_t			m_Time;
+		unsigned short	m_nMilliseconds;
+		size_t			m_nSubLength;
+		size_t			m_nMessageLength;
+		size_t			m_nFieldCount;
+	};
+
+	//! Constants
+	static const size_t BUFFER_SIZE = 128 * 1024;	// must be a power of 2
+	static const size_t MAX_MESSAGE = 32 * 1024;
+	static const size_t MAX_SUBSYSTEM = 256;
+	static const size_t MAX_RECORD = BUFFER_SIZE / 2;
+
+	//! Construction
+	LogBuffer() : m_Head(0), m_Tail(0), m_bOrphaned(false)
+	{}
+
+	//! Scratch space for the owning thread to format a message into.
+	char * GetFormatBuffer()
+	{
+		return m_Format;
+	}
+	bool IsEmpty() const
+	{
+		return m_Head.load() == m_Tail.load(boost::memory_order_relaxed);
+	}
+	bool IsOrphaned() const
+	{
+		return m_bOrphaned;
+	}
+	//! Called when the owning thread exits, the log thread deletes this buffer once it's been drained.
+	void SetOrphaned()
+	{
+		m_bOrphaned = true;
+	}
+
+	//! Returns the size of a record, anything larger than MAX_RECORD can't be pushed.
+	static size_t GetRecordSize(const Header & a_Header, const LogFields & a_Fields)
+	{
+		size_t nSize = sizeof(Header) + a_Header.m_nSubLength + a_Header.m_nMessageLength;
+		for (LogFields::const_iterator iField = a_Fields.begin(); iField != a_Fields.end(); ++iField)
+			nSize += sizeof(FieldHeader) + iField->first.size() + iField->second.size();
+		return nSize;
+	}
+
+	//! Returns true if a record of a_nSize bytes can be pushed, only the owning thread may call this.
+	bool HasRoom(size_t a_nSize) const
+	{
+		return BUFFER_SIZE - (m_Head.load(boost::memory_order_relaxed) - m_Tail.load(boost::memory_order_acquire)) >= a_nSize;
+	}
+
+	//! Add a record, a_Header.m_nSize must be set by GetRecordSize(). Returns false if there isn't enough room right now.
+	bool Push(const Header & a_Header, const char * a_pSub, const char * a_pMessage, const LogFields & a_Fields)
+	{
+		size_t nHead = m_Head.load(boost::memory_order_relaxed);
+		if (BUFFER_SIZE - (nHead - m_Tail.load(boost::memory_order_acquire)) < a_Header.m_nSize)
+			return false;
+
+		size_t nPosition = nHead;
+		nPosition = Write(nPosition, &a_Header, sizeof(Header));
+		nPosition = Write(nPosition, a_pSub, a_Header.m_nSubLength);
+		nPosition = Write(nPosition, a_pMessage, a_Header.m_nMessageLength);
+		for (LogFields::const_iterator iField = a_Fields.begin(); iField != a_Fields.end(); ++iField)
+		{
+			FieldHeader field;
+			field.m_nKeyLength = iField->first.size();
+			field.m_nValueLength = iField->second.size();
+			nPosition = Write(nPosition, &field, sizeof(field));
+			nPosition = Write(nPosition, iField->first.data(), field.m_nKeyLength);
+			nPosition = Write(nPosition, iField->second.data(), field.m_nValueLength);
+		}
+		m_Head.store(nHead + a_Header.m_nSize);
+		return true;
+	}
+	//! Read the header of the oldest record, returns false if this buffer is empty.
+	bool Peek(Header & a_Header) const
+	{
+		size_t nTail = m_Tail.load(boost::memory_order_relaxed);
+		if (nTail == m_Head.load(boost::memory_order_acquire))
+			return false;
+		Read(nTail, &a_Header, sizeof(Header));
+		return true;
+	}
+	//! Move the record returned by Peek() into a_Record.
+	void Pop(const Header & a_Header, LogRecord & a_Record)
+	{
+		size_t nTail = m_Tail.load(boost::memory_order_relaxed);
+		size_t nPosition = nTail + sizeof(Header);
+		nPosition = Read(nPosition, a_Record.m_SubSystem, a_Header.m_nSubLength);
+		nPosition = Read(nPosition, a_Record.m_Message, a_Header.m_nMessageLength);
+
+		a_Record.m_Fields.resize(a_Header.m_nFieldCount);
+		for (size_t i = 0; i < a_Header.m_nFieldCount; ++i)
+		{
+			FieldHeader field;
+			nPosition = Read(nPosition, &field, sizeof(field));
+			nPosition = Read(nPosition, a_Record.m_Fields[i].first, field.m_nKeyLength);
+			nPosition = Read(nPosition, a_Record.m_Fields[i].second, field.m_nValueLength);
+		}
+		m_Tail.store(nTail + a_Header.m_nSize, boost::memory_order_release);
+	}
+
+private:
+	//! Types
+	struct FieldHeader
+	{
+		size_t			m_nKeyLength;
+		size_t			m_nValueLength;
+	};
+
+	//! Data
+	boost::atomic<size_t>	m_Head;			// next position to write, only changed by the owning thread
+	boost::atomic<size_t>	m_Tail;			// next position to read, only changed by the log thread
+	boost::atomic<bool>		m_bOrphaned;
+	char					m_Data[BUFFER_SIZE];
+	char					m_Format[MAX_MESSAGE];
+
+	//! Copy bytes into the ring at the given position, returns the position after the bytes.
+	size_t Write(size_t a_nPosition, const void * a_pData, size_t a_nBytes)
+	{
+		size_t nOffset = a_nPosition & (BUFFER_SIZE - 1);
+		size_t nFirst = a_nBytes < BUFFER_SIZE - nOffset ? a_nBytes : BUFFER_SIZE - nOffset;
+		memcpy(m_Data + nOffset, a_pData, nFirst);
+		memcpy(m_Data, (const char *)a_pData + nFirst, a_nBytes - nFirst);
+		return a_nPosition + a_nBytes;
+	}
+	size_t Read(size_t a_nPosition, void * a_pData, size_t a_nBytes) const
+	{
+		size_t nOffset = a_nPosition & (BUFFER_SIZE - 1);
+		size_t nFirst = a_nBytes < BUFFER_SIZE - nOffset ? a_nBytes : BUFFER_SIZE - nOffset;
+		memcpy(a_pData, m_Data + nOffset, nFirst);
+		memcpy((char *)a_pData + nFirst, m_Data, a_nBytes - nFirst);
+		return a_nPosition + a_nBytes;
+	}
+	size_t Read(size_t a_nPosition, std::string & a_Value, size_t a_nBytes) const
+	{
+		a_Value.resize(a_nBytes);
+		if (a_nBytes > 0)
+			Read(a_nPosition, &a_Value[0], a_nBytes);
+		return a_nPosition + a_nBytes;
+	}
+};
+
+//! Owns the log thread & the buffers of every thread that has logged something.
+class LogQueue
+{
+public:
+	//! Constants
+	static const size_t BATCH_SIZE = 64;		// records moved out of the buffers under m_BufferLock at a time
+	static const int FULL_WAIT_MS = 1000;		// how long a thread waits for room in a full buffer before dropping
+	static const int GAP_WAIT_MS = 50;			// how long we wait for a record that is still being pushed
+
+	//! Construction
+	LogQueue() : 
+		m_ThreadBuffer(&LogQueue::OnThreadExit),
+		m_pThread(NULL),
+		m_bRunning(false),
+		m_bStop(false),
+		m_bIdle(false),
+		m_nSequence(0),
+		m_nProcessed(0),
+		m_nDropped(0),
+		m_bStalled(false),
+		m_Batch(BATCH_SIZE),
+		m_nNextSequence(0),
+		m_bGap(false),
+		m_fGapStart(0.0),
+		m_LastTime(0)
+	{}
+
+	static LogQueue & Instance()
+	{
+		static LogQueue queue;
+		return queue;
+	}
+
+	bool IsRunning() const
+	{
+		return m_bRunning;
+	}
+
+	//! Start the log thread if it's not already running.
+	void Start()
+	{
+		boost::lock_guard<boost::mutex> lock(m_ControlLock);
+		if (m_pThread == NULL)
+		{
+			m_bStop = false;
+			m_bRunning = true;
+			m_pThread = new boost::thread(boost::bind(&LogQueue::LogThread, this));
+			m_ThreadId = m_pThread->get_id();
+		}
+	}
+
+	//! Stop the log thread, anything still queued is processed first.
+	void Stop()
+	{
+		boost::lock_guard<boost::mutex> lock(m_ControlLock);
+		if (m_pThread != NULL)
+		{
+			m_bRunning = false;
+			m_bStop = true;
+			Wake();
+
+			m_pThread->join();
+			delete m_pThread;
+			m_pThread = NULL;
+
+			// pick up anything that was pushed while we were stopping..
+			Drain(true);
+		}
+	}
+
+	//! Returns a buffer of LogBuffer::MAX_MESSAGE bytes for the calling thread to format a message into before
+	//! calling Push(), returns NULL if the caller needs to process the record itself.
+	char * GetFormatBuffer()
+	{
+		if (!m_bRunning || boost::this_thread::get_id() == m_ThreadId)
+			return NULL;
+		return GetThreadBuffer()->GetFormatBuffer();
+	}
+
+	//! Queue a record for the log thread, returns false if the caller needs to process the record itself.
+	bool Push(LogLevel a_Level, const char * a_pSub, const char * a_pMessage, size_t a_nMessageLength, 
+		const LogFields & a_Fields)
+	{
+		if (!m_bRunning || boost::this_thread::get_id() == m_ThreadId)
+			return false;
+
+		Time now;
+		LogBuffer::Header header;
+		header.m_Level = a_Level;
+		header.m_Time = now.GetTime();
+		header.m_nMilliseconds = now.GetMilliseconds();
+		header.m_nSubLength = strlen(a_pSub);
+		if (header.m_nSubLength >= LogBuffer::MAX_SUBSYSTEM)
+			header.m_nSubLength = LogBuffer::MAX_SUBSYSTEM - 1;
+		header.m_nMessageLength = a_nMessageLength;
+		header.m_nFieldCount = a_Fields.size();
+		header.m_nSize = LogBuffer::GetRecordSize(header, a_Fields);
+		if (header.m_nSize > LogBuffer::MAX_RECORD)
+			return false;
+
+		// if the log thread is falling behind, wait a while for it before dropping the record. We never wait
+		// for long since the log thread may be waiting on a lock the caller holds..
+		LogBuffer * pBuffer = GetThreadBuffer();
+		if (!pBuffer->HasRoom(header.m_nSize) && !WaitForRoom(pBuffer, header.m_nSize))
+		{
+			if (!m_bRunning)
+				return false;
+			++m_nDropped;
+			return true;
+		}
+
+		// only this thread adds to the buffer, so the push can't fail now. The sequence is taken as late as
+		// possible as the log thread waits for any record with an earlier sequence that isn't in a buffer yet.
+		header.m_nSequence = m_nSequence++;
+		pBuffer->Push(header, a_pSub, a_pMessage, a_Fields);
+
+		if (m_bIdle)
+			Wake();
+		return true;
+	}
+
+	void Flush()
+	{
+		if (!m_bRunning || boost::this_thread::get_id() == m_ThreadId)
+			return;
+
+		unsigned int nTarget = m_nSequence;
+		boost::unique_lock<boost::mutex> lock(m_WakeLock);
+		while (m_bRunning && (int)(m_nProcessed - nTarget) < 0)
+		{
+			m_Wake.notify_all();
+			m_Flushed.timed_wait(lock, boost::posix_time::milliseconds(100));
+		}
+	}
+
+private:
+	//! Types
+	typedef std::list<LogBuffer *>		BufferList;
+
+	//! Data
+	boost::thread_specific_ptr<LogBuffer>
+							m_ThreadBuffer;
+	boost::mutex			m_BufferLock;
+	BufferList				m_Buffers;
+
+	boost::mutex			m_ControlLock;
+	boost::thread *			m_pThread;
+	boost::thread::id		m_ThreadId;
+	boost::atomic<bool>		m_bRunning;
+	boost::atomic<bool>		m_bStop;
+
+	boost::mutex			m_WakeLock;
+	boost::condition_variable
+							m_Wake;
+	boost::condition_variable
+							m_Flushed;
+	boost::atomic<bool>		m_bIdle;			// true while the log thread is waiting on m_Wake
+
+	boost::atomic<unsigned int>
+							m_nSequence;
+	boost::atomic<unsigned int>
+							m_nProcessed;
+	boost::atomic<unsigned int>
+							m_nDropped;			// records dropped because a buffer stayed full
+	boost::atomic<bool>		m_bStalled;			// true if the log thread hasn't processed a record since a buffer stayed full
+
+	// only used by the log thread..
+	std::vector<LogRecord>	m_Batch;			// re-used for each batch so the strings keep their memory
+	unsigned int			m_nNextSequence;	// sequence of the next record to process
+	bool					m_bGap;				// true if the last Drain() waited on a record still being pushed
+	double					m_fGapStart;		// time we started waiting on m_nNextSequence
+	time_t					m_LastTime;
+	std::string				m_LastTimeText;
+
+	LogBuffer * GetThreadBuffer()
+	{
+		LogBuffer * pBuffer = m_ThreadBuffer.get();
+		if (pBuffer == NULL)
+		{
+			pBuffer = new LogBuffer();
+			m_ThreadBuffer.reset(pBuffer);
+
+			boost::lock_guard<boost::mutex> lock(m_BufferLock);
+			m_Buffers.push_back(pBuffer);
+		}
+		return pBuffer;
+	}
+
+	static void OnThreadExit(LogBuffer * a_pBuffer)
+	{
+		a_pBuffer->SetOrphaned();
+	}
+
+	void Wake()
+	{
+		boost::lock_guard<boost::mutex> lock(m_WakeLock);
+		m_Wake.notify_all();
+	}
+
+	//! Wait up to FULL_WAIT_MS for the log thread to make room in a_pBuffer, returns false if it didn't. Once
+	//! a wait has timed out we don't wait again until the log thread processes another record.
+	bool WaitForRoom(LogBuffer * a_pBuffer, size_t a_nSize)
+	{
+		if (m_bStalled)
+			return false;
+
+		boost::unique_lock<boost::mutex> lock(m_WakeLock);
+		boost::system_time timeout = boost::get_system_time() + boost::posix_time::milliseconds((long)FULL_WAIT_MS);
+		while (m_bRunning && !a_pBuffer->HasRoom(a_nSize))
+		{
+			m_Wake.notify_all();
+			if (!m_Flushed.timed_wait(lock, timeout) && !a_pBuffer->HasRoom(a_nSize))
+			{
+				m_bStalled = true;
+				return false;
+			}
+		}
+		return a_pBuffer->HasRoom(a_nSize);
+	}
+
+	void LogThread()
+	{
+		while (!m_bStop)
+		{
+			if (Drain() > 0)
+			{
+				m_Flushed.notify_all();
+				continue;
+			}
+			if (m_bGap)
+			{
+				// a thread is part way through pushing the next record..
+				boost::this_thread::yield();
+				continue;
+			}
+
+			boost::unique_lock<boost::mutex> lock(m_WakeLock);
+			m_Flushed.notify_all();
+
+			m_bIdle = true;
+			if (!m_bStop && IsEmpty())
+				m_Wake.timed_wait(lock, boost::posix_time::milliseconds(100));
+			m_bIdle = false;
+		}
+
+		Drain(true);
+
+		boost::lock_guard<boost::mutex> lock(m_WakeLock);
+		m_Flushed.notify_all();
+	}
+
+	bool IsEmpty()
+	{
+		boost::lock_guard<boost::mutex> lock(m_BufferLock);
+		for (BufferList::iterator iBuffer = m_Buffers.begin(); iBuffer != m_Buffers.end(); ++iBuffer)
+			if (!(*iBuffer)->IsEmpty())
+				return false;
+		return true;
+	}
+
+	//! Process all queued records in the order they were logged, returns the number of records processed. The
+	//! reactors are invoked without m_BufferLock, so a thread logging while it holds a reactor lock can't block
+	//! on us. If a_bForce is true, we don't wait for records that are still being pushed.
+	size_t Drain(bool a_bForce = false)
+	{
+		size_t nProcessed = 0;
+		for (;;)
+		{
+			size_t nCount = Collect(a_bForce);
+			if (nCount == 0)
+				break;
+
+			for (size_t i = 0; i < nCount; ++i)
+			{
+				Log::ProcessRecord(m_Batch[i]);
+				++m_nProcessed;
+				m_bStalled = false;
+			}
+			nProcessed += nCount;
+
+			// wake any thread waiting on room in its buffer..
+			boost::lock_guard<boost::mutex> lock(m_WakeLock);
+			m_Flushed.notify_all();
+		}
+
+		unsigned int nDropped = m_nDropped.exchange(0);
+		if (nDropped > 0)
+		{
+			Time now;
+			LogRecord & record = m_Batch[0];
+			record.m_Level = LL_WARNING;
+			record.m_SubSystem = "Log";
+			record.m_Message = StringUtil::Format("Dropped %u records, the log thread fell behind.", nDropped);
+			record.m_Fields.clear();
+			record.m_TimeEpoch = now.GetTime();
+			record.m_nMilliseconds = now.GetMilliseconds();
+			record.m_Time = now.GetFormattedTime("%x %X") + StringUtil::Format(".%03d", (int)now.GetMilliseconds());
+			Log::ProcessRecord(record);
+		}
+
+		// remove the buffers of any threads that have exited..
+		boost::lock_guard<boost::mutex> lock(m_BufferLock);
+		for (BufferList::iterator iBuffer = m_Buffers.begin(); iBuffer != m_Buffers.end(); )
+		{
+			LogBuffer * pBuffer = *iBuffer;
+			if (pBuffer->IsOrphaned() && pBuffer->IsEmpty())
+			{
+				m_Buffers.erase(iBuffer++);
+				delete pBuffer;
+			}
+			else
+				++iBuffer;
+		}
+
+		return nProcessed;
+	}
+
+	//! Move up to BATCH_SIZE records into m_Batch in sequence order, returns the number of records moved.
+	size_t Collect(bool a_bForce)
+	{
+		boost::lock_guard<boost::mutex> lock(m_BufferLock);
+
+		m_bGap = false;
+		size_t nCount = 0;
+		while (nCount < BATCH_SIZE)
+		{
+			LogBuffer * pNext = NULL;
+			LogBuffer::Header next;
+			LogBuffer::Header header;
+			for (BufferList::iterator iBuffer = m_Buffers.begin(); iBuffer != m_Buffers.end(); ++iBuffer)
+			{
+				if ((*iBuffer)->Peek(header) && (pNext == NULL || (int)(header.m_nSequence - next.m_nSequence) < 0))
 				{
-					const std::string & log = *iLog;
-					fwrite( log.c_str(), sizeof(char), log.size(), f );
+					pNext = *iBuffer;
+					next = header;
 				}
+			}
+			if (pNext == NULL)
+				break;
 
-				fclose( f );
+			// an earlier record has its sequence but isn't in its buffer yet, give the thread a moment to finish
+			// pushing it. If it's taking too long we move on rather than hold up the log.
+			if (next.m_nSequence != m_nNextSequence && !a_bForce)
+			{
+				double fNow = Time().GetEpochTime();
+				if (m_fGapStart == 0.0)
+					m_fGapStart = fNow;
+				if ((fNow - m_fGapStart) * 1000.0 < GAP_WAIT_MS)
+				{
+					m_bGap = true;
+					break;
+				}
 			}
+			m_fGapStart = 0.0;
+			m_nNextSequence = next.m_nSequence + 1;
+
+			LogRecord & record = m_Batch[nCount++];
+			pNext->Pop(next, record);
+			record.m_Level = next.m_Level;
+			record.m_TimeEpoch = next.m_Time;
+			record.m_nMilliseconds = next.m_nMilliseconds;
+			if (next.m_Time != m_LastTime || m_LastTimeText.empty())
+			{
+				m_LastTime = next.m_Time;
+				m_LastTimeText = Time(next.m_Time).GetFormattedTime("%x %X");
+			}
+			char millis[8];
+			snprintf(millis, sizeof(millis), ".%03d", (int)next.m_nMilliseconds);
+			record.m_Time = m_LastTimeText;
+			record.m_Time += millis;
 		}
-		else
+
+		return nCount;
+	}
+};
+
+//! Per subsystem sampling & rate limits, no lock is taken unless a limit has been set.
+class LogLimiter
+{
+public:
+	//! Construction
+	LogLimiter() : m_bActive(false)
+	{}
+
+	static LogLimiter & Instance()
+	{
+		static LogLimiter limiter;
+		return limiter;
+	}
+
+	void SetSampling(const std::string & a_SubSystem, int a_nOneIn)
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		m_Configs[a_SubSystem].m_nOneIn = a_nOneIn;
+		OnConfigChanged();
+	}
+
+	void SetRateLimit(const std::string & a_SubSystem, float a_fPerSecond, int a_nBurst)
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		Limit & config = m_Configs[a_SubSystem];
+		config.m_fPerSecond = a_fPerSecond;
+		config.m_nBurst = a_nBurst > 0 ? a_nBurst : 1;
+		OnConfigChanged();
+	}
+
+	//! Returns false if the record should be dropped, if records were dropped since the last one let through
+	//! then a field with that count is added to a_Fields.
+	bool Admit(LogLevel a_Level, const char * a_pSub, LogFields & a_Fields)
+	{
+		if (!m_bActive || a_Level >= LL_CRITICAL)
+			return true;
+
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		Limit & limit = GetLimit(a_pSub);
+		if (limit.m_nOneIn > 1 && a_Level < LL_ERROR && (limit.m_nSampled++ % limit.m_nOneIn) != 0)
+			return false;
+
+		if (limit.m_fPerSecond > 0.0f)
+		{
+			double fNow = Time().GetEpochTime();
+			limit.m_fTokens += (fNow - limit.m_fLastTime) * limit.m_fPerSecond;
+			if (limit.m_fTokens > limit.m_nBurst)
+				limit.m_fTokens = limit.m_nBurst;
+			limit.m_fLastTime = fNow;
+
+			if (limit.m_fTokens < 1.0)
+			{
+				limit.m_nDropped += 1;
+				return false;
+			}
+			limit.m_fTokens -= 1.0;
+		}
+
+		if (limit.m_nDropped > 0)
 		{
-			// nothing to do..
-			m_OutputLock.unlock();
+			a_Fields.push_back(LogFields::value_type("dropped", StringUtil::Format("%u", limit.m_nDropped)));
+			limit.m_nDropped = 0;
 		}
+		return true;
 	}
 
-	m_bThreadStopped = true;
+private:
+	//! Types
+	struct Limit
+	{
+		Limit() : m_nOneIn(0), m_nSampled(0), m_fPerSecond(0.0f), m_nBurst(1), 
+			m_fTokens(0.0), m_fLastTime(0.0), m_nDropped(0)
+		{}
+
+		int				m_nOneIn;
+		unsigned int	m_nSampled;
+		float			m_fPerSecond;
+		int				m_nBurst;
+		double			m_fTokens;
+		double			m_fLastTime;
+		unsigned int	m_nDropped;
+	};
+	typedef std::map<std::string, Limit>	LimitMap;
+
+	//! Data
+	boost::atomic<bool>		m_bActive;
+	boost::mutex			m_Lock;
+	LimitMap				m_Configs;			// limits that have been set, "*" is the default
+	LimitMap				m_Limits;			// current state for each subsystem that has logged something
+
+	//! Find the state for a subsystem, creating it from the configured limits if needed
+	Limit & GetLimit(const char * a_pSub)
+	{
+		LimitMap::iterator iLimit = m_Limits.find(a_pSub);
+		if (iLimit != m_Limits.end())
+			return iLimit->second;
+
+		// start with the defaults, then apply anything set for this subsystem..
+		Limit & limit = m_Limits[a_pSub];
+		LimitMap::iterator iDefault = m_Configs.find("*");
+		if (iDefault != m_Configs.end())
+			limit = iDefault->second;
+		LimitMap::iterator iConfig = m_Configs.find(a_pSub);
+		if (iConfig != m_Configs.end())
+		{
+			if (iConfig->second.m_nOneIn > 1)
+				limit.m_nOneIn = iConfig->second.m_nOneIn;
+			if (iConfig->second.m_fPerSecond > 0.0f)
+			{
+				limit.m_fPerSecond = iConfig->second.m_fPerSecond;
+				limit.m_nBurst = iConfig->second.m_nBurst;
+			}
+		}
+		limit.m_fTokens = limit.m_nBurst;
+		limit.m_fLastTime = Time().GetEpochTime();
+		return limit;
+	}
+
+	void OnConfigChanged()
+	{
+		// start again with the new limits..
+		m_Limits.clear();
+
+		// remove anything that doesn't limit anymore..
+		for (LimitMap::iterator iConfig = m_Configs.begin(); iConfig != m_Configs.end(); )
+		{
+			if (iConfig->second.m_nOneIn <= 1 && iConfig->second.m_fPerSecond <= 0.0f)
+				m_Configs.erase(iConfig++);
+			else
+				++iConfig;
+		}
+		m_bActive = m_Configs.size() > 0;
+	}
+};
+
+//! Format a message into a_pBuffer, returns the length of the message.
+static size_t FormatText(char * a_pBuffer, size_t a_nBufferSize, const char * a_pFormat, va_list args)
+{
+	int nLength = vsnprintf(a_pBuffer, a_nBufferSize, a_pFormat, args);
+	if (nLength < 0)
+		nLength = 0;
+	else if ((size_t)nLength >= a_nBufferSize)
+		nLength = (int)a_nBufferSize - 1;
+	a_pBuffer[nLength] = 0;
+	return nLength;
+}
+
+//! Process a record on the calling thread.
+static void ProcessNow(LogLevel a_Level, const char * a_pSub, const char * a_pMessage, size_t a_nLength, 
+	const LogFields & a_Fields)
+{
+	LogRecord rec;
+	rec.m_Level = a_Level;
+	rec.m_SubSystem = a_pSub;
+	rec.m_Message.assign( a_pMessage, a_nLength );
+	rec.m_Fields = a_Fields;
+
+	Time now;
+	rec.m_Time = now.GetFormattedTime( "%x %X" ) + StringUtil::Format(".%0.3d", (int)now.GetMilliseconds()); 
+	rec.m_TimeEpoch = now.GetTime();
+	rec.m_nMilliseconds = now.GetMilliseconds();
+
+	Log::ProcessRecord(rec);
+}
+
+//! Stop the log thread before any static data it uses is destroyed.
+static void StopLogQueue()
+{
+	LogQueue::Instance().Stop();
 }
 
+int Log::sm_MinLevel = LL_CRITICAL + 1;
+size_t Log::sm_nMaxBodySize = 1024;
+
 Log::ReactorList & Log::GetReactorList()
 {
 	static ReactorList reactors;
@@ -168,22 +1189,53 @@ boost::recursive_mutex & Log::GetReactorLock()
 	return lock;
 }
 
+void Log::UpdateMinLevel()
+{
+	int minLevel = LL_CRITICAL + 1;
+	ReactorList & reactors = GetReactorList();
+	for (ReactorList::iterator iReactor = reactors.begin(); iReactor != reactors.end(); ++iReactor)
+	{
+		int level = (*iReactor)->GetMinLevel();
+		if (level < minLevel)
+			minLevel = level;
+	}
+	sm_MinLevel = minLevel;
+}
+
 void Log::RegisterReactor(ILogReactor * a_pReactor)
 {
-	boost::lock_guard<boost::recursive_mutex> lock( GetReactorLock() );
-	GetReactorList().push_back(a_pReactor);
+	{
+		boost::lock_guard<boost::recursive_mutex> lock( GetReactorLock() );
+		GetReactorList().push_back(a_pReactor);
+		UpdateMinLevel();
+	}
+
+	// the queue must exist before we register with atexit() so it's destroyed after StopLogQueue() is called
+	LogQueue & queue = LogQueue::Instance();
+	static bool bRegistered = false;
+	if (! bRegistered )
+	{
+		bRegistered = true;
+		atexit( StopLogQueue );
+	}
+	queue.Start();
 }
 
 void Log::RemoveReactor(ILogReactor * a_pReactor, bool a_bDelete /*= true */)
 {
+	Flush();
+
 	boost::lock_guard<boost::recursive_mutex> lock( GetReactorLock() );
 	GetReactorList().remove(a_pReactor);
+	UpdateMinLevel();
 	if ( a_bDelete )
 		delete a_pReactor;
 }
 
 void Log::RemoveAllReactors( bool a_bDelete /*= true*/ )
 {
+	LogQueue::Instance().Stop();
+
 	boost::lock_guard<boost::recursive_mutex> lock( GetReactorLock() );
 	ReactorList & reactors = GetReactorList();
 
@@ -197,24 +1249,66 @@ void Log::RemoveAllReactors( bool a_bDelete /*= true*/ )
 	}
 
 	reactors.clear();
+	UpdateMinLevel();
 }
 
 void Log::DoLog(LogLevel a_Level, const char * a_pSub, const char * a_pFormat, va_list args )
 {
-	char buffer[1024 * 32];
+	if (! IsEnabled( a_Level ) )
+		return;
+	LogFields fields;
+	if (! LogLimiter::Instance().Admit( a_Level, a_pSub, fields ) )
+		return;
 
-	LogRecord rec;
-	rec.m_Level = a_Level;
-	rec.m_SubSystem = a_pSub;
+	LogQueue & queue = LogQueue::Instance();
+	char * pBuffer = queue.GetFormatBuffer();
+	if ( pBuffer != NULL )
+	{
+		size_t nLength = FormatText( pBuffer, LogBuffer::MAX_MESSAGE, a_pFormat, args );
+		if ( queue.Push( a_Level, a_pSub, pBuffer, nLength, fields ) )
+		{
+			// make sure a critical error is out before we possibly crash..
+			if ( a_Level >= LL_CRITICAL )
+				queue.Flush();
+		}
+		else
+			ProcessNow( a_Level, a_pSub, pBuffer, nLength, fields );
+		return;
+	}
 
-	Time now;
-	rec.m_Time = now.GetFormattedTime( "%x %X" ) + StringUtil::Format(".%0.3d", (int)now.GetMilliseconds()); 
-	rec.m_TimeEpoch = now.GetTime();
+	// the log thread isn't running or this is the log thread, process the record now..
+	char buffer[ LogBuffer::MAX_MESSAGE ];
+	size_t nLength = FormatText( buffer, sizeof(buffer), a_pFormat, args );
+	ProcessNow( a_Level, a_pSub, buffer, nLength, fields );
+}
 
-	vsnprintf(buffer, sizeof(buffer) - 1, a_pFormat, args);
-	rec.m_Message = buffer;
+void Log::Write(const LogEntry & a_Entry)
+{
+	LogLevel level = a_Entry.GetLevel();
+	if (! IsEnabled( level ) )
+		return;
+	LogFields dropped;
+	if (! LogLimiter::Instance().Admit( level, a_Entry.GetSubSystem(), dropped ) )
+		return;
 
-	ProcessRecord(rec);
+	const LogFields * pFields = &a_Entry.GetFields();
+	LogFields fields;
+	if ( dropped.size() > 0 )
+	{
+		fields = a_Entry.GetFields();
+		fields.insert( fields.end(), dropped.begin(), dropped.end() );
+		pFields = &fields;
+	}
+
+	LogQueue & queue = LogQueue::Instance();
+	const std::string & text = a_Entry.GetText();
+	if ( queue.Push( level, a_Entry.GetSubSystem(), text.c_str(), text.size(), *pFields ) )
+	{
+		if ( level >= LL_CRITICAL )
+			queue.Flush();
+	}
+	else
+		ProcessNow( level, a_Entry.GetSubSystem(), text.c_str(), text.size(), *pFields );
 }
 
 void Log::ProcessRecord(const LogRecord & rec)
@@ -227,6 +1321,11 @@ void Log::ProcessRecord(const LogRecord & rec)
 	}
 }
 
+void Log::Flush()
+{
+	LogQueue::Instance().Flush();
+}
+
 void Log::DebugLow(const char * a_pSub, const char * a_pFormat, ...)
 {
 	va_list args;
@@ -291,6 +1390,60 @@ void Log::Critical( const char * a_pSub, const char * a_pFormat, ... )
 	va_end(args);
 }
 
+void Log::FormatFields( const LogFields & a_Fields, std::string & a_Output )
+{
+	for( LogFields::const_iterator iField = a_Fields.begin(); iField != a_Fields.end(); ++iField )
+	{
+		const std::string & value = iField->second;
+		a_Output += ' ';
+		a_Output += iField->first;
+		a_Output += '=';
+		if ( value.size() > 0 && value.find_first_of( " \"=\r\n\t" ) == std::string::npos )
+		{
+			a_Output += value;
+			continue;
+		}
+
+		a_Output += '"';
+		for( size_t i = 0; i < value.size(); ++i )
+		{
+			char c = value[i];
+			if ( c == '"' || c == '\\' )
+			{
+				a_Output += '\\';
+				a_Output += c;
+			}
+			else if ( c == '\n' )
+				a_Output += "\\n";
+			else if ( c == '\r' )
+				a_Output += "\\r";
+			else
+				a_Output += c;
+		}
+		a_Output += '"';
+	}
+}
+
+void Log::SetSampling( const std::string & a_SubSystem, int a_nOneIn )
+{
+	LogLimiter::Instance().SetSampling( a_SubSystem, a_nOneIn );
+}
+
+void Log::SetRateLimit( const std::string & a_SubSystem, float a_fPerSecond, int a_nBurst )
+{
+	LogLimiter::Instance().SetRateLimit( a_SubSystem, a_fPerSecond, a_nBurst );
+}
+
+void Log::SetMaxBodySize( size_t a_nBytes )
+{
+	sm_nMaxBodySize = a_nBytes;
+}
+
+size_t Log::GetMaxBodySize()
+{
+	return sm_nMaxBodySize;
+}
+
 const char * Log::LevelText( LogLevel a_Level )
 {
 	static const char * LEVELS[] = 
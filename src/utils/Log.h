@@ -22,7 +22,9 @@
 
 #include <string>
 #include <list>
+#include <vector>
 #include <stdarg.h>
+#include <stdio.h>
 
 #include <boost/thread.hpp>
 #include "WDCLib.h"		// include last
@@ -39,13 +41,65 @@ enum LogLevel
 	LL_CRITICAL
 };
 
+//! Key/value pairs attached to a record
+typedef std::vector< std::pair<std::string, std::string> >		LogFields;
+
 struct LogRecord
 {
+	LogRecord() : m_Level(LL_STATUS), m_TimeEpoch(0), m_nMilliseconds(0)
+	{}
+
 	LogLevel		m_Level;
 	std::string		m_Time;
 	std::string		m_SubSystem;
 	std::string		m_Message;
 	time_t          m_TimeEpoch;
+	unsigned short	m_nMilliseconds;
+	LogFields		m_Fields;
+};
+
+//! A structured log record, data is attached as fields instead of being formatted into the message. Use
+//! Log::Write() to log the entry.
+class WDC_API LogEntry
+{
+public:
+	//! Construction
+	LogEntry(LogLevel a_Level, const char * a_pSub, const std::string & a_Message) :
+		m_Level(a_Level), m_pSubSystem(a_pSub), m_Message(a_Message)
+	{}
+
+	//! Accessors
+	LogLevel GetLevel() const
+	{
+		return m_Level;
+	}
+	const char * GetSubSystem() const
+	{
+		return m_pSubSystem;
+	}
+	const std::string & GetText() const
+	{
+		return m_Message;
+	}
+	const LogFields & GetFields() const
+	{
+		return m_Fields;
+	}
+
+	//! Mutators
+	LogEntry & Add(const char * a_pKey, const std::string & a_Value);
+	LogEntry & Add(const char * a_pKey, const char * a_pValue);
+	LogEntry & Add(const char * a_pKey, int a_nValue);
+	LogEntry & Add(const char * a_pKey, double a_fValue);
+	//! Add a request or response body, anything over Log::GetMaxBodySize() is left out.
+	LogEntry & AddBody(const char * a_pKey, const std::string & a_Body);
+
+private:
+	//! Data
+	LogLevel			m_Level;
+	const char *		m_pSubSystem;
+	std::string			m_Message;
+	LogFields			m_Fields;
 };
 
 //! Abstract interface for any object that wants to hook into the LogSystem.
@@ -56,8 +110,14 @@ public:
 	{}
 
 	virtual void Process(const LogRecord & a_Record) = 0;
+	//! Returns the lowest level this reactor wants, nothing below the lowest level of all reactors is formatted.
+	virtual LogLevel GetMinLevel() const
+	{
+		return LL_DEBUG_LOW;
+	}
 };
 
+//! Prints records to stdout
 class WDC_API ConsoleReactor : public ILogReactor
 {
 public:
@@ -65,46 +125,122 @@ public:
 	{}
 
 	virtual void Process(const LogRecord & a_Record);
+	virtual LogLevel GetMinLevel() const
+	{
+		return m_MinLevel;
+	}
 
 private:
 	LogLevel			m_MinLevel;
 };
 
+//! Writes log records to a file from its own thread. The file is kept open and each batch of records is
+//! written with a single flush as soon as the thread wakes up. Existing logs are rotated on construction, 
+//! the log can also be rotated while running based on its size or age.
 class WDC_API FileReactor : public ILogReactor
 {
 public:
 	FileReactor(const char * a_pLogFile, LogLevel a_MinLevel = LL_STATUS, int a_LogHistory = 5 );
 	~FileReactor();
 
+	//! Rotate the log once it's at least a_nMaxBytes in size or a_fMaxAge seconds old, 0 disables either check.
+	void SetRotation(size_t a_nMaxBytes, float a_fMaxAge = 0.0f);
+	//! If true, logs rotated from now on are compressed into a .gz file in the background.
+	void SetCompress(bool a_bCompress);
+
 	virtual void Process(const LogRecord & a_Record);
+	virtual LogLevel GetMinLevel() const
+	{
+		return m_MinLevel;
+	}
+
+protected:
+	//! Append the record to a_Output as it should be written to the file.
+	virtual void FormatRecord(const LogRecord & a_Record, std::string & a_Output);
 
 private:
 	//! Types
-	typedef std::list<std::string>			LogList;
+	typedef std::vector<std::string>		LogList;
+
+	//! Constants
+	static const size_t WRITE_BUFFER_SIZE = 64 * 1024;
 
 	//! Data
 	std::string			m_LogFile;
 	LogLevel			m_MinLevel;
+	int					m_LogHistory;
+	size_t				m_nMaxBytes;
+	float				m_fMaxAge;
+	bool				m_bCompress;
 
 	bool				m_bStopThread;
-	bool				m_bThreadStopped;
 	boost::thread *		m_pThread;
-	boost::recursive_mutex
-						m_OutputLock;
+	boost::thread *		m_pCompressThread;
+	boost::mutex		m_OutputLock;
+	boost::condition_variable
+						m_OutputReady;
 	LogList				m_Output;
 
+	FILE *				m_pFile;				// the following are only used by the write thread
+	size_t				m_nFileSize;
+	double				m_fFileOpened;
+
 	void WriteThread();
+	void WriteOutput(const LogList & a_Output);
+	void OpenFile();
+	void CloseFile();
+	void RotateFiles(bool a_bCompress);
+
+	static void CompressFile(const std::string & a_File);
+};
+
+//! Writes records in a compact binary format, Read() can be used by an offline tool to decode the file.
+//! Each record is a marker byte followed by the size of the record and then the record itself, all integers
+//! are stored as variable length unsigned integers and strings as their length followed by the bytes:
+//!   marker(0xA5) size level time milliseconds subsystem message field-count { key value }
+class WDC_API BinaryReactor : public FileReactor
+{
+public:
+	//! Constants
+	static const unsigned char RECORD_MARKER = 0xA5;
+
+	//! Construction
+	BinaryReactor(const char * a_pLogFile, LogLevel a_MinLevel = LL_STATUS, int a_LogHistory = 5) :
+		FileReactor(a_pLogFile, a_MinLevel, a_LogHistory)
+	{}
+
+	//! Decode one record from a_Data starting at a_nOffset, a_nOffset is moved to the next record. Returns
+	//! false if there isn't a complete record, bytes that aren't part of a record are skipped.
+	static bool Decode(const std::string & a_Data, size_t & a_nOffset, LogRecord & a_Record);
+	//! Read all records from a binary log file, returns false if the file can't be read.
+	static bool Read(const std::string & a_LogFile, std::vector<LogRecord> & a_Records);
+
+protected:
+	virtual void FormatRecord(const LogRecord & a_Record, std::string & a_Output);
 };
 
+//! Records are queued into a lock-free buffer owned by the calling thread, a single background thread turns
+//! them into LogRecord objects and passes them to the reactors. Nothing is formatted unless a reactor wants
+//! the level, Flush() can be used to wait until everything logged so far has been processed.
 class WDC_API Log
 {
 public:
+	//! Returns true if any reactor wants records of the given level.
+	static bool IsEnabled(LogLevel a_Level)
+	{
+		return a_Level >= sm_MinLevel;
+	}
+
 	static void RegisterReactor(ILogReactor * a_pReactor);
 	static void RemoveReactor(ILogReactor * a_pReactor, bool a_bDelete = true );
 	static void RemoveAllReactors( bool a_bDelete = true );
 
 	static void DoLog(LogLevel a_Level, const char * a_pSub, const char * a_pFormat, va_list args );
+	//! Log a structured record.
+	static void Write(const LogEntry & a_Entry);
 	static void ProcessRecord(const LogRecord & rec);
+	//! Block until all records logged before this call have been processed by the reactors.
+	static void Flush();
 
 	static void DebugLow(const char * a_pSub, const char * a_pFormat, ...);
 	static void DebugMed(const char * a_pSub, const char * a_pFormat, ...);
@@ -116,13 +252,30 @@ public:
 	static void Critical( const char * a_pSub, const char * a_pFormat, ... );
 
 	static const char * LevelText( LogLevel a_Level );
+	//! Append the fields as " key=value" to a_Output, values are quoted if needed.
+	static void FormatFields( const LogFields & a_Fields, std::string & a_Output );
+
+	//! Only let 1 in a_nOneIn records below LL_ERROR from the given subsystem through, 1 or less turns sampling
+	//! off. A subsystem of "*" sets the default for any subsystem without its own setting.
+	static void SetSampling( const std::string & a_SubSystem, int a_nOneIn );
+	//! Limit the given subsystem to a_fPerSecond records with bursts of up to a_nBurst records, 0 turns the
+	//! limit off. Critical records are never dropped, the number of records dropped is added to the next record
+	//! let through. A subsystem of "*" sets the default, each subsystem still gets its own token bucket.
+	static void SetRateLimit( const std::string & a_SubSystem, float a_fPerSecond, int a_nBurst );
+	//! Set the largest body LogEntry::AddBody() will log.
+	static void SetMaxBodySize( size_t a_nBytes );
+	static size_t GetMaxBodySize();
 
 private:
 	//! Types
 	typedef std::list<ILogReactor *>		ReactorList;
 	//! Data
+	static int sm_MinLevel;				// lowest level of all reactors, only changed under the reactor lock
+	static size_t sm_nMaxBodySize;
+
 	static ReactorList & GetReactorList();
 	static boost::recursive_mutex & GetReactorLock();
+	static void UpdateMinLevel();
 };
 
 #endif
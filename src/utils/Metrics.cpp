@@ -0,0 +1,221 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <math.h>
+
+#include "Metrics.h"
+#include "Log.h"
+
+Metrics::Histogram::Histogram() : m_nCount(0), m_nSum(0), m_nMax(0)
+{
+	for (int i = 0; i < BUCKET_COUNT; ++i)
+		m_Buckets[i].store(0, boost::memory_order_relaxed);
+}
+
+void Metrics::Histogram::RecordMicroseconds(boost::uint64_t a_nValue)
+{
+	m_Buckets[GetBucket(a_nValue)].fetch_add(1, boost::memory_order_relaxed);
+	m_nCount.fetch_add(1, boost::memory_order_relaxed);
+	m_nSum.fetch_add(a_nValue, boost::memory_order_relaxed);
+
+	boost::uint64_t nMax = m_nMax.load(boost::memory_order_relaxed);
+	while (a_nValue > nMax && !m_nMax.compare_exchange_weak(nMax, a_nValue, boost::memory_order_relaxed))
+		;
+}
+
+double Metrics::Histogram::GetQuantile(double a_fQuantile) const
+{
+	boost::uint64_t nCount = GetCount();
+	if (nCount == 0)
+		return 0.0;
+
+	boost::uint64_t nRank = (boost::uint64_t)ceil(a_fQuantile * nCount);
+	if (nRank < 1)
+		nRank = 1;
+
+	boost::uint64_t nMax = m_nMax.load(boost::memory_order_relaxed);
+	boost::uint64_t nSeen = 0;
+	for (int i = 0; i < BUCKET_COUNT; ++i)
+	{
+		nSeen += m_Buckets[i].load(boost::memory_order_relaxed);
+		if (nSeen >= nRank)
+		{
+			// report the middle of the bucket, but never more than the largest value we've seen
+			boost::uint64_t nValue = GetBucketStart(i) + GetBucketWidth(i) / 2;
+			if (nValue > nMax)
+				nValue = nMax;
+			return nValue / 1000000.0;
+		}
+	}
+
+	// the count was updated before the buckets we just read..
+	return nMax / 1000000.0;
+}
+
+int Metrics::Histogram::GetBucket(boost::uint64_t a_nValue)
+{
+	// values below 2 * SUB_BUCKETS have a bucket each..
+	if (a_nValue < (2 * SUB_BUCKETS))
+		return (int)a_nValue;
+
+	int nShift = 0;
+	while ((a_nValue >> nShift) >= (2 * SUB_BUCKETS))
+		++nShift;
+	if (nShift > MAX_SHIFT)
+		return BUCKET_COUNT - 1;
+
+	return ((nShift + 1) << SUB_BUCKET_BITS) + (int)((a_nValue >> nShift) - SUB_BUCKETS);
+}
+
+boost::uint64_t Metrics::Histogram::GetBucketStart(int a_nBucket)
+{
+	if (a_nBucket < (2 * SUB_BUCKETS))
+		return a_nBucket;
+
+	int nShift = (a_nBucket >> SUB_BUCKET_BITS) - 1;
+	return ((boost::uint64_t)(SUB_BUCKETS + (a_nBucket & (SUB_BUCKETS - 1)))) << nShift;
+}
+
+boost::uint64_t Metrics::Histogram::GetBucketWidth(int a_nBucket)
+{
+	if (a_nBucket < (2 * SUB_BUCKETS))
+		return 1;
+	return ((boost::uint64_t)1) << ((a_nBucket >> SUB_BUCKET_BITS) - 1);
+}
+
+Metrics * Metrics::Instance()
+{
+	static Metrics * pInstance = new Metrics();		// never deleted, other static objects may record during shutdown
+	return pInstance;
+}
+
+Metrics::Metrics() : m_nMaxSeries(1000)
+{}
+
+Metrics::~Metrics()
+{
+	for (SeriesMap::iterator iSeries = m_Series.begin(); iSeries != m_Series.end(); ++iSeries)
+	{
+		Series & series = iSeries->second;
+		if (series.m_eType == COUNTER)
+			delete (Counter *)series.m_pMetric;
+		else if (series.m_eType == GAUGE)
+			delete (Gauge *)series.m_pMetric;
+		else
+			delete (Histogram *)series.m_pMetric;
+	}
+}
+
+Metrics::Counter * Metrics::GetCounter(const std::string & a_Name, const Tags & a_Tags /*= Tags()*/)
+{
+	return (Counter *)FindSeries(a_Name, a_Tags, COUNTER);
+}
+
+Metrics::Gauge * Metrics::GetGauge(const std::string & a_Name, const Tags & a_Tags /*= Tags()*/)
+{
+	return (Gauge *)FindSeries(a_Name, a_Tags, GAUGE);
+}
+
+Metrics::Histogram * Metrics::GetHistogram(const std::string & a_Name, const Tags & a_Tags /*= Tags()*/)
+{
+	return (Histogram *)FindSeries(a_Name, a_Tags, HISTOGRAM);
+}
+
+void Metrics::Export(IMetricsExporter & a_Exporter)
+{
+	boost::lock_guard<boost::mutex> lock(m_Lock);
+	for (SeriesMap::const_iterator iSeries = m_Series.begin(); iSeries != m_Series.end(); ++iSeries)
+	{
+		const Series & series = iSeries->second;
+		if (series.m_eType == COUNTER)
+			a_Exporter.OnCounter(series.m_Name, series.m_Tags, *(Counter *)series.m_pMetric);
+		else if (series.m_eType == GAUGE)
+			a_Exporter.OnGauge(series.m_Name, series.m_Tags, *(Gauge *)series.m_pMetric);
+		else
+			a_Exporter.OnHistogram(series.m_Name, series.m_Tags, *(Histogram *)series.m_pMetric);
+	}
+}
+
+void * Metrics::FindSeries(const std::string & a_Name, const Tags & a_Tags, Type a_eType)
+{
+	boost::lock_guard<boost::mutex> lock(m_Lock);
+
+	std::string key(GetKey(a_Name, a_Tags));
+	bool bTagged = true;
+	SeriesMap::iterator iSeries = m_Series.find(key);
+	if (iSeries == m_Series.end())
+	{
+		size_t & nCount = m_SeriesCount[a_Name];
+		if (nCount >= m_nMaxSeries && a_Tags.size() > 0)
+		{
+			if (nCount == m_nMaxSeries)
+			{
+				Log::Warning("Metrics", "Too many series for %s, recording new tags into the untagged series.", a_Name.c_str());
+				nCount += 1;		// only warn once
+			}
+
+			bTagged = false;
+			key = GetKey(a_Name, Tags());
+			iSeries = m_Series.find(key);
+		}
+	}
+
+	if (iSeries == m_Series.end())
+	{
+		iSeries = m_Series.insert(SeriesMap::value_type(key, Series())).first;
+		m_SeriesCount[a_Name] += 1;
+
+		Series & series = iSeries->second;
+		series.m_Name = a_Name;
+		if (bTagged)
+			series.m_Tags = a_Tags;
+		series.m_eType = a_eType;
+		if (a_eType == COUNTER)
+			series.m_pMetric = new Counter();
+		else if (a_eType == GAUGE)
+			series.m_pMetric = new Gauge();
+		else
+			series.m_pMetric = new Histogram();
+	}
+
+	if (iSeries->second.m_eType != a_eType)
+	{
+		// hand back a series that isn't exported rather than crash the caller..
+		Log::Error("Metrics", "Metric %s is already registered with a different type.", a_Name.c_str());
+		if (a_eType == COUNTER)
+			return &m_UnusedCounter;
+		if (a_eType == GAUGE)
+			return &m_UnusedGauge;
+		return &m_UnusedHistogram;
+	}
+
+	return iSeries->second.m_pMetric;
+}
+
+std::string Metrics::GetKey(const std::string & a_Name, const Tags & a_Tags)
+{
+	std::string key(a_Name);
+	key += '{';
+	for (Tags::const_iterator iTag = a_Tags.begin(); iTag != a_Tags.end(); ++iTag)
+	{
+		key += iTag->first;
+		key += '\x1';
+		key += iTag->second;
+		key += '\x2';
+	}
+	return key;
+}
@@ -0,0 +1,219 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_METRICS_H
+#define WDC_METRICS_H
+
+#include <map>
+#include <string>
+
+#include "boost/atomic.hpp"
+#include "boost/cstdint.hpp"
+#include "boost/noncopyable.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include "WDCLib.h"		// include last always
+
+class IMetricsExporter;
+
+//! Process wide registry of counters, gauges and latency histograms.
+//!
+//! A metric is identified by its name and a set of tags (e.g. service="NLC", status="200"), each unique
+//! combination is a separate series. Looking up a series takes a lock, recording into a series never does, so
+//! callers on a hot path should look the series up once and keep the returned pointer. Series are never
+//! deleted once created, the returned pointers are valid for the life of the process.
+//!
+//! The number of series for a single name is capped by SetMaxSeries(), once the cap is reached any new tag
+//! combination is recorded into the untagged series for that name instead.
+class WDC_API Metrics : private boost::noncopyable
+{
+public:
+	//! Types
+	typedef std::map<std::string, std::string>		Tags;
+
+	enum Type
+	{
+		COUNTER,
+		GAUGE,
+		HISTOGRAM
+	};
+
+	//! A value that only ever goes up.
+	class WDC_API Counter : private boost::noncopyable
+	{
+	public:
+		Counter() : m_nValue(0)
+		{}
+
+		void Increment(boost::int64_t a_nAmount = 1)
+		{
+			m_nValue.fetch_add(a_nAmount, boost::memory_order_relaxed);
+		}
+		boost::int64_t Get() const
+		{
+			return m_nValue.load(boost::memory_order_relaxed);
+		}
+
+	private:
+		boost::atomic<boost::int64_t>	m_nValue;
+	};
+
+	//! A value that can go up and down, e.g. the number of open connections.
+	class WDC_API Gauge : private boost::noncopyable
+	{
+	public:
+		Gauge() : m_nValue(0)
+		{}
+
+		void Set(boost::int64_t a_nValue)
+		{
+			m_nValue.store(a_nValue, boost::memory_order_relaxed);
+		}
+		void Add(boost::int64_t a_nAmount)
+		{
+			m_nValue.fetch_add(a_nAmount, boost::memory_order_relaxed);
+		}
+		boost::int64_t Get() const
+		{
+			return m_nValue.load(boost::memory_order_relaxed);
+		}
+
+	private:
+		boost::atomic<boost::int64_t>	m_nValue;
+	};
+
+	//! Log-linear latency histogram, each power of two is split into SUB_BUCKETS linear buckets so any
+	//! recorded value is reported within 1/SUB_BUCKETS (12.5%) of its real value. Values are kept in
+	//! microseconds from 1us up to about 12 days, larger values are clamped.
+	class WDC_API Histogram : private boost::noncopyable
+	{
+	public:
+		static const int SUB_BUCKET_BITS = 3;
+		static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+		static const int MAX_SHIFT = 37;
+		static const int BUCKET_COUNT = (MAX_SHIFT + 2) * SUB_BUCKETS;
+
+		Histogram();
+
+		//! Record a duration in seconds
+		void Record(double a_fSeconds)
+		{
+			RecordMicroseconds(a_fSeconds > 0.0 ? (boost::uint64_t)(a_fSeconds * 1000000.0) : 0);
+		}
+		void RecordMicroseconds(boost::uint64_t a_nValue);
+
+		boost::uint64_t GetCount() const
+		{
+			return m_nCount.load(boost::memory_order_relaxed);
+		}
+		//! Returns the sum of all recorded values in seconds
+		double GetSum() const
+		{
+			return m_nSum.load(boost::memory_order_relaxed) / 1000000.0;
+		}
+		//! Returns the largest recorded value in seconds
+		double GetMax() const
+		{
+			return m_nMax.load(boost::memory_order_relaxed) / 1000000.0;
+		}
+		//! Returns the value in seconds that a_fQuantile (0.0 - 1.0) of the recorded values are less than or equal to.
+		double GetQuantile(double a_fQuantile) const;
+
+		//! Returns the bucket a value in microseconds is counted in.
+		static int GetBucket(boost::uint64_t a_nValue);
+		//! Returns the lowest value in microseconds counted by a bucket.
+		static boost::uint64_t GetBucketStart(int a_nBucket);
+		//! Returns the number of values in microseconds counted by a bucket.
+		static boost::uint64_t GetBucketWidth(int a_nBucket);
+
+	private:
+		boost::atomic<boost::uint32_t>	m_Buckets[BUCKET_COUNT];
+		boost::atomic<boost::uint64_t>	m_nCount;
+		boost::atomic<boost::uint64_t>	m_nSum;
+		boost::atomic<boost::uint64_t>	m_nMax;
+	};
+
+	//! Singleton
+	static Metrics * Instance();
+
+	//! Construction
+	Metrics();
+	~Metrics();
+
+	//! Accessors
+	size_t GetMaxSeries() const
+	{
+		return m_nMaxSeries;
+	}
+
+	//! Mutators
+	void SetMaxSeries(size_t a_nMaxSeries)
+	{
+		m_nMaxSeries = a_nMaxSeries;
+	}
+
+	//! Find or create a series, the name should follow the Prometheus naming rules ([a-zA-Z_:][a-zA-Z0-9_:]*).
+	Counter * GetCounter(const std::string & a_Name, const Tags & a_Tags = Tags());
+	Gauge * GetGauge(const std::string & a_Name, const Tags & a_Tags = Tags());
+	Histogram * GetHistogram(const std::string & a_Name, const Tags & a_Tags = Tags());
+
+	//! Pass every series to the given exporter, series are grouped by name and sorted by their tags.
+	void Export(IMetricsExporter & a_Exporter);
+
+private:
+	//! Types
+	struct Series
+	{
+		Series() : m_eType(COUNTER), m_pMetric(NULL)
+		{}
+
+		std::string		m_Name;
+		Tags			m_Tags;
+		Type			m_eType;
+		void *			m_pMetric;
+	};
+	typedef std::map<std::string, Series>		SeriesMap;
+	typedef std::map<std::string, size_t>		CountMap;
+
+	//! Data
+	boost::mutex	m_Lock;
+	SeriesMap		m_Series;				// keyed by name & tags
+	CountMap		m_SeriesCount;			// number of series for each name
+	size_t			m_nMaxSeries;
+	Counter			m_UnusedCounter;		// returned when a name is requested with the wrong type
+	Gauge			m_UnusedGauge;
+	Histogram		m_UnusedHistogram;
+
+	void * FindSeries(const std::string & a_Name, const Tags & a_Tags, Type a_eType);
+	//! Returns the key of a series, the key starts with the name so all series with the same name
+	//! are next to each other in m_Series.
+	static std::string GetKey(const std::string & a_Name, const Tags & a_Tags);
+};
+
+//! Interface for any object that publishes the metrics, Metrics::Export() invokes one of these for each series.
+class WDC_API IMetricsExporter
+{
+public:
+	virtual ~IMetricsExporter()
+	{}
+
+	virtual void OnCounter(const std::string & a_Name, const Metrics::Tags & a_Tags, const Metrics::Counter & a_Counter) = 0;
+	virtual void OnGauge(const std::string & a_Name, const Metrics::Tags & a_Tags, const Metrics::Gauge & a_Gauge) = 0;
+	virtual void OnHistogram(const std::string & a_Name, const Metrics::Tags & a_Tags, const Metrics::Histogram & a_Histogram) = 0;
+};
+
+#endif
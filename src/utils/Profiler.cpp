@@ -0,0 +1,362 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <algorithm>
+
+#include "Profiler.h"
+#include "Log.h"
+#include "StringUtil.h"
+#include "Trace.h"
+
+// the stack is found by following the frame pointers of the interrupted main thread, this
+// only reads memory inside that thread's stack so it's safe to do in a signal handler.
+#if defined(__GLIBC__) && (defined(__x86_64__) || defined(__aarch64__))
+#define ENABLE_STALL_STACK		1
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <ucontext.h>
+#else
+#define ENABLE_STALL_STACK		0
+#endif
+
+#if ENABLE_STALL_STACK
+namespace {
+
+const int MAX_FRAMES = 64;
+const int STACK_SIGNAL = SIGUSR2;
+
+pthread_t					g_MainThread;
+boost::atomic<bool>			g_bHaveMain(false);
+uintptr_t					g_StackLow = 0;		// bounds of the main thread's stack
+uintptr_t					g_StackHigh = 0;
+void *						g_Frames[MAX_FRAMES];
+volatile int				g_nFrames = 0;
+boost::atomic<bool>			g_bCaptured(false);
+struct sigaction			g_PrevAction;		// the handler to restore once the watchdog stops
+bool						g_bInstalled = false;
+
+//! Invoked on the main thread by the watchdog
+void OnStackSignal(int, siginfo_t *, void * a_pContext)
+{
+	const ucontext_t * pContext = (const ucontext_t *)a_pContext;
+#if defined(__x86_64__)
+	uintptr_t pc = (uintptr_t)pContext->uc_mcontext.gregs[REG_RIP];
+	uintptr_t fp = (uintptr_t)pContext->uc_mcontext.gregs[REG_RBP];
+#else
+	uintptr_t pc = (uintptr_t)pContext->uc_mcontext.pc;
+	uintptr_t fp = (uintptr_t)pContext->uc_mcontext.regs[29];
+#endif
+
+	int nFrames = 0;
+	g_Frames[nFrames++] = (void *)pc;
+
+	// each frame starts with the caller's frame pointer followed by the return address, stop once
+	// it leaves the stack or stops growing towards the base since the code may omit frame pointers.
+	while (nFrames < MAX_FRAMES && (fp % sizeof(uintptr_t)) == 0
+		&& fp >= g_StackLow && fp + 2 * sizeof(uintptr_t) <= g_StackHigh)
+	{
+		const uintptr_t * pFrame = (const uintptr_t *)fp;
+		if (pFrame[1] == 0)
+			break;
+		g_Frames[nFrames++] = (void *)pFrame[1];
+		if (pFrame[0] <= fp)
+			break;
+		fp = pFrame[0];
+	}
+
+	g_nFrames = nFrames;
+	g_bCaptured = true;
+}
+
+}
+#endif
+
+Profiler::Scope::Scope(const char * a_pFile, int a_nLine, double a_fQueued /*= 0.0*/) :
+	m_pFile(a_pFile != NULL ? a_pFile : ""),
+	m_nLine(a_nLine),
+	m_fQueued(a_fQueued),
+	m_fStart(Trace::Now()),
+	m_bSampled(false)
+{
+	Profiler * pProfiler = Instance();
+	int nSampleRate = pProfiler->m_nSampleRate;
+	if (nSampleRate > 0)
+		m_bSampled = (pProfiler->m_nSampleCount++ % (unsigned int)nSampleRate) == 0;
+
+	m_pPrevFile = pProfiler->m_pFile;
+	m_nPrevLine = pProfiler->m_nLine;
+	pProfiler->m_pFile = m_pFile;
+	pProfiler->m_nLine = m_nLine;
+	if (pProfiler->m_nDepth++ == 0)
+		pProfiler->m_nBlockedSince = (boost::int64_t)(m_fStart * 1000000.0);
+}
+
+Profiler::Scope::~Scope()
+{
+	Profiler * pProfiler = Instance();
+	if (--pProfiler->m_nDepth == 0)
+		pProfiler->m_nBlockedSince = 0;
+	pProfiler->m_pFile = m_pPrevFile;
+	pProfiler->m_nLine = m_nPrevLine;
+
+	double elapsed = Trace::Now() - m_fStart;
+	if (m_bSampled)
+	{
+		Site * pSite = pProfiler->FindSite(m_pFile, m_nLine);
+		pSite->m_Run.Record(elapsed);
+		if (m_fQueued > 0.0)
+			pSite->m_Wait.Record(m_fStart - m_fQueued);
+	}
+
+	if (pProfiler->m_fErrorTime > 0.0 && elapsed > pProfiler->m_fErrorTime)
+		Log::Error("Profiler", "Delegate %s:%d took %f seconds to invoke on main thread.", m_pFile, m_nLine, elapsed);
+	else if (pProfiler->m_fWarningTime > 0.0 && elapsed > pProfiler->m_fWarningTime)
+		Log::Warning("Profiler", "Delegate %s:%d took %f seconds to invoke on main thread.", m_pFile, m_nLine, elapsed);
+}
+
+Profiler * Profiler::Instance()
+{
+	static Profiler * pInstance = new Profiler();		// never deleted, delegates may be invoked during shutdown
+	return pInstance;
+}
+
+Profiler::Profiler() :
+	m_nSampleRate(DEFAULT_SAMPLE_RATE),
+	m_nSampleCount(0),
+	m_fWarningTime(0.1),
+	m_fErrorTime(0.5),
+	m_nDepth(0),
+	m_nBlockedSince(0),
+	m_pFile(""),
+	m_nLine(0),
+	m_pWatchdog(NULL),
+	m_bStopWatchdog(false),
+	m_fThreshold(1.0)
+{}
+
+Profiler::~Profiler()
+{
+	StopWatchdog();
+	for (SiteMap::iterator iSite = m_Sites.begin(); iSite != m_Sites.end(); ++iSite)
+		delete iSite->second;
+}
+
+void Profiler::StartWatchdog(double a_fThreshold /*= 1.0*/)
+{
+	StopWatchdog();
+
+#if ENABLE_STALL_STACK
+	// this is the main thread, find the bounds of its stack for the signal handler
+	pthread_attr_t attr;
+	if (!g_bHaveMain && pthread_getattr_np(pthread_self(), &attr) == 0)
+	{
+		void * pStack = NULL;
+		size_t nStackSize = 0;
+		if (pthread_attr_getstack(&attr, &pStack, &nStackSize) == 0)
+		{
+			g_MainThread = pthread_self();
+			g_StackLow = (uintptr_t)pStack;
+			g_StackHigh = g_StackLow + nStackSize;
+			g_bHaveMain = true;
+		}
+		pthread_attr_destroy(&attr);
+	}
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = OnStackSignal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART | SA_SIGINFO;
+	if (sigaction(STACK_SIGNAL, &action, &g_PrevAction) == 0)
+		g_bInstalled = true;
+#endif
+
+	m_fThreshold = a_fThreshold;
+	m_bStopWatchdog = false;
+	m_pWatchdog = new boost::thread(boost::bind(&Profiler::WatchdogMain, this));
+}
+
+void Profiler::StopWatchdog()
+{
+	if (m_pWatchdog != NULL)
+	{
+		m_bStopWatchdog = true;
+		m_pWatchdog->join();
+		delete m_pWatchdog;
+		m_pWatchdog = NULL;
+	}
+
+#if ENABLE_STALL_STACK
+	// the watchdog has stopped, so it can't signal the main thread anymore
+	if (g_bInstalled)
+	{
+		sigaction(STACK_SIGNAL, &g_PrevAction, NULL);
+		g_bInstalled = false;
+	}
+#endif
+}
+
+//! Sort the sites with the largest values first
+struct SortSites
+{
+	SortSites(Profiler::SortBy a_eSort) : m_eSort(a_eSort)
+	{}
+
+	bool operator()(const Profiler::SiteStats & a_Left, const Profiler::SiteStats & a_Right) const
+	{
+		if (m_eSort == Profiler::SORT_MAX)
+			return a_Left.m_fMax > a_Right.m_fMax;
+		if (m_eSort == Profiler::SORT_WAIT)
+			return a_Left.m_fWaitP99 > a_Right.m_fWaitP99;
+		return a_Left.m_fTotal > a_Right.m_fTotal;
+	}
+
+	Profiler::SortBy m_eSort;
+};
+
+void Profiler::GetTopSites(SiteStatsList & a_Sites, size_t a_nCount /*= 10*/, SortBy a_eSort /*= SORT_TOTAL*/)
+{
+	a_Sites.clear();
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		for (SiteMap::const_iterator iSite = m_Sites.begin(); iSite != m_Sites.end(); ++iSite)
+		{
+			const Site * pSite = iSite->second;
+
+			SiteStats stats;
+			stats.m_Site = StringUtil::Format("%s:%d", iSite->first.first, iSite->first.second);
+			stats.m_nCount = pSite->m_Run.GetCount();
+			stats.m_fTotal = pSite->m_Run.GetSum();
+			stats.m_fMax = pSite->m_Run.GetMax();
+			stats.m_fP50 = pSite->m_Run.GetQuantile(0.5);
+			stats.m_fP99 = pSite->m_Run.GetQuantile(0.99);
+			stats.m_fWaitP50 = pSite->m_Wait.GetQuantile(0.5);
+			stats.m_fWaitP99 = pSite->m_Wait.GetQuantile(0.99);
+			a_Sites.push_back(stats);
+		}
+	}
+
+	std::sort(a_Sites.begin(), a_Sites.end(), SortSites(a_eSort));
+	if (a_nCount > 0 && a_Sites.size() > a_nCount)
+		a_Sites.resize(a_nCount);
+}
+
+std::string Profiler::GetReport(size_t a_nCount /*= 10*/, SortBy a_eSort /*= SORT_TOTAL*/)
+{
+	SiteStatsList sites;
+	GetTopSites(sites, a_nCount, a_eSort);
+
+	std::string report(StringUtil::Format("%10s %10s %10s %10s %10s %10s %10s  %s\n",
+		"count", "total(s)", "max(ms)", "p50(ms)", "p99(ms)", "wait50(ms)", "wait99(ms)", "site"));
+	for (size_t i = 0; i < sites.size(); ++i)
+	{
+		const SiteStats & site = sites[i];
+		report += StringUtil::Format("%10llu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f  %s\n",
+			(unsigned long long)site.m_nCount, site.m_fTotal, site.m_fMax * 1000.0, site.m_fP50 * 1000.0, site.m_fP99 * 1000.0,
+			site.m_fWaitP50 * 1000.0, site.m_fWaitP99 * 1000.0, site.m_Site.c_str());
+	}
+
+	return report;
+}
+
+Profiler::StallList Profiler::GetStalls()
+{
+	boost::lock_guard<boost::mutex> lock(m_Lock);
+	return m_Stalls;
+}
+
+void Profiler::Reset()
+{
+	boost::lock_guard<boost::mutex> lock(m_Lock);
+	for (SiteMap::iterator iSite = m_Sites.begin(); iSite != m_Sites.end(); ++iSite)
+		delete iSite->second;
+	m_Sites.clear();
+	m_Stalls.clear();
+}
+
+Profiler::Site * Profiler::FindSite(const char * a_pFile, int a_nLine)
+{
+	boost::lock_guard<boost::mutex> lock(m_Lock);
+
+	Site *& pSite = m_Sites[SiteKey(a_pFile, a_nLine)];
+	if (pSite == NULL)
+		pSite = new Site();
+	return pSite;
+}
+
+void Profiler::WatchdogMain()
+{
+	boost::int64_t nReported = 0;			// start time of the last stall we reported, so each stall is only reported once
+	while (!m_bStopWatchdog)
+	{
+		boost::this_thread::sleep(boost::posix_time::milliseconds(
+			std::max(1, std::min(100, (int)(m_fThreshold * 250.0)))));
+
+		boost::int64_t nSince = m_nBlockedSince;
+		if (nSince == 0 || nSince == nReported)
+			continue;
+
+		double fBlocked = Trace::Now() - nSince / 1000000.0;
+		if (fBlocked < m_fThreshold)
+			continue;
+
+		nReported = nSince;
+
+		Stall stall;
+		stall.m_Site = StringUtil::Format("%s:%d", (const char *)m_pFile, (int)m_nLine);
+		stall.m_fTime = Trace::Now();
+		stall.m_fBlocked = fBlocked;
+		CaptureStack(stall.m_Stack);
+
+		std::string stack;
+		for (size_t i = 0; i < stall.m_Stack.size(); ++i)
+			stack += "\n    " + stall.m_Stack[i];
+		Log::Error("Profiler", "Main thread blocked for %f seconds in %s.%s", fBlocked, stall.m_Site.c_str(), stack.c_str());
+
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		m_Stalls.push_back(stall);
+		if (m_Stalls.size() > MAX_STALLS)
+			m_Stalls.pop_front();
+	}
+}
+
+void Profiler::CaptureStack(std::vector<std::string> & a_Stack)
+{
+	a_Stack.clear();
+#if ENABLE_STALL_STACK
+	if (!g_bHaveMain)
+		return;
+
+	g_bCaptured = false;
+	if (pthread_kill(g_MainThread, STACK_SIGNAL) != 0)
+		return;
+	for (int i = 0; i < 100 && !g_bCaptured; ++i)
+		boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+	if (!g_bCaptured)
+		return;
+
+	char ** pSymbols = backtrace_symbols(g_Frames, g_nFrames);
+	if (pSymbols != NULL)
+	{
+		for (int i = 0; i < g_nFrames; ++i)
+			a_Stack.push_back(pSymbols[i]);
+		free(pSymbols);
+	}
+#endif
+}
@@ -0,0 +1,195 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_PROFILER_H
+#define WDC_PROFILER_H
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "boost/atomic.hpp"
+#include "boost/thread.hpp"
+
+#include "Metrics.h"
+#include "WDCLib.h"		// include last always
+
+//! Profiler for the delegates invoked on the main thread.
+//!
+//! Each delegate site (the file & line the delegate was made) gets a histogram of the time spent running
+//! the delegate and the time it waited in the main queue. A watchdog thread can be started which reports
+//! any delegate that blocks the main thread for longer than a threshold, on glibc platforms the report
+//! includes the stack of the main thread at the time it was found to be blocked.
+//!
+//! Only one in GetSampleRate() delegates is added to the histograms, every delegate is watched by the watchdog.
+//! Stacks are found by following frame pointers, so build with -fno-omit-frame-pointer for a complete stack.
+class WDC_API Profiler
+{
+public:
+	//! Types
+	struct SiteStats
+	{
+		SiteStats() : m_nCount(0), m_fTotal(0.0), m_fMax(0.0), m_fP50(0.0), m_fP99(0.0),
+			m_fWaitP50(0.0), m_fWaitP99(0.0)
+		{}
+
+		std::string			m_Site;			// file:line
+		boost::uint64_t		m_nCount;		// number of samples
+		double				m_fTotal;		// total run time of the samples in seconds
+		double				m_fMax;
+		double				m_fP50;
+		double				m_fP99;
+		double				m_fWaitP50;		// time spent in the main queue
+		double				m_fWaitP99;
+	};
+	typedef std::vector<SiteStats>		SiteStatsList;
+
+	struct Stall
+	{
+		Stall() : m_fTime(0.0), m_fBlocked(0.0)
+		{}
+
+		std::string			m_Site;			// delegate running when the stall was found
+		double				m_fTime;		// epoch time the stall was found
+		double				m_fBlocked;		// seconds the main thread had been blocked
+		std::vector<std::string>
+							m_Stack;		// stack of the main thread, empty if not supported
+	};
+	typedef std::list<Stall>			StallList;
+
+	enum SortBy
+	{
+		SORT_TOTAL,				// total run time
+		SORT_MAX,				// longest single run
+		SORT_WAIT				// 99th percentile queue wait
+	};
+
+	//! Times a delegate invoked on the main thread, the time is recorded when this object is destroyed. A warning
+	//! is logged if the delegate takes longer than the warning time. This must only be used on the main thread.
+	class WDC_API Scope
+	{
+	public:
+		Scope(const char * a_pFile, int a_nLine, double a_fQueued = 0.0);
+		~Scope();
+
+	private:
+		Scope(const Scope &);
+		Scope & operator=(const Scope &);
+
+		const char *		m_pFile;
+		int					m_nLine;
+		double				m_fQueued;
+		double				m_fStart;
+		bool				m_bSampled;
+		const char *		m_pPrevFile;
+		int					m_nPrevLine;
+	};
+
+	//! Constants
+	static const int DEFAULT_SAMPLE_RATE = 16;
+
+	//! Singleton
+	static Profiler * Instance();
+
+	//! Construction
+	Profiler();
+	~Profiler();
+
+	//! Accessors
+	int GetSampleRate() const
+	{
+		return m_nSampleRate;
+	}
+	double GetWarningTime() const
+	{
+		return m_fWarningTime;
+	}
+	double GetErrorTime() const
+	{
+		return m_fErrorTime;
+	}
+
+	//! Mutators
+	//! Add one in a_nOneIn delegates to the histograms, 1 records every delegate and 0 records none. The default
+	//! is one in DEFAULT_SAMPLE_RATE so the histograms don't add a lock to every delegate.
+	void SetSampleRate(int a_nOneIn)
+	{
+		m_nSampleRate = a_nOneIn;
+	}
+	//! Set the run time a delegate is logged as a warning or an error, use 0 to disable.
+	void SetWarningTimes(double a_fWarning, double a_fError)
+	{
+		m_fWarningTime = a_fWarning;
+		m_fErrorTime = a_fError;
+	}
+
+	//! Start a thread that reports a stall when the main thread is in a single delegate for longer than a_fThreshold seconds.
+	//! This must be called on the main thread, which is remembered as the thread to capture a stack from.
+	//! On glibc the stack is captured with SIGUSR2, the previous handler is restored by StopWatchdog().
+	void StartWatchdog(double a_fThreshold = 1.0);
+	void StopWatchdog();
+
+	//! Returns the sites with the highest value, a_nCount of 0 returns all of them.
+	void GetTopSites(SiteStatsList & a_Sites, size_t a_nCount = 10, SortBy a_eSort = SORT_TOTAL);
+	//! Returns a text table of the top sites.
+	std::string GetReport(size_t a_nCount = 10, SortBy a_eSort = SORT_TOTAL);
+	//! Returns the most recent stalls found by the watchdog, oldest first.
+	StallList GetStalls();
+	//! Clear all recorded sites & stalls, this should only be called on the main thread.
+	void Reset();
+
+private:
+	//! Types
+	struct Site
+	{
+		Metrics::Histogram	m_Run;
+		Metrics::Histogram	m_Wait;
+	};
+	typedef std::pair<const char *, int>	SiteKey;
+	typedef std::map<SiteKey, Site *>		SiteMap;
+
+	//! Data
+	boost::mutex		m_Lock;
+	SiteMap				m_Sites;
+	StallList			m_Stalls;
+	int					m_nSampleRate;
+	boost::atomic<unsigned int>
+						m_nSampleCount;
+	double				m_fWarningTime;
+	double				m_fErrorTime;
+
+	// state of the main thread, read by the watchdog..
+	boost::atomic<int>	m_nDepth;
+	boost::atomic<boost::int64_t>
+						m_nBlockedSince;	// microseconds since epoch the outer delegate started, 0 when idle
+	boost::atomic<const char *>
+						m_pFile;			// innermost delegate running
+	boost::atomic<int>	m_nLine;
+
+	boost::thread *		m_pWatchdog;
+	volatile bool		m_bStopWatchdog;
+	double				m_fThreshold;
+
+	Site * FindSite(const char * a_pFile, int a_nLine);
+	void WatchdogMain();
+	void CaptureStack(std::vector<std::string> & a_Stack);
+
+	static const size_t MAX_STALLS = 16;
+};
+
+#endif
@@ -0,0 +1,122 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "PrometheusExporter.h"
+#include "StringUtil.h"
+
+PrometheusExporter::PrometheusExporter()
+{}
+
+std::string PrometheusExporter::Format(Metrics * a_pMetrics /*= Metrics::Instance()*/)
+{
+	PrometheusExporter exporter;
+	a_pMetrics->Export(exporter);
+	return exporter.m_Text;
+}
+
+void PrometheusExporter::Start(IWebServer * a_pServer, const std::string & a_EndPoint /*= "/metrics"*/)
+{
+	// the registry is thread safe, so don't make a scrape wait on the main thread
+	a_pServer->AddEndpoint("GET", a_EndPoint, DELEGATE(PrometheusExporter, OnRequest, IWebServer::RequestSP, this), false);
+}
+
+void PrometheusExporter::OnCounter(const std::string & a_Name, const Metrics::Tags & a_Tags, const Metrics::Counter & a_Counter)
+{
+	WriteType(a_Name, "counter");
+	WriteSeries(a_Name, a_Tags, NULL, StringUtil::Format("%lld", (long long)a_Counter.Get()));
+}
+
+void PrometheusExporter::OnGauge(const std::string & a_Name, const Metrics::Tags & a_Tags, const Metrics::Gauge & a_Gauge)
+{
+	WriteType(a_Name, "gauge");
+	WriteSeries(a_Name, a_Tags, NULL, StringUtil::Format("%lld", (long long)a_Gauge.Get()));
+}
+
+void PrometheusExporter::OnHistogram(const std::string & a_Name, const Metrics::Tags & a_Tags, const Metrics::Histogram & a_Histogram)
+{
+	static const double QUANTILES[] = { 0.5, 0.9, 0.99 };
+
+	WriteType(a_Name, "summary");
+	for (size_t i = 0; i < sizeof(QUANTILES) / sizeof(QUANTILES[0]); ++i)
+	{
+		std::string quantile(StringUtil::Format("%g", QUANTILES[i]));
+		WriteSeries(a_Name, a_Tags, quantile.c_str(), StringUtil::Format("%.9g", a_Histogram.GetQuantile(QUANTILES[i])));
+	}
+	WriteSeries(a_Name + "_sum", a_Tags, NULL, StringUtil::Format("%.9g", a_Histogram.GetSum()));
+	WriteSeries(a_Name + "_count", a_Tags, NULL, StringUtil::Format("%llu", (unsigned long long)a_Histogram.GetCount()));
+}
+
+void PrometheusExporter::OnRequest(IWebServer::RequestSP a_spRequest)
+{
+	IWebServer::Headers headers;
+	headers["Content-Type"] = "text/plain; version=0.0.4";
+	a_spRequest->m_spConnection->SendResponse(200, "OK", headers, Format());
+}
+
+void PrometheusExporter::WriteType(const std::string & a_Name, const char * a_pType)
+{
+	if (a_Name == m_LastName)
+		return;
+
+	m_LastName = a_Name;
+	m_Text += "# TYPE ";
+	m_Text += a_Name;
+	m_Text += ' ';
+	m_Text += a_pType;
+	m_Text += '\n';
+}
+
+void PrometheusExporter::WriteSeries(const std::string & a_Name, const Metrics::Tags & a_Tags, const char * a_pQuantile,
+	const std::string & a_Value)
+{
+	m_Text += a_Name;
+	if (a_Tags.size() > 0 || a_pQuantile != NULL)
+	{
+		char sep = '{';
+		for (Metrics::Tags::const_iterator iTag = a_Tags.begin(); iTag != a_Tags.end(); ++iTag)
+		{
+			m_Text += sep;
+			m_Text += iTag->first;
+			m_Text += "=\"";
+			for (size_t i = 0; i < iTag->second.size(); ++i)
+			{
+				char c = iTag->second[i];
+				if (c == '\\' || c == '"')
+					m_Text += '\\';
+				else if (c == '\n')
+				{
+					m_Text += "\\n";
+					continue;
+				}
+				m_Text += c;
+			}
+			m_Text += '"';
+			sep = ',';
+		}
+		if (a_pQuantile != NULL)
+		{
+			m_Text += sep;
+			m_Text += "quantile=\"";
+			m_Text += a_pQuantile;
+			m_Text += '"';
+		}
+		m_Text += '}';
+	}
+	m_Text += ' ';
+	m_Text += a_Value;
+	m_Text += '\n';
+}
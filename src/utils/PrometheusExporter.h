@@ -0,0 +1,64 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_PROMETHEUS_EXPORTER_H
+#define WDC_PROMETHEUS_EXPORTER_H
+
+#include <string>
+
+#include "Metrics.h"
+#include "IWebServer.h"
+#include "WDCLib.h"		// include last always
+
+//! Formats the metrics registry in the Prometheus text exposition format, histograms are exported as
+//! a summary with the 0.5, 0.9 and 0.99 quantiles. Start() serves the text from an IWebServer end-point
+//! so the process can be scraped directly.
+class WDC_API PrometheusExporter : public IMetricsExporter
+{
+public:
+	//! Construction
+	PrometheusExporter();
+
+	//! Accessors
+	const std::string & GetText() const
+	{
+		return m_Text;
+	}
+
+	//! Returns all series in the given registry in the Prometheus text format.
+	static std::string Format(Metrics * a_pMetrics = Metrics::Instance());
+
+	//! Serve the metrics at a_EndPoint on the given server, this object must not be destroyed before the server.
+	void Start(IWebServer * a_pServer, const std::string & a_EndPoint = "/metrics");
+
+	//! IMetricsExporter interface
+	virtual void OnCounter(const std::string & a_Name, const Metrics::Tags & a_Tags, const Metrics::Counter & a_Counter);
+	virtual void OnGauge(const std::string & a_Name, const Metrics::Tags & a_Tags, const Metrics::Gauge & a_Gauge);
+	virtual void OnHistogram(const std::string & a_Name, const Metrics::Tags & a_Tags, const Metrics::Histogram & a_Histogram);
+
+private:
+	//! Data
+	std::string		m_Text;
+	std::string		m_LastName;				// name of the last series, the TYPE line is written once per name
+
+	void OnRequest(IWebServer::RequestSP a_spRequest);
+	void WriteType(const std::string & a_Name, const char * a_pType);
+	void WriteSeries(const std::string & a_Name, const Metrics::Tags & a_Tags, const char * a_pQuantile,
+		const std::string & a_Value);
+};
+
+#endif
@@ -20,7 +20,9 @@
 
 #include <string>
 #include <list>
+#include <vector>
 
+#include "boost/atomic.hpp"
 #include "boost/shared_ptr.hpp"
 
 #include "StringHash.h"
@@ -30,6 +32,14 @@
 	RTTI (Run Time Time information) class allows us to determine the type
 	of an object at run-time. The user of this system must use the RTTI_DECL() macro
 	in the class definition.
+
+	Each RTTI keeps the list of its base classes from the root down, so a class at depth N
+	derives from a_pType only if entry N of that list is a_pType. IsType() is then a
+	single comparison no matter how deep the hierarchy is. The list never changes once
+	the RTTI is constructed, so it's safe to read from any thread.
+
+	ISerializable also keeps the type it writes for each class on the RTTI, so looking it
+	up doesn't need a lock or a map.
 */
 
 class WDC_API RTTI
@@ -37,19 +47,27 @@ class WDC_API RTTI
 public:
 	//! Types
 	typedef std::list< RTTI * >			ClassList;
+	typedef std::vector< const RTTI * >	TypeList;
 
 	//! Construction
 	RTTI(const std::string & a_ClassName) :
 		m_ClassName(a_ClassName),
 		m_ClassID(StringHash::DJB(a_ClassName.c_str())),
-		m_pBaseClass(NULL)
+		m_pBaseClass(NULL),
+		m_Types(1, this),
+		m_nWriteVersion(0),
+		m_pWriteType(NULL)
 	{}
 
 	RTTI(const std::string & a_ClassName, RTTI & a_BaseClass) :
 		m_ClassName(a_ClassName),
 		m_ClassID(StringHash::DJB(a_ClassName.c_str())),
-		m_pBaseClass(&a_BaseClass)
+		m_pBaseClass(&a_BaseClass),
+		m_Types(a_BaseClass.m_Types),
+		m_nWriteVersion(0),
+		m_pWriteType(NULL)
 	{
+		m_Types.push_back(this);
 		a_BaseClass.m_ChildClasses.push_back(this);
 	}
 
@@ -82,6 +100,16 @@ public:
 	{
 		return m_ChildClasses;
 	}
+	//! Returns the number of base classes above this class
+	size_t GetDepth() const
+	{
+		return m_Types.size() - 1;
+	}
+	//! Returns this class and all its base classes, the root class first
+	const TypeList & GetTypes() const
+	{
+		return m_Types;
+	}
 
 	bool operator==(const RTTI & cmp) const
 	{
@@ -91,23 +119,27 @@ public:
 	//! This returns true if the given type is derived from this class type.
 	bool IsType(const RTTI * a_pType) const
 	{
-		const RTTI * pType = this;
-		while (pType != NULL)
-		{
-			if (pType == a_pType)
-				return true;
-			pType = pType->m_pBaseClass;
-		}
+		if (a_pType == NULL)
+			return false;
 
-		return false;
+		size_t nDepth = a_pType->m_Types.size() - 1;
+		return nDepth < m_Types.size() && m_Types[nDepth] == a_pType;
 	}
 
 private:
+	friend class ISerializable;
+
 	//! Data
 	std::string			m_ClassName;		// the name of this class
 	unsigned int		m_ClassID;			// hash of our class name
 	RTTI *				m_pBaseClass;		// our base class
 	ClassList			m_ChildClasses;		// classes derived from this class
+	TypeList			m_Types;			// the root class down to this class
+
+	mutable boost::atomic<unsigned int>
+						m_nWriteVersion;	// serializable factory version + 1 that m_pWriteType was resolved for, 0 if never
+	mutable boost::atomic<const RTTI *>
+						m_pWriteType;		// see ISerializable::GetWriteType()
 };
 
 //! Use this macro for a class that derives from anther class.
@@ -0,0 +1,291 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_SIGNAL_H
+#define WDC_SIGNAL_H
+
+#include <vector>
+
+#include "boost/atomic.hpp"
+#include "boost/noncopyable.hpp"
+#include "boost/shared_ptr.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/type_traits/remove_cv.hpp"
+#include "boost/type_traits/remove_reference.hpp"
+
+#include "Delegate.h"
+#include "ThreadPool.h"
+#include "WDCLib.h"		// include last always
+
+//! A Signal invokes any number of delegates each time it's emitted, e.g.
+//!
+//! Signal<const RecognizeResults &> OnResults;
+//! OnResults.Connect( DELEGATE( MyObject, OnResults, const RecognizeResults &, spObject ) );
+//! OnResults.Connect( DELEGATE( MyLog, OnResults, const RecognizeResults &, pLog ), Signal<const RecognizeResults &>::MAIN_THREAD );
+//!
+//! OnResults.Emit( results );
+//!
+//! Emit() never takes a lock. The subscribers are kept in an array that is never changed once it's
+//! published, Connect() & Disconnect() build a new array and swap it in. An old array is deleted once no
+//! Emit() is running, so any thread may emit while others connect or disconnect, and a subscriber may
+//! disconnect itself (or anything else) while being invoked.
+//!
+//! A subscriber made from a shared_ptr is removed automatically once its object has been destroyed.
+//!
+//! INLINE subscribers are called on the emitting thread with the argument as given, so a reference
+//! argument is never copied. For MAIN_THREAD & THREAD_POOL subscribers the argument is copied once per
+//! Emit() and that copy is shared by all of them. A pointer argument is copied as a pointer, the object
+//! must stay valid until the queued calls are made. With no ThreadPool every subscriber is called inline.
+template<typename ARG>
+class Signal : private boost::noncopyable
+{
+public:
+	//! Types
+	enum Dispatch
+	{
+		INLINE,			// invoke on the thread calling Emit()
+		MAIN_THREAD,	// queue with ThreadPool::InvokeOnMain()
+		THREAD_POOL		// queue with ThreadPool::InvokeOnThread()
+	};
+	typedef unsigned int		ConnectionID;
+
+	//! Construction
+	Signal() : m_pSubscribers(new SubscriberList()), m_nReaders(0), m_nNextID(1)
+	{}
+	~Signal()
+	{
+		delete m_pSubscribers.load();
+		for (size_t i = 0; i < m_Retired.size(); ++i)
+			delete m_Retired[i];
+	}
+
+	//! Accessors
+	size_t GetCount() const
+	{
+		ReadLock lock(this);
+		return lock.GetList().size();
+	}
+
+	//! Mutators
+	//! Add a subscriber, returns the ID to pass to Disconnect() or 0 if the delegate isn't valid.
+	ConnectionID Connect(const Delegate<ARG> & a_Delegate, Dispatch a_eDispatch = INLINE)
+	{
+		if (!a_Delegate.IsValid())
+			return 0;
+
+		boost::mutex::scoped_lock lock(m_WriteLock);
+		SubscriberList * pList = new SubscriberList(*m_pSubscribers.load());
+		pList->push_back(Subscriber(a_Delegate, a_eDispatch, m_nNextID++));
+		Publish(pList);
+		return pList->back().m_nID;
+	}
+
+	//! Remove the subscriber with the given ID, returns false if it's not connected.
+	bool Disconnect(ConnectionID a_nID)
+	{
+		boost::mutex::scoped_lock lock(m_WriteLock);
+		return Remove(RemoveID(a_nID)) > 0;
+	}
+
+	//! Remove all subscribers that call the given object, returns the number removed.
+	size_t DisconnectObject(void * a_pObject)
+	{
+		boost::mutex::scoped_lock lock(m_WriteLock);
+		return Remove(RemoveObject(a_pObject));
+	}
+
+	void Clear()
+	{
+		boost::mutex::scoped_lock lock(m_WriteLock);
+		if (m_pSubscribers.load()->size() > 0)
+			Publish(new SubscriberList());
+	}
+
+	//! Invoke or queue every subscriber with the given argument.
+	void Emit(ARG a_Arg)
+	{
+		bool bExpired = false;
+		{
+			ReadLock lock(this);
+			const SubscriberList & list = lock.GetList();
+
+			ThreadPool * pPool = ThreadPool::Instance();
+			boost::shared_ptr<Value> spValue;
+			for (size_t i = 0; i < list.size(); ++i)
+			{
+				const Subscriber & sub = list[i];
+				if (sub.m_eDispatch == INLINE || pPool == NULL)
+				{
+					if (!sub.m_Delegate(a_Arg))
+						bExpired = true;
+				}
+				else if (sub.m_Delegate.IsExpired())
+					bExpired = true;
+				else
+				{
+					if (!spValue)
+						spValue.reset(new Value(a_Arg));
+
+					VoidDelegate call = VOID_FUNCTOR_DELEGATE(Queued(sub.m_Delegate, spValue));
+					if (sub.m_eDispatch == MAIN_THREAD)
+						pPool->InvokeOnMain(call);
+					else
+						pPool->InvokeOnThread(call);
+				}
+			}
+		}
+
+		if (bExpired)
+		{
+			boost::mutex::scoped_lock lock(m_WriteLock);
+			Remove(RemoveExpired());
+		}
+	}
+
+	void operator()(ARG a_Arg)
+	{
+		Emit(a_Arg);
+	}
+
+private:
+	//! Types
+	typedef typename boost::remove_cv<typename boost::remove_reference<ARG>::type>::type	Value;
+
+	struct Subscriber
+	{
+		Subscriber(const Delegate<ARG> & a_Delegate, Dispatch a_eDispatch, ConnectionID a_nID) :
+			m_Delegate(a_Delegate), m_eDispatch(a_eDispatch), m_nID(a_nID)
+		{}
+
+		Delegate<ARG>	m_Delegate;
+		Dispatch		m_eDispatch;
+		ConnectionID	m_nID;
+	};
+	typedef std::vector<Subscriber>		SubscriberList;
+
+	//! Keeps the published list from being deleted while it's read.
+	class ReadLock
+	{
+	public:
+		ReadLock(const Signal * a_pSignal) : m_pSignal(a_pSignal)
+		{
+			// the count must go up before the list is loaded, see Publish()
+			++m_pSignal->m_nReaders;
+			m_pList = m_pSignal->m_pSubscribers.load();
+		}
+		~ReadLock()
+		{
+			--m_pSignal->m_nReaders;
+		}
+
+		const SubscriberList & GetList() const
+		{
+			return *m_pList;
+		}
+
+	private:
+		const Signal *				m_pSignal;
+		const SubscriberList *		m_pList;
+	};
+
+	//! A queued call, holds the copy of the argument shared by all the queued subscribers.
+	struct Queued
+	{
+		Queued(const Delegate<ARG> & a_Delegate, const boost::shared_ptr<Value> & a_spValue) :
+			m_Delegate(a_Delegate), m_spValue(a_spValue)
+		{}
+
+		void operator()()
+		{
+			m_Delegate(*m_spValue);
+		}
+
+		Delegate<ARG>				m_Delegate;
+		boost::shared_ptr<Value>	m_spValue;
+	};
+
+	struct RemoveID
+	{
+		RemoveID(ConnectionID a_nID) : m_nID(a_nID)
+		{}
+		bool operator()(const Subscriber & a_Sub) const
+		{
+			return a_Sub.m_nID == m_nID;
+		}
+		ConnectionID m_nID;
+	};
+	struct RemoveObject
+	{
+		RemoveObject(void * a_pObject) : m_pObject(a_pObject)
+		{}
+		bool operator()(const Subscriber & a_Sub) const
+		{
+			return a_Sub.m_Delegate.IsObject(m_pObject);
+		}
+		void * m_pObject;
+	};
+	struct RemoveExpired
+	{
+		bool operator()(const Subscriber & a_Sub) const
+		{
+			return a_Sub.m_Delegate.IsExpired();
+		}
+	};
+
+	//! Data
+	boost::atomic<SubscriberList *>		m_pSubscribers;
+	mutable boost::atomic<int>			m_nReaders;		// number of ReadLock objects
+	boost::mutex						m_WriteLock;	// held by Connect() & Disconnect()
+	std::vector<SubscriberList *>		m_Retired;		// lists replaced while a ReadLock may be using them
+	ConnectionID						m_nNextID;
+
+	//! Publish a new list with any subscribers that match a_Pred removed, m_WriteLock must be held.
+	template<typename PRED>
+	size_t Remove(const PRED & a_Pred)
+	{
+		const SubscriberList & current = *m_pSubscribers.load();
+
+		SubscriberList * pList = new SubscriberList();
+		pList->reserve(current.size());
+		for (size_t i = 0; i < current.size(); ++i)
+			if (!a_Pred(current[i]))
+				pList->push_back(current[i]);
+
+		size_t removed = current.size() - pList->size();
+		if (removed > 0)
+			Publish(pList);
+		else
+			delete pList;
+		return removed;
+	}
+
+	//! Replace the list, m_WriteLock must be held. The swap happens before m_nReaders is read, so if no
+	//! readers are counted then any ReadLock made after this point will load the new list & the old ones
+	//! can be deleted.
+	void Publish(SubscriberList * a_pList)
+	{
+		m_Retired.push_back(m_pSubscribers.exchange(a_pList));
+		if (m_nReaders.load() == 0)
+		{
+			for (size_t i = 0; i < m_Retired.size(); ++i)
+				delete m_Retired[i];
+			m_Retired.clear();
+		}
+	}
+};
+
+#endif
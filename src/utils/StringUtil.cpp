@@ -112,9 +112,12 @@ std::string StringUtil::Format( const char * a_pFormat, ... )
 	int rv = vsnprintf(buffer, sizeof(buffer), a_pFormat, args);
 	if ( rv >= sizeof(buffer) )
 	{
-		// buffer too small, allocate a buffer from the heap and try again..
-		char * heapBuffer = new char[ rv + 1024 ];
-		vsnprintf(heapBuffer, rv, a_pFormat, args);
+		// buffer too small, allocate a buffer from the heap and try again, args can't be used twice..
+		va_end(args);
+		va_start(args, a_pFormat);
+
+		char * heapBuffer = new char[ rv + 1 ];
+		vsnprintf(heapBuffer, rv + 1, a_pFormat, args);
 		va_end(args);
 
 		std::string result( heapBuffer );
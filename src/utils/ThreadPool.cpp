@@ -18,16 +18,12 @@
 //! Define to 1 to protect thread calls against a crash..
 #define ENABLE_THREAD_TRY_CATCH					1
 
-//! maximum amount of time to spend in a single delegate before we throw an error
-#if ENABLE_DELEGATE_DEBUG
-#define WARNING_DELEGATE_TIME		(0.1)
-#define ERROR_DELEGATE_TIME			(0.5)
-#endif
-
 #include "ThreadPool.h"
 #include "WatsonException.h"
 #include "Log.h"
+#include "Profiler.h"
 #include "Time.h"
+#include "StringUtil.h"
 
 ThreadPool * ThreadPool::sm_pInstance = NULL;
 
@@ -43,6 +39,7 @@ ThreadPool::ThreadPool( int a_Threads /*= 10*/ ) :
 	if ( sm_pInstance != NULL )
 		throw WatsonException( "ThreadPool already exists." );
 	sm_pInstance = this;
+	m_MainThreadId = tthread::this_thread::get_id();
 
 	for(int i=0;i<m_ThreadCount;++i)
 		m_Threads.push_back( new tthread::thread( ThreadMain, this ) );
@@ -59,6 +56,10 @@ ThreadPool::~ThreadPool()
 		delete *iThread;
 	}
 
+	for( DelegateList::iterator iDelegate = m_MainQueue.begin(); iDelegate != m_MainQueue.end(); ++iDelegate )
+		(*iDelegate)->Destroy();
+	m_MainQueue.clear();
+
 	if ( sm_pInstance == this )
 		sm_pInstance = NULL;
 }
@@ -73,23 +74,10 @@ void ThreadPool::ProcessMainThread()
 
 	for( DelegateList::iterator iDelegate = invoke.begin(); iDelegate != invoke.end(); ++iDelegate )
 	{
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-        double startTime = Time().GetEpochTime();
-#endif
-		(*iDelegate)->Invoke();
-
-#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-        double elapsed = Time().GetEpochTime() - startTime;
-		if(elapsed > WARNING_DELEGATE_TIME)
 		{
-			if ( elapsed > ERROR_DELEGATE_TIME )
-				Log::Error("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-					(*iDelegate)->GetFile(), (*iDelegate)->GetLine(), elapsed );
-			else
-				Log::Warning("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-					(*iDelegate)->GetFile(), (*iDelegate)->GetLine(), elapsed );
+			Profiler::Scope profile( (*iDelegate)->GetFile(), (*iDelegate)->GetLine(), (*iDelegate)->m_fQueued );
+			Invoke( *iDelegate, "main_queue" );
 		}
-#endif
 		(*iDelegate)->Destroy();
 	}
 }
@@ -100,6 +88,7 @@ int ThreadPool::RunMainThread()
 {
 	m_MainQueueLock.lock();
 	m_StopMain = false;
+	m_MainThreadId = tthread::this_thread::get_id();
 
 	while( !m_StopMain )
 	{
@@ -113,9 +102,14 @@ int ThreadPool::RunMainThread()
 		m_MainQueueLock.lock();
 	};
 
-	m_MainQueue.clear();
+	// destroy anything still queued, so whatever the delegates hold onto is released..
+	DelegateList dropped;
+	dropped.splice( dropped.begin(), m_MainQueue );
 	m_MainQueueLock.unlock();
 
+	for( DelegateList::iterator iDelegate = dropped.begin(); iDelegate != dropped.end(); ++iDelegate )
+		(*iDelegate)->Destroy();
+
 	return m_ExitCode;
 }
 
@@ -127,6 +121,12 @@ void ThreadPool::StopMainThread(int a_ExitCode)
 	m_ExitCode = a_ExitCode;
 }
 
+bool ThreadPool::IsMainThread()
+{
+	tthread::lock_guard<tthread::recursive_mutex> lock( m_MainQueueLock );
+	return m_MainThreadId == tthread::this_thread::get_id();
+}
+
 
 void ThreadPool::ThreadMain( void * arg )
 {
@@ -136,7 +136,9 @@ void ThreadPool::ThreadMain( void * arg )
 	pPool->m_ActiveThreads += 1;
 	while(! pPool->m_Shutdown )
 	{
-		pPool->m_WakeThread.wait( pPool->m_ThreadQueueLock );
+		// don't wait if something was queued before this thread started waiting..
+		if ( pPool->m_ThreadQueue.size() == 0 )
+			pPool->m_WakeThread.wait( pPool->m_ThreadQueueLock );
 		pPool->m_BusyThreads += 1;
 
 		while( pPool->m_ThreadQueue.size() > 0 )
@@ -148,7 +150,7 @@ void ThreadPool::ThreadMain( void * arg )
 #if ENABLE_THREAD_TRY_CATCH
 			try {
 #endif
-				pCallback->Invoke();
+				Invoke( pCallback, "thread_queue" );
 #if ENABLE_THREAD_TRY_CATCH
 			}
 			catch( WatsonException ex )
@@ -180,3 +182,19 @@ void ThreadPool::InvokeOnMain(ICallback * a_pCallback)
 		m_MainQueue.push_back(a_pCallback);
 		m_WakeMain.notify_one();
 }
+
+void ThreadPool::Invoke(ICallback * a_pCallback, const char * a_pQueue)
+{
+	if (! a_pCallback->m_Context.IsValid() )
+	{
+		a_pCallback->Invoke();
+		return;
+	}
+
+	// record the time spent waiting in the queue, then the callback itself..
+	Trace::AddSpan( a_pQueue, "ThreadPool", a_pCallback->m_fQueued, Trace::Now(), a_pCallback->m_Context );
+
+	TraceSpan span( a_pCallback->m_Context, "callback", "ThreadPool" );
+	span.SetDetail( StringUtil::Format( "%s:%d", a_pCallback->GetFile(), a_pCallback->GetLine() ) );
+	a_pCallback->Invoke();
+}
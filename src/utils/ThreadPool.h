@@ -21,6 +21,7 @@
 #include <list>
 
 #include "Delegate.h"
+#include "Trace.h"
 #include "tinythread++/tinythread.h"
 #include "WDCLib.h"
 
@@ -67,18 +68,29 @@ public:
 	int RunMainThread();
 	//! This is called to make ProcessMainThread() exit.
 	void StopMainThread(int a_ExitCode = 0);
+	//! Returns true if called from the main thread, that's the thread that created the pool or the
+	//! last one to call RunMainThread().
+	bool IsMainThread();
 
 private:
 	//! Types
 	class ICallback
 	{
 	public:
+		ICallback() : m_fQueued( Trace::Now() )
+		{
+			if ( Trace::IsEnabled() )
+				m_Context = Trace::GetContext();
+		}
 		virtual ~ICallback()
 		{}
 		virtual void Invoke() = 0;
 		virtual void Destroy() = 0;
 		virtual const char * GetFile() const = 0;
 		virtual int GetLine() const = 0;
+
+		Trace::Context	m_Context;		// trace of the thread that queued this callback
+		double			m_fQueued;		// time this callback was queued
 	};
 
 	class VoidCallback : public ICallback
@@ -100,20 +112,12 @@ private:
 
 		virtual const char * GetFile() const
 		{
-#if ENABLE_DELEGATE_DEBUG
 			return m_Delegate.GetFile();
-#else
-			return "";
-#endif
 		}
 
 		virtual int GetLine() const
 		{
-#if ENABLE_DELEGATE_DEBUG
 			return m_Delegate.GetLine();
-#else
-			return 0;
-#endif
 		}
 
 		VoidDelegate	m_Delegate;
@@ -139,20 +143,12 @@ private:
 
 		virtual const char * GetFile() const
 		{
-#if ENABLE_DELEGATE_DEBUG
 			return m_Delegate.GetFile();
-#else
-			return "";
-#endif
 		}
 
 		virtual int GetLine() const
 		{
-#if ENABLE_DELEGATE_DEBUG
 			return m_Delegate.GetLine();
-#else
-			return 0;
-#endif
 		}
 
 		Delegate<ARG>	m_Delegate;
@@ -165,6 +161,8 @@ private:
 	//! Functions
 	void InvokeOnThread( ICallback * a_pCallback );
 	void InvokeOnMain( ICallback * a_pCallback );
+	//! Invoke the callback in the trace of the thread that queued it.
+	static void Invoke( ICallback * a_pCallback, const char * a_pQueue );
 
 	//! Data
 	volatile bool		m_StopMain;
@@ -178,6 +176,7 @@ private:
 	tthread::recursive_mutex
 						m_MainQueueLock;
 	DelegateList		m_MainQueue;
+	tthread::thread::id	m_MainThreadId;
 
 	tthread::condition_variable
 						m_WakeThread;
@@ -0,0 +1,300 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <stdio.h>
+#include <vector>
+
+#include "boost/thread.hpp"
+#include "boost/date_time/posix_time/posix_time.hpp"
+#include "jsoncpp/json/json.h"
+
+#include "Trace.h"
+#include "StringUtil.h"
+
+boost::atomic<bool> Trace::sm_bEnabled(false);
+
+namespace {
+
+//! A finished span
+struct TraceEvent
+{
+	const char *		m_pName;
+	const char *		m_pCategory;
+	double				m_fStart;
+	double				m_fEnd;
+	unsigned int		m_ThreadId;
+	unsigned int		m_TraceId;
+	unsigned int		m_SpanId;
+	unsigned int		m_ParentId;
+	std::string			m_Detail;
+};
+
+//! Trace state of a single thread
+struct TraceThread
+{
+	Trace::Context		m_Context;
+	unsigned int		m_ThreadId;
+};
+
+class TraceState
+{
+public:
+	static TraceState & Instance()
+	{
+		static TraceState * pInstance = new TraceState();		// never deleted, threads may record while exiting
+		return *pInstance;
+	}
+
+	TraceState() : m_nMaxEvents(0), m_fStartTime(0.0), m_NextId(0), m_NextThread(0)
+	{}
+
+	TraceThread & GetThread()
+	{
+		TraceThread * pThread = m_Thread.get();
+		if (pThread == NULL)
+		{
+			pThread = new TraceThread();
+			pThread->m_ThreadId = ++m_NextThread;
+			m_Thread.reset(pThread);
+		}
+		return *pThread;
+	}
+
+	boost::mutex		m_Lock;
+	std::vector<TraceEvent>
+						m_Events;
+	size_t				m_nMaxEvents;
+	double				m_fStartTime;
+	boost::atomic<unsigned int>
+						m_NextId;
+	boost::atomic<unsigned int>
+						m_NextThread;
+	boost::thread_specific_ptr<TraceThread>
+						m_Thread;
+};
+
+}
+
+Trace::Scope::Scope(const Context & a_Context) : m_bActive(Trace::IsEnabled())
+{
+	if (m_bActive)
+	{
+		Context & current = TraceState::Instance().GetThread().m_Context;
+		m_Previous = current;
+		current = a_Context;
+	}
+}
+
+Trace::Scope::~Scope()
+{
+	if (m_bActive)
+		TraceState::Instance().GetThread().m_Context = m_Previous;
+}
+
+void Trace::Start(size_t a_nMaxEvents /*= 100000*/)
+{
+	TraceState & state = TraceState::Instance();
+	{
+		boost::lock_guard<boost::mutex> lock(state.m_Lock);
+		state.m_nMaxEvents = a_nMaxEvents;
+		if (state.m_Events.size() == 0)
+			state.m_fStartTime = Now();
+	}
+	sm_bEnabled = true;
+}
+
+void Trace::Stop()
+{
+	sm_bEnabled = false;
+}
+
+void Trace::Clear()
+{
+	TraceState & state = TraceState::Instance();
+	boost::lock_guard<boost::mutex> lock(state.m_Lock);
+	state.m_Events.clear();
+	state.m_fStartTime = Now();
+}
+
+size_t Trace::GetEventCount()
+{
+	TraceState & state = TraceState::Instance();
+	boost::lock_guard<boost::mutex> lock(state.m_Lock);
+	return state.m_Events.size();
+}
+
+double Trace::Now()
+{
+	static const boost::posix_time::ptime EPOCH(boost::gregorian::date(1970, 1, 1));
+	return (boost::posix_time::microsec_clock::universal_time() - EPOCH).total_microseconds() / 1000000.0;
+}
+
+Trace::Context Trace::GetContext()
+{
+	if (!IsEnabled())
+		return Context();
+	return TraceState::Instance().GetThread().m_Context;
+}
+
+void Trace::SetContext(const Context & a_Context)
+{
+	if (IsEnabled())
+		TraceState::Instance().GetThread().m_Context = a_Context;
+}
+
+Trace::Context Trace::NewTrace()
+{
+	Context trace;
+	if (IsEnabled())
+		trace.m_TraceId = NextId();
+	return trace;
+}
+
+Trace::Context Trace::NewSpan(const Context & a_Parent)
+{
+	Context span;
+	if (IsEnabled())
+	{
+		span.m_TraceId = a_Parent.IsValid() ? a_Parent.m_TraceId : NextId();
+		span.m_SpanId = NextId();
+	}
+	return span;
+}
+
+void Trace::AddSpan(const char * a_pName, const char * a_pCategory, double a_fStart, double a_fEnd,
+	const Context & a_Parent, const std::string & a_Detail /*= std::string()*/)
+{
+	if (IsEnabled() && a_Parent.IsValid())
+		Record(a_pName, a_pCategory, a_fStart, a_fEnd, a_Parent, NewSpan(a_Parent), a_Detail);
+}
+
+void Trace::AddSpan(const char * a_pName, const char * a_pCategory, double a_fStart, double a_fEnd,
+	const Context & a_Parent, const Context & a_Span, const std::string & a_Detail /*= std::string()*/)
+{
+	if (IsEnabled() && a_Span.IsValid())
+		Record(a_pName, a_pCategory, a_fStart, a_fEnd, a_Parent, a_Span, a_Detail);
+}
+
+std::string Trace::ExportJson()
+{
+	TraceState & state = TraceState::Instance();
+	boost::lock_guard<boost::mutex> lock(state.m_Lock);
+
+	std::string json("{\"traceEvents\":[");
+	for (size_t i = 0; i < state.m_Events.size(); ++i)
+	{
+		const TraceEvent & e = state.m_Events[i];
+		if (i > 0)
+			json += ",\n";
+		json += StringUtil::Format("{\"name\":%s,\"cat\":%s,\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,"
+			"\"args\":{\"trace\":%u,\"span\":%u,\"parent\":%u",
+			Json::valueToQuotedString(e.m_pName).c_str(), Json::valueToQuotedString(e.m_pCategory).c_str(),
+			(e.m_fStart - state.m_fStartTime) * 1000000.0, (e.m_fEnd - e.m_fStart) * 1000000.0, e.m_ThreadId,
+			e.m_TraceId, e.m_SpanId, e.m_ParentId);
+		if (e.m_Detail.size() > 0)
+		{
+			json += ",\"detail\":";
+			json += Json::valueToQuotedString(e.m_Detail.c_str());
+		}
+		json += "}}";
+	}
+	json += "],\"displayTimeUnit\":\"ms\"}\n";
+
+	return json;
+}
+
+bool Trace::SaveJson(const std::string & a_File)
+{
+	std::string json(ExportJson());
+
+	FILE * pFile = fopen(a_File.c_str(), "wb");
+	if (pFile == NULL)
+		return false;
+	bool bSuccess = fwrite(json.data(), 1, json.size(), pFile) == json.size();
+	fclose(pFile);
+
+	return bSuccess;
+}
+
+unsigned int Trace::NextId()
+{
+	unsigned int id = ++TraceState::Instance().m_NextId;
+	if (id == 0)
+		id = ++TraceState::Instance().m_NextId;		// 0 is never a valid id
+	return id;
+}
+
+void Trace::Record(const char * a_pName, const char * a_pCategory, double a_fStart, double a_fEnd,
+	const Context & a_Parent, const Context & a_Span, const std::string & a_Detail)
+{
+	TraceState & state = TraceState::Instance();
+
+	TraceEvent e;
+	e.m_pName = a_pName;
+	e.m_pCategory = a_pCategory;
+	e.m_fStart = a_fStart;
+	e.m_fEnd = a_fEnd;
+	e.m_ThreadId = state.GetThread().m_ThreadId;
+	e.m_TraceId = a_Span.m_TraceId;
+	e.m_SpanId = a_Span.m_SpanId;
+	e.m_ParentId = a_Parent.m_SpanId;
+
+	boost::lock_guard<boost::mutex> lock(state.m_Lock);
+	if (state.m_Events.size() < state.m_nMaxEvents)
+	{
+		state.m_Events.push_back(e);
+		state.m_Events.back().m_Detail = a_Detail;
+	}
+}
+
+TraceSpan::TraceSpan(const char * a_pName, const char * a_pCategory /*= "wdc"*/) :
+	m_pName(a_pName), m_pCategory(a_pCategory), m_bActive(false), m_fStart(0.0)
+{
+	if (Trace::IsEnabled())
+		Begin(Trace::GetContext());
+}
+
+TraceSpan::TraceSpan(const Trace::Context & a_Parent, const char * a_pName, const char * a_pCategory /*= "wdc"*/) :
+	m_pName(a_pName), m_pCategory(a_pCategory), m_bActive(false), m_fStart(0.0)
+{
+	if (Trace::IsEnabled())
+		Begin(a_Parent);
+}
+
+TraceSpan::~TraceSpan()
+{
+	if (m_bActive)
+	{
+		TraceState::Instance().GetThread().m_Context = m_Previous;
+		Trace::Record(m_pName, m_pCategory, m_fStart, Trace::Now(), m_Parent, m_Span, m_Detail);
+	}
+}
+
+void TraceSpan::Begin(const Trace::Context & a_Parent)
+{
+	if (!a_Parent.IsValid())
+		return;
+
+	m_bActive = true;
+	m_Parent = a_Parent;
+	m_Span = Trace::NewSpan(a_Parent);
+	m_fStart = Trace::Now();
+
+	Trace::Context & current = TraceState::Instance().GetThread().m_Context;
+	m_Previous = current;
+	current = m_Span;
+}
@@ -0,0 +1,150 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_TRACE_H
+#define WDC_TRACE_H
+
+#include <string>
+
+#include "boost/atomic.hpp"
+#include "boost/noncopyable.hpp"
+
+#include "WDCLib.h"		// include last always
+
+//! Records timed spans of a request as it moves between threads, the spans can be saved in the Chrome
+//! trace format and viewed with chrome://tracing or Perfetto.
+//!
+//! Each thread has a current context, the trace & span that the work on that thread belongs to. A context
+//! is copied into each callback queued with the ThreadPool and restored when the callback is invoked,
+//! so the spans recorded by the callback belong to the same trace. Work that moves between threads some
+//! other way (e.g. asio handlers) should keep the context with GetContext() and restore it with a Scope.
+//!
+//! Tracing is off until Start() is called, while it's off a span costs a single flag check.
+class WDC_API Trace
+{
+public:
+	//! Types
+	struct Context
+	{
+		Context() : m_TraceId(0), m_SpanId(0)
+		{}
+
+		bool IsValid() const
+		{
+			return m_TraceId != 0;
+		}
+
+		unsigned int		m_TraceId;
+		unsigned int		m_SpanId;		// parent of any span started in this context
+	};
+
+	//! Makes a context current on this thread until this object is destroyed.
+	class WDC_API Scope : private boost::noncopyable
+	{
+	public:
+		Scope(const Context & a_Context);
+		~Scope();
+
+	private:
+		Context		m_Previous;
+		bool		m_bActive;
+	};
+
+	static bool IsEnabled()
+	{
+		return sm_bEnabled.load(boost::memory_order_relaxed);
+	}
+
+	//! Start recording spans, once a_nMaxEvents spans are recorded any further spans are dropped.
+	static void Start(size_t a_nMaxEvents = 100000);
+	//! Stop recording spans, the recorded spans are kept until Clear() is called.
+	static void Stop();
+	static void Clear();
+	//! Returns the number of spans recorded.
+	static size_t GetEventCount();
+
+	//! Returns the time in seconds with microsecond precision.
+	static double Now();
+	//! Returns the current context of this thread.
+	static Context GetContext();
+	static void SetContext(const Context & a_Context);
+	//! Returns a context to start a new trace in, or an invalid context if tracing is off.
+	static Context NewTrace();
+	//! Returns the context of a new span that's a child of a_Parent, a new trace is started if a_Parent isn't
+	//! valid. Returns an invalid context if tracing is off. The span is recorded later with AddSpan(), this is
+	//! used for spans that don't start and finish on the same thread.
+	static Context NewSpan(const Context & a_Parent);
+	//! Record a span that has already finished, a_pName & a_pCategory must be string constants. The span is
+	//! recorded as a child of a_Parent on the current thread.
+	static void AddSpan(const char * a_pName, const char * a_pCategory, double a_fStart, double a_fEnd,
+		const Context & a_Parent, const std::string & a_Detail = std::string());
+	//! Record a span returned by NewSpan().
+	static void AddSpan(const char * a_pName, const char * a_pCategory, double a_fStart, double a_fEnd,
+		const Context & a_Parent, const Context & a_Span, const std::string & a_Detail = std::string());
+
+	//! Returns the recorded spans in the Chrome trace JSON format.
+	static std::string ExportJson();
+	//! Save the recorded spans into the given file, returns false on failure.
+	static bool SaveJson(const std::string & a_File);
+
+private:
+	friend class TraceSpan;
+
+	static unsigned int NextId();
+	static void Record(const char * a_pName, const char * a_pCategory, double a_fStart, double a_fEnd,
+		const Context & a_Parent, const Context & a_Span, const std::string & a_Detail);
+
+	static boost::atomic<bool>	sm_bEnabled;
+};
+
+//! Records a span from construction until destruction, any spans started on this thread or callbacks
+//! queued with the ThreadPool while this object is alive are children of this span. Nothing is
+//! recorded unless tracing is on and the thread is working on a trace.
+class WDC_API TraceSpan : private boost::noncopyable
+{
+public:
+	//! Start a span in the current context of this thread.
+	TraceSpan(const char * a_pName, const char * a_pCategory = "wdc");
+	//! Start a span in the given context, the context is made current on this thread until the span ends.
+	TraceSpan(const Trace::Context & a_Parent, const char * a_pName, const char * a_pCategory = "wdc");
+	~TraceSpan();
+
+	bool IsActive() const
+	{
+		return m_bActive;
+	}
+	//! Set some text to show with this span, e.g. the URL of a request.
+	void SetDetail(const std::string & a_Detail)
+	{
+		if (m_bActive)
+			m_Detail = a_Detail;
+	}
+
+private:
+	void Begin(const Trace::Context & a_Parent);
+
+	const char *		m_pName;
+	const char *		m_pCategory;
+	bool				m_bActive;
+	Trace::Context		m_Parent;
+	Trace::Context		m_Previous;
+	Trace::Context		m_Span;
+	double				m_fStart;
+	std::string			m_Detail;
+};
+
+#endif
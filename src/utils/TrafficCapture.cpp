@@ -0,0 +1,350 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <stdio.h>
+#include <fstream>
+#include <set>
+
+#include "TrafficCapture.h"
+#include "JsonParser.h"
+#include "Log.h"
+
+#include "boost/thread.hpp"
+
+boost::atomic<int> TrafficCapture::sm_nSources(0);
+
+namespace {
+
+const char		CAPTURE_MAGIC[] = "WDCCAP01";
+const size_t	CAPTURE_MAGIC_SIZE = sizeof(CAPTURE_MAGIC) - 1;
+const char *	REDACTED = "<redacted>";
+
+//! Headers that carry credentials or a session, the value is redacted in either direction.
+const char * const SECRET_HEADERS[] =
+{
+	"Authorization",
+	"Proxy-Authorization",
+	"X-Watson-Authorization-Token",
+	"Cookie",
+	"Set-Cookie"
+};
+//! Members of a JSON body that are redacted by default, see TrafficCapture::AddRedactedField().
+const char * const SECRET_FIELDS[] =
+{
+	"token",
+	"gds-token",
+	"access_token",
+	"refresh_token",
+	"password",
+	"apikey",
+	"api_key"
+};
+
+//! The open capture file
+struct CaptureState
+{
+	typedef std::set<std::string>	FieldSet;
+
+	CaptureState() : m_pFile(NULL), m_nRecords(0),
+		m_Fields(SECRET_FIELDS, SECRET_FIELDS + sizeof(SECRET_FIELDS) / sizeof(SECRET_FIELDS[0]))
+	{}
+
+	static CaptureState & Instance()
+	{
+		static CaptureState state;
+		return state;
+	}
+
+	boost::mutex		m_Lock;
+	FILE *				m_pFile;
+	size_t				m_nRecords;
+	FieldSet			m_Fields;
+};
+
+void AppendVarint(std::string & a_Output, boost::uint64_t a_nValue)
+{
+	while (a_nValue >= 0x80)
+	{
+		a_Output += (char)((a_nValue & 0x7f) | 0x80);
+		a_nValue >>= 7;
+	}
+	a_Output += (char)a_nValue;
+}
+
+void AppendString(std::string & a_Output, const std::string & a_String)
+{
+	AppendVarint(a_Output, a_String.size());
+	a_Output += a_String;
+}
+
+bool IsSecretHeader(const std::string & a_Name)
+{
+	for (size_t i = 0; i < sizeof(SECRET_HEADERS) / sizeof(SECRET_HEADERS[0]); ++i)
+		if (StringUtil::Compare(a_Name, SECRET_HEADERS[i], true) == 0)
+			return true;
+	// custom session & token headers, e.g. X-Session-Id or X-Auth-Token
+	return StringUtil::Find(a_Name, "session", 0, true) != std::string::npos
+		|| StringUtil::Find(a_Name, "token", 0, true) != std::string::npos;
+}
+
+void AppendHeaders(std::string & a_Output, const IWebClient::Headers & a_Headers)
+{
+	AppendVarint(a_Output, a_Headers.size());
+	for (IWebClient::Headers::const_iterator iHeader = a_Headers.begin(); iHeader != a_Headers.end(); ++iHeader)
+	{
+		AppendString(a_Output, iHeader->first);
+		AppendString(a_Output, IsSecretHeader(iHeader->first) ? std::string(REDACTED) : iHeader->second);
+	}
+}
+
+//! Returns true if any value in the tree was replaced.
+bool RedactValue(Json::Value & a_Value, const CaptureState::FieldSet & a_Fields)
+{
+	bool bRedacted = false;
+	if (a_Value.isObject())
+	{
+		Json::Value::Members members(a_Value.getMemberNames());
+		for (size_t i = 0; i < members.size(); ++i)
+		{
+			Json::Value & member = a_Value[members[i]];
+			if (a_Fields.find(members[i]) != a_Fields.end() && !member.isObject() && !member.isArray())
+			{
+				member = REDACTED;
+				bRedacted = true;
+			}
+			else if (RedactValue(member, a_Fields))
+				bRedacted = true;
+		}
+	}
+	else if (a_Value.isArray())
+	{
+		for (Json::ArrayIndex i = 0; i < a_Value.size(); ++i)
+			if (RedactValue(a_Value[i], a_Fields))
+				bRedacted = true;
+	}
+	return bRedacted;
+}
+
+//! Redact the secret members of a JSON body, any other body is written as it is.
+std::string RedactBody(const std::string & a_Body, const CaptureState::FieldSet & a_Fields)
+{
+	// most bodies have none of the fields, so look for the quoted names before parsing
+	bool bFound = false;
+	for (CaptureState::FieldSet::const_iterator iField = a_Fields.begin(); !bFound && iField != a_Fields.end(); ++iField)
+		bFound = a_Body.find("\"" + *iField + "\"") != std::string::npos;
+	if (!bFound)
+		return a_Body;
+
+	Json::Value root;
+	if (!JsonParser::ParseJson(a_Body, root) || !RedactValue(root, a_Fields))
+		return a_Body;
+	std::string body(Json::FastWriter().write(root));
+	if (!body.empty() && body[body.size() - 1] == '\n')
+		body.erase(body.size() - 1);
+	return body;
+}
+
+//! Reads the fields of a record, every read fails once the end of the record is passed.
+class RecordReader
+{
+public:
+	RecordReader(const std::string & a_Data) : m_Data(a_Data), m_nOffset(0)
+	{}
+
+	bool ReadVarint(boost::uint64_t & a_nValue)
+	{
+		a_nValue = 0;
+		for (int nShift = 0; nShift < 64; nShift += 7)
+		{
+			if (m_nOffset >= m_Data.size())
+				return false;
+			unsigned char c = (unsigned char)m_Data[m_nOffset++];
+			a_nValue |= (boost::uint64_t)(c & 0x7f) << nShift;
+			if ((c & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	bool ReadString(std::string & a_String)
+	{
+		boost::uint64_t nSize = 0;
+		if (!ReadVarint(nSize) || nSize > m_Data.size() - m_nOffset)
+			return false;
+		a_String.assign(m_Data, m_nOffset, (size_t)nSize);
+		m_nOffset += (size_t)nSize;
+		return true;
+	}
+
+	bool ReadHeaders(IWebClient::Headers & a_Headers)
+	{
+		boost::uint64_t nCount = 0;
+		if (!ReadVarint(nCount))
+			return false;
+		for (boost::uint64_t i = 0; i < nCount; ++i)
+		{
+			std::string key;
+			if (!ReadString(key) || !ReadString(a_Headers[key]))
+				return false;
+		}
+		return true;
+	}
+
+private:
+	const std::string &		m_Data;
+	size_t					m_nOffset;
+};
+
+}
+
+bool TrafficCapture::Start(const std::string & a_File, int a_nSources /*= SOURCE_SERVICE*/)
+{
+	CaptureState & state = CaptureState::Instance();
+	boost::lock_guard<boost::mutex> lock(state.m_Lock);
+	if (state.m_pFile != NULL)
+		fclose(state.m_pFile);
+
+	state.m_nRecords = 0;
+	state.m_pFile = fopen(a_File.c_str(), "ab");
+	if (state.m_pFile == NULL)
+	{
+		Log::Error("TrafficCapture", "Failed to open %s.", a_File.c_str());
+		sm_nSources = 0;
+		return false;
+	}
+
+	// a new file starts with the magic, records are appended onto an existing file..
+	fseek(state.m_pFile, 0, SEEK_END);
+	if (ftell(state.m_pFile) == 0)
+		fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_SIZE, state.m_pFile);
+
+	sm_nSources = a_nSources;
+	return true;
+}
+
+void TrafficCapture::Stop()
+{
+	sm_nSources = 0;
+
+	CaptureState & state = CaptureState::Instance();
+	boost::lock_guard<boost::mutex> lock(state.m_Lock);
+	if (state.m_pFile != NULL)
+	{
+		fclose(state.m_pFile);
+		state.m_pFile = NULL;
+	}
+}
+
+size_t TrafficCapture::GetRecordCount()
+{
+	CaptureState & state = CaptureState::Instance();
+	boost::lock_guard<boost::mutex> lock(state.m_Lock);
+	return state.m_nRecords;
+}
+
+void TrafficCapture::AddRedactedField(const std::string & a_Field)
+{
+	CaptureState & state = CaptureState::Instance();
+	boost::lock_guard<boost::mutex> lock(state.m_Lock);
+	state.m_Fields.insert(a_Field);
+}
+
+void TrafficCapture::Capture(const Record & a_Record)
+{
+	if (!IsCapturing(a_Record.m_eSource))
+		return;
+
+	CaptureState & state = CaptureState::Instance();
+	boost::lock_guard<boost::mutex> lock(state.m_Lock);
+	if (state.m_pFile == NULL)
+		return;
+
+	std::string record;
+	AppendVarint(record, (boost::uint64_t)a_Record.m_eSource);
+	AppendVarint(record, (boost::uint64_t)(a_Record.m_fTime * 1000000.0));
+	AppendVarint(record, (boost::uint64_t)(a_Record.m_fDuration > 0.0 ? a_Record.m_fDuration * 1000000.0 : 0.0));
+	AppendVarint(record, a_Record.m_nStatusCode);
+	AppendString(record, a_Record.m_ServiceId);
+	AppendString(record, a_Record.m_RequestType);
+	AppendString(record, a_Record.m_URL);
+	AppendHeaders(record, a_Record.m_RequestHeaders);
+	AppendString(record, RedactBody(a_Record.m_RequestBody, state.m_Fields));
+	AppendHeaders(record, a_Record.m_ResponseHeaders);
+	AppendString(record, RedactBody(a_Record.m_ResponseBody, state.m_Fields));
+
+	unsigned char length[4];
+	for (int i = 0; i < 4; ++i)
+		length[i] = (unsigned char)((record.size() >> (i * 8)) & 0xff);
+
+	fwrite(length, 1, sizeof(length), state.m_pFile);
+	fwrite(record.data(), 1, record.size(), state.m_pFile);
+	fflush(state.m_pFile);
+	state.m_nRecords += 1;
+}
+
+bool TrafficCapture::Load(const std::string & a_File, RecordList & a_Records)
+{
+	std::ifstream input(a_File.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open())
+	{
+		Log::Error("TrafficCapture", "Failed to open %s.", a_File.c_str());
+		return false;
+	}
+
+	std::string data;
+	data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+	if (data.compare(0, CAPTURE_MAGIC_SIZE, CAPTURE_MAGIC) != 0)
+	{
+		Log::Error("TrafficCapture", "%s is not a capture file.", a_File.c_str());
+		return false;
+	}
+
+	size_t nOffset = CAPTURE_MAGIC_SIZE;
+	while (nOffset + 4 <= data.size())
+	{
+		size_t nLength = 0;
+		for (int i = 0; i < 4; ++i)
+			nLength |= (size_t)(unsigned char)data[nOffset + i] << (i * 8);
+		nOffset += 4;
+		if (nLength > data.size() - nOffset)
+			break;		// cut short
+
+		std::string payload(data, nOffset, nLength);
+		nOffset += nLength;
+
+		Record record;
+		RecordReader reader(payload);
+		boost::uint64_t nSource = 0, nTime = 0, nDuration = 0, nStatusCode = 0;
+		if (!reader.ReadVarint(nSource) || !reader.ReadVarint(nTime) || !reader.ReadVarint(nDuration)
+			|| !reader.ReadVarint(nStatusCode) || !reader.ReadString(record.m_ServiceId)
+			|| !reader.ReadString(record.m_RequestType) || !reader.ReadString(record.m_URL)
+			|| !reader.ReadHeaders(record.m_RequestHeaders) || !reader.ReadString(record.m_RequestBody)
+			|| !reader.ReadHeaders(record.m_ResponseHeaders) || !reader.ReadString(record.m_ResponseBody))
+		{
+			Log::Warning("TrafficCapture", "Skipping malformed record in %s.", a_File.c_str());
+			continue;
+		}
+
+		record.m_eSource = (Source)nSource;
+		record.m_fTime = nTime / 1000000.0;
+		record.m_fDuration = nDuration / 1000000.0;
+		record.m_nStatusCode = (unsigned int)nStatusCode;
+		a_Records.push_back(record);
+	}
+
+	return true;
+}
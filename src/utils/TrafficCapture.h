@@ -0,0 +1,96 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_TRAFFIC_CAPTURE_H
+#define WDC_TRAFFIC_CAPTURE_H
+
+#include <string>
+#include <vector>
+
+#include "boost/atomic.hpp"
+
+#include "IWebClient.h"
+#include "WDCLib.h"		// include last always
+
+//! Captures the requests made by the services, with their responses & timing, into an append-only file
+//! that can be replayed later with TrafficReplay.
+//!
+//! Requests are captured as an IService::Request completes (SOURCE_SERVICE), or as any HTTP request made
+//! with an IWebClient completes (SOURCE_WEB_CLIENT). A service request is also a web client request, so
+//! capturing both sources records it twice. Web socket traffic & cached responses are not captured.
+//!
+//! Credential, cookie & session headers are redacted in both directions, as are the token & password
+//! members of a JSON request or response body (see AddRedactedField()). Bodies that aren't JSON are
+//! written as they are.
+//!
+//! Each record is written as a 32-bit length followed by the fields, strings are prefixed by a variable
+//! length integer. A record cut short by a crash is ignored when the file is loaded.
+//!
+//! Capturing is off until Start() is called, while it's off a request costs a single flag check.
+class WDC_API TrafficCapture
+{
+public:
+	//! Types
+	enum Source
+	{
+		SOURCE_SERVICE = 0x1,
+		SOURCE_WEB_CLIENT = 0x2
+	};
+
+	struct Record
+	{
+		Record() : m_eSource(SOURCE_SERVICE), m_fTime(0.0), m_fDuration(0.0), m_nStatusCode(0)
+		{}
+
+		Source					m_eSource;
+		double					m_fTime;			// epoch time the request was made
+		double					m_fDuration;		// seconds until the response was complete
+		unsigned int			m_nStatusCode;		// 0 if no response was received
+		std::string				m_ServiceId;		// empty for SOURCE_WEB_CLIENT
+		std::string				m_RequestType;
+		std::string				m_URL;
+		IWebClient::Headers		m_RequestHeaders;
+		std::string				m_RequestBody;
+		IWebClient::Headers		m_ResponseHeaders;
+		std::string				m_ResponseBody;
+	};
+	typedef std::vector<Record>		RecordList;
+
+	static bool IsCapturing(Source a_eSource)
+	{
+		return (sm_nSources.load(boost::memory_order_relaxed) & a_eSource) != 0;
+	}
+
+	//! Start appending records to a_File, a_nSources is a mask of the Source values to capture.
+	static bool Start(const std::string & a_File, int a_nSources = SOURCE_SERVICE);
+	//! Stop capturing and close the file.
+	static void Stop();
+	//! Returns the number of records written since Start().
+	static size_t GetRecordCount();
+	//! Redact the value of any JSON body member with this name, e.g. a service specific token field.
+	static void AddRedactedField(const std::string & a_Field);
+	//! Write a record, this is ignored unless the source of the record is being captured.
+	static void Capture(const Record & a_Record);
+
+	//! Load all records from a capture file, returns false if the file can't be read.
+	static bool Load(const std::string & a_File, RecordList & a_Records);
+
+private:
+	static boost::atomic<int>	sm_nSources;
+};
+
+#endif
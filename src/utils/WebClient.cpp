@@ -36,17 +36,16 @@
 #include "utf8_v2_3_4/source/utf8.h"
 
 #include "Log.h"
+#include "Profiler.h"
 #include "ThreadPool.h"
+#include "TrafficCapture.h"
+#include "Time.h"
+#include "Trace.h"
 #include "WatsonException.h"
 #include "WebClientService.h"
 
 #include <string>
 
-#if ENABLE_DELEGATE_DEBUG
-#define WARNING_DELEGATE_TIME (0.1)
-#define ERROR_DELEGATE_TIME	(0.5)
-#endif
-
 RTTI_IMPL( IWebClient, IWebSocket );
 
 // include the OpenSSL libs
@@ -65,6 +64,29 @@ boost::atomic<unsigned int>		IWebClient::sm_BytesSent;
 boost::atomic<unsigned int>		IWebClient::sm_BytesRecv;
 std::string						IWebClient::sm_ClientId;
 
+namespace {
+
+	//! Add the headers every request sends, unless they are already set. Connection & ClientId are set by
+	//! SendRequest() since they replace any given value.
+	void AddDefaultHeaders( IWebClient::Headers & a_Headers, const std::string & a_Host )
+	{
+		if ( a_Headers.find( "Accept" ) == a_Headers.end() )
+			a_Headers["Accept"] = "*/*";
+		if ( a_Headers.find( "Host" ) == a_Headers.end() )
+			a_Headers["Host"] = a_Host;
+		if ( a_Headers.find( "User-Agent") == a_Headers.end() )
+			a_Headers["User-Agent"] = "SelfWebClient";
+	}
+
+	void AppendHeader( std::string & a_Request, const std::string & a_Key, const std::string & a_Value )
+	{
+		a_Request += a_Key;
+		a_Request += ": ";
+		a_Request += a_Value;
+		a_Request += "\r\n";
+	}
+}
+
 IWebClient::ConnectionMap &	IWebClient::GetConnectionMap()
 {
 	static ConnectionMap * pMAP = new ConnectionMap();
@@ -109,11 +131,36 @@ IWebClient::SP IWebClient::Create( const URL & a_URL )
 	return spClient;
 }
 
+IWebClient::RequestTemplate::SP IWebClient::CreateTemplate( const Headers & a_Headers, const std::string & a_Host )
+{
+	boost::shared_ptr<RequestTemplate> spTemplate( new RequestTemplate() );
+	spTemplate->m_Headers = a_Headers;
+	if ( a_Headers.find( "Host" ) == a_Headers.end() )
+		spTemplate->m_Host = a_Host;
+
+	Headers headers( a_Headers );
+	AddDefaultHeaders( headers, a_Host );
+	headers.erase( "Connection" );
+	headers.erase( "ClientId" );
+
+	for( Headers::const_iterator iHeader = headers.begin(); iHeader != headers.end(); ++iHeader )
+	{
+		RequestTemplate::Line line;
+		line.m_Key = iHeader->first;
+		AppendHeader( line.m_Line, iHeader->first, iHeader->second );
+		spTemplate->m_Block += line.m_Line;
+		spTemplate->m_Lines.push_back( line );
+	}
+
+	return spTemplate;
+}
+
 void IWebClient::Free( const SP & a_spClient )
 {
 	if ( a_spClient )
 	{
 		a_spClient->ClearDelegates();
+		a_spClient->SetTemplate( RequestTemplate::SP() );
 
 		if ( a_spClient->GetState() == CONNECTED )
 		{
@@ -163,7 +210,9 @@ public:
 		m_SendCount( 0 ),
 		m_RequestsSent( 0 ),
 		m_RetryAttempts( 0 ),
-		m_pResponse( NULL )
+		m_pResponse( NULL ),
+		m_fTracePhase( 0.0 ),
+		m_fCaptureStart( 0.0 )
 	{}
 
 	~WebClientT()
@@ -218,6 +267,16 @@ public:
 			m_Headers = a_Headers;
 	}
 
+	virtual void SetTemplate(const RequestTemplate::SP & a_spTemplate)
+	{
+		m_spTemplate = a_spTemplate;
+	}
+
+	virtual const RequestTemplate::SP & GetTemplate() const
+	{
+		return m_spTemplate;
+	}
+
 	virtual void SetRequestType(const std::string & a_ReqType)
 	{
 		m_RequestType = a_ReqType;
@@ -244,8 +303,17 @@ public:
 		if ( pService == NULL )
 			return false;		// this would only happen if we are in the middle of shutting down..
 
+		m_TraceContext = Trace::GetContext();
+		if ( m_TraceContext.IsValid() )
+			m_fTracePhase = Trace::Now();
+
 		bool bWebSocket = _stricmp( m_URL.GetProtocol().c_str(), "ws" ) == 0 
 			|| _stricmp( m_URL.GetProtocol().c_str(), "wss" ) == 0;
+
+		m_fCaptureStart = 0.0;
+		m_CaptureContent.clear();
+		if ( !bWebSocket && TrafficCapture::IsCapturing( TrafficCapture::SOURCE_WEB_CLIENT ) )
+			m_fCaptureStart = Trace::Now();
 		if ( m_eState != CONNECTED || !m_URL.CanUseConnection( m_ConnectedURL ) || bWebSocket )
 		{
 			m_WebSocket = bWebSocket;
@@ -384,6 +452,7 @@ protected:
 	{
 		WebClientService * pService = WebClientService::Instance();
 		assert( pService != NULL );
+		TracePhase( "io_queue" );
 
 		// resolve DNS first before we bother making the socket/stream objects..
 		boost::asio::ip::tcp::resolver::iterator i = boost::asio::ip::tcp::resolver::iterator();
@@ -401,6 +470,7 @@ protected:
 			i = boost::asio::ip::tcp::resolver::iterator();
 		}
 
+		TracePhase( "dns" );
 		if (i == boost::asio::ip::tcp::resolver::iterator())
 		{
 			Log::DebugLow("WebClientT", "Failed to resolve %s", m_URL.GetHost().c_str());
@@ -427,6 +497,7 @@ protected:
 	{
 		if (! error )
 		{
+			TracePhase( "connect" );
 			if (! StartHandshake() )
 			{
 				// no handshake needed for non-secure connections, go ahead and send the request
@@ -501,18 +572,28 @@ protected:
 
 		m_RequestsSent += 1;
 		m_eInternalState = SENDING_REQUEST;
+		TracePhase( "connected" );
 		m_LastRequest = m_Request;
 		m_ContentLen = 0;
 
 		std::string & req = m_Request;
-		if ( !m_WebSocket )
+		if ( m_spTemplate && (m_WebSocket || (m_spTemplate->m_Host.size() > 0 && m_spTemplate->m_Host != m_URL.GetHost())) )
 		{
-			if ( m_Headers.find( "Accept" ) == m_Headers.end() )
-				m_Headers["Accept"] = "*/*";
-			if ( m_Headers.find( "Host" ) == m_Headers.end() )
-				m_Headers["Host"] = m_URL.GetHost();
-			if ( m_Headers.find( "User-Agent") == m_Headers.end() )
-				m_Headers["User-Agent"] = "SelfWebClient";
+			// the template doesn't apply, merge its headers into ours..
+			Headers headers( m_spTemplate->m_Headers );
+			for( Headers::const_iterator iHeader = m_Headers.begin(); iHeader != m_Headers.end(); ++iHeader )
+				headers[iHeader->first] = iHeader->second;
+			m_Headers.swap( headers );
+			m_spTemplate.reset();
+		}
+
+		if ( m_spTemplate )
+		{
+			SerializeRequest( req );
+		}
+		else if ( !m_WebSocket )
+		{
+			AddDefaultHeaders( m_Headers, m_URL.GetHost() );
 			m_Headers["Connection"] = "Keep-Alive";			// change to close to avoid reusing connections
 			if ( sm_ClientId.size() > 0 )
 				m_Headers["ClientId"] = sm_ClientId;
@@ -566,11 +647,57 @@ protected:
 		sm_BytesSent += req.length();
 	}
 
+	//! Serialize the request from m_spTemplate, only the headers from SetHeaders() are serialized here.
+	void SerializeRequest( std::string & a_Request )
+	{
+		const std::string & endPoint = m_URL.GetEndPoint();
+		bool bBody = m_RequestType == "POST" || m_RequestType == "PUT";
+
+		a_Request.clear();
+		a_Request.reserve( m_RequestType.size() + endPoint.size() + m_spTemplate->m_Block.size() + 128 
+			+ sm_ClientId.size() + (bBody ? m_Body.size() : 0) );
+		a_Request += m_RequestType;
+		a_Request += " /";
+		a_Request += endPoint;
+		a_Request += " HTTP/1.1\r\n";
+
+		if ( m_Headers.empty() )
+			a_Request += m_spTemplate->m_Block;
+		else
+		{
+			const RequestTemplate::LineList & lines = m_spTemplate->m_Lines;
+			for(size_t i=0;i<lines.size();++i)
+				if ( m_Headers.find( lines[i].m_Key ) == m_Headers.end() )
+					a_Request += lines[i].m_Line;
+			for( Headers::const_iterator iHeader = m_Headers.begin(); iHeader != m_Headers.end(); ++iHeader )
+			{
+				if ( _stricmp( iHeader->first.c_str(), "Connection" ) == 0 
+					|| (sm_ClientId.size() > 0 && _stricmp( iHeader->first.c_str(), "ClientId" ) == 0) )
+					continue;
+				AppendHeader( a_Request, iHeader->first, iHeader->second );
+			}
+		}
+
+		a_Request += "Connection: Keep-Alive\r\n";
+		if ( sm_ClientId.size() > 0 )
+			AppendHeader( a_Request, "ClientId", sm_ClientId );
+		if ( bBody )
+		{
+			char length[32];
+			snprintf( length, sizeof(length), "Content-Length: %u\r\n", (unsigned int)m_Body.size() );
+			a_Request += length;
+		}
+		a_Request += "\r\n";		// blank line
+		if ( bBody )
+			a_Request += m_Body;
+	}
+
 	void HTTP_RequestSent( const boost::system::error_code& error,
 		size_t bytes_transferred)
 	{
 		if (!error) 
 		{
+			TracePhase( "send" );
 			// Read the response headers..
 			m_eInternalState = READING_RESPONSE;
 			boost::asio::async_read_until(*m_pSocket,
@@ -594,6 +721,8 @@ protected:
 		if (!error) 
 		{
 			sm_BytesRecv += bytes_transferred;
+			m_pResponse->m_HeaderTime = Time().GetEpochTime();
+			TracePhase( "first_byte" );
 			std::istream input( &m_RecvBuffer );
 			input >> m_pResponse->m_Version;
 			input >> m_pResponse->m_StatusCode;
@@ -738,9 +867,7 @@ protected:
 		{
 			// end of chunked content
 			m_pResponse->m_bDone = true;
-			ThreadPool::Instance()->InvokeOnMain<RequestData *>(
-				DELEGATE(WebClientT, OnResponse, RequestData *, shared_from_this()), m_pResponse);
-			m_pResponse = NULL;
+			QueueResponse();
 		}
 		else
 		{
@@ -830,8 +957,7 @@ protected:
 			{
 				// send the chunk, then go try to read the next chunk length..
 				RequestData * pNewReq = new RequestData( *m_pResponse );
-				ThreadPool::Instance()->InvokeOnMain<RequestData *>(
-					DELEGATE(WebClientT, OnResponse, RequestData *, shared_from_this()), m_pResponse);
+				QueueResponse();
 				m_pResponse = pNewReq;
 
 				// read the chunk ending...
@@ -840,17 +966,13 @@ protected:
 			else
 			{
 				m_pResponse->m_bDone = true;
-				ThreadPool::Instance()->InvokeOnMain<RequestData *>(
-					DELEGATE(WebClientT, OnResponse, RequestData *, shared_from_this()), m_pResponse);
-				m_pResponse = NULL;
+				QueueResponse();
 			}
 		}
 		else if ( error == boost::asio::error::eof )
 		{
 			m_pResponse->m_bDone = true;
-			ThreadPool::Instance()->InvokeOnMain<RequestData *>(
-				DELEGATE(WebClientT, OnResponse, RequestData *, shared_from_this()), m_pResponse);
-			m_pResponse = NULL;
+			QueueResponse();
 		}
 		else
 		{
@@ -1026,6 +1148,30 @@ protected:
 		delete pBuffer;
 	}
 
+	//! Queue m_pResponse to be passed to the data receiver on the main thread.
+	void QueueResponse()
+	{
+		if ( m_pResponse->m_bDone )
+			TracePhase( "receive" );
+
+		// queue in the trace of this request, so the main thread callbacks are part of it..
+		Trace::Scope scope( m_TraceContext );
+		ThreadPool::Instance()->InvokeOnMain<RequestData *>(
+			DELEGATE(WebClientT, OnResponse, RequestData *, shared_from_this()), m_pResponse);
+		m_pResponse = NULL;
+	}
+
+	//! Record the time since the last phase of the current request.
+	void TracePhase( const char * a_pPhase )
+	{
+		if (! m_TraceContext.IsValid() )
+			return;
+
+		double now = Trace::Now();
+		Trace::AddSpan( a_pPhase, "WebClient", m_fTracePhase, now, m_TraceContext, m_URL.GetHost() );
+		m_fTracePhase = now;
+	}
+
 	void OnResponse(RequestData * a_pData)
 	{
 		bool bClose = false;
@@ -1033,25 +1179,14 @@ protected:
 		if ( iConnection != a_pData->m_Headers.end() )
 			bClose = _stricmp( iConnection->second.c_str(), "close") == 0;
 
-	#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-		double startTime = Time().GetEpochTime();
-		const char * pFile = m_DataReceiver.GetFile();
-		int nLine = m_DataReceiver.GetLine();
-	#endif
+		if ( m_fCaptureStart > 0.0 )
+			Capture( a_pData );
+
 		if ( m_DataReceiver.IsValid() )
-			m_DataReceiver( a_pData );
-	#if defined(WARNING_DELEGATE_TIME) && defined(ERROR_DELEGATE_TIME)
-		double elapsed = Time().GetEpochTime() - startTime;
-		if(elapsed > WARNING_DELEGATE_TIME)
 		{
-			if ( elapsed > ERROR_DELEGATE_TIME )
-				Log::Error("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-					pFile, nLine, elapsed );
-			else
-				Log::Warning("ThreadPool", "Delegate %s:%d took %f seconds to invoke on main thread.", 
-					pFile, nLine, elapsed );
+			Profiler::Scope profile( m_DataReceiver.GetFile(), m_DataReceiver.GetLine() );
+			m_DataReceiver( a_pData );
 		}
-	#endif
 
 		// close the socket afterwards, only if 
 		if ( bClose && a_pData->m_bDone )
@@ -1060,6 +1195,29 @@ protected:
 		delete a_pData;
 	}
 
+	//! Collect the response for the traffic capture, the record is written once the response is done.
+	void Capture( RequestData * a_pData )
+	{
+		m_CaptureContent += a_pData->m_Content;
+		if (! a_pData->m_bDone )
+			return;
+
+		TrafficCapture::Record record;
+		record.m_eSource = TrafficCapture::SOURCE_WEB_CLIENT;
+		record.m_fTime = m_fCaptureStart;
+		record.m_fDuration = Trace::Now() - m_fCaptureStart;
+		record.m_nStatusCode = a_pData->m_StatusCode;
+		record.m_RequestType = m_RequestType;
+		record.m_URL = m_URL.GetURL();
+		record.m_RequestHeaders = GetRequestHeaders();
+		record.m_RequestBody = m_Body;
+		record.m_ResponseHeaders = a_pData->m_Headers;
+		record.m_ResponseBody.swap( m_CaptureContent );
+		TrafficCapture::Capture( record );
+
+		m_fCaptureStart = 0.0;
+	}
+
 	void OnWebSocketFrame( IWebSocket::Frame * a_pFrame )
 	{
 		FrameSP spFrame( a_pFrame );
@@ -1135,6 +1293,8 @@ protected:
 	URL				m_URL;					// URL we want to connect toos
 	URL				m_ConnectedURL;			// URL we are actually connected too
 	Headers			m_Headers;
+	RequestTemplate::SP
+					m_spTemplate;			// headers shared with other requests, sent before m_Headers
 	std::string		m_RequestType;
 	std::string		m_Body;
 
@@ -1156,6 +1316,10 @@ protected:
 	boost::asio::streambuf
 					m_RecvBuffer;			// response buffer
 	RequestData *	m_pResponse;			// response to our request
+	Trace::Context	m_TraceContext;			// trace of the request being sent
+	double			m_fTracePhase;			// time the current phase of the request started
+	double			m_fCaptureStart;		// time the request was sent if it's being captured, otherwise 0
+	std::string		m_CaptureContent;		// response content received so far for the capture
 	std::string		m_Incoming;				// received web socket data
 	BufferList		m_Pending;				// pending sends
 	BufferList		m_Send;					// send queue
@@ -1241,6 +1405,7 @@ protected:
 	{
 		if (! error )
 		{
+			TracePhase( "tls" );
 			ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE( WebClientT<SocketType>, OnConnected, shared_from_this() ) );
 		}
 		else
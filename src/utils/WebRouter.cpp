@@ -0,0 +1,252 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <string.h>
+
+#include "WebRouter.h"
+#include "StringUtil.h"
+#include "Log.h"
+
+WebRouter::Node::~Node()
+{
+	for (size_t i = 0; i < m_Children.size(); ++i)
+		delete m_Children[i];
+	delete m_pParam;
+	delete m_pWildcard;
+}
+
+WebRouter::WebRouter() : m_nRoutes(0)
+{}
+
+WebRouter::~WebRouter()
+{}
+
+bool WebRouter::IsCompilable(const std::string & a_EndPointMask)
+{
+	if (a_EndPointMask.find('?') != std::string::npos)
+		return false;
+	size_t nWild = a_EndPointMask.find('*');
+	return nWild == std::string::npos || nWild == a_EndPointMask.size() - 1;
+}
+
+void WebRouter::AddRoute(const std::string & a_Method, const std::string & a_EndPointMask, size_t a_RouteId)
+{
+	m_nRoutes += 1;
+	if (!IsCompilable(a_EndPointMask))
+	{
+		m_WildRoutes.push_back(WildRoute(a_Method, a_EndPointMask, a_RouteId));
+		return;
+	}
+
+	Node * pNode = &m_Root;
+	size_t i = 0;
+	while (i < a_EndPointMask.size())
+	{
+		if (a_EndPointMask[i] == ':' && i > 0 && a_EndPointMask[i - 1] == '/')
+		{
+			size_t nEnd = a_EndPointMask.find('/', i);
+			if (nEnd == std::string::npos)
+				nEnd = a_EndPointMask.size();
+
+			std::string name(a_EndPointMask.substr(i + 1, nEnd - i - 1));
+			if (pNode->m_pParam == NULL)
+			{
+				pNode->m_pParam = new Node();
+				pNode->m_ParamName = name;
+			}
+			else if (pNode->m_ParamName != name)
+			{
+				Log::Warning("WebRouter", "Parameter :%s in %s conflicts with :%s, using :%s.",
+					name.c_str(), a_EndPointMask.c_str(), pNode->m_ParamName.c_str(), pNode->m_ParamName.c_str());
+			}
+
+			pNode = pNode->m_pParam;
+			i = nEnd;
+		}
+		else if (a_EndPointMask[i] == '*')
+		{
+			if (pNode->m_pWildcard == NULL)
+				pNode->m_pWildcard = new Node();
+			pNode = pNode->m_pWildcard;
+			i += 1;
+		}
+		else
+		{
+			// find the end of this static text, a parameter must start a path segment
+			size_t nEnd = i;
+			while (nEnd < a_EndPointMask.size())
+			{
+				char c = a_EndPointMask[nEnd];
+				if (c == '*' || (c == ':' && nEnd > 0 && a_EndPointMask[nEnd - 1] == '/'))
+					break;
+				++nEnd;
+			}
+
+			pNode = InsertStatic(pNode, a_EndPointMask.c_str() + i, nEnd - i);
+			i = nEnd;
+		}
+	}
+
+	pNode->m_Handlers.push_back(Handler(a_Method, a_RouteId));
+}
+
+WebRouter::MatchResult WebRouter::Find(const std::string & a_Method, const std::string & a_EndPoint,
+	size_t & a_RouteId, Parameters & a_Parameters) const
+{
+	a_Parameters.clear();
+
+	MatchResult result = Match(&m_Root, a_Method, a_EndPoint.c_str(), a_EndPoint.size(), a_RouteId, a_Parameters);
+	if (result == MATCHED)
+		return MATCHED;
+
+	for (size_t i = 0; i < m_WildRoutes.size(); ++i)
+	{
+		const WildRoute & route = m_WildRoutes[i];
+		if (!StringUtil::WildMatch(route.m_EndPointMask.c_str(), a_EndPoint.c_str()))
+			continue;
+
+		if (route.m_Method.size() == 0 || route.m_Method == a_Method)
+		{
+			a_RouteId = route.m_RouteId;
+			return MATCHED;
+		}
+		result = METHOD_NOT_ALLOWED;
+	}
+
+	return result;
+}
+
+WebRouter::Node * WebRouter::InsertStatic(Node * a_pNode, const char * a_pText, size_t a_nLength)
+{
+	while (a_nLength > 0)
+	{
+		size_t nIndex = a_pNode->m_Indices.find(a_pText[0]);
+		if (nIndex == std::string::npos)
+		{
+			Node * pChild = new Node();
+			pChild->m_Prefix.assign(a_pText, a_nLength);
+			a_pNode->m_Indices += a_pText[0];
+			a_pNode->m_Children.push_back(pChild);
+			return pChild;
+		}
+
+		Node * pChild = a_pNode->m_Children[nIndex];
+
+		size_t nCommon = 0;
+		while (nCommon < a_nLength && nCommon < pChild->m_Prefix.size() && a_pText[nCommon] == pChild->m_Prefix[nCommon])
+			++nCommon;
+
+		if (nCommon < pChild->m_Prefix.size())
+		{
+			// split the child, the new node takes the common prefix..
+			Node * pSplit = new Node();
+			pSplit->m_Prefix = pChild->m_Prefix.substr(0, nCommon);
+			pChild->m_Prefix.erase(0, nCommon);
+			pSplit->m_Indices += pChild->m_Prefix[0];
+			pSplit->m_Children.push_back(pChild);
+
+			a_pNode->m_Children[nIndex] = pSplit;
+			pChild = pSplit;
+		}
+
+		a_pNode = pChild;
+		a_pText += nCommon;
+		a_nLength -= nCommon;
+	}
+
+	return a_pNode;
+}
+
+WebRouter::MatchResult WebRouter::SelectHandler(const HandlerList & a_Handlers, const std::string & a_Method, size_t & a_RouteId)
+{
+	if (a_Handlers.size() == 0)
+		return NOT_FOUND;
+
+	for (size_t i = 0; i < a_Handlers.size(); ++i)
+	{
+		const Handler & handler = a_Handlers[i];
+		if (handler.m_Method.size() == 0 || handler.m_Method == a_Method)
+		{
+			a_RouteId = handler.m_RouteId;
+			return MATCHED;
+		}
+	}
+
+	return METHOD_NOT_ALLOWED;
+}
+
+WebRouter::MatchResult WebRouter::Match(const Node * a_pNode, const std::string & a_Method, const char * a_pPath, size_t a_nLength,
+	size_t & a_RouteId, Parameters & a_Parameters)
+{
+	MatchResult result = NOT_FOUND;
+	MatchResult child = NOT_FOUND;
+
+	if (a_nLength == 0)
+	{
+		if ((result = SelectHandler(a_pNode->m_Handlers, a_Method, a_RouteId)) == MATCHED)
+			return MATCHED;
+		// a trailing wildcard also matches nothing, just like StringUtil::WildMatch()
+		if (a_pNode->m_pWildcard != NULL
+			&& (child = SelectHandler(a_pNode->m_pWildcard->m_Handlers, a_Method, a_RouteId)) != NOT_FOUND)
+			return child;
+		return result;
+	}
+
+	// static text first..
+	size_t nIndex = a_pNode->m_Indices.find(a_pPath[0]);
+	if (nIndex != std::string::npos)
+	{
+		const Node * pChild = a_pNode->m_Children[nIndex];
+		size_t nPrefix = pChild->m_Prefix.size();
+		if (nPrefix <= a_nLength && memcmp(a_pPath, pChild->m_Prefix.data(), nPrefix) == 0)
+		{
+			if ((child = Match(pChild, a_Method, a_pPath + nPrefix, a_nLength - nPrefix, a_RouteId, a_Parameters)) == MATCHED)
+				return MATCHED;
+			if (child == METHOD_NOT_ALLOWED)
+				result = child;
+		}
+	}
+
+	// then a named parameter, which consumes a single non-empty path segment..
+	if (a_pNode->m_pParam != NULL)
+	{
+		const char * pEnd = (const char *)memchr(a_pPath, '/', a_nLength);
+		size_t nSegment = pEnd != NULL ? (size_t)(pEnd - a_pPath) : a_nLength;
+		if (nSegment > 0)
+		{
+			std::string & value = a_Parameters[a_pNode->m_ParamName];
+			value.assign(a_pPath, nSegment);
+
+			if ((child = Match(a_pNode->m_pParam, a_Method, a_pPath + nSegment, a_nLength - nSegment, a_RouteId, a_Parameters)) == MATCHED)
+				return MATCHED;
+			if (child == METHOD_NOT_ALLOWED)
+				result = child;
+			a_Parameters.erase(a_pNode->m_ParamName);
+		}
+	}
+
+	// finally the trailing wildcard takes whatever is left..
+	if (a_pNode->m_pWildcard != NULL)
+	{
+		if ((child = SelectHandler(a_pNode->m_pWildcard->m_Handlers, a_Method, a_RouteId)) == MATCHED)
+			return MATCHED;
+		if (child == METHOD_NOT_ALLOWED)
+			result = child;
+	}
+
+	return result;
+}
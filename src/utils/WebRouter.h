@@ -0,0 +1,125 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_WEB_ROUTER_H
+#define WDC_WEB_ROUTER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+
+#include "WDCLib.h"		// include last always
+
+//! Compiled radix-tree router used by the web server to map a request end-point onto a registered route.
+//!
+//! Supported end-point masks:
+//!   /v1/things			.. static path
+//!   /v1/things/:id		.. named parameter, matches a single path segment
+//!   /v1/files/*			.. trailing wildcard, matches the rest of the path (including nothing)
+//!
+//! Any other mask containing '?' or a non-trailing '*' is matched with StringUtil::WildMatch() after the tree,
+//! in the order the routes were added. Static segments take priority over parameters, which take priority over
+//! a trailing wildcard. When more than one route is registered for the same mask, the lowest route ID wins.
+//!
+//! A router is not modified once it's been handed to another thread, lookups are const and take no locks.
+class WDC_API WebRouter : private boost::noncopyable
+{
+public:
+	//! Types
+	typedef std::map<std::string, std::string>		Parameters;
+
+	enum MatchResult
+	{
+		MATCHED,				// a route was found, a_RouteId is valid
+		NOT_FOUND,				// no route matches the end-point
+		METHOD_NOT_ALLOWED		// the end-point matches, but no route for the request method
+	};
+
+	//! Construction
+	WebRouter();
+	~WebRouter();
+
+	//! Accessors
+	size_t GetRouteCount() const
+	{
+		return m_nRoutes;
+	}
+
+	//! Add a route, a_Method may be empty to match any request method. The a_RouteId is returned by Find()
+	//! when this route is matched.
+	void AddRoute(const std::string & a_Method, const std::string & a_EndPointMask, size_t a_RouteId);
+	//! Find the route for the given request method and end-point, this doesn't allocate unless the
+	//! route has named parameters which are returned in a_Parameters.
+	MatchResult Find(const std::string & a_Method, const std::string & a_EndPoint,
+		size_t & a_RouteId, Parameters & a_Parameters) const;
+
+	//! Returns true if the given mask can be compiled into the tree.
+	static bool IsCompilable(const std::string & a_EndPointMask);
+
+private:
+	//! Types
+	struct Handler
+	{
+		Handler(const std::string & a_Method, size_t a_RouteId) : m_Method(a_Method), m_RouteId(a_RouteId)
+		{}
+
+		std::string			m_Method;
+		size_t				m_RouteId;
+	};
+	typedef std::vector<Handler>	HandlerList;
+
+	struct Node
+	{
+		Node() : m_pParam(NULL), m_pWildcard(NULL)
+		{}
+		~Node();
+
+		std::string			m_Prefix;			// static text consumed by this node
+		std::string			m_Indices;			// first character of each static child, in the same order as m_Children
+		std::vector<Node *>	m_Children;			// static children
+		Node *				m_pParam;			// child for a ":name" segment
+		std::string			m_ParamName;
+		Node *				m_pWildcard;		// child for a trailing "*"
+		HandlerList			m_Handlers;			// routes that end at this node
+	};
+
+	struct WildRoute
+	{
+		WildRoute(const std::string & a_Method, const std::string & a_EndPointMask, size_t a_RouteId) :
+			m_Method(a_Method), m_EndPointMask(a_EndPointMask), m_RouteId(a_RouteId)
+		{}
+
+		std::string			m_Method;
+		std::string			m_EndPointMask;
+		size_t				m_RouteId;
+	};
+	typedef std::vector<WildRoute>	WildRouteList;
+
+	//! Data
+	Node			m_Root;
+	WildRouteList	m_WildRoutes;			// routes that couldn't be compiled into the tree
+	size_t			m_nRoutes;
+
+	static Node * InsertStatic(Node * a_pNode, const char * a_pText, size_t a_nLength);
+	static MatchResult SelectHandler(const HandlerList & a_Handlers, const std::string & a_Method, size_t & a_RouteId);
+	static MatchResult Match(const Node * a_pNode, const std::string & a_Method, const char * a_pPath, size_t a_nLength,
+		size_t & a_RouteId, Parameters & a_Parameters);
+};
+
+#endif
@@ -16,6 +16,12 @@
 */
 
 #include <map>
+#include <stdio.h>
+#include <errno.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 
 #include "boost/asio.hpp"		
 #include "boost/thread.hpp"
@@ -30,9 +36,150 @@
 #include "WebSocketFramer.h"
 #include "Log.h"
 #include "SHA1.h"
+#include "Time.h"
 #include "IWebServer.h"
+#include "HttpRequestParser.h"
+#include "WebRouter.h"
 #include "WDCLib.h"		// include last always
 
+//! number of bytes we try to read from the socket at a time while receiving a request
+const size_t READ_SIZE = 8 * 1024;
+//! SendChunk() returns false once this many bytes are waiting to be sent
+const size_t SEND_HIGH_WATER = 256 * 1024;
+//! the drain handler is invoked once the queued bytes fall to this size
+const size_t SEND_LOW_WATER = 64 * 1024;
+//! number of bytes read from a file at a time when it can't be sent directly
+const size_t FILE_BLOCK_SIZE = 64 * 1024;
+//! number of seconds before we start checking the minimum read rate of a request
+const double MIN_READ_RATE_GRACE = 5.0;
+//! number of seconds between checks of the read rate of a request
+const double READ_RATE_INTERVAL = 1.0;
+
+//! Send part of a file directly to the socket, returns false if this isn't supported for the socket type
+//! in which case the caller has to read the file and send it like any other data.
+template<typename SOCKET, typename HANDLER>
+bool SendFileDirect(SOCKET &, FILE *, size_t &, size_t &, boost::system::error_code &, HANDLER)
+{
+	return false;
+}
+
+#if defined(__linux__)
+//! On Linux we can send the file from the page cache without copying it through user space. If the socket
+//! can't take any more bytes, a_OnWritable is invoked once it can.
+template<typename HANDLER>
+bool SendFileDirect(boost::asio::ip::tcp::socket & a_Socket, FILE * a_pFile, size_t & a_nOffset, size_t & a_nRemaining,
+	boost::system::error_code & a_Error, HANDLER a_OnWritable)
+{
+	// sendfile() mustn't block a thread of the io_service, the mode of the socket is restored before we return
+	bool bNonBlocking = a_Socket.native_non_blocking();
+	a_Socket.native_non_blocking(true, a_Error);
+	while (!a_Error && a_nRemaining > 0)
+	{
+		off_t offset = (off_t)a_nOffset;
+		ssize_t nSent = ::sendfile(a_Socket.native_handle(), fileno(a_pFile), &offset, a_nRemaining);
+		if (nSent > 0)
+		{
+			a_nOffset += (size_t)nSent;
+			a_nRemaining -= (size_t)nSent;
+		}
+		else if (nSent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			a_Socket.async_write_some(boost::asio::null_buffers(), a_OnWritable);
+			break;
+		}
+		else if (nSent == 0)
+			a_Error = boost::asio::error::eof;		// the file is shorter than when we opened it
+		else if (errno != EINTR)
+			a_Error = boost::system::error_code(errno, boost::asio::error::get_system_category());
+	}
+
+	if (!bNonBlocking)
+	{
+		boost::system::error_code ec;
+		a_Socket.native_non_blocking(false, ec);
+	}
+	return true;
+}
+#endif
+
+//! Counters shared between the server and its connections, a connection may outlive the server.
+struct WebServerStats
+{
+	WebServerStats() : m_nActiveRequests(0), m_nConnections(0), m_nQueuedOnMain(0),
+		m_fLastMainDispatch(0.0), m_fMainLatency(0.0)
+	{}
+
+	//! Types
+	typedef boost::shared_ptr<WebServerStats>	SP;
+	typedef std::map<std::string, int>			OriginMap;
+
+	boost::atomic<int>	m_nActiveRequests;		// number of requests waiting on a response
+	boost::mutex		m_Lock;					// protects everything below
+	int					m_nConnections;
+	OriginMap			m_Origins;				// number of connections from each remote address
+	int					m_nQueuedOnMain;		// requests queued for the main thread
+	double				m_fLastMainDispatch;	// time the main thread last took a request
+	double				m_fMainLatency;			// time the last request waited on the main thread
+};
+
+//! A request queued for the main thread, this measures how long requests wait on the main thread.
+//! It only holds onto the stats so it's safe to invoke after the server is gone. The delegate holds
+//! a copy of this object, so it's freed along with the delegate.
+struct WebServerDispatch
+{
+	//! Counts the request in m_nQueuedOnMain until it's taken by the main thread, or until the last copy of
+	//! the delegate is dropped without being invoked, e.g. when the main queue is cleared.
+	struct Queued
+	{
+		typedef boost::shared_ptr<Queued>		SP;
+
+		Queued(const WebServerStats::SP & a_spStats) : m_spStats(a_spStats), m_fQueued(Time().GetEpochTime()), m_bTaken(false)
+		{
+			boost::mutex::scoped_lock lock(m_spStats->m_Lock);
+			if (m_spStats->m_nQueuedOnMain++ == 0)
+				m_spStats->m_fLastMainDispatch = m_fQueued;		// don't count the time the queue was empty
+		}
+		~Queued()
+		{
+			if (!m_bTaken)
+			{
+				boost::mutex::scoped_lock lock(m_spStats->m_Lock);
+				m_spStats->m_nQueuedOnMain -= 1;
+			}
+		}
+
+		void Take()
+		{
+			double fNow = Time().GetEpochTime();
+			boost::mutex::scoped_lock lock(m_spStats->m_Lock);
+			m_spStats->m_nQueuedOnMain -= 1;
+			m_spStats->m_fLastMainDispatch = fNow;
+			m_spStats->m_fMainLatency = fNow - m_fQueued;
+			m_bTaken = true;
+		}
+
+		WebServerStats::SP		m_spStats;
+		double					m_fQueued;
+		bool					m_bTaken;
+	};
+
+	WebServerDispatch(const WebServerStats::SP & a_spStats, Delegate<IWebServer::RequestSP> a_Handler,
+		IWebServer::RequestSP a_spRequest) :
+		m_spQueued(new Queued(a_spStats)), m_Handler(a_Handler), m_spRequest(a_spRequest)
+	{}
+
+	void operator()()
+	{
+		m_spQueued->Take();
+		m_Handler(m_spRequest);
+	}
+
+	Queued::SP				m_spQueued;
+	Delegate<IWebServer::RequestSP>
+							m_Handler;
+	IWebServer::RequestSP	m_spRequest;
+};
+
 //! Server class for handling incoming REST requests and WebSocket connections. 
 template<typename socket_type>
 class WDC_API WebServerT : public IWebServer
@@ -43,6 +190,8 @@ public:
 	typedef boost::asio::streambuf						StreamBuffer;
 	typedef boost::shared_ptr<StreamBuffer>				StreamBufferSP;
 	typedef boost::recursive_mutex						Mutex;
+	typedef WebServerStats								Stats;
+	typedef WebServerStats::SP							StatsSP;
 
 	//! This class handles a single connection to a client. The request handler
 	//! may use this class to send back responses.
@@ -57,14 +206,43 @@ public:
 		Connection(WebServerT * a_pServer, socket_type * a_pSocket) :
 			m_bClosed(false),
 			m_bWebSocket(false),
+			m_bCloseOnSent(false),
+			m_bKeepAlive(false),
+			m_bHTTP11(true),
+			m_bResponseKeepAlive(false),
+			m_bChunkedResponse(false),
+			m_bWaitingDrain(false),
+			m_bIdle(false),
+			m_bInRequest(false),
+			m_nRequests(0),
 			m_pServer(a_pServer),
 			m_pSocket(a_pSocket),
-			m_ReadBuffer(new StreamBuffer())
+			m_nSendQueued(0),
+			m_pFile(NULL),
+			m_nFileOffset(0),
+			m_nFileRemaining(0),
+			m_ReadBuffer(new StreamBuffer()),
+			m_bAdmitted(false),
+			m_fRequestStart(0.0),
+			m_spStats(a_pServer->m_spStats),
+			m_ReadRateTimer(a_pServer->m_Service),
+			m_nMinReadRate(0),
+			m_bReadRateDropped(false),
+			m_nRequestBytes(0)
 		{}
 		virtual ~Connection()
 		{
 			Close();
 
+			if (m_bAdmitted)
+			{
+				boost::mutex::scoped_lock lock(m_spStats->m_Lock);
+				m_spStats->m_nConnections -= 1;
+				Stats::OriginMap::iterator iOrigin = m_spStats->m_Origins.find(m_Origin);
+				if (iOrigin != m_spStats->m_Origins.end() && --iOrigin->second <= 0)
+					m_spStats->m_Origins.erase(iOrigin);
+			}
+
 			delete m_pSocket;
 		}
 
@@ -77,6 +255,81 @@ public:
 		{
 			return m_ReadBuffer;
 		}
+		HttpRequestParser & GetParser()
+		{
+			return m_Parser;
+		}
+		bool IsIdle() const
+		{
+			return m_bIdle;
+		}
+		int GetRequestCount() const
+		{
+			return m_nRequests;
+		}
+		const std::string & GetOrigin() const
+		{
+			return m_Origin;
+		}
+		double GetRequestStart() const
+		{
+			return m_fRequestStart;
+		}
+
+		//! Mutators
+		void SetIdle(bool a_bIdle)
+		{
+			m_bIdle = a_bIdle;
+		}
+		void SetRequestStart(double a_fTime)
+		{
+			m_fRequestStart = a_fTime;
+		}
+		//! Set the number of bytes of the current request received so far.
+		void SetRequestBytes(size_t a_nBytes)
+		{
+			m_nRequestBytes = a_nBytes;
+		}
+
+		//! Count this connection against the server limits, returns false if the server has too many connections
+		//! already or too many from this remote address.
+		bool Admit(int a_nMaxConnections, int a_nMaxPerOrigin)
+		{
+			boost::system::error_code ec;
+			m_Origin = m_pSocket->lowest_layer().remote_endpoint(ec).address().to_string();
+
+			boost::mutex::scoped_lock lock(m_spStats->m_Lock);
+			if (a_nMaxConnections > 0 && m_spStats->m_nConnections >= a_nMaxConnections)
+				return false;
+			int & nOrigin = m_spStats->m_Origins[m_Origin];
+			if (a_nMaxPerOrigin > 0 && nOrigin >= a_nMaxPerOrigin)
+			{
+				if (nOrigin == 0)
+					m_spStats->m_Origins.erase(m_Origin);
+				return false;
+			}
+
+			nOrigin += 1;
+			m_spStats->m_nConnections += 1;
+			m_bAdmitted = true;
+			return true;
+		}
+
+		//! Called by the server before a request is handed to the end-point, a_bKeepAlive is
+		//! true if the connection may be re-used once the response has been sent.
+		void BeginRequest(bool a_bKeepAlive, bool a_bHTTP11)
+		{
+			m_nRequests += 1;
+			m_bKeepAlive = a_bKeepAlive;
+			m_bHTTP11 = a_bHTTP11;
+			if (!m_bInRequest.exchange(true))
+				++m_spStats->m_nActiveRequests;
+		}
+		void EndRequest()
+		{
+			if (m_bInRequest.exchange(false))
+				--m_spStats->m_nActiveRequests;
+		}
 
 		//! Start a timeout for this connection, if cancel() is not called on the returned timer
 		//! before it fires, then this socket will be closed automatically.
@@ -86,9 +339,34 @@ public:
 			if (pPool != NULL)
 				m_spTimeoutTimer = pPool->StartTimer(VOID_DELEGATE(Connection, OnTimeout, this), a_fSeconds, true, false);
 		}
-		void CancelTimeout()
+		//! Drop the client if it sends the current request slower than a_nMinReadRate bytes per second once
+		//! MIN_READ_RATE_GRACE has passed. This is checked on a timer of our io_service so a client that stops
+		//! sending is caught too, even when the main thread is too busy to run timers.
+		void StartReadRateCheck(size_t a_nMinReadRate)
+		{
+			boost::mutex::scoped_lock lock(m_ReadRateLock);
+			m_nMinReadRate = a_nMinReadRate;
+			m_bReadRateDropped = false;
+			m_nRequestBytes = 0;
+			if (a_nMinReadRate > 0)
+				WaitReadRate();
+		}
+		//! Stop checking the read rate, returns false if the client has already been dropped for
+		//! sending too slowly, in which case the request must not be processed.
+		bool StopReadRateCheck()
+		{
+			boost::mutex::scoped_lock lock(m_ReadRateLock);
+			m_nMinReadRate = 0;
+
+			boost::system::error_code ec;
+			m_ReadRateTimer.cancel(ec);
+			return !m_bReadRateDropped;
+		}
+		//! Stop the timeout & the read rate check, returns false if the client was dropped for sending too slowly.
+		bool CancelTimeout()
 		{
 			m_spTimeoutTimer.reset();
+			return StopReadRateCheck();
 		}
 
 		//! IWebSocket interface
@@ -165,6 +443,9 @@ public:
 					m_bWebSocket = false;
 				}
 
+				EndRequest();
+				CloseFile();
+
 				try {
 					m_pSocket->lowest_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_both);
 					m_pSocket->lowest_layer().close();
@@ -179,13 +460,11 @@ public:
 
 		virtual void SendAsync(const std::string & a_Send)
 		{
-			m_SendLock.lock();
-			bool bSend = m_Sending.begin() == m_Sending.end();
-			m_Sending.push_back( a_Send );
-			m_SendLock.unlock();
-
-			if ( bSend )
-				OnSend();
+			std::string send(a_Send);
+			QueueSend(send);
+			// raw data sent while handling a request is the response, the connection isn't re-used
+			// since we can't tell where that response ends.
+			EndRequest();
 		}
 
 		virtual void ReadAsync(size_t a_Bytes, Delegate< std::string * > a_ReadCallback)
@@ -207,30 +486,117 @@ public:
 		}
 
 		virtual void SendResponse(int a_nStatusCode, const std::string & a_Reply, const Headers & a_Headers,
-			const std::string & a_Content, bool a_bClose = true)
+			const std::string & a_Content, bool a_bClose = false)
 		{
-			std::string response(StringUtil::Format("HTTP/1.1 %d %s\r\n", a_nStatusCode, a_Reply.c_str()));
-			for (typename Headers::const_iterator iHeader = a_Headers.begin(); iHeader != a_Headers.end(); ++iHeader)
-				response += iHeader->first + " : " + iHeader->second + "\r\n";
-			response += "\r\n";
-			if (a_Content.size() > 0)
-				response += a_Content;
+			m_bResponseKeepAlive = IsKeepAlive(a_bClose);
 
-			SendAsync(response);
-			if (a_bClose)
-				Close();
+			std::string response;
+			CreateHeader(response, a_nStatusCode, a_Reply, a_Headers, (long)a_Content.size());
+			response += a_Content;
+
+			QueueSend(response);
+			FinishResponse();
 		}
 
 		virtual void SendResponse(int a_nStatusCode, const std::string & a_Reply,
-			const std::string & a_Content, bool a_bClose = true)
+			const std::string & a_Content, bool a_bClose = false)
+		{
+			SendResponse(a_nStatusCode, a_Reply, Headers(), a_Content, a_bClose);
+		}
+
+		virtual void BeginChunkedResponse(int a_nStatusCode, const std::string & a_Reply, const Headers & a_Headers)
 		{
-			std::string response(StringUtil::Format("HTTP/1.1 %d %s\r\n\r\n", a_nStatusCode, a_Reply.c_str()));
-			if (a_Content.size() > 0)
-				response += a_Content;
+			// a HTTP/1.0 client doesn't understand chunks, so we send the body as is and close when done.
+			m_bChunkedResponse = m_bHTTP11;
+			m_bResponseKeepAlive = m_bHTTP11 && IsKeepAlive(false);
+
+			std::string header;
+			CreateHeader(header, a_nStatusCode, a_Reply, a_Headers, m_bChunkedResponse ? -1 : -2);
+			QueueSend(header);
+		}
 
-			SendAsync(response);
+		virtual bool SendChunk(const std::string & a_Chunk)
+		{
+			if (a_Chunk.size() > 0)
+			{
+				std::string chunk;
+				if (m_bChunkedResponse)
+				{
+					chunk.reserve(a_Chunk.size() + 16);
+					chunk = StringUtil::Format("%x\r\n", (unsigned int)a_Chunk.size());
+					chunk += a_Chunk;
+					chunk += "\r\n";
+				}
+				else
+					chunk = a_Chunk;
+				QueueSend(chunk);
+			}
+
+			m_SendLock.lock();
+			bool bAccepting = m_nSendQueued < SEND_HIGH_WATER;
+			if (!bAccepting)
+				m_bWaitingDrain = true;
+			m_SendLock.unlock();
+
+			return bAccepting;
+		}
+
+		virtual void EndChunkedResponse(bool a_bClose = false)
+		{
+			if (m_bChunkedResponse)
+			{
+				std::string end("0\r\n\r\n");
+				QueueSend(end);
+			}
 			if (a_bClose)
-				Close();
+				m_bResponseKeepAlive = false;
+			FinishResponse();
+		}
+
+		virtual bool SendFile(int a_nStatusCode, const std::string & a_Reply, const Headers & a_Headers,
+			const std::string & a_FilePath, bool a_bClose = false)
+		{
+			FILE * pFile = fopen(a_FilePath.c_str(), "rb");
+			if (pFile == NULL)
+			{
+				Log::Error("Connection", "Failed to open %s for sending.", a_FilePath.c_str());
+				return false;
+			}
+
+			long nSize = -1;
+			if (fseek(pFile, 0, SEEK_END) == 0)
+				nSize = ftell(pFile);
+			if (nSize < 0 || fseek(pFile, 0, SEEK_SET) != 0)
+			{
+				Log::Error("Connection", "Failed to find the size of %s.", a_FilePath.c_str());
+				fclose(pFile);
+				return false;
+			}
+
+			m_bResponseKeepAlive = IsKeepAlive(a_bClose);
+
+			std::string header;
+			CreateHeader(header, a_nStatusCode, a_Reply, a_Headers, nSize);
+
+			// set the file before we queue the header, the header may be sent before QueueSend() returns..
+			m_SendLock.lock();
+			m_pFile = pFile;
+			m_nFileOffset = 0;
+			m_nFileRemaining = (size_t)nSize;
+			m_SendLock.unlock();
+
+			QueueSend(header);
+			return true;
+		}
+
+		virtual void SetDrainHandler(Delegate<IConnection::SP> a_Handler)
+		{
+			m_OnDrain = a_Handler;
+		}
+
+		virtual size_t GetSendQueued() const
+		{
+			return m_nSendQueued;
 		}
 
 		virtual void StartWebSocket(const std::string & a_WebSocketKey)
@@ -245,9 +611,11 @@ public:
 			output << "Sec-WebSocket-Accept: " << StringUtil::EncodeBase64(sha1) << "\r\n";
 			output << "\r\n";
 
-			SendAsync( output.str() );
+			std::string handshake(output.str());
+			QueueSend(handshake);
 
 			m_bWebSocket = true;
+			EndRequest();
 
 			// start reading data for this web-socket, we pass the shared_pointer for this connection
 			// which will keep this socket open until a read-fails or the user calls close.
@@ -269,6 +637,18 @@ public:
 		//! Data
 		bool			m_bClosed;
 		bool			m_bWebSocket;
+		bool			m_bCloseOnSent;			// close once m_Sending is empty
+		bool			m_bKeepAlive;			// true if the current request allows keep-alive
+		bool			m_bHTTP11;				// true if the current request is HTTP/1.1
+		bool			m_bResponseKeepAlive;	// true if we told the client the connection is kept open
+		bool			m_bChunkedResponse;
+		bool			m_bWaitingDrain;		// true when SendChunk() has returned false
+		bool			m_bIdle;				// true while waiting on the next request of a persistent connection
+		boost::atomic<bool>
+						m_bInRequest;			// true while a request is waiting on a response
+		int				m_nRequests;			// number of requests received on this connection
+		Delegate<IConnection::SP>
+						m_OnDrain;
 		std::string		m_Incoming;
 		FrameList		m_Frames;
 		Delegate<FrameSP>
@@ -282,9 +662,27 @@ public:
 		boost::recursive_mutex
 						m_SendLock;
 		SendList		m_Sending;
+		size_t			m_nSendQueued;			// bytes in m_Sending
+		FILE *			m_pFile;				// file to send once m_Sending is empty
+		size_t			m_nFileOffset;
+		size_t			m_nFileRemaining;
 		StreamBufferSP	m_ReadBuffer;
+		HttpRequestParser
+						m_Parser;
+		bool			m_bAdmitted;			// true if this connection is counted in m_spStats
+		std::string		m_Origin;				// remote address of the client
+		boost::atomic<double>
+						m_fRequestStart;		// time we started receiving the current request
+		StatsSP			m_spStats;				// shared with the server, so we never touch the server once it's gone
 		TimerPool::ITimer::SP
 						m_spTimeoutTimer;
+		boost::mutex	m_ReadRateLock;			// guards the read rate timer & the members below
+		boost::asio::deadline_timer
+						m_ReadRateTimer;
+		size_t			m_nMinReadRate;			// min bytes per second for the current request, 0 for no minimum
+		bool			m_bReadRateDropped;		// true if we sent a 408 for the current request
+		boost::atomic<size_t>
+						m_nRequestBytes;		// bytes of the current request received so far
 
 		void OnReadWS(const boost::system::error_code& ec)
 		{
@@ -363,19 +761,146 @@ public:
 				OnError( boost::system::error_code() );
 			}
 		}
+		//! Queue data to send, the contents of a_Send are taken without copying them.
+		void QueueSend(std::string & a_Send)
+		{
+			m_SendLock.lock();
+			bool bSend = m_Sending.begin() == m_Sending.end();
+			m_Sending.push_back( std::string() );
+			m_Sending.back().swap( a_Send );
+			m_nSendQueued += m_Sending.back().size();
+			m_SendLock.unlock();
+
+			if ( bSend )
+				OnSend();
+		}
+
+		bool IsKeepAlive(bool a_bClose) const
+		{
+			return !a_bClose && m_bKeepAlive && !m_pServer->IsStopping();
+		}
+
+		//! Create the status line & headers for a response, a_nContentLength is -1 for a chunked
+		//! response or -2 if the body ends when the connection is closed.
+		void CreateHeader(std::string & a_Header, int a_nStatusCode, const std::string & a_Reply,
+			const Headers & a_Headers, long a_nContentLength)
+		{
+			a_Header = StringUtil::Format("HTTP/1.1 %d %s\r\n", a_nStatusCode, a_Reply.c_str());
+			for (typename Headers::const_iterator iHeader = a_Headers.begin(); iHeader != a_Headers.end(); ++iHeader)
+				a_Header += iHeader->first + ": " + iHeader->second + "\r\n";
+			// the client needs to know where the body ends to use a persistent connection
+			if (a_nContentLength == -1)
+				a_Header += "Transfer-Encoding: chunked\r\n";
+			else if (a_nContentLength >= 0 && a_Headers.find("Content-Length") == a_Headers.end())
+				a_Header += StringUtil::Format("Content-Length: %ld\r\n", a_nContentLength);
+			if (a_Headers.find("Connection") == a_Headers.end())
+				a_Header += m_bResponseKeepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+			a_Header += "\r\n";
+		}
+
+		//! The response has been queued, read the next request or close this connection.
+		void FinishResponse()
+		{
+			EndRequest();
+			if (m_bResponseKeepAlive)
+				m_pServer->ReadRequest(shared_from_this(), true);
+			else
+				CloseOnSent();
+		}
+
+		void SendFileBlock()
+		{
+			boost::system::error_code ec;
+			if (SendFileDirect(*m_pSocket, m_pFile, m_nFileOffset, m_nFileRemaining, ec,
+				boost::bind(&Connection::OnFileWritable, shared_from_this(), boost::asio::placeholders::error)))
+			{
+				if (ec)
+				{
+					Log::Error("Connection", "Failed to send file: %s", ec.message().c_str());
+					CloseFile();
+					OnError(ec);
+				}
+				else if (m_nFileRemaining == 0)
+				{
+					CloseFile();
+					FinishResponse();
+				}
+				return;
+			}
+
+			if (m_nFileRemaining == 0)
+			{
+				CloseFile();
+				FinishResponse();
+				return;
+			}
+
+			// read the next block and send it like any other data, OnSent() will call us again once it's sent
+			std::string block;
+			block.resize(m_nFileRemaining < FILE_BLOCK_SIZE ? m_nFileRemaining : FILE_BLOCK_SIZE);
+			size_t nRead = fread(&block[0], 1, block.size(), m_pFile);
+			if (nRead == 0)
+			{
+				Log::Error("Connection", "Failed to read file.");
+				CloseFile();
+				Close();
+				return;
+			}
+
+			block.resize(nRead);
+			m_nFileOffset += nRead;
+			m_nFileRemaining -= nRead;
+			QueueSend(block);
+		}
+
+		void OnFileWritable(const boost::system::error_code & ec)
+		{
+			if (!ec)
+				SendFileBlock();
+			else
+			{
+				CloseFile();
+				OnError(ec);
+			}
+		}
+
+		void CloseFile()
+		{
+			m_SendLock.lock();
+			FILE * pFile = m_pFile;
+			m_pFile = NULL;
+			m_SendLock.unlock();
+
+			if (pFile != NULL)
+				fclose(pFile);
+		}
+
 		void OnSent(const boost::system::error_code & ec)
 		{
 			m_SendLock.lock();
 
+			m_nSendQueued -= m_Sending.front().size();
 			m_Sending.pop_front();
 			bool bSend = m_Sending.begin() != m_Sending.end();
+			bool bFile = !bSend && m_pFile != NULL;
+			bool bClose = !bSend && !bFile && m_bCloseOnSent;
+			bool bDrained = m_bWaitingDrain && m_nSendQueued <= SEND_LOW_WATER;
+			if (bDrained)
+				m_bWaitingDrain = false;
 
 			m_SendLock.unlock();
 
 			if (!ec)
 			{
+				if ( bDrained && m_OnDrain.IsValid() )
+					ThreadPool::Instance()->InvokeOnMain<IConnection::SP>( m_OnDrain, shared_from_this() );
+
 				if ( bSend )
 					OnSend();
+				else if ( bFile )
+					SendFileBlock();
+				else if ( bClose )
+					Close();
 			}
 			else
 			{
@@ -383,6 +908,18 @@ public:
 			}
 		}
 
+		//! Close this connection once everything queued has been sent.
+		void CloseOnSent()
+		{
+			m_SendLock.lock();
+			bool bClose = m_Sending.begin() == m_Sending.end() && m_pFile == NULL;
+			m_bCloseOnSent = true;
+			m_SendLock.unlock();
+
+			if (bClose)
+				Close();
+		}
+
 		void OnError(const boost::system::error_code & ec)
 		{
 			if (m_OnError.IsValid())
@@ -400,6 +937,41 @@ public:
 			Log::Debug("Connection", "OnTimeout()");
 			Close();
 		}
+
+		//! Wait for the next check of the read rate, m_ReadRateLock must be locked.
+		void WaitReadRate()
+		{
+			m_ReadRateTimer.expires_from_now(boost::posix_time::milliseconds((long)(READ_RATE_INTERVAL * 1000.0)));
+			m_ReadRateTimer.async_wait(boost::bind(&Connection::OnReadRateTimer,
+				boost::static_pointer_cast<Connection>(shared_from_this()), boost::asio::placeholders::error));
+		}
+
+		void OnReadRateTimer(const boost::system::error_code & ec)
+		{
+			if (ec)
+				return;
+
+			double fElapsed = Time().GetEpochTime() - m_fRequestStart;
+			size_t nBytes = m_nRequestBytes;
+			{
+				// the check may have been stopped after the timer fired..
+				boost::mutex::scoped_lock lock(m_ReadRateLock);
+				if (m_nMinReadRate == 0)
+					return;
+				if (fElapsed <= MIN_READ_RATE_GRACE || nBytes >= (size_t)(fElapsed * m_nMinReadRate))
+				{
+					WaitReadRate();
+					return;
+				}
+
+				m_nMinReadRate = 0;
+				m_bReadRateDropped = true;
+			}
+
+			Log::Warning("WebServer", "Dropping slow client %s, %u bytes in %.1f seconds.",
+				m_Origin.c_str(), (unsigned int)nBytes, fElapsed);
+			SendResponse(408, "Request Timeout", std::string(), true);
+		}
 	};
 
 	WebServerT(const std::string & a_Interface = std::string(),
@@ -409,6 +981,18 @@ public:
 		m_nPort(a_nPort),
 		m_nThreads(a_nThreads),
 		m_fRequestTimeout(a_fRequestTimeout),
+		m_fIdleTimeout(5.0f),
+		m_nMaxRequests(100),
+		m_fDrainTimeout(5.0f),
+		m_bStopping(false),
+		m_nMaxConnections(1024),
+		m_nMaxPerOrigin(64),
+		m_nMaxHeaderSize(64 * 1024),
+		m_nMaxBodySize(16 * 1024 * 1024),
+		m_nMinReadRate(128),
+		m_fMaxQueueLatency(5.0f),
+		m_nRetryAfter(1),
+		m_spStats(new Stats()),
 		m_pWork(NULL)
 	{}
 
@@ -417,11 +1001,48 @@ public:
 		Stop();
 	}
 
+	//! Accessors
+	bool IsStopping() const
+	{
+		return m_bStopping;
+	}
+
 	//! IWebServer interface
+	virtual void SetKeepAlive(float a_fIdleTimeout, int a_nMaxRequests)
+	{
+		m_fIdleTimeout = a_fIdleTimeout;
+		m_nMaxRequests = a_nMaxRequests;
+	}
+
+	virtual void SetDrainTimeout(float a_fDrainTimeout)
+	{
+		m_fDrainTimeout = a_fDrainTimeout;
+	}
+
+	virtual void SetConnectionLimits(int a_nMaxConnections, int a_nMaxPerOrigin)
+	{
+		m_nMaxConnections = a_nMaxConnections;
+		m_nMaxPerOrigin = a_nMaxPerOrigin;
+	}
+
+	virtual void SetRequestLimits(size_t a_nMaxHeaderSize, size_t a_nMaxBodySize, size_t a_nMinReadRate)
+	{
+		m_nMaxHeaderSize = a_nMaxHeaderSize;
+		m_nMaxBodySize = a_nMaxBodySize;
+		m_nMinReadRate = a_nMinReadRate;
+	}
+
+	virtual void SetLoadShedding(float a_fMaxQueueLatency, int a_nRetryAfter)
+	{
+		m_fMaxQueueLatency = a_fMaxQueueLatency;
+		m_nRetryAfter = a_nRetryAfter;
+	}
+
 	virtual bool Start()
 	{
 		if (m_pWork != NULL)
 			return false;
+		m_bStopping = false;
 
 		if (m_Service.stopped())
 			m_Service.reset();
@@ -465,13 +1086,9 @@ public:
 		delete m_pWork;
 		m_pWork = NULL;
 
-		// wait for all the threads to exit..
-		m_Service.stop();
-		for (ThreadList::iterator iThread = m_Threads.begin(); iThread != m_Threads.end(); ++iThread)
-			(*iThread)->join();
-		m_Threads.clear();
-
-		// unbind the port
+		// stop accepting new connections, then give any requests in progress a chance to send their
+		// response. Responses sent while stopping close the connection instead of keeping it alive.
+		m_bStopping = true;
 		try {
 			m_Acceptor.close();
 		}
@@ -480,6 +1097,26 @@ public:
 			Log::Warning( "WebServer", "Caught Exception: %s", ex.what() );
 		}
 
+		// end-points run on the main thread, so when we are stopped on it keep processing it while we wait or
+		// they can never respond. On any other thread we just wait, the main thread invokes them as usual.
+		ThreadPool * pPool = ThreadPool::Instance();
+		bool bProcessMain = pPool != NULL && pPool->IsMainThread();
+		Time start;
+		while (m_spStats->m_nActiveRequests > 0 && (Time().GetEpochTime() - start.GetEpochTime()) < m_fDrainTimeout)
+		{
+			if (bProcessMain)
+				pPool->ProcessMainThread();
+			boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+		}
+		if (m_spStats->m_nActiveRequests > 0)
+			Log::Warning("WebServer", "Stopping with %d requests still active.", (int)m_spStats->m_nActiveRequests);
+
+		// wait for all the threads to exit..
+		m_Service.stop();
+		for (ThreadList::iterator iThread = m_Threads.begin(); iThread != m_Threads.end(); ++iThread)
+			(*iThread)->join();
+		m_Threads.clear();
+
 		return true;
 	}
 
@@ -490,9 +1127,18 @@ public:
 	virtual void AddEndpoint(const std::string & a_EndPointMask,
 		Delegate<RequestSP> a_RequestHandler,
 		bool a_bInvokeOnMain = true)
+	{
+		AddEndpoint(std::string(), a_EndPointMask, a_RequestHandler, a_bInvokeOnMain);
+	}
+
+	virtual void AddEndpoint(const std::string & a_RequestType,
+		const std::string & a_EndPointMask,
+		Delegate<RequestSP> a_RequestHandler,
+		bool a_bInvokeOnMain = true)
 	{
 		boost::lock_guard<Mutex> lock(m_EndPointLock);
-		m_EndPoints.push_back(EndPoint(a_EndPointMask, a_RequestHandler, a_bInvokeOnMain));
+		m_EndPoints.push_back(EndPoint(a_RequestType, a_EndPointMask, a_RequestHandler, a_bInvokeOnMain));
+		CompileRoutes();
 	}
 
 	//! Remove a register end-point.
@@ -503,6 +1149,20 @@ public:
 			if ((*iEndPoint).m_EndPointMask == a_EndPointMask)
 			{
 				m_EndPoints.erase(iEndPoint);
+				CompileRoutes();
+				return true;
+			}
+		return false;
+	}
+
+	virtual bool RemoveEndpoint(const std::string & a_RequestType, const std::string & a_EndPointMask)
+	{
+		boost::lock_guard<Mutex> lock(m_EndPointLock);
+		for (typename EndPointList::iterator iEndPoint = m_EndPoints.begin(); iEndPoint != m_EndPoints.end(); ++iEndPoint)
+			if ((*iEndPoint).m_RequestType == a_RequestType && (*iEndPoint).m_EndPointMask == a_EndPointMask)
+			{
+				m_EndPoints.erase(iEndPoint);
+				CompileRoutes();
 				return true;
 			}
 		return false;
@@ -510,9 +1170,16 @@ public:
 
 	void OnAccepted(ConnectionSP a_spConnection, const boost::system::error_code & ec)
 	{
+		if (m_bStopping)
+			return;				// the acceptor has been closed
 		Accept();		// start accepting the next connection already..
 		if (!ec)
-			ReadRequest(a_spConnection);
+		{
+			if (AdmitConnection(a_spConnection))
+				ReadRequest(a_spConnection, false);
+			else
+				SendBusy(a_spConnection, "Too many connections.");
+		}
 	}
 
 protected:
@@ -527,15 +1194,27 @@ protected:
 	//! Structure for a end-point.
 	struct EndPoint
 	{
-		EndPoint(const std::string & a_EndPointMask, Delegate<RequestSP> a_RequestHandler, bool a_bInvokeOnMain) :
-			m_EndPointMask(a_EndPointMask), m_RequestHandler(a_RequestHandler), m_bInvokeOnMain(a_bInvokeOnMain)
+		EndPoint(const std::string & a_RequestType, const std::string & a_EndPointMask, 
+			Delegate<RequestSP> a_RequestHandler, bool a_bInvokeOnMain) :
+			m_RequestType(a_RequestType), m_EndPointMask(a_EndPointMask), 
+			m_RequestHandler(a_RequestHandler), m_bInvokeOnMain(a_bInvokeOnMain)
 		{}
 
+		std::string			m_RequestType;			// empty for any request type
 		std::string			m_EndPointMask;
 		Delegate<RequestSP>	m_RequestHandler;
 		bool				m_bInvokeOnMain;
 	};
-	typedef std::list<EndPoint>	EndPointList;
+	typedef std::vector<EndPoint>	EndPointList;
+
+	//! Immutable snapshot of the end-points and the router compiled from them. A new snapshot
+	//! is swapped in each time an end-point is added or removed, so the request threads never lock.
+	struct Routes
+	{
+		EndPointList		m_EndPoints;
+		WebRouter			m_Router;				// route ID is the index into m_EndPoints
+	};
+	typedef boost::shared_ptr<const Routes>		RoutesSP;
 
 
 	//! Data
@@ -543,125 +1222,194 @@ protected:
 	int				m_nPort;				// which port are we listening on
 	int				m_nThreads;				// number of threads to start for handling incoming requests
 	float			m_fRequestTimeout;		// amount of time from an open connection until we receive the request
+	float			m_fIdleTimeout;			// amount of time a persistent connection may wait on the next request
+	int				m_nMaxRequests;			// max number of requests on a persistent connection, 1 disables keep-alive
+	float			m_fDrainTimeout;		// amount of time Stop() waits on active requests
+	volatile bool	m_bStopping;
+	int				m_nMaxConnections;		// max number of open connections, 0 for no limit
+	int				m_nMaxPerOrigin;		// max number of open connections from a single remote address, 0 for no limit
+	size_t			m_nMaxHeaderSize;		// max size of the request line & headers
+	size_t			m_nMaxBodySize;			// max size of a request body
+	size_t			m_nMinReadRate;			// min bytes per second a client must send a request, 0 for no minimum
+	float			m_fMaxQueueLatency;		// shed requests once they wait this long on the main thread, 0 to never shed
+	int				m_nRetryAfter;			// seconds sent in Retry-After when shedding
+	StatsSP			m_spStats;
 
 	Service			m_Service;
 	Work *			m_pWork;
 	Acceptor		m_Acceptor;
 
 	ThreadList		m_Threads;				// list of our threads
-	Mutex			m_EndPointLock;
-	EndPointList	m_EndPoints;			// NOTE: we may want to move to a std::map at some point
+	Mutex			m_EndPointLock;			// serializes changes to m_EndPoints
+	EndPointList	m_EndPoints;
+	RoutesSP		m_spRoutes;				// current snapshot, use boost::atomic_load()/atomic_store()
 
 											//! Accept incoming connections, this must be provided by the base class.
 	virtual void	Accept() = 0;
 
-	void ReadRequest(ConnectionSP a_spConnection)
+	//! Start reading the next request on the given connection, a_bIdle is true when this is a persistent
+	//! connection waiting on the next request from the client.
+	void ReadRequest(ConnectionSP a_spConnection, bool a_bIdle)
 	{
 		Connection * pConnection = static_cast<Connection *>(a_spConnection.get());
-		pConnection->StartTimeout(m_fRequestTimeout);
-
-		boost::asio::async_read_until(*pConnection->GetSocket(),
-			*pConnection->GetReadBuffer(), "\r\n\r\n",
-			boost::bind(&WebServerT::OnRequestRead, this, a_spConnection, 
-				boost::asio::placeholders::error));
+		HttpRequestParser & parser = pConnection->GetParser();
+		parser.Reset();
+		parser.SetMaxHeaderSize(m_nMaxHeaderSize);
+		parser.SetMaxBodySize(m_nMaxBodySize);
+		pConnection->SetIdle(a_bIdle);
+		pConnection->SetRequestStart(Time().GetEpochTime());
+		pConnection->StartTimeout(a_bIdle ? m_fIdleTimeout : m_fRequestTimeout);
+		if (!a_bIdle)
+			pConnection->StartReadRateCheck(m_nMinReadRate);
+
+		// the buffer may already hold the start of the request if the client pipelined it behind the last one
+		ParseRequest(a_spConnection);
 	}
 
-	void OnRequestRead(ConnectionSP a_spConnection, const boost::system::error_code & ec)
+	void OnRequestRead(ConnectionSP a_spConnection, const boost::system::error_code & ec, size_t a_nBytes)
 	{
 		Connection * pConnection = static_cast<Connection *>(a_spConnection.get());
-		pConnection->CancelTimeout();
-
 		if (!ec)
 		{
-			std::istream input( pConnection->GetReadBuffer().get() );
+			pConnection->GetReadBuffer()->commit(a_nBytes);
+			ParseRequest(a_spConnection);
+		}
+		else
+			pConnection->CancelTimeout();
+	}
 
-			std::string line;
-			std::getline(input, line);
+	//! Parse whatever we have received so far, this either dispatches the request or reads more bytes.
+	void ParseRequest(ConnectionSP a_spConnection)
+	{
+		Connection * pConnection = static_cast<Connection *>(a_spConnection.get());
+		StreamBuffer & buffer = *pConnection->GetReadBuffer();
+		HttpRequestParser & parser = pConnection->GetParser();
 
-			size_t nRequestEnd = line.find(' ');
-			if (nRequestEnd != std::string::npos)
+		const char * pData = boost::asio::buffer_cast<const char *>(buffer.data());
+		switch (parser.Parse(pData, buffer.size()))
+		{
+		case HttpRequestParser::COMPLETE:
 			{
-				size_t nEndpointEnd = line.find(' ', nRequestEnd + 1);
-				if (nEndpointEnd != std::string::npos)
-				{
-					RequestSP spRequest(new Request());
-					spRequest->m_Origin = pConnection->GetSocket()->lowest_layer().remote_endpoint().address().to_string();
-					spRequest->m_RequestType = line.substr(0, nRequestEnd);
-					spRequest->m_EndPoint = line.substr(nRequestEnd + 1, nEndpointEnd - nRequestEnd - 1);
-					spRequest->m_Protocol = StringUtil::Trim(line.substr(nEndpointEnd + 1), " \r");
-					spRequest->m_spConnection = a_spConnection;
-
-					std::getline(input, line);
-					size_t nSeperator = line.find(':');
-					while (nSeperator != std::string::npos)
-					{
-						std::string key(StringUtil::Trim(line.substr(0, nSeperator)));
-						std::string value(StringUtil::Trim(line.substr(nSeperator + 1), " \r"));
-						spRequest->m_Headers[key] = value;
+				if (!pConnection->CancelTimeout())
+					return;		// already dropped as a slow client
 
-						std::getline(input, line);
-						nSeperator = line.find(':');
-					}
+				pConnection->BeginRequest(parser.IsKeepAlive(pData) && pConnection->GetRequestCount() + 1 < m_nMaxRequests,
+					!HttpRequestParser::Equals(pData, parser.GetProtocol(), "HTTP/1.0"));
 
-					// add all query parameters as headers as well.
-					size_t nQuery = spRequest->m_EndPoint.find( '?' );
-					if ( nQuery != std::string::npos )
-					{
-						std::string ep( spRequest->m_EndPoint.substr( 0, nQuery ) );
-						std::string query( spRequest->m_EndPoint.substr( nQuery + 1 ) );
-
-						std::vector<std::string> params;
-						StringUtil::Split( query, "&", params );
-						for(size_t i=0;i<params.size();++i)
-						{
-							const std::string & param = params[i];
-
-							size_t nSeperator = param.find( '=' );
-							if ( nSeperator != std::string::npos )
-							{
-								std::string key( param.substr( 0, nSeperator ) );
-								std::string value( param.substr( nSeperator + 1 ) );
-								spRequest->m_Headers[key] = value;
-							}
-							else
-								spRequest->m_Headers[param] = "";
-						}
-
-						spRequest->m_EndPoint = ep;
-					}
+				RequestSP spRequest(new Request());
+				spRequest->m_Origin = pConnection->GetOrigin();
+				spRequest->m_spConnection = a_spConnection;
+				parser.GetRequest(pData, *spRequest);
 
-					// hand off our stream buffer to the connect, so it can get any remaining bytes..
-					ProcessRequest(spRequest);
-				}
+				// leave any bytes of the next request in the buffer..
+				buffer.consume(parser.GetConsumed());
+				ProcessRequest(spRequest);
 			}
+			return;
+		case HttpRequestParser::INVALID:
+			{
+				if (!pConnection->CancelTimeout())
+					return;
+
+				Log::Warning("WebServer", "Rejecting request from %s: %d %s",
+					pConnection->GetOrigin().c_str(), parser.GetErrorStatus(), parser.GetErrorReason());
+				pConnection->SendResponse(parser.GetErrorStatus(), parser.GetErrorReason(), std::string(), true);
+			}
+			return;
+		case HttpRequestParser::SEND_CONTINUE:
+			pConnection->SendAsync("HTTP/1.1 100 Continue\r\n\r\n");
+			break;
+		case HttpRequestParser::NEED_MORE:
+			break;
+		}
+
+		// once the client starts sending the next request, it gets the full request timeout
+		if (pConnection->IsIdle() && buffer.size() > 0)
+		{
+			pConnection->SetIdle(false);
+			pConnection->SetRequestStart(Time().GetEpochTime());
+			pConnection->StartTimeout(m_fRequestTimeout);
+			pConnection->StartReadRateCheck(m_nMinReadRate);
 		}
+		pConnection->SetRequestBytes(buffer.size());
+
+		pConnection->GetSocket()->async_read_some(buffer.prepare(READ_SIZE),
+			boost::bind(&WebServerT::OnRequestRead, this, a_spConnection,
+				boost::asio::placeholders::error,
+				boost::asio::placeholders::bytes_transferred));
+	}
+
+	//! Count a new connection against our limits, returns false if it should be rejected.
+	bool AdmitConnection(ConnectionSP a_spConnection)
+	{
+		Connection * pConnection = static_cast<Connection *>(a_spConnection.get());
+		if (pConnection->Admit(m_nMaxConnections, m_nMaxPerOrigin))
+			return true;
+
+		Log::Debug("WebServer", "Rejecting connection from %s, too many connections.", pConnection->GetOrigin().c_str());
+		return false;
+	}
+
+	//! Send a 503 response & close the connection.
+	void SendBusy(ConnectionSP a_spConnection, const std::string & a_Content)
+	{
+		Headers headers;
+		headers["Retry-After"] = StringUtil::Format("%d", m_nRetryAfter);
+		a_spConnection->SendResponse(503, "Service Unavailable", headers, a_Content, true);
+	}
+
+	//! Returns true if requests are waiting on the main thread longer than m_fMaxQueueLatency.
+	bool IsMainOverloaded()
+	{
+		if (m_fMaxQueueLatency <= 0.0f)
+			return false;
+
+		boost::mutex::scoped_lock lock(m_spStats->m_Lock);
+		if (m_spStats->m_nQueuedOnMain == 0)
+			return false;
+		double fNow = Time().GetEpochTime();
+		return m_spStats->m_fMainLatency > m_fMaxQueueLatency
+			|| (fNow - m_spStats->m_fLastMainDispatch) > m_fMaxQueueLatency;
+	}
+
+	//! Build a new routes snapshot from m_EndPoints, caller must hold m_EndPointLock.
+	void CompileRoutes()
+	{
+		boost::shared_ptr<Routes> spRoutes(new Routes());
+		spRoutes->m_EndPoints = m_EndPoints;
+		for (size_t i = 0; i < m_EndPoints.size(); ++i)
+			spRoutes->m_Router.AddRoute(m_EndPoints[i].m_RequestType, m_EndPoints[i].m_EndPointMask, i);
+
+		boost::atomic_store(&m_spRoutes, RoutesSP(spRoutes));
 	}
 
 	void ProcessRequest(RequestSP a_spRequest)
 	{
-		// automatically upgrade connections to web-sockets if they have a key..
-		Delegate<RequestSP> spRequestHandler;
-		bool bInvokeOnMain = false;
+		RoutesSP spRoutes = boost::atomic_load(&m_spRoutes);
+
+		size_t nRouteId = 0;
+		WebRouter::MatchResult result = WebRouter::NOT_FOUND;
+		if (spRoutes)
+			result = spRoutes->m_Router.Find(a_spRequest->m_RequestType, a_spRequest->m_EndPoint, nRouteId, a_spRequest->m_Parameters);
 
-		m_EndPointLock.lock();
-		for (typename EndPointList::const_iterator iEndPoint = m_EndPoints.begin(); iEndPoint != m_EndPoints.end(); ++iEndPoint)
+		if (result == WebRouter::MATCHED)
 		{
-			if (StringUtil::WildMatch((*iEndPoint).m_EndPointMask.c_str(), a_spRequest->m_EndPoint.c_str()))
+			const EndPoint & endPoint = spRoutes->m_EndPoints[nRouteId];
+			if (endPoint.m_bInvokeOnMain)
 			{
-				spRequestHandler = (*iEndPoint).m_RequestHandler;
-				bInvokeOnMain = (*iEndPoint).m_bInvokeOnMain;
-				break;
+				if (IsMainOverloaded())
+					SendBusy(a_spRequest->m_spConnection, "Server is busy.");
+				else
+				{
+					ThreadPool::Instance()->InvokeOnMain(VOID_FUNCTOR_DELEGATE(
+						WebServerDispatch(m_spStats, endPoint.m_RequestHandler, a_spRequest)));
+				}
 			}
-		}
-		m_EndPointLock.unlock();
-
-		if (spRequestHandler.IsValid())
-		{
-			if (bInvokeOnMain)
-				ThreadPool::Instance()->InvokeOnMain<RequestSP>(spRequestHandler, a_spRequest);
 			else
-				spRequestHandler(a_spRequest);
+				endPoint.m_RequestHandler(a_spRequest);
 		}
+		else if (result == WebRouter::METHOD_NOT_ALLOWED)
+			a_spRequest->m_spConnection->SendResponse(405, "Method Not Allowed", "Unsupported request type.");
 		else
 			a_spRequest->m_spConnection->SendResponse(500, "Server Error", "Unsupported end-point.");
 	}
@@ -677,6 +1425,11 @@ public:
 		int a_nPort = 80, int a_nThreads = 5, float a_fRequestTimeout = 30.0f) :
 		WebServerT<boost::asio::ip::tcp::socket>(a_Interface, a_nPort, a_nThreads, a_fRequestTimeout)
 	{}
+	~WebServer()
+	{
+		// stop while we can still handle any completed accepts
+		Stop();
+	}
 
 protected:
 	//! WebServerBase interface
@@ -711,6 +1464,7 @@ public:
 	}
 	~SecureWebServer()
 	{
+		Stop();
 		delete m_pSSL;
 	}
 
@@ -727,10 +1481,13 @@ protected:
 
 	void OnBeginHandshake(ConnectionSP a_spConnection, const boost::system::error_code & ec)
 	{
+		if (m_bStopping)
+			return;
+
 		//Immediately start accepting a new connection
 		Accept();
 
-		if (!ec)
+		if (!ec && AdmitConnection(a_spConnection))
 		{
 			Connection * pConnection = static_cast<Connection *>(a_spConnection.get());
 			pConnection->StartTimeout(m_fRequestTimeout);
@@ -746,7 +1503,7 @@ protected:
 		pConnection->CancelTimeout();
 
 		if (!ec)
-			ReadRequest(a_spConnection);
+			ReadRequest(a_spConnection, false);
 	}
 
 private:
@@ -0,0 +1,171 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <algorithm>
+
+#include "boost/thread.hpp"
+#include "jsoncpp/json/json.h"
+
+#include "Benchmark.h"
+#include "utils/Log.h"
+#include "utils/StringUtil.h"
+#include "utils/Time.h"
+#include "utils/Trace.h"
+
+int Benchmark::sm_nRepetitions = 5;
+double Benchmark::sm_fScale = 1.0;
+
+#if defined(_MSC_VER)
+#define BENCH_COMPILER		StringUtil::Format("msvc %d", _MSC_VER)
+#elif defined(__VERSION__)
+#define BENCH_COMPILER		std::string(__VERSION__)
+#else
+#define BENCH_COMPILER		std::string("unknown")
+#endif
+
+#if defined(_DEBUG)
+#define BENCH_BUILD			"debug"
+#else
+#define BENCH_BUILD			"release"
+#endif
+
+int Benchmark::RunBenchmarks( const std::vector<std::string> & a_Benchmarks, ResultList & a_Results )
+{
+	std::vector<std::string> benchmarks( a_Benchmarks );
+	if ( benchmarks.size() == 0 )
+	{
+		for( BenchmarkList::iterator iBench = GetBenchmarkList().begin(); iBench != GetBenchmarkList().end(); ++iBench )
+			benchmarks.push_back( (*iBench)->GetName() );
+	}
+
+	int failed = 0;
+	for(size_t i=0;i<benchmarks.size();++i)
+	{
+		Benchmark * pBenchmark = NULL;
+		for( BenchmarkList::iterator iBench = GetBenchmarkList().begin(); pBenchmark == NULL && iBench != GetBenchmarkList().end(); ++iBench )
+		{
+			if ( (*iBench)->GetName() == benchmarks[i] )
+				pBenchmark = *iBench;
+		}
+
+		if ( pBenchmark == NULL )
+		{
+			Log::Error( "Benchmark", "Failed to find benchmark %s.", benchmarks[i].c_str() );
+			failed += 1;
+			continue;
+		}
+
+		Log::Status( "Benchmark", "Running Benchmark %s...", pBenchmark->GetName().c_str() );
+		pBenchmark->m_pResults = &a_Results;
+		try {
+			pBenchmark->RunBenchmark();
+		}
+		catch( const std::exception & e )
+		{
+			Log::Error( "Benchmark", "Benchmark %s FAILED: %s", pBenchmark->GetName().c_str(), e.what() );
+			failed += 1;
+		}
+		pBenchmark->m_pResults = NULL;
+	}
+
+	return failed;
+}
+
+std::string Benchmark::FormatJson( const ResultList & a_Results, const std::string & a_Label )
+{
+	Json::Value root;
+	root["label"] = a_Label;
+	root["time"] = Time().GetEpochTime();
+	root["compiler"] = BENCH_COMPILER;
+	root["build"] = BENCH_BUILD;
+	root["cpus"] = (int)boost::thread::hardware_concurrency();
+	root["repetitions"] = sm_nRepetitions;
+	root["scale"] = sm_fScale;
+
+	Json::Value & results = root["results"];
+	results = Json::Value( Json::arrayValue );
+	for(size_t i=0;i<a_Results.size();++i)
+	{
+		const Result & result = a_Results[i];
+
+		Json::Value & r = results.append( Json::Value() );
+		r["benchmark"] = result.m_Benchmark;
+		r["case"] = result.m_Case;
+		r["operations"] = (Json::UInt64)result.m_nOperations;
+		r["ns_per_op_min"] = result.m_fMin * 1000000000.0;
+		r["ns_per_op_median"] = result.m_fMedian * 1000000000.0;
+		r["ns_per_op_max"] = result.m_fMax * 1000000000.0;
+		r["ops_per_sec"] = result.m_fMedian > 0.0 ? 1.0 / result.m_fMedian : 0.0;
+		if ( result.m_nBytesPerOp > 0 )
+			r["mb_per_sec"] = result.m_fMedian > 0.0 ? (result.m_nBytesPerOp / result.m_fMedian) / (1024.0 * 1024.0) : 0.0;
+	}
+
+	return Json::StyledWriter().write( root );
+}
+
+std::string Benchmark::FormatCSV( const ResultList & a_Results, const std::string & a_Label )
+{
+	std::string csv( "label,benchmark,case,operations,ns_per_op_min,ns_per_op_median,ns_per_op_max,ops_per_sec,mb_per_sec\n" );
+	for(size_t i=0;i<a_Results.size();++i)
+	{
+		const Result & result = a_Results[i];
+		double fOpsPerSec = result.m_fMedian > 0.0 ? 1.0 / result.m_fMedian : 0.0;
+		double fMBPerSec = (fOpsPerSec * result.m_nBytesPerOp) / (1024.0 * 1024.0);
+
+		csv += StringUtil::Format( "%s,%s,%s,%llu,%.1f,%.1f,%.1f,%.1f,%.3f\n",
+			a_Label.c_str(), result.m_Benchmark.c_str(), result.m_Case.c_str(), (unsigned long long)result.m_nOperations,
+			result.m_fMin * 1000000000.0, result.m_fMedian * 1000000000.0, result.m_fMax * 1000000000.0,
+			fOpsPerSec, fMBPerSec );
+	}
+
+	return csv;
+}
+
+void Benchmark::Measure( const std::string & a_Name, boost::uint64_t a_nOperations,
+	Delegate<boost::uint64_t> a_Case, size_t a_nBytesPerOp /*= 0*/ )
+{
+	boost::uint64_t nOperations = (boost::uint64_t)(a_nOperations * sm_fScale);
+	if ( nOperations < 1 )
+		nOperations = 1;
+
+	// warm up caches, pools & connections before timing anything..
+	a_Case( nOperations );
+
+	std::vector<double> times;
+	for(int i=0;i<sm_nRepetitions;++i)
+	{
+		double fStart = Trace::Now();
+		a_Case( nOperations );
+		times.push_back( (Trace::Now() - fStart) / nOperations );
+	}
+	std::sort( times.begin(), times.end() );
+
+	Result result;
+	result.m_Benchmark = m_Name;
+	result.m_Case = a_Name;
+	result.m_nOperations = nOperations;
+	result.m_nRepetitions = sm_nRepetitions;
+	result.m_nBytesPerOp = a_nBytesPerOp;
+	result.m_fMin = times.front();
+	result.m_fMedian = times[ times.size() / 2 ];
+	result.m_fMax = times.back();
+
+	Log::Status( "Benchmark", "%s/%s: %.1f ns/op (min %.1f, max %.1f)", m_Name.c_str(), a_Name.c_str(),
+		result.m_fMedian * 1000000000.0, result.m_fMin * 1000000000.0, result.m_fMax * 1000000000.0 );
+	if ( m_pResults != NULL )
+		m_pResults->push_back( result );
+}
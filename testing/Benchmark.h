@@ -0,0 +1,124 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_BENCHMARK_H
+#define WDC_BENCHMARK_H
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include "boost/cstdint.hpp"
+
+#include "utils/Delegate.h"
+
+//! Base class for the benchmarks run by wdc_bench.
+//!
+//! Benchmarks register themselves the same way a UnitTest does. Each benchmark times one or more cases with
+//! Measure(), a case is a delegate that performs the given number of operations and returns once they are all
+//! complete. Every case is run once to warm up and then GetRepetitions() more times, the result reports the
+//! fastest, median and slowest repetition so noisy machines can be spotted in the output.
+class Benchmark
+{
+public:
+	//! Types
+	struct Result
+	{
+		Result() : m_nOperations(0), m_nRepetitions(0), m_nBytesPerOp(0),
+			m_fMin(0.0), m_fMedian(0.0), m_fMax(0.0)
+		{}
+
+		std::string			m_Benchmark;
+		std::string			m_Case;
+		boost::uint64_t		m_nOperations;		// operations in each repetition
+		int					m_nRepetitions;
+		size_t				m_nBytesPerOp;		// 0 if the case doesn't process bytes
+		double				m_fMin;				// seconds per operation
+		double				m_fMedian;
+		double				m_fMax;
+	};
+	typedef std::vector<Result>		ResultList;
+
+	//! Construction
+	Benchmark( const char * a_pName ) : m_Name( a_pName ), m_pResults( NULL )
+	{
+		GetBenchmarkList().push_back( this );
+	}
+	virtual ~Benchmark()
+	{
+		GetBenchmarkList().remove( this );
+	}
+
+	const std::string & GetName() const
+	{
+		return m_Name;
+	}
+
+	virtual void RunBenchmark() = 0;
+
+	//! Number of timed repetitions of each case.
+	static int GetRepetitions()
+	{
+		return sm_nRepetitions;
+	}
+	static void SetRepetitions( int a_nRepetitions )
+	{
+		sm_nRepetitions = a_nRepetitions > 0 ? a_nRepetitions : 1;
+	}
+	//! Multiplier applied to the operation count of every case, use less than 1.0 for a quick run.
+	static double GetScale()
+	{
+		return sm_fScale;
+	}
+	static void SetScale( double a_fScale )
+	{
+		sm_fScale = a_fScale;
+	}
+
+	//! Run one or more benchmarks by name, or all of them if none are given. Returns the number of benchmarks
+	//! that failed or were not found.
+	static int RunBenchmarks( const std::vector<std::string> & a_Benchmarks, ResultList & a_Results );
+	//! Format results as JSON, a_Label is included so runs of different versions can be told apart.
+	static std::string FormatJson( const ResultList & a_Results, const std::string & a_Label );
+	//! Format results as CSV with a header line.
+	static std::string FormatCSV( const ResultList & a_Results, const std::string & a_Label );
+
+protected:
+	//! Time a case, a_Case is invoked with the number of operations it should perform.
+	void Measure( const std::string & a_Name, boost::uint64_t a_nOperations,
+		Delegate<boost::uint64_t> a_Case, size_t a_nBytesPerOp = 0 );
+
+private:
+	//! Types
+	typedef std::list<Benchmark *>	BenchmarkList;
+
+	//! Data
+	const std::string	m_Name;
+	ResultList *		m_pResults;		// valid while RunBenchmark() is running
+
+	static int			sm_nRepetitions;
+	static double		sm_fScale;
+
+	static BenchmarkList & GetBenchmarkList()
+	{
+		// never destroyed for the same reasons as the UnitTest list
+		static BenchmarkList * LIST = new BenchmarkList();
+		return *LIST;
+	}
+};
+
+#endif
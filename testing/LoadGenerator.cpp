@@ -0,0 +1,138 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "LoadGenerator.h"
+#include "utils/Log.h"
+#include "utils/StringUtil.h"
+#include "utils/ThreadPool.h"
+#include "utils/Trace.h"
+
+#include "boost/thread.hpp"
+
+void LoadGenerator::Client::Done(bool a_bSuccess)
+{
+	if (m_pGenerator != NULL)
+		m_pGenerator->OnDone(this, a_bSuccess);
+}
+
+LoadGenerator::LoadGenerator(size_t a_nClients, SendDelegate a_Send) :
+	m_Send(a_Send),
+	m_Clients(a_nClients > 0 ? a_nClients : 1),
+	m_fRate(0.0),
+	m_nSent(0),
+	m_nCompleted(0),
+	m_nErrors(0),
+	m_fElapsed(0.0),
+	m_spLatency(new Metrics::Histogram())
+{
+	for (size_t i = 0; i < m_Clients.size(); ++i)
+	{
+		m_Clients[i].m_pGenerator = this;
+		m_Clients[i].m_nIndex = i;
+	}
+}
+
+LoadGenerator::~LoadGenerator()
+{
+	// requests still pending will find no generator..
+	for (size_t i = 0; i < m_Clients.size(); ++i)
+		m_Clients[i].m_pGenerator = NULL;
+}
+
+bool LoadGenerator::Run(boost::uint64_t a_nRequests, double a_fTimeout /*= 30.0*/)
+{
+	ThreadPool * pPool = ThreadPool::Instance();
+	if (pPool == NULL || !m_Send.IsValid())
+	{
+		Log::Error("LoadGenerator", "Run() requires a ThreadPool and a send delegate.");
+		return false;
+	}
+
+	m_spLatency.reset(new Metrics::Histogram());
+	m_nSent = m_nCompleted = m_nErrors = 0;
+	m_fElapsed = 0.0;
+
+	double fStart = Trace::Now();
+	double fNextSend = fStart;
+	double fLastDone = fStart;
+	boost::uint64_t nLastDone = 0;
+
+	while (m_nCompleted < a_nRequests)
+	{
+		for (size_t i = 0; i < m_Clients.size() && m_nSent < a_nRequests; ++i)
+		{
+			Client & client = m_Clients[i];
+			if (client.m_bBusy)
+				continue;
+
+			double fNow = Trace::Now();
+			if (m_fRate > 0.0)
+			{
+				if (fNow < fNextSend)
+					break;
+				client.m_fStart = fNextSend;
+				fNextSend += 1.0 / m_fRate;
+			}
+			else
+				client.m_fStart = fNow;
+
+			client.m_bBusy = true;
+			client.m_nRequest = m_nSent++;
+			m_Send(&client);
+		}
+
+		pPool->ProcessMainThread();
+		boost::this_thread::yield();
+
+		double fNow = Trace::Now();
+		if (m_nCompleted != nLastDone)
+		{
+			nLastDone = m_nCompleted;
+			fLastDone = fNow;
+		}
+		else if ((fNow - fLastDone) > a_fTimeout)
+		{
+			m_fElapsed = fNow - fStart;
+			Log::Error("LoadGenerator", "Timed out with %llu of %llu requests done.",
+				(unsigned long long)m_nCompleted, (unsigned long long)a_nRequests);
+			return false;
+		}
+	}
+
+	m_fElapsed = Trace::Now() - fStart;
+	return true;
+}
+
+std::string LoadGenerator::GetReport() const
+{
+	return StringUtil::Format("%llu requests, %llu errors, %u clients, %.3f s, %.1f req/s, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms",
+		(unsigned long long)m_nCompleted, (unsigned long long)m_nErrors, (unsigned int)m_Clients.size(), m_fElapsed, GetThroughput(),
+		m_spLatency->GetQuantile(0.5) * 1000.0, m_spLatency->GetQuantile(0.9) * 1000.0,
+		m_spLatency->GetQuantile(0.99) * 1000.0, m_spLatency->GetMax() * 1000.0);
+}
+
+void LoadGenerator::OnDone(Client * a_pClient, bool a_bSuccess)
+{
+	if (!a_pClient->m_bBusy)
+		return;
+
+	a_pClient->m_bBusy = false;
+	m_spLatency->Record(Trace::Now() - a_pClient->m_fStart);
+	m_nCompleted += 1;
+	if (!a_bSuccess)
+		m_nErrors += 1;
+}
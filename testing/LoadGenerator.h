@@ -0,0 +1,161 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_LOAD_GENERATOR_H
+#define WDC_LOAD_GENERATOR_H
+
+#include <string>
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+#include "boost/scoped_ptr.hpp"
+
+#include "services/IService.h"
+#include "utils/Delegate.h"
+#include "utils/Metrics.h"
+
+//! Drives a number of concurrent clients making requests to a service, usually a service pointed at a
+//! MockService, and measures the throughput and the latency of the requests.
+//!
+//! For each request the send delegate is invoked with the Client making it, the delegate starts the request
+//! and its callback must end with a call to Client::Done(). The Client provides callbacks for the common
+//! IService callback types, e.g.
+//!
+//!   nlc.Classify(id, text, DELEGATE(LoadGenerator::Client, OnJson, const Json::Value &, a_pClient));
+//!
+//! By default each client sends its next request as soon as the last one is done. With SetRate() requests
+//! are started on a fixed schedule instead, and latency is measured from the time the request was due, so a
+//! slow response is not hidden by delaying the requests behind it.
+class LoadGenerator : private boost::noncopyable
+{
+public:
+	//! Types
+	class Client
+	{
+	public:
+		Client() : m_pGenerator(NULL), m_nIndex(0), m_nRequest(0), m_fStart(0.0), m_bBusy(false)
+		{}
+
+		//! Returns the index of this client, 0 to GetClients() - 1
+		size_t GetIndex() const
+		{
+			return m_nIndex;
+		}
+		//! Returns the sequence number of the current request across all clients
+		boost::uint64_t GetRequest() const
+		{
+			return m_nRequest;
+		}
+
+		//! Must be invoked once the response to the current request has been received.
+		void Done(bool a_bSuccess);
+
+		//! Callbacks that call Done()
+		void OnJson(const Json::Value & a_Json)
+		{
+			Done(!a_Json.isNull());
+		}
+		void OnData(const std::string & a_Data)
+		{
+			Done(a_Data.size() > 0);
+		}
+		template<typename T>
+		void OnObject(T * a_pObject)
+		{
+			Done(a_pObject != NULL);
+			delete a_pObject;
+		}
+
+	private:
+		friend class LoadGenerator;
+
+		LoadGenerator *		m_pGenerator;
+		size_t				m_nIndex;
+		boost::uint64_t		m_nRequest;
+		double				m_fStart;		// time the request was due
+		bool				m_bBusy;
+	};
+	typedef Delegate<Client *>				SendDelegate;
+
+	//! Construction
+	LoadGenerator(size_t a_nClients, SendDelegate a_Send);
+	~LoadGenerator();
+
+	//! Accessors
+	size_t GetClients() const
+	{
+		return m_Clients.size();
+	}
+	double GetRate() const
+	{
+		return m_fRate;
+	}
+	boost::uint64_t GetCompleted() const
+	{
+		return m_nCompleted;
+	}
+	boost::uint64_t GetErrors() const
+	{
+		return m_nErrors;
+	}
+	//! Returns the seconds taken by the last Run()
+	double GetElapsed() const
+	{
+		return m_fElapsed;
+	}
+	//! Returns the completed requests per second of the last Run()
+	double GetThroughput() const
+	{
+		return m_fElapsed > 0.0 ? m_nCompleted / m_fElapsed : 0.0;
+	}
+	//! Returns the latency of the requests completed by the last Run()
+	const Metrics::Histogram & GetLatency() const
+	{
+		return *m_spLatency;
+	}
+
+	//! Mutators
+	//! Start a_fRequestsPerSecond requests a second across all clients, 0 to start a request as soon as
+	//! a client is free.
+	void SetRate(double a_fRequestsPerSecond)
+	{
+		m_fRate = a_fRequestsPerSecond;
+	}
+
+	//! Make a_nRequests requests, this must be called from the main thread and processes the main thread
+	//! until every request is done. Returns false if no request completes for a_fTimeout seconds, any requests
+	//! still pending then must complete or time out before this object is destroyed.
+	bool Run(boost::uint64_t a_nRequests, double a_fTimeout = 30.0);
+	//! Returns a one line summary of the last Run()
+	std::string GetReport() const;
+
+private:
+	//! Data
+	SendDelegate		m_Send;
+	std::vector<Client>	m_Clients;
+	double				m_fRate;
+	boost::uint64_t		m_nSent;
+	boost::uint64_t		m_nCompleted;
+	boost::uint64_t		m_nErrors;
+	double				m_fElapsed;
+	boost::scoped_ptr<Metrics::Histogram>
+						m_spLatency;
+
+	void OnDone(Client * a_pClient, bool a_bSuccess);
+};
+
+#endif
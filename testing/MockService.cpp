@@ -0,0 +1,659 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <fstream>
+
+#include "boost/random/uniform_01.hpp"
+
+#include "MockService.h"
+#include "utils/Config.h"
+#include "utils/Log.h"
+#include "utils/Sound.h"
+#include "utils/StringUtil.h"
+#include "utils/Time.h"
+
+RTTI_IMPL( MockResponse, ISerializable );
+
+static const char * DEFAULT_SPEECH_RESULTS =
+	"{\"result_index\":0,\"results\":[{\"final\":true,\"alternatives\":[{\"transcript\":\"hello world \",\"confidence\":0.9}]}]}";
+static const int SYNTHESIZE_RATE = 22050;
+//! How long Stop() waits for delayed replies beyond the maximum latency
+static const float STOP_TIMEOUT = 5.0f;
+
+void MockResponse::Serialize(Json::Value & json)
+{
+	json["m_RequestType"] = m_RequestType;
+	json["m_EndPoint"] = m_EndPoint;
+	json["m_StatusCode"] = m_StatusCode;
+	json["m_Body"] = m_Body;
+	json["m_fLatency"] = m_fLatency;
+
+	SerializeMap("m_Headers", m_Headers, json);
+}
+
+void MockResponse::Deserialize(const Json::Value & json)
+{
+	if (json["m_RequestType"].isString())
+		m_RequestType = json["m_RequestType"].asString();
+	if (json["m_EndPoint"].isString())
+		m_EndPoint = json["m_EndPoint"].asString();
+	if (json["m_StatusCode"].isNumeric())
+		m_StatusCode = json["m_StatusCode"].asInt();
+	if (json["m_Body"].isString())
+		m_Body = json["m_Body"].asString();
+	if (json["m_fLatency"].isNumeric())
+		m_fLatency = json["m_fLatency"].asFloat();
+
+	DeserializeMap("m_Headers", json, m_Headers);
+}
+
+//----------------------------------------
+
+MockService::MockService(int a_nPort /*= 8090*/, const std::string & a_Interface /*= "127.0.0.1"*/, int a_nThreads /*= 5*/) :
+	m_pServer(IWebServer::Create(a_Interface, a_nPort, a_nThreads)),
+	m_nPort(a_nPort),
+	m_Interface(a_Interface),
+	m_bActive(false),
+	m_Random((boost::uint32_t)a_nPort),
+	m_fMinLatency(0.0f),
+	m_fMaxLatency(0.0f),
+	m_fErrorRate(0.0f),
+	m_nErrorStatus(500),
+	m_SpeechResults(DEFAULT_SPEECH_RESULTS),
+	m_nBytesPerResult(32000),
+	m_fSecondsPerWord(0.3f),
+	m_nFrameSize(8192),
+	m_nRequests(0),
+	m_nErrors(0),
+	m_nNotFound(0),
+	m_nPending(0)
+{
+	m_pServer->SetKeepAlive(30.0f, 1000000);
+	m_pServer->AddEndpoint("/*", DELEGATE(MockService, OnNotFound, IWebServer::RequestSP, this), false);
+}
+
+MockService::~MockService()
+{
+	Stop();
+
+	delete m_pServer;
+	for (size_t i = 0; i < m_Routes.size(); ++i)
+		delete m_Routes[i];
+}
+
+std::string MockService::GetURL() const
+{
+	return StringUtil::Format("http://%s:%d", m_Interface.size() > 0 && m_Interface != "0.0.0.0" ? m_Interface.c_str() : "127.0.0.1", m_nPort);
+}
+
+void MockService::SetLatency(float a_fMin, float a_fMax)
+{
+	boost::lock_guard<boost::mutex> lock(m_Lock);
+	m_fMinLatency = a_fMin;
+	m_fMaxLatency = a_fMax > a_fMin ? a_fMax : a_fMin;
+}
+
+void MockService::SetErrorRate(float a_fRate, int a_nStatusCode /*= 500*/)
+{
+	boost::lock_guard<boost::mutex> lock(m_Lock);
+	m_fErrorRate = a_fRate;
+	m_nErrorStatus = a_nStatusCode;
+}
+
+bool MockService::Start()
+{
+	if (m_bActive)
+		return false;
+	if (!m_pServer->Start())
+	{
+		Log::Error("MockService", "Failed to start server on port %d.", m_nPort);
+		return false;
+	}
+
+	m_bActive = true;
+	return true;
+}
+
+bool MockService::Stop()
+{
+	if (!m_bActive)
+		return false;
+
+	double fWait = Time().GetEpochTime() + m_fMaxLatency + STOP_TIMEOUT;
+	while (m_nPending > 0 && Time().GetEpochTime() < fWait)
+		boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+	if (m_nPending > 0)
+		Log::Warning("MockService", "Stopped with %d replies still waiting.", (int)m_nPending);
+
+	m_pServer->Stop();
+	m_bActive = false;
+
+	boost::lock_guard<boost::mutex> lock(m_Lock);
+	m_Sessions.clear();
+	return true;
+}
+
+bool MockService::AddServiceConfig(const std::string & a_ServiceId, const std::string & a_Path, Config * a_pConfig /*= NULL*/)
+{
+	if (a_pConfig == NULL)
+		a_pConfig = Config::Instance();
+	if (a_pConfig == NULL)
+	{
+		Log::Error("MockService", "No config to add %s to.", a_ServiceId.c_str());
+		return false;
+	}
+
+	ServiceConfig config;
+	config.m_ServiceId = a_ServiceId;
+	config.m_URL = GetURL() + a_Path;
+	config.m_User = "mock";
+	config.m_Password = "mock";
+	a_pConfig->AddServiceConfig(config);
+
+	return true;
+}
+
+void MockService::AddResponse(const MockResponse & a_Response)
+{
+	Route * pRoute = NULL;
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		for (size_t i = 0; i < m_Routes.size(); ++i)
+		{
+			const MockResponse & first = m_Routes[i]->m_Responses.front();
+			if (first.m_RequestType == a_Response.m_RequestType && first.m_EndPoint == a_Response.m_EndPoint)
+			{
+				m_Routes[i]->m_Responses.push_back(a_Response);
+				return;
+			}
+		}
+
+		pRoute = new Route(this);
+		pRoute->m_Responses.push_back(a_Response);
+		m_Routes.push_back(pRoute);
+	}
+
+	m_pServer->AddEndpoint(a_Response.m_RequestType, a_Response.m_EndPoint,
+		DELEGATE(Route, OnRequest, IWebServer::RequestSP, pRoute), false);
+}
+
+void MockService::AddResponse(const std::string & a_RequestType, const std::string & a_EndPoint,
+	int a_StatusCode, const std::string & a_Body, const std::string & a_ContentType /*= "application/json"*/)
+{
+	AddResponse(MockResponse(a_RequestType, a_EndPoint, a_StatusCode, a_Body, a_ContentType));
+}
+
+bool MockService::LoadResponses(const std::string & a_File)
+{
+	std::ifstream input(a_File.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open())
+	{
+		Log::Error("MockService", "Failed to open %s.", a_File.c_str());
+		return false;
+	}
+
+	std::string data;
+	data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+
+	Json::Value json;
+	Json::Reader reader(Json::Features::strictMode());
+	if (!reader.parse(data, json) || !json["m_Responses"].isArray())
+	{
+		Log::Error("MockService", "Failed to parse responses from %s.", a_File.c_str());
+		return false;
+	}
+
+	ResponseList responses;
+	ISerializable::DeserializeVector("m_Responses", json, responses);
+	for (size_t i = 0; i < responses.size(); ++i)
+		AddResponse(responses[i]);
+
+	Log::Status("MockService", "Loaded %u responses from %s.", (unsigned int)responses.size(), a_File.c_str());
+	return true;
+}
+
+bool MockService::SaveResponses(const std::string & a_File) const
+{
+	ResponseList responses;
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		for (size_t i = 0; i < m_Routes.size(); ++i)
+			responses.insert(responses.end(), m_Routes[i]->m_Responses.begin(), m_Routes[i]->m_Responses.end());
+	}
+
+	Json::Value json;
+	ISerializable::SerializeVector("m_Responses", responses, json);
+
+	std::ofstream output(a_File.c_str(), std::ios::out | std::ios::binary);
+	if (!output.is_open())
+	{
+		Log::Error("MockService", "Failed to open %s for writing.", a_File.c_str());
+		return false;
+	}
+
+	output << json.toStyledString();
+	return true;
+}
+
+void MockService::AddSpeechToText(const std::string & a_Path /*= "/speech-to-text/api"*/,
+	const std::string & a_Results /*= std::string()*/, size_t a_nBytesPerResult /*= 32000*/)
+{
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		m_SpeechResults = a_Results.size() > 0 ? a_Results : DEFAULT_SPEECH_RESULTS;
+		m_nBytesPerResult = a_nBytesPerResult > 0 ? a_nBytesPerResult : 1;
+	}
+
+	m_pServer->AddEndpoint(a_Path + "/v1/recognize", DELEGATE(MockService, OnRecognize, IWebServer::RequestSP, this), false);
+}
+
+void MockService::AddTextToSpeech(const std::string & a_Path /*= "/text-to-speech/api"*/,
+	float a_fSecondsPerWord /*= 0.3f*/, size_t a_nFrameSize /*= 8192*/)
+{
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		m_fSecondsPerWord = a_fSecondsPerWord;
+		m_nFrameSize = a_nFrameSize > 0 ? a_nFrameSize : 1;
+	}
+
+	m_pServer->AddEndpoint(a_Path + "/v1/synthesize", DELEGATE(MockService, OnSynthesize, IWebServer::RequestSP, this), false);
+}
+
+//----------------------------------------
+
+float MockService::GetLatency()
+{
+	boost::lock_guard<boost::mutex> lock(m_Lock);
+	if (m_fMaxLatency <= 0.0f)
+		return 0.0f;
+	return m_fMinLatency + (m_fMaxLatency - m_fMinLatency) * boost::random::uniform_01<float>()(m_Random);
+}
+
+bool MockService::InjectError()
+{
+	boost::lock_guard<boost::mutex> lock(m_Lock);
+	if (m_fErrorRate <= 0.0f)
+		return false;
+	return boost::random::uniform_01<float>()(m_Random) < m_fErrorRate;
+}
+
+void MockService::Respond(IWebServer::RequestSP a_spRequest, int a_nStatusCode, const MockResponse::Headers & a_Headers,
+	const std::string & a_Body, float a_fLatency /*= -1.0f*/)
+{
+	++m_nRequests;
+
+	Reply * pReply = new Reply();
+	pReply->m_spConnection = a_spRequest->m_spConnection;
+	if (InjectError())
+	{
+		++m_nErrors;
+		pReply->m_nStatusCode = m_nErrorStatus;
+		pReply->m_Headers["Content-Type"] = "application/json";
+		pReply->m_Content = StringUtil::Format("{\"code\":%d,\"error\":\"%s\"}", m_nErrorStatus, GetReason(m_nErrorStatus));
+	}
+	else
+	{
+		pReply->m_nStatusCode = a_nStatusCode;
+		for (MockResponse::Headers::const_iterator iHeader = a_Headers.begin(); iHeader != a_Headers.end(); ++iHeader)
+			pReply->m_Headers[iHeader->first] = iHeader->second;
+		pReply->m_Content = a_Body;
+	}
+
+	Send(pReply, a_fLatency < 0.0f ? GetLatency() : a_fLatency);
+}
+
+bool MockService::StartSession(IWebServer::RequestSP a_spRequest, bool a_bSpeechToText)
+{
+	IWebServer::Headers::iterator iWebSocketKey = a_spRequest->m_Headers.find("Sec-WebSocket-Key");
+	if (iWebSocketKey == a_spRequest->m_Headers.end())
+		return false;
+
+	++m_nRequests;
+	if (InjectError())
+	{
+		++m_nErrors;
+		a_spRequest->m_spConnection->SendResponse(m_nErrorStatus, GetReason(m_nErrorStatus), GetReason(m_nErrorStatus), true);
+		return true;
+	}
+
+	Session::SP spSession(new Session(this, a_bSpeechToText));
+	spSession->m_wpConnection = a_spRequest->m_spConnection;
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+
+		// forget sessions whose connection has gone..
+		for (SessionList::iterator iSession = m_Sessions.begin(); iSession != m_Sessions.end(); )
+		{
+			IWebServer::ConnectionSP spConnection = (*iSession)->m_wpConnection.lock();
+			if (!spConnection || spConnection->IsClosed())
+				iSession = m_Sessions.erase(iSession);
+			else
+				++iSession;
+		}
+		m_Sessions.push_back(spSession);
+	}
+
+	a_spRequest->m_spConnection->SetFrameReceiver(DELEGATE(Session, OnFrame, IWebSocket::FrameSP, spSession));
+	a_spRequest->m_spConnection->StartWebSocket(iWebSocketKey->second);
+	return true;
+}
+
+void MockService::SendFrames(Session * a_pSession, const std::vector<IWebSocket::Frame> & a_Frames, bool a_bClose /*= false*/)
+{
+	Reply * pReply = new Reply();
+	pReply->m_spConnection = a_pSession->m_wpConnection.lock();
+	pReply->m_bWebSocket = true;
+	pReply->m_Frames = a_Frames;
+	pReply->m_bClose = a_bClose;
+	if (!pReply->m_spConnection)
+	{
+		delete pReply;
+		return;
+	}
+
+	// a random latency would re-order the replies, so never send before the last reply on this socket..
+	double fNow = Time().GetEpochTime();
+	double fSend = fNow + GetLatency();
+	if (fSend < a_pSession->m_fLastSend)
+		fSend = a_pSession->m_fLastSend;
+	a_pSession->m_fLastSend = fSend;
+
+	Send(pReply, (float)(fSend - fNow));
+}
+
+void MockService::Send(Reply * a_pReply, float a_fDelay)
+{
+	if (a_fDelay <= 0.0f)
+		OnReply(a_pReply);
+	else if (TimerPool::Instance() != NULL)
+	{
+		a_pReply->m_bDelayed = true;
+		++m_nPending;
+
+		// the timer may fire before StartTimer() returns, OnReply() takes the lock so it waits for m_spTimer..
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		a_pReply->m_spTimer = TimerPool::Instance()->StartTimer<Reply *>(
+			DELEGATE(MockService, OnReply, Reply *, this), a_pReply, a_fDelay, false, false);
+	}
+	else
+	{
+		boost::this_thread::sleep(boost::posix_time::microseconds((boost::int64_t)(a_fDelay * 1000000.0f)));
+		OnReply(a_pReply);
+	}
+}
+
+void MockService::OnReply(Reply * a_pReply)
+{
+	if (a_pReply->m_bDelayed)
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);		// wait for Send() to store m_spTimer
+	}
+
+	IWebServer::ConnectionSP spConnection = a_pReply->m_spConnection;
+	if (!spConnection->IsClosed())
+	{
+		if (a_pReply->m_bWebSocket)
+		{
+			for (size_t i = 0; i < a_pReply->m_Frames.size(); ++i)
+			{
+				const IWebSocket::Frame & frame = a_pReply->m_Frames[i];
+				if (frame.m_Op == IWebSocket::TEXT_FRAME)
+					spConnection->SendText(frame.m_Data);
+				else
+					spConnection->SendBinary(frame.m_Data);
+			}
+			if (a_pReply->m_bClose)
+				spConnection->SendClose("");
+		}
+		else
+			spConnection->SendResponse(a_pReply->m_nStatusCode, GetReason(a_pReply->m_nStatusCode), a_pReply->m_Headers, a_pReply->m_Content);
+	}
+
+	if (a_pReply->m_bDelayed)
+		--m_nPending;
+	delete a_pReply;
+}
+
+//----------------------------------------
+
+void MockService::Route::OnRequest(IWebServer::RequestSP a_spRequest)
+{
+	MockResponse response;
+	{
+		boost::lock_guard<boost::mutex> lock(m_pService->m_Lock);
+		response = m_Responses[m_nNext];
+		m_nNext = (m_nNext + 1) % m_Responses.size();
+	}
+
+	m_pService->Respond(a_spRequest, response.m_StatusCode, response.m_Headers, response.m_Body, response.m_fLatency);
+}
+
+void MockService::Session::OnFrame(IWebSocket::FrameSP a_spFrame)
+{
+	if (m_bSpeechToText)
+		m_pService->OnRecognizeFrame(this, a_spFrame);
+	else
+		m_pService->OnSynthesizeFrame(this, a_spFrame);
+}
+
+void MockService::OnNotFound(IWebServer::RequestSP a_spRequest)
+{
+	++m_nNotFound;
+	Log::Warning("MockService", "No response for %s %s", a_spRequest->m_RequestType.c_str(), a_spRequest->m_EndPoint.c_str());
+
+	IWebServer::Headers headers;
+	headers["Content-Type"] = "application/json";
+	a_spRequest->m_spConnection->SendResponse(404, GetReason(404), headers, "{\"code\":404,\"error\":\"Not Found\"}");
+}
+
+void MockService::OnRecognize(IWebServer::RequestSP a_spRequest)
+{
+	if (StartSession(a_spRequest, true))
+		return;
+
+	MockResponse::Headers headers;
+	headers["Content-Type"] = "application/json";
+
+	std::string results;
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		results = m_SpeechResults;
+	}
+	Respond(a_spRequest, 200, headers, results);
+}
+
+void MockService::OnSynthesize(IWebServer::RequestSP a_spRequest)
+{
+	if (StartSession(a_spRequest, false))
+		return;
+
+	Json::Value json;
+	Json::Reader reader(Json::Features::strictMode());
+	if (!reader.parse(a_spRequest->m_Content, json) || !json["text"].isString())
+	{
+		MockResponse::Headers headers;
+		headers["Content-Type"] = "application/json";
+		Respond(a_spRequest, 400, headers, "{\"code\":400,\"error\":\"Missing text\"}");
+		return;
+	}
+
+	std::string wave;
+	std::vector<std::string> words;
+	Synthesize(json["text"].asString(), wave, words);
+
+	MockResponse::Headers headers;
+	headers["Content-Type"] = "audio/wav";
+	Respond(a_spRequest, 200, headers, wave);
+}
+
+void MockService::OnRecognizeFrame(Session * a_pSession, IWebSocket::FrameSP a_spFrame)
+{
+	std::string results;
+	size_t nBytesPerResult = 0;
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		results = m_SpeechResults;
+		nBytesPerResult = m_nBytesPerResult;
+	}
+
+	std::vector<IWebSocket::Frame> frames;
+	IWebSocket::Frame text;
+	text.m_Op = IWebSocket::TEXT_FRAME;
+
+	if (a_spFrame->m_Op == IWebSocket::TEXT_FRAME)
+	{
+		++m_nRequests;
+
+		Json::Value json;
+		Json::Reader reader(Json::Features::strictMode());
+		std::string action;
+		if (reader.parse(a_spFrame->m_Data, json) && json["action"].isString())
+			action = json["action"].asString();
+
+		if (action == "start")
+		{
+			a_pSession->m_nAudioBytes = 0;
+			text.m_Data = "{\"state\":\"listening\"}";
+			frames.push_back(text);
+		}
+		else if (action == "stop")
+		{
+			if (a_pSession->m_nAudioBytes > 0)
+			{
+				text.m_Data = results;
+				frames.push_back(text);
+			}
+			a_pSession->m_nAudioBytes = 0;
+			text.m_Data = "{\"state\":\"listening\"}";
+			frames.push_back(text);
+		}
+		else if (action != "no-op")
+		{
+			text.m_Data = "{\"error\":\"Unknown action\"}";
+			frames.push_back(text);
+		}
+	}
+	else if (a_spFrame->m_Op == IWebSocket::BINARY_FRAME)
+	{
+		a_pSession->m_nAudioBytes += a_spFrame->m_Data.size();
+		while (a_pSession->m_nAudioBytes >= nBytesPerResult)
+		{
+			a_pSession->m_nAudioBytes -= nBytesPerResult;
+			text.m_Data = results;
+			frames.push_back(text);
+		}
+	}
+
+	if (frames.size() > 0)
+		SendFrames(a_pSession, frames);
+}
+
+void MockService::OnSynthesizeFrame(Session * a_pSession, IWebSocket::FrameSP a_spFrame)
+{
+	if (a_spFrame->m_Op != IWebSocket::TEXT_FRAME)
+		return;
+	++m_nRequests;
+
+	std::vector<IWebSocket::Frame> frames;
+	IWebSocket::Frame frame;
+
+	Json::Value json;
+	Json::Reader reader(Json::Features::strictMode());
+	if (!reader.parse(a_spFrame->m_Data, json) || !json["text"].isString())
+	{
+		frame.m_Op = IWebSocket::TEXT_FRAME;
+		frame.m_Data = "{\"error\":\"Missing text\"}";
+		frames.push_back(frame);
+		SendFrames(a_pSession, frames, true);
+		return;
+	}
+
+	std::string wave;
+	std::vector<std::string> words;
+	Synthesize(json["text"].asString(), wave, words);
+
+	size_t nFrameSize = 0;
+	float fSecondsPerWord = 0.0f;
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		nFrameSize = m_nFrameSize;
+		fSecondsPerWord = m_fSecondsPerWord;
+	}
+
+	frame.m_Op = IWebSocket::BINARY_FRAME;
+	for (size_t nOffset = 0; nOffset < wave.size(); nOffset += nFrameSize)
+	{
+		frame.m_Data = wave.substr(nOffset, nFrameSize);
+		frames.push_back(frame);
+	}
+
+	frame.m_Op = IWebSocket::TEXT_FRAME;
+	for (size_t i = 0; i < words.size(); ++i)
+	{
+		Json::Value timing(Json::arrayValue);
+		timing.append(words[i]);
+		timing.append(i * fSecondsPerWord);
+		timing.append((i + 1) * fSecondsPerWord);
+
+		Json::Value message;
+		message["words"].append(timing);
+		frame.m_Data = Json::FastWriter().write(message);
+		frames.push_back(frame);
+	}
+
+	SendFrames(a_pSession, frames, true);
+}
+
+void MockService::Synthesize(const std::string & a_Text, std::string & a_Wave, std::vector<std::string> & a_Words)
+{
+	float fSecondsPerWord = 0.0f;
+	{
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		fSecondsPerWord = m_fSecondsPerWord;
+	}
+
+	std::vector<std::string> words;
+	StringUtil::Split(a_Text, " \t\r\n", words);
+	for (size_t i = 0; i < words.size(); ++i)
+		if (words[i].size() > 0)
+			a_Words.push_back(words[i]);
+
+	size_t nSamples = (size_t)(a_Words.size() * fSecondsPerWord * SYNTHESIZE_RATE);
+	Sound::SaveWave(a_Wave, SYNTHESIZE_RATE, 1, 16, std::string(nSamples * 2, '\0'));
+}
+
+const char * MockService::GetReason(int a_nStatusCode)
+{
+	switch (a_nStatusCode)
+	{
+	case 200: return "OK";
+	case 201: return "Created";
+	case 204: return "No Content";
+	case 400: return "Bad Request";
+	case 401: return "Unauthorized";
+	case 403: return "Forbidden";
+	case 404: return "Not Found";
+	case 408: return "Request Timeout";
+	case 429: return "Too Many Requests";
+	case 500: return "Internal Server Error";
+	case 502: return "Bad Gateway";
+	case 503: return "Service Unavailable";
+	case 504: return "Gateway Timeout";
+	}
+
+	return a_nStatusCode < 400 ? "OK" : "Error";
+}
@@ -0,0 +1,244 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_MOCK_SERVICE_H
+#define WDC_MOCK_SERVICE_H
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "boost/atomic.hpp"
+#include "boost/noncopyable.hpp"
+#include "boost/random/mersenne_twister.hpp"
+#include "boost/shared_ptr.hpp"
+#include "boost/thread.hpp"
+
+#include "utils/ISerializable.h"
+#include "utils/IWebServer.h"
+#include "utils/TimerPool.h"
+
+class Config;
+
+//! A canned response returned by the MockService, these can be saved to and loaded from a JSON file.
+struct MockResponse : public ISerializable
+{
+	RTTI_DECL();
+
+	//! Types
+	typedef std::map<std::string, std::string>		Headers;
+
+	MockResponse() : m_StatusCode(200), m_fLatency(-1.0f)
+	{}
+	MockResponse(const std::string & a_RequestType, const std::string & a_EndPoint,
+		int a_StatusCode, const std::string & a_Body, const std::string & a_ContentType = "application/json") :
+		m_RequestType(a_RequestType), m_EndPoint(a_EndPoint), m_StatusCode(a_StatusCode), m_Body(a_Body), m_fLatency(-1.0f)
+	{
+		if (a_ContentType.size() > 0)
+			m_Headers["Content-Type"] = a_ContentType;
+	}
+
+	std::string			m_RequestType;		// GET, POST, DELETE, etc.. empty to match any request type
+	std::string			m_EndPoint;			// end-point mask including the service path, see WebRouter
+	int					m_StatusCode;
+	Headers				m_Headers;
+	std::string			m_Body;
+	float				m_fLatency;			// seconds to wait before responding, negative to use MockService::SetLatency()
+
+	//! ISerializable interface
+	virtual void Serialize(Json::Value & json);
+	virtual void Deserialize(const Json::Value & json);
+};
+
+//! In-process stand-in for the Watson services, so services and load tests can run without credentials or a network.
+//!
+//! A service is pointed at the mock with AddServiceConfig(), which sets ServiceConfig::m_URL to GetURL() followed by
+//! the path of the service (e.g. /natural-language-classifier/api). Requests are answered with the canned responses
+//! added with AddResponse() or LoadResponses(), any other request gets a 404. Every response may be delayed by a
+//! random latency and replaced by an error response at a given rate.
+//!
+//! AddSpeechToText() and AddTextToSpeech() emulate the web socket protocols of those services, so SpeechToText::StartListening()
+//! and the streaming TextToSpeech::ToSound() work against the mock as well.
+//!
+//! Delayed responses are sent from the TimerPool, if no TimerPool exists the responding thread sleeps instead.
+class MockService : private boost::noncopyable
+{
+public:
+	//! Types
+	typedef std::vector<MockResponse>		ResponseList;
+
+	//! Construction
+	MockService(int a_nPort = 8090, const std::string & a_Interface = "127.0.0.1", int a_nThreads = 5);
+	~MockService();
+
+	//! Accessors
+	int GetPort() const
+	{
+		return m_nPort;
+	}
+	//! Returns the URL of this server, e.g. http://127.0.0.1:8090
+	std::string GetURL() const;
+	//! Returns the number of requests & web socket messages received
+	boost::uint64_t GetRequestCount() const
+	{
+		return m_nRequests.load(boost::memory_order_relaxed);
+	}
+	//! Returns the number of injected errors
+	boost::uint64_t GetErrorCount() const
+	{
+		return m_nErrors.load(boost::memory_order_relaxed);
+	}
+	//! Returns the number of requests that matched no response
+	boost::uint64_t GetNotFoundCount() const
+	{
+		return m_nNotFound.load(boost::memory_order_relaxed);
+	}
+
+	//! Mutators
+	//! Every response is delayed by a random time between a_fMin and a_fMax seconds.
+	void SetLatency(float a_fMin, float a_fMax);
+	//! Respond to a_fRate (0.0 - 1.0) of the requests with a_nStatusCode instead, web socket
+	//! upgrade requests are refused with the same error.
+	void SetErrorRate(float a_fRate, int a_nStatusCode = 500);
+
+	bool Start();
+	//! Stop the server, this waits for any delayed responses to be sent first.
+	bool Stop();
+
+	//! Add or update the ServiceConfig for a_ServiceId in the given config, or Config::Instance() if NULL, so
+	//! the service sends its requests to this mock. a_Path is the path of the service (e.g. /text-to-speech/api).
+	bool AddServiceConfig(const std::string & a_ServiceId, const std::string & a_Path, Config * a_pConfig = NULL);
+
+	//! Add a canned response, responses may be added while the server is running. When more than one response
+	//! is added for the same request type & end-point they are returned in turn, in the order they were added.
+	void AddResponse(const MockResponse & a_Response);
+	void AddResponse(const std::string & a_RequestType, const std::string & a_EndPoint,
+		int a_StatusCode, const std::string & a_Body, const std::string & a_ContentType = "application/json");
+	//! Load recorded responses from a JSON file, the file contains the responses in a "m_Responses" array.
+	bool LoadResponses(const std::string & a_File);
+	//! Save all canned responses into a file that can be loaded with LoadResponses().
+	bool SaveResponses(const std::string & a_File) const;
+
+	//! Emulate the speech to text web socket at a_Path + /v1/recognize. The server enters the listening state
+	//! on a start action and sends a_Results for every a_nBytesPerResult bytes of audio received, and when
+	//! the stop action is received. HTTP requests to the same end-point get a_Results as the response.
+	void AddSpeechToText(const std::string & a_Path = "/speech-to-text/api",
+		const std::string & a_Results = std::string(), size_t a_nBytesPerResult = 32000);
+	//! Emulate the text to speech web socket at a_Path + /v1/synthesize. Each text message is answered with
+	//! a_fSecondsPerWord of silence for each word in a_nFrameSize binary frames, a words message for each word,
+	//! then the connection is closed. HTTP requests to the same end-point get the audio as a WAV file.
+	void AddTextToSpeech(const std::string & a_Path = "/text-to-speech/api",
+		float a_fSecondsPerWord = 0.3f, size_t a_nFrameSize = 8192);
+
+private:
+	//! Types
+	struct Route
+	{
+		Route(MockService * a_pService) : m_pService(a_pService), m_nNext(0)
+		{}
+
+		void OnRequest(IWebServer::RequestSP a_spRequest);
+
+		MockService *		m_pService;
+		ResponseList		m_Responses;
+		size_t				m_nNext;			// next response to return, guarded by MockService::m_Lock
+	};
+	typedef std::vector<Route *>			RouteList;
+
+	//! State of an emulated web socket connection, frames are received on the main thread
+	struct Session
+	{
+		typedef boost::shared_ptr<Session>	SP;
+
+		Session(MockService * a_pService, bool a_bSpeechToText) : m_pService(a_pService),
+			m_bSpeechToText(a_bSpeechToText), m_nAudioBytes(0), m_fLastSend(0.0)
+		{}
+
+		void OnFrame(IWebSocket::FrameSP a_spFrame);
+
+		MockService *		m_pService;
+		bool				m_bSpeechToText;
+		boost::weak_ptr<IWebServer::IConnection>
+							m_wpConnection;
+		size_t				m_nAudioBytes;		// audio received since the last results
+		double				m_fLastSend;		// time the last reply is sent, replies are never re-ordered
+	};
+	typedef std::list<Session::SP>			SessionList;
+
+	//! A response or web socket frames waiting to be sent
+	struct Reply
+	{
+		Reply() : m_nStatusCode(200), m_bWebSocket(false), m_bClose(false), m_bDelayed(false)
+		{}
+
+		IWebServer::ConnectionSP		m_spConnection;
+		int								m_nStatusCode;
+		IWebServer::Headers				m_Headers;
+		std::string						m_Content;
+		bool							m_bWebSocket;
+		std::vector<IWebSocket::Frame>	m_Frames;
+		bool							m_bClose;		// send a close frame after m_Frames
+		bool							m_bDelayed;		// sent by m_spTimer
+		TimerPool::ITimer::SP			m_spTimer;		// keeps the timer alive until the reply is sent
+	};
+
+	//! Data
+	IWebServer *			m_pServer;
+	int						m_nPort;
+	std::string				m_Interface;
+	bool					m_bActive;
+	mutable boost::mutex	m_Lock;
+	boost::random::mt19937	m_Random;			// for the latency & errors, guarded by m_Lock
+	RouteList				m_Routes;
+	SessionList				m_Sessions;
+	float					m_fMinLatency;
+	float					m_fMaxLatency;
+	float					m_fErrorRate;
+	int						m_nErrorStatus;
+	std::string				m_SpeechResults;
+	size_t					m_nBytesPerResult;
+	float					m_fSecondsPerWord;
+	size_t					m_nFrameSize;
+	boost::atomic<boost::uint64_t>
+							m_nRequests;
+	boost::atomic<boost::uint64_t>
+							m_nErrors;
+	boost::atomic<boost::uint64_t>
+							m_nNotFound;
+	boost::atomic<int>		m_nPending;			// replies waiting on a timer
+
+	float GetLatency();
+	bool InjectError();
+	void Respond(IWebServer::RequestSP a_spRequest, int a_nStatusCode, const MockResponse::Headers & a_Headers,
+		const std::string & a_Body, float a_fLatency = -1.0f);
+	bool StartSession(IWebServer::RequestSP a_spRequest, bool a_bSpeechToText);
+	void SendFrames(Session * a_pSession, const std::vector<IWebSocket::Frame> & a_Frames, bool a_bClose = false);
+	void Send(Reply * a_pReply, float a_fDelay);
+	void OnReply(Reply * a_pReply);
+
+	void OnNotFound(IWebServer::RequestSP a_spRequest);
+	void OnRecognize(IWebServer::RequestSP a_spRequest);
+	void OnSynthesize(IWebServer::RequestSP a_spRequest);
+	void OnRecognizeFrame(Session * a_pSession, IWebSocket::FrameSP a_spFrame);
+	void OnSynthesizeFrame(Session * a_pSession, IWebSocket::FrameSP a_spFrame);
+	void Synthesize(const std::string & a_Text, std::string & a_Wave, std::vector<std::string> & a_Words);
+
+	static const char * GetReason(int a_nStatusCode);
+};
+
+#endif
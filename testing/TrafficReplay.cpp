@@ -0,0 +1,224 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <algorithm>
+
+#include "TrafficReplay.h"
+#include "MockService.h"
+#include "utils/Log.h"
+#include "utils/StringUtil.h"
+#include "utils/ThreadPool.h"
+#include "utils/Trace.h"
+
+#include "boost/thread.hpp"
+
+namespace {
+
+bool CompareTime(const TrafficCapture::Record & a_Left, const TrafficCapture::Record & a_Right)
+{
+	return a_Left.m_fTime < a_Right.m_fTime;
+}
+
+}
+
+TrafficReplay::TrafficReplay() :
+	m_fSpeed(1.0),
+	m_nCompleted(0),
+	m_nErrors(0),
+	m_fElapsed(0.0),
+	m_spLatency(new Metrics::Histogram())
+{}
+
+TrafficReplay::~TrafficReplay()
+{}
+
+bool TrafficReplay::Load(const std::string & a_File, int a_nSources /*= TrafficCapture::SOURCE_SERVICE*/)
+{
+	RecordList records;
+	if (!TrafficCapture::Load(a_File, records))
+		return false;
+
+	RecordList selected;
+	for (size_t i = 0; i < records.size(); ++i)
+		if ((records[i].m_eSource & a_nSources) != 0)
+			selected.push_back(records[i]);
+
+	SetRecords(selected);
+	Log::Status("TrafficReplay", "Loaded %u requests from %s.", (unsigned int)m_Records.size(), a_File.c_str());
+	return true;
+}
+
+void TrafficReplay::SetRecords(const RecordList & a_Records)
+{
+	m_Records.clear();
+	for (size_t i = 0; i < a_Records.size(); ++i)
+		if (a_Records[i].m_nStatusCode != 0)
+			m_Records.push_back(a_Records[i]);
+
+	// records are captured as the requests complete, replay them in the order they were made..
+	std::stable_sort(m_Records.begin(), m_Records.end(), CompareTime);
+}
+
+void TrafficReplay::AddResponses(MockService & a_Mock, bool a_bLatency /*= true*/) const
+{
+	for (size_t i = 0; i < m_Records.size(); ++i)
+	{
+		const TrafficCapture::Record & record = m_Records[i];
+
+		MockResponse response;
+		response.m_RequestType = record.m_RequestType;
+		response.m_EndPoint = GetPath(URL(record.m_URL));
+		response.m_StatusCode = (int)record.m_nStatusCode;
+		response.m_Body = record.m_ResponseBody;
+		if (a_bLatency)
+			response.m_fLatency = (float)record.m_fDuration;
+
+		// the framing headers are written by the mock for the body it sends..
+		for (IWebClient::Headers::const_iterator iHeader = record.m_ResponseHeaders.begin();
+			iHeader != record.m_ResponseHeaders.end(); ++iHeader)
+		{
+			if (StringUtil::Compare(iHeader->first, "Content-Length", true) != 0
+				&& StringUtil::Compare(iHeader->first, "Transfer-Encoding", true) != 0
+				&& StringUtil::Compare(iHeader->first, "Connection", true) != 0)
+				response.m_Headers[iHeader->first] = iHeader->second;
+		}
+
+		a_Mock.AddResponse(response);
+	}
+}
+
+bool TrafficReplay::Run(const std::string & a_URL, double a_fTimeout /*= 30.0*/)
+{
+	ThreadPool * pPool = ThreadPool::Instance();
+	if (pPool == NULL)
+	{
+		Log::Error("TrafficReplay", "Run() requires a ThreadPool.");
+		return false;
+	}
+
+	m_spLatency.reset(new Metrics::Histogram());
+	m_nCompleted = m_nErrors = 0;
+	m_fElapsed = 0.0;
+	if (m_Records.size() == 0)
+		return true;
+
+	std::vector<PendingSP> pending;
+	pending.reserve(m_Records.size());
+
+	double fFirst = m_Records[0].m_fTime;
+	double fStart = Trace::Now();
+	double fLastDone = fStart;
+	boost::uint64_t nLastDone = 0;
+
+	while (m_nCompleted < m_Records.size())
+	{
+		double fNow = Trace::Now();
+		while (pending.size() < m_Records.size())
+		{
+			const TrafficCapture::Record & record = m_Records[pending.size()];
+			double fDue = fStart;
+			if (m_fSpeed > 0.0)
+				fDue += (record.m_fTime - fFirst) / m_fSpeed;
+			if (fDue > fNow)
+				break;
+
+			PendingSP spPending(new Pending(this, pending.size()));
+			spPending->m_fStart = fDue;
+			pending.push_back(spPending);
+
+			IWebClient::Headers headers(record.m_RequestHeaders);
+			headers.erase("Host");
+			headers.erase("Content-Length");
+
+			spPending->m_spClient = IWebClient::Create(URL(a_URL + "/" + URL(record.m_URL).GetEndPoint()));
+			spPending->m_spClient->SetHeaders(headers);
+			spPending->m_spClient->SetRequestType(record.m_RequestType);
+			spPending->m_spClient->SetBody(record.m_RequestBody);
+			spPending->m_spClient->SetDataReceiver(DELEGATE(Pending, OnResponse, IWebClient::RequestData *, spPending));
+			spPending->m_spClient->SetStateReceiver(DELEGATE(Pending, OnState, IWebClient *, spPending));
+			if (!spPending->m_spClient->Send())
+				OnDone(spPending.get(), 0);
+		}
+
+		pPool->ProcessMainThread();
+		boost::this_thread::yield();
+
+		fNow = Trace::Now();
+		if (m_nCompleted != nLastDone)
+		{
+			nLastDone = m_nCompleted;
+			fLastDone = fNow;
+		}
+		else if (pending.size() == m_Records.size() && (fNow - fLastDone) > a_fTimeout)
+		{
+			m_fElapsed = fNow - fStart;
+			Log::Error("TrafficReplay", "Timed out with %llu of %u requests done.",
+				(unsigned long long)m_nCompleted, (unsigned int)m_Records.size());
+			return false;
+		}
+	}
+
+	m_fElapsed = Trace::Now() - fStart;
+	return true;
+}
+
+std::string TrafficReplay::GetReport() const
+{
+	return StringUtil::Format("%llu requests, %llu errors, speed %.1fx, %.3f s, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms",
+		(unsigned long long)m_nCompleted, (unsigned long long)m_nErrors, m_fSpeed, m_fElapsed,
+		m_spLatency->GetQuantile(0.5) * 1000.0, m_spLatency->GetQuantile(0.9) * 1000.0,
+		m_spLatency->GetQuantile(0.99) * 1000.0, m_spLatency->GetMax() * 1000.0);
+}
+
+void TrafficReplay::OnDone(Pending * a_pPending, unsigned int a_nStatusCode)
+{
+	if (a_pPending->m_bDone)
+		return;
+
+	a_pPending->m_bDone = true;
+	m_spLatency->Record(Trace::Now() - a_pPending->m_fStart);
+	m_nCompleted += 1;
+
+	const TrafficCapture::Record & record = m_Records[a_pPending->m_nRecord];
+	if (a_nStatusCode != record.m_nStatusCode)
+	{
+		Log::Warning("TrafficReplay", "%s %s returned %u, captured %u.", record.m_RequestType.c_str(),
+			record.m_URL.c_str(), a_nStatusCode, record.m_nStatusCode);
+		m_nErrors += 1;
+	}
+
+	IWebClient::Free(a_pPending->m_spClient);
+	a_pPending->m_spClient.reset();
+}
+
+void TrafficReplay::Pending::OnResponse(IWebClient::RequestData * a_pResponse)
+{
+	if (a_pResponse->m_bDone)
+		m_pReplay->OnDone(this, a_pResponse->m_StatusCode);
+}
+
+void TrafficReplay::Pending::OnState(IWebClient * a_pClient)
+{
+	if (a_pClient->GetState() == IWebClient::DISCONNECTED)
+		m_pReplay->OnDone(this, 0);
+}
+
+std::string TrafficReplay::GetPath(const URL & a_URL)
+{
+	const std::string & endPoint = a_URL.GetEndPoint();
+	return "/" + endPoint.substr(0, endPoint.find('?'));
+}
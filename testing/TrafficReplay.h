@@ -0,0 +1,134 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef WDC_TRAFFIC_REPLAY_H
+#define WDC_TRAFFIC_REPLAY_H
+
+#include <string>
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+#include "boost/scoped_ptr.hpp"
+#include "boost/shared_ptr.hpp"
+
+#include "utils/IWebClient.h"
+#include "utils/Metrics.h"
+#include "utils/TrafficCapture.h"
+
+class MockService;
+
+//! Replays the requests from a TrafficCapture file against a MockService, so a perf regression run can use
+//! the requests a device really made.
+//!
+//! AddResponses() loads the captured responses into the mock, each end-point answers with its captured responses
+//! in the order they were captured and after the same time the real service took. Run() then sends the captured
+//! requests to the mock at the times they were made, or faster with SetSpeed(), and measures their latency.
+//!
+//! Requests that got no response (a failed connection or a timeout) are not replayed.
+class TrafficReplay : private boost::noncopyable
+{
+public:
+	//! Types
+	typedef TrafficCapture::RecordList		RecordList;
+
+	//! Construction
+	TrafficReplay();
+	~TrafficReplay();
+
+	//! Accessors
+	const RecordList & GetRecords() const
+	{
+		return m_Records;
+	}
+	double GetSpeed() const
+	{
+		return m_fSpeed;
+	}
+	boost::uint64_t GetCompleted() const
+	{
+		return m_nCompleted;
+	}
+	//! Returns the number of requests that failed or got a different status code to the captured one
+	boost::uint64_t GetErrors() const
+	{
+		return m_nErrors;
+	}
+	//! Returns the seconds taken by the last Run()
+	double GetElapsed() const
+	{
+		return m_fElapsed;
+	}
+	const Metrics::Histogram & GetLatency() const
+	{
+		return *m_spLatency;
+	}
+
+	//! Mutators
+	//! Load the records of the given sources (a mask of TrafficCapture::Source) from a capture file.
+	bool Load(const std::string & a_File, int a_nSources = TrafficCapture::SOURCE_SERVICE);
+	void SetRecords(const RecordList & a_Records);
+	//! Replay a_fSpeed times faster than the requests were made, 0 sends every request at once.
+	void SetSpeed(double a_fSpeed)
+	{
+		m_fSpeed = a_fSpeed;
+	}
+
+	//! Add the captured responses to the mock, if a_bLatency is true each response is delayed by the
+	//! time the captured request took.
+	void AddResponses(MockService & a_Mock, bool a_bLatency = true) const;
+	//! Send the captured requests to a_URL (e.g. MockService::GetURL()), this must be called from the main
+	//! thread and processes the main thread until every request is done. Returns false if no request
+	//! completes for a_fTimeout seconds.
+	bool Run(const std::string & a_URL, double a_fTimeout = 30.0);
+	//! Returns a one line summary of the last Run()
+	std::string GetReport() const;
+
+private:
+	//! Types
+	struct Pending
+	{
+		Pending(TrafficReplay * a_pReplay, size_t a_nRecord) : m_pReplay(a_pReplay), m_nRecord(a_nRecord),
+			m_fStart(0.0), m_bDone(false)
+		{}
+
+		void OnResponse(IWebClient::RequestData * a_pResponse);
+		void OnState(IWebClient * a_pClient);
+
+		TrafficReplay *		m_pReplay;
+		size_t				m_nRecord;
+		double				m_fStart;		// time the request was due
+		bool				m_bDone;
+		IWebClient::SP		m_spClient;
+	};
+	typedef boost::shared_ptr<Pending>		PendingSP;
+
+	//! Data
+	RecordList			m_Records;
+	double				m_fSpeed;
+	boost::uint64_t		m_nCompleted;
+	boost::uint64_t		m_nErrors;
+	double				m_fElapsed;
+	boost::scoped_ptr<Metrics::Histogram>
+						m_spLatency;
+
+	void OnDone(Pending * a_pPending, unsigned int a_nStatusCode);
+
+	//! Returns the path of a URL without the query string
+	static std::string GetPath(const URL & a_URL);
+};
+
+#endif
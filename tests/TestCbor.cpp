@@ -0,0 +1,110 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <math.h>
+
+#include "UnitTest.h"
+#include "utils/Cbor.h"
+#include "services/SpeechToText/DataModels.h"
+
+class TestCbor : UnitTest
+{
+public:
+	//! Construction
+	TestCbor() : UnitTest("TestCbor")
+	{}
+
+	virtual void RunTest()
+	{
+		// every value reads back as JSON text would..
+		Json::Value root;
+		root["int"] = -12345;
+		root["small"] = 7;
+		root["int64"] = Json::Value::minLargestInt;
+		root["uint"] = 4000000000u;
+		root["uint64"] = Json::Value::maxLargestUInt;
+		root["float"] = 0.5;
+		root["double"] = 0.1;
+		root["bool"] = true;
+		root["null"] = Json::Value();
+		root["string"] = "caf\xc3\xa9 \"quoted\"";
+		root["embedded"] = Json::Value("a\0b", "a\0b" + 3);
+		root["empty_array"] = Json::Value(Json::arrayValue);
+		root["empty_object"] = Json::Value(Json::objectValue);
+		root["array"][0] = 1;
+		root["array"][1]["nested"][0] = "deep";
+
+		std::string data(Cbor::Write(root));
+		Test(Cbor::IsCbor(data));
+		Test(data.size() < Json::FastWriter().write(root).size());
+
+		Json::Value read;
+		Test(Cbor::Read(data, read));
+		Test(Json::FastWriter().write(read) == Json::FastWriter().write(root));
+		Test(read["int64"].asLargestInt() == Json::Value::minLargestInt);
+		Test(read["uint64"].type() == Json::uintValue && read["uint64"].asLargestUInt() == Json::Value::maxLargestUInt);
+		Test(read["float"].type() == Json::realValue);
+		Test(read["embedded"].asString().size() == 3);
+
+		// values written by other encoders (RFC 7049 appendix A)..
+		Test(Cbor::Read(std::string("\x19\x03\xe8", 3), read) && read.asInt() == 1000);
+		Test(Cbor::Read(std::string("\x38\x63", 2), read) && read.asInt() == -100);
+		Test(Cbor::Read(std::string("\xf9\x3c\x00", 3), read) && read.asDouble() == 1.0);
+		Test(Cbor::Read(std::string("\xf9\xc4\x00", 3), read) && read.asDouble() == -4.0);
+		Test(Cbor::Read(std::string("\xf9\x7c\x00", 3), read) && read.asDouble() > 1e308);
+		Test(Cbor::Read(std::string("\xf7", 1), read) && read.isNull());
+		Test(Cbor::Read(std::string("\xc1\x1a\x51\x4b\x67\xb0", 6), read) && read.asUInt() == 1363896240u);
+		Test(Cbor::Read(std::string("\x9f\x01\x82\x02\x03\x9f\x04\x05\xff\xff", 10), read)
+			&& read.size() == 3 && read[1][1].asInt() == 3 && read[2][1].asInt() == 5);
+		Test(Cbor::Read(std::string("\x7f\x65strea\x64ming\xff", 13), read) && read.asString() == "streaming");
+		Test(Cbor::Read(std::string("\xa2\x61\x61\x01\x61\x62\x82\x02\x03", 9), read)
+			&& read["a"].asInt() == 1 && read["b"][1].asInt() == 3);
+
+		// errors..
+		std::string error;
+		Test(!Cbor::Read(data.substr(0, data.size() - 1), read, &error) && read.isNull());
+		Test(error.size() > 0);
+		Test(!Cbor::Read(std::string("\xa1\x01\x02", 3), read));
+		Test(!Cbor::Read(std::string("\x01\x02", 2), read));
+		Test(!Cbor::Read(std::string("\xff", 1), read));
+		Test(!Cbor::Read(std::string("\x9f\x01", 2), read));
+		Test(!Cbor::Read(std::string("\x5b\xff\xff\xff\xff\xff\xff\xff\xff", 9), read));
+		Test(!Cbor::Read(std::string(), read));
+
+		// CBOR or JSON text..
+		Test(Cbor::ParseData(data, read) && read["array"] == root["array"]);
+		Test(Cbor::ParseData("{\"a\":[1,2]}", read) && read["a"][1].asInt() == 2);
+		Test(!Cbor::ParseData("{\"a\":", read, &error));
+
+		// objects in a binary file..
+		RecognizeResults results;
+		results.m_ResultIndex = 3;
+		results.m_Results.push_back(SpeechResult());
+		results.m_Results[0].m_Final = true;
+		results.m_Results[0].m_Alternatives.push_back(SpeechAlt());
+		results.m_Results[0].m_Alternatives[0].m_Transcript = "hello";
+		results.m_Results[0].m_Alternatives[0].m_Confidence = 0.75;
+		Test(ISerializable::SerializeToBinaryFile("test.cbor", &results, false));
+
+		RecognizeResults loaded;
+		Test(ISerializable::DeserializeFromFile("test.cbor", &loaded) != NULL);
+		Test(loaded.m_ResultIndex == 3 && loaded.HasFinalResult() && loaded.GetConfidence() == 0.75);
+		Test(ISerializable::DeserializeObject(ISerializable::SerializeToBinary(&results, false), &loaded) != NULL);
+	}
+};
+
+TestCbor TEST_CBOR;
@@ -0,0 +1,188 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <fstream>
+
+#include "boost/filesystem.hpp"
+
+#include "UnitTest.h"
+#include "utils/Config.h"
+#include "services/SpeechToText/SpeechToText.h"
+#include "services/TextToSpeech/TextToSpeech.h"
+
+class TestConfig : UnitTest
+{
+public:
+	//! Construction
+	TestConfig() : UnitTest("TestConfig")
+	{}
+
+	virtual void RunTest()
+	{
+		TestServices();
+		TestServiceConfigs();
+		TestWatch();
+	}
+
+	void TestServices()
+	{
+		Config config;
+		Test(config.FindService<TextToSpeech>() == NULL);
+
+		TextToSpeech * pTTS = new TextToSpeech();
+		Test(config.AddService(pTTS));
+		Test(config.FindService<TextToSpeech>() == pTTS);
+		Test(config.FindService<TextToSpeech>() == pTTS);
+		Test(config.FindService<TextToSpeech>("TextToSpeechV1") == pTTS);
+		Test(config.FindService<TextToSpeech>("SpeechToTextV1") == NULL);
+		Test(config.FindService<SpeechToText>() == NULL);
+
+		// adding a service updates the cached results..
+		SpeechToText * pSTT = config.GetService<SpeechToText>();
+		Test(pSTT != NULL);
+		Test(config.FindService<SpeechToText>() == pSTT);
+		Test(config.FindService<IService>() == pTTS);
+		Test(config.FindService<IService>("SpeechToTextV1") == pSTT);
+
+		std::vector<IService *> services;
+		Test(config.FindServices(services) == 2);
+
+		Test(config.RemoveService(pTTS));
+		Test(config.FindService<TextToSpeech>() == NULL);
+		Test(config.FindService<IService>() == pSTT);
+	}
+
+	void TestServiceConfigs()
+	{
+		Config config;
+		Test(!config.FindServiceConfig("TextToSpeechV1"));
+
+		ServiceConfig tts;
+		tts.m_ServiceId = "TextToSpeechV1";
+		tts.m_URL = "http://localhost/text-to-speech/api";
+		tts.m_User = "user";
+		tts.m_Password = "password";
+		Test(config.AddServiceConfig(tts));
+		Test(!config.AddServiceConfig(tts));
+		Test(!config.AddServiceConfig(MakeConfig("SpeechToTextV1", "http://localhost/speech-to-text/api"), true));
+
+		TextToSpeech * pTTS = new TextToSpeech();
+		Test(config.AddService(pTTS));
+		Test(pTTS->Start());
+		Test(pTTS->GetHeaders().find("Authorization") != pTTS->GetHeaders().end());
+		std::string auth = pTTS->GetHeaders().find("Authorization")->second;
+
+		// an update replaces the config, a pointer to the old one still reads the old values..
+		ServiceConfig::SP spOld = config.FindServiceConfig("TextToSpeechV1");
+		Test(spOld && spOld->m_User == "user");
+		tts.m_User = "rotated";
+		Test(config.AddServiceConfig(tts));
+		Test(spOld->m_User == "user");
+		Test(config.FindServiceConfig("TextToSpeechV1")->m_User == "rotated");
+		Test(pTTS->GetConfig()->m_User == "rotated");
+		Test(pTTS->GetHeaders().find("Authorization")->second != auth);
+
+		Test(config.AddServiceConfig(MakeConfig("SpeechToTextV1", "http://localhost/speech-to-text/api")));
+		Test(config.GetSnapshot()->m_ServiceConfigs.size() == 2);
+		Test(config.RemoveServiceConfig("SpeechToTextV1"));
+		Test(!config.RemoveServiceConfig("SpeechToTextV1"));
+		Test(!config.FindServiceConfig("SpeechToTextV1"));
+
+		// a reload applies only what changed..
+		ServiceConfig stt = MakeConfig("SpeechToTextV1", "http://localhost/stt");
+		Json::Value json;
+		json["m_ServiceConfigs"][0] = ISerializable::SerializeObject(&tts, false);
+		json["m_ServiceConfigs"][1] = ISerializable::SerializeObject(&stt, false);
+		Test(config.ReloadServiceConfigs(json) == 1);
+		Test(config.ReloadServiceConfigs(json) == 0);
+		Test(config.FindServiceConfig("SpeechToTextV1")->m_URL == "http://localhost/stt");
+
+		// ..and a config without the list is rejected rather than removing everything
+		Json::Value empty;
+		empty["m_Libs"][0] = "lib";
+		Test(config.ReloadServiceConfigs(empty) < 0);
+		empty["m_ServiceConfigs"] = "none";
+		Test(config.ReloadServiceConfigs(empty) < 0);
+		Test(config.GetSnapshot()->m_ServiceConfigs.size() == 2);
+
+		pTTS->Stop();
+	}
+
+	void TestWatch()
+	{
+		ThreadPool pool(1);
+		TimerPool timers;
+		Config config;
+
+		ServiceConfig stt = MakeConfig("SpeechToTextV1", "http://localhost/a/speech-to-text/api");
+		WriteConfig(stt);
+		Test(config.ReloadServiceConfigs(std::string("test_config.json")) == 1);
+		Test(config.ReloadServiceConfigs(std::string("nofile.json")) < 0);
+
+		// the service updates its headers on the main thread..
+		SpeechToText * pSTT = new SpeechToText();
+		Test(config.AddService(pSTT));
+		Test(pSTT->Start());
+		ServiceConfig rotated = MakeConfig("SpeechToTextV1", "http://localhost/b/speech-to-text/api");
+		rotated.m_User = "user";
+		rotated.m_Password = "password";
+		Test(config.AddServiceConfig(rotated));
+		Test(pSTT->GetHeaders().find("Authorization") == pSTT->GetHeaders().end());
+		Test(pSTT->GetConfig()->m_URL == stt.m_URL);
+		pool.ProcessMainThread();
+		Test(pSTT->GetHeaders().find("Authorization") != pSTT->GetHeaders().end());
+		Test(pSTT->GetConfig()->m_URL == rotated.m_URL);
+
+		Test(config.WatchFile("test_config.json", 0.05f));
+
+		// the size of the file changes too, so the reload doesn't depend on the resolution of the file time..
+		stt.m_URL = "http://localhost/changed/speech-to-text/api";
+		WriteConfig(stt);
+
+		bool bReloaded = false;
+		for (int i = 0; i < 100 && !bReloaded; ++i)
+		{
+			pool.ProcessMainThread();
+			boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+			bReloaded = config.FindServiceConfig("SpeechToTextV1")->m_URL == stt.m_URL;
+		}
+		Test(bReloaded);
+		Test(pSTT->GetConfig()->m_URL != stt.m_URL);
+		pool.ProcessMainThread();
+		Test(pSTT->GetConfig()->m_URL == stt.m_URL);
+		config.StopWatching();
+		boost::filesystem::remove("test_config.json");
+	}
+
+	static ServiceConfig MakeConfig(const std::string & a_ServiceId, const std::string & a_URL)
+	{
+		ServiceConfig config;
+		config.m_ServiceId = a_ServiceId;
+		config.m_URL = a_URL;
+		return config;
+	}
+
+	static void WriteConfig(ServiceConfig & a_Config)
+	{
+		Json::Value json;
+		json["m_ServiceConfigs"][0] = ISerializable::SerializeObject(&a_Config, false);
+		std::ofstream output("test_config.json");
+		output << Json::FastWriter().write(json);
+	}
+};
+
+TestConfig TEST_CONFIG;
@@ -0,0 +1,152 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/Coroutine.h"
+
+// this test is only built when the tests are compiled with coroutine support
+#if defined(WDC_HAS_COROUTINES)
+
+#include "UnitTest.h"
+#include "utils/StringUtil.h"
+#include "utils/ThreadPool.h"
+#include "utils/TimerPool.h"
+
+class TestCoroutine : UnitTest
+{
+public:
+	//! Construction
+	TestCoroutine() : UnitTest("TestCoroutine"), m_nSteps(0)
+	{}
+
+	virtual void RunTest()
+	{
+		TestAwait();
+		TestErrors();
+		TestCancel();
+		TestPools();
+	}
+
+	void TestAwait()
+	{
+		Promise<int> promise;
+		Future<std::string> text = ToText(promise.GetFuture());
+		Test(text.IsPending());
+
+		promise.SetValue(5);
+		Test(text.IsReady() && text.GetValue() == "5");
+
+		// a future that's already complete doesn't suspend..
+		Test(ToText(promise.GetFuture()).GetValue() == "5");
+
+		// frames are reused once freed..
+		void * pFrame = CoroutineFramePool::Allocate(100);
+		CoroutineFramePool::Free(pFrame, 100);
+		Test(CoroutineFramePool::GetFreeCount(100) > 0);
+		Test(CoroutineFramePool::Allocate(90) == pFrame);
+		CoroutineFramePool::Free(pFrame, 90);
+	}
+
+	void TestErrors()
+	{
+		Promise<int> promise;
+		Future<std::string> text = ToText(promise.GetFuture());
+		promise.SetError("lost");
+		Test(text.GetStatus() == FutureState::FAILED && text.GetError() == "lost");
+
+		Future<int> thrown = Throw();
+		Test(thrown.GetStatus() == FutureState::FAILED && thrown.GetError() == "thrown");
+	}
+
+	void TestCancel()
+	{
+		Promise<int> first;
+		Promise<int> second;
+		m_nSteps = 0;
+		Future<int> sum = Sum(first.GetFuture(), second.GetFuture());
+
+		// canceling the coroutine cancels the future it's waiting on..
+		Test(sum.Cancel());
+		Test(first.GetFuture().IsCanceled());
+		Test(m_nSteps == 0);
+		Test(second.GetFuture().IsPending());
+
+		// ..and it stops at the next co_await
+		Promise<int> a, b;
+		Future<int> stopped = Sum(a.GetFuture(), b.GetFuture());
+		a.SetValue(1);
+		Test(m_nSteps == 1);
+		stopped.Cancel();
+		Test(b.GetFuture().IsCanceled());
+	}
+
+	void TestPools()
+	{
+		ThreadPool pool(2);
+		TimerPool timers;
+
+		m_nSteps = 0;
+		m_MainThread = boost::this_thread::get_id();
+		Future<int> slept = SleepThenSwitch();
+		Test(slept.IsPending());
+		Spin(m_nSteps, 1);
+		Test(m_nSteps == 1);
+
+		for (int i = 0; i < 1000 && slept.IsPending(); ++i)
+			boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+		Test(slept.IsReady() && slept.GetValue() == 1);
+	}
+
+	static Future<std::string> ToText(Future<int> a_Value)
+	{
+		int nValue = co_await a_Value;
+		co_return StringUtil::Format("%d", nValue);
+	}
+
+	static Future<int> Throw()
+	{
+		throw WatsonException("thrown");
+		co_return 0;
+	}
+
+	Future<int> Sum(Future<int> a_First, Future<int> a_Second)
+	{
+		int nFirst = co_await a_First;
+		m_nSteps += 1;
+		int nSecond = co_await a_Second;
+		m_nSteps += 1;
+		co_return nFirst + nSecond;
+	}
+
+	Future<int> SleepThenSwitch()
+	{
+		co_await Coroutine::Sleep(0.01);
+		Test(boost::this_thread::get_id() == m_MainThread);
+		m_nSteps += 1;
+
+		co_await Coroutine::SwitchTo(FutureState::THREAD_POOL);
+		Test(boost::this_thread::get_id() != m_MainThread);
+		co_return m_nSteps;
+	}
+
+private:
+	int					m_nSteps;
+	boost::thread::id	m_MainThread;
+};
+
+TestCoroutine TEST_COROUTINE;
+
+#endif
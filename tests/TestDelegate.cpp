@@ -15,6 +15,7 @@
 *
 */
 
+#include <boost/bind.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
 
@@ -38,11 +39,49 @@ public:
 			m_InvokeCount += 1;
 		}
 
+		//! drops the last reference to this object while it's being invoked
+		void ReleaseSelf(SP * a_pSelf)
+		{
+			a_pSelf->reset();
+			m_InvokeCount += 1;
+		}
+
 		int m_InvokeCount;
 	};
 
+	//! A function object too large to be stored inside the delegate
+	struct LargeFunctor
+	{
+		LargeFunctor(int * a_pTotal) : m_pTotal(a_pTotal)
+		{
+			sm_nAlive += 1;
+			for (int i = 0; i < 8; ++i)
+				m_Values[i] = i;
+		}
+		LargeFunctor(const LargeFunctor & a_Copy) : m_pTotal(a_Copy.m_pTotal)
+		{
+			sm_nAlive += 1;
+			for (int i = 0; i < 8; ++i)
+				m_Values[i] = a_Copy.m_Values[i];
+		}
+		~LargeFunctor()
+		{
+			sm_nAlive -= 1;
+		}
+
+		void operator()(int a)
+		{
+			*m_pTotal += a + m_Values[7];
+		}
+
+		int *	m_pTotal;
+		double	m_Values[8];
+
+		static int sm_nAlive;
+	};
+
 	//! Construction
-	TestDelegate() : m_DelegateInvoked( false ), UnitTest( "TestDelegate" )
+	TestDelegate() : UnitTest( "TestDelegate" ), m_DelegateInvoked( false ), m_nTotal( 0 )
 	{}
 
 	virtual void RunTest()
@@ -61,6 +100,58 @@ public:
 		Test( spObject->m_InvokeCount == 1 );
 		spObject.reset();
 		Test(! voidDelegate() );			// test that we failed..
+
+		TestFunctors();
+	}
+
+	void TestFunctors()
+	{
+		// member functions, function objects & copies of both..
+		Delegate<int> d = DELEGATE( TestDelegate, Add, int, this );
+		Delegate<int> copy( d );
+		m_nTotal = 0;
+		UnitTest::Test( copy( 2 ) && m_nTotal == 2 );
+		UnitTest::Test( copy.IsObject( this ) && copy.IsValid() );
+
+		d = FUNCTOR_DELEGATE( int, boost::bind( &TestDelegate::AddTwo, this, _1, 10 ) );
+		copy = d;
+		d.Reset();
+		UnitTest::Test( !d.IsValid() && !d( 1 ) );
+		UnitTest::Test( copy( 1 ) && m_nTotal == 13 );
+
+		{
+			Delegate<int> large = FUNCTOR_DELEGATE( int, LargeFunctor( &m_nTotal ) );
+			Delegate<int> largeCopy( large );
+			UnitTest::Test( LargeFunctor::sm_nAlive == 2 );
+			large = copy;
+			UnitTest::Test( LargeFunctor::sm_nAlive == 1 );
+			UnitTest::Test( largeCopy( 1 ) && m_nTotal == 21 );
+		}
+		UnitTest::Test( LargeFunctor::sm_nAlive == 0 );
+
+		VoidDelegate v = VOID_FUNCTOR_DELEGATE( boost::bind( &TestDelegate::Add, this, 100 ) );
+		VoidDelegate vCopy;
+		vCopy = v;
+		UnitTest::Test( vCopy() && m_nTotal == 121 );
+
+		// a weak object is kept alive until the call returns..
+		TestObject::SP spObject( new TestObject() );
+		Delegate<TestObject::SP *> release = DELEGATE( TestObject, ReleaseSelf, TestObject::SP *, spObject );
+		Delegate<TestObject::SP *> releaseCopy( release );
+		TestObject::WP wpObject( spObject );
+		UnitTest::Test( releaseCopy( &spObject ) );
+		UnitTest::Test( !spObject && wpObject.expired() );
+		UnitTest::Test( !release( &spObject ) );
+	}
+
+	void Add( int a )
+	{
+		m_nTotal += a;
+	}
+
+	void AddTwo( int a, int b )
+	{
+		m_nTotal += a + b;
 	}
 
 	void Test( int a )
@@ -71,6 +162,9 @@ public:
 
 private:
 	bool m_DelegateInvoked;
+	int m_nTotal;
 };
 
+int TestDelegate::LargeFunctor::sm_nAlive = 0;
+
 TestDelegate TEST_DELEGATE;
@@ -17,6 +17,7 @@
 
 #include "UnitTest.h"
 #include "utils/Factory.h"
+#include "utils/StringUtil.h"
 
 namespace TestFactoryClasses {
 
@@ -25,6 +26,8 @@ namespace TestFactoryClasses {
 	public:
 		Base() 
 		{}
+		virtual ~Base()
+		{}
 
 		virtual int GetDepth()
 		{
@@ -103,6 +106,69 @@ public:
 		pObject1 = NULL;
 		pObject2 = NULL;
 		pObject3 = NULL;
+
+		TestTable();
+	}
+
+	void TestTable()
+	{
+		BaseFactory factory;
+
+		// "aB" and "b!" have the same hash..
+		Test(StringHash::DJB("aB") == StringHash::DJB("b!"));
+		RegisterWithFactory<TestA> * pRegA = new RegisterWithFactory<TestA>("aB", factory);
+		RegisterWithFactory<TestB> * pRegB = new RegisterWithFactory<TestB>("b!", factory);
+		Base * pObject = factory.CreateObject("b!");
+		Test(pObject != NULL && pObject->GetDepth() == 2);
+		delete pObject;
+		delete pRegA;
+		Test(factory.CreateObject("aB") == NULL);
+		pObject = factory.CreateObject("b!");
+		Test(pObject != NULL && pObject->GetDepth() == 2);
+		delete pObject;
+		delete pRegB;
+		Test(factory.GetCount() == 0);
+
+		// grow the table, then remove every other class..
+		std::vector< RegisterWithFactory<TestA> * > registered;
+		for (int i = 0; i < 200; ++i)
+			registered.push_back(new RegisterWithFactory<TestA>(StringUtil::Format("Class%d", i), factory));
+		Test(factory.GetCount() == 200);
+
+		unsigned int nVersion = factory.GetVersion();
+		for (size_t i = 0; i < registered.size(); i += 2)
+		{
+			delete registered[i];
+			registered[i] = NULL;
+		}
+		Test(factory.GetVersion() != nVersion);
+		Test(factory.GetCount() == 100);
+		for (int i = 0; i < 200; ++i)
+			Test((factory.FindCreator(StringUtil::Format("Class%d", i)) != NULL) == ((i % 2) != 0));
+
+		// an override replaces the class for an ID..
+		RegisterWithFactory<TestB> * pOverride = new RegisterWithFactory<TestB>("Class1", factory, true);
+		Test(factory.IsOverride("Class1") && !factory.IsOverride("Class3"));
+		pObject = factory.CreateObject("Class1");
+		Test(pObject != NULL && pObject->GetDepth() == 2);
+		delete pObject;
+		delete pOverride;
+
+		// objects are created in order of their ID, not the order of the table..
+		RegisterWithFactory<TestB> * pFirst = new RegisterWithFactory<TestB>("A", factory);
+		RegisterWithFactory<TestB> * pLast = new RegisterWithFactory<TestB>("Z", factory);
+		std::list<Base *> objects;
+		factory.CreateAllObjects(objects);
+		Test(objects.size() == 101);
+		Test(objects.front()->GetDepth() == 2 && objects.back()->GetDepth() == 2);
+		for (std::list<Base *>::iterator iObject = objects.begin(); iObject != objects.end(); ++iObject)
+			delete *iObject;
+		delete pFirst;
+		delete pLast;
+
+		for (size_t i = 0; i < registered.size(); ++i)
+			delete registered[i];
+		Test(factory.GetCount() == 0);
 	}
 
 };
@@ -0,0 +1,224 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <boost/bind.hpp>
+
+#include "UnitTest.h"
+#include "utils/Future.h"
+#include "utils/StringUtil.h"
+#include "utils/ThreadPool.h"
+
+class TestFuture : UnitTest
+{
+public:
+	//! Construction
+	TestFuture() : UnitTest("TestFuture"), m_nCallbacks(0), m_nCanceled(0)
+	{}
+
+	virtual void RunTest()
+	{
+		TestThen();
+		TestCancel();
+		TestWhen();
+		TestExecutors();
+	}
+
+	void TestThen()
+	{
+		Promise<int> promise;
+		Future<int> future = promise.GetFuture();
+		Test(future.IsPending());
+
+		m_nCallbacks = 0;
+		future.Then(DELEGATE(TestFuture, OnInt, const Future<int> &, this));
+		Future<std::string> text = future.Then<std::string>(boost::bind(&TestFuture::ToText, _1, _2));
+		Test(m_nCallbacks == 0 && text.IsPending());
+
+		Test(promise.SetValue(42));
+		Test(!promise.SetValue(43));
+		Test(future.IsReady() && future.GetValue() == 42);
+		Test(m_nCallbacks == 1);
+		Test(text.IsReady() && text.GetValue() == "42");
+
+		// callbacks added once complete are invoked now..
+		future.Then(DELEGATE(TestFuture, OnInt, const Future<int> &, this));
+		Test(m_nCallbacks == 2);
+
+		// a step that throws fails the next future..
+		Future<std::string> failed = future.Then<std::string>(boost::bind(&TestFuture::Throw, _1, _2));
+		Test(failed.GetStatus() == FutureState::FAILED && failed.GetError() == "step failed");
+
+		// the callback passed to a service resolves the promise, NULL is a failure..
+		Promise< boost::shared_ptr<std::string> > owned;
+		owned.GetCallback()(new std::string("owned"));
+		Test(owned.GetFuture().IsReady() && *owned.GetFuture().GetValue() == "owned");
+
+		Future<std::string *> null = Promise<std::string *>::Start(boost::bind(&TestFuture::CallNull, _1));
+		Test(null.GetStatus() == FutureState::FAILED);
+
+		// the future fails if every promise is destroyed..
+		Future<int> broken;
+		{
+			Promise<int> abandoned;
+			Promise<int> copy(abandoned);
+			broken = copy.GetFuture();
+		}
+		Test(broken.GetStatus() == FutureState::FAILED);
+	}
+
+	void TestCancel()
+	{
+		Promise<int> first;
+		m_nCanceled = 0;
+		first.GetState()->AddCanceler(VOID_DELEGATE(TestFuture, OnCanceled, this));
+
+		Future<std::string> second = first.GetFuture().Then<std::string>(boost::bind(&TestFuture::ToText, _1, _2));
+		Test(second.Cancel());
+		Test(!second.Cancel());
+		Test(second.IsCanceled());
+		Test(first.GetFuture().IsCanceled() && m_nCanceled == 1);
+		Test(!first.SetValue(1));
+
+		// futures started inside a step are canceled with it..
+		Promise<int> outer;
+		Future<int> inner;
+		Future<int> step = outer.GetFuture().Then<int>(boost::bind(&TestFuture::StartInner, this, &inner, _1, _2));
+		outer.SetValue(1);
+		Test(inner.IsPending() && step.IsPending());
+		step.Cancel();
+		Test(inner.IsCanceled());
+		m_Held.Reset();
+		m_HeldNext = Promise<int>();
+
+		// a canceler added after the cancel is invoked now..
+		first.GetState()->AddCanceler(VOID_DELEGATE(TestFuture, OnCanceled, this));
+		Test(m_nCanceled == 2);
+	}
+
+	void TestWhen()
+	{
+		std::vector< Promise<int> > promises;
+		std::vector< Future<int> > futures;
+		for (size_t i = 0; i < 3; ++i)
+		{
+			promises.push_back(Promise<int>());
+			futures.push_back(promises[i].GetFuture());
+		}
+
+		Future< std::vector< Future<int> > > all = WhenAll(futures);
+		Future<size_t> any = WhenAny(futures);
+		Test(all.IsPending() && any.IsPending());
+
+		promises[1].SetValue(1);
+		Test(any.IsReady() && any.GetValue() == 1);
+		Test(all.IsPending());
+		promises[0].SetError("failed");
+		promises[2].SetValue(2);
+		Test(all.IsReady() && all.GetValue().size() == 3);
+		Test(all.GetValue()[0].GetStatus() == FutureState::FAILED && all.GetValue()[2].GetValue() == 2);
+
+		Test(WhenAll(std::vector< Future<int> >()).IsReady());
+
+		// canceling the group cancels each future..
+		Promise<int> a, b;
+		std::vector< Future<int> > pair;
+		pair.push_back(a.GetFuture());
+		pair.push_back(b.GetFuture());
+		WhenAll(pair).Cancel();
+		Test(a.GetFuture().IsCanceled() && b.GetFuture().IsCanceled());
+
+		// a future that never completes doesn't keep the group alive once nothing refers to it..
+		FutureState::WP wpAll, wpAny, wpNever;
+		{
+			std::vector< Future<int> > never;
+			never.push_back(Future<int>(Future<int>::StateSP(new FutureValue<int>())));
+			wpNever = never[0].GetState();
+			wpAll = WhenAll(never).GetState();
+			wpAny = WhenAny(never).GetState();
+			Test(!wpAll.expired() && !wpAny.expired());
+		}
+		Test(wpNever.expired() && wpAll.expired() && wpAny.expired());
+	}
+
+	void TestExecutors()
+	{
+		ThreadPool pool(2);
+
+		Promise<int> promise;
+		m_nCallbacks = 0;
+		promise.GetFuture().Then(DELEGATE(TestFuture, OnInt, const Future<int> &, this), FutureState::MAIN_THREAD);
+		Future<std::string> text = promise.GetFuture().Then<std::string>(boost::bind(&TestFuture::ToText, _1, _2), FutureState::THREAD_POOL);
+
+		promise.SetValue(7);
+		Test(m_nCallbacks == 0);
+		Spin(m_nCallbacks, 1);
+		Test(m_nCallbacks == 1);
+
+		for (int i = 0; i < 1000 && text.IsPending(); ++i)
+			boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+		Test(text.IsReady() && text.GetValue() == "7");
+	}
+
+	void OnInt(const Future<int> & a_Future)
+	{
+		Test(a_Future.IsReady());
+		m_nCallbacks += 1;
+	}
+
+	void OnCanceled()
+	{
+		m_nCanceled += 1;
+	}
+
+	static void ToText(const Future<int> & a_Future, Promise<std::string> & a_Next)
+	{
+		if (a_Future.IsReady())
+			a_Next.SetValue(StringUtil::Format("%d", a_Future.GetValue()));
+		else
+			a_Next.SetError(a_Future.GetError());
+	}
+
+	static void Throw(const Future<int> &, Promise<std::string> &)
+	{
+		throw WatsonException("step failed");
+	}
+
+	static void CallNull(Delegate<std::string *> a_Callback)
+	{
+		a_Callback(NULL);
+	}
+
+	//! Start a future that isn't resolved, keeping the promises so they don't fail
+	void StartInner(Future<int> * a_pInner, const Future<int> &, Promise<int> & a_Next)
+	{
+		*a_pInner = Promise<int>::Start(boost::bind(&TestFuture::Hold, this, _1));
+		m_HeldNext = a_Next;
+	}
+
+	void Hold(Delegate<const int &> a_Callback)
+	{
+		m_Held = a_Callback;
+	}
+
+private:
+	int						m_nCallbacks;
+	int						m_nCanceled;
+	Delegate<const int &>	m_Held;
+	Promise<int>			m_HeldNext;
+};
+
+TestFuture TEST_FUTURE;
@@ -0,0 +1,109 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+#include "UnitTest.h"
+#include "utils/HttpRequestParser.h"
+
+class TestHttpRequestParser : UnitTest
+{
+public:
+	//! Construction
+	TestHttpRequestParser() : UnitTest("TestHttpRequestParser")
+	{}
+
+	virtual void RunTest()
+	{
+		HttpRequestParser parser;
+		IWebServer::Request request;
+
+		// feed the request one byte at a time, like a very slow client..
+		std::string get("GET /v1/things?limit=10&verbose HTTP/1.1\r\nHost: localhost\r\nX-Test:   padded value  \r\n\r\n");
+		for (size_t i = 1; i < get.size(); ++i)
+			Test(parser.Parse(get.data(), i) == HttpRequestParser::NEED_MORE);
+		Test(parser.Parse(get.data(), get.size()) == HttpRequestParser::COMPLETE);
+		Test(parser.GetConsumed() == get.size());
+		parser.GetRequest(get.data(), request);
+		Test(request.m_RequestType == "GET");
+		Test(request.m_EndPoint == "/v1/things");
+		Test(request.m_Protocol == "HTTP/1.1");
+		Test(request.m_Headers["host"] == "localhost");
+		Test(request.m_Headers["X-Test"] == "padded value");
+		Test(request.m_Headers["limit"] == "10");
+		Test(request.m_Headers.find("verbose") != request.m_Headers.end());
+		Test(request.m_Content.size() == 0);
+
+		// pipelined requests, the second request is left for the next parse
+		std::string pipelined("POST /a HTTP/1.1\r\nContent-Length: 5\r\n\r\nhelloGET /b HTTP/1.1\r\n\r\n");
+		parser.Reset();
+		Test(parser.Parse(pipelined.data(), pipelined.size()) == HttpRequestParser::COMPLETE);
+		request = IWebServer::Request();
+		parser.GetRequest(pipelined.data(), request);
+		Test(request.m_EndPoint == "/a" && request.m_Content == "hello");
+
+		std::string next(pipelined.substr(parser.GetConsumed()));
+		parser.Reset();
+		Test(parser.Parse(next.data(), next.size()) == HttpRequestParser::COMPLETE);
+		request = IWebServer::Request();
+		parser.GetRequest(next.data(), request);
+		Test(request.m_RequestType == "GET" && request.m_EndPoint == "/b");
+
+		// chunked body with an extension and a trailer
+		std::string chunked("POST /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+			"5;name=value\r\nhello\r\n7\r\n, world\r\n0\r\nX-Trailer: ignored\r\n\r\n");
+		parser.Reset();
+		for (size_t i = 1; i < chunked.size(); ++i)
+			Test(parser.Parse(chunked.data(), i) == HttpRequestParser::NEED_MORE);
+		Test(parser.Parse(chunked.data(), chunked.size()) == HttpRequestParser::COMPLETE);
+		Test(parser.IsChunked());
+		request = IWebServer::Request();
+		parser.GetRequest(chunked.data(), request);
+		Test(request.m_Content == "hello, world");
+
+		// Expect: 100-continue is reported once before the body arrives
+		std::string expect("PUT /d HTTP/1.1\r\nExpect: 100-continue\r\nContent-Length: 3\r\n\r\n");
+		parser.Reset();
+		Test(parser.Parse(expect.data(), expect.size()) == HttpRequestParser::SEND_CONTINUE);
+		Test(parser.Parse(expect.data(), expect.size()) == HttpRequestParser::NEED_MORE);
+		expect += "abc";
+		Test(parser.Parse(expect.data(), expect.size()) == HttpRequestParser::COMPLETE);
+
+		// malformed & oversized requests
+		std::string bad("GET /\x01 HTTP/1.1\r\n\r\n");
+		parser.Reset();
+		Test(parser.Parse(bad.data(), bad.size()) == HttpRequestParser::INVALID);
+		Test(parser.GetErrorStatus() == 400);
+
+		std::string smuggle("POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n");
+		parser.Reset();
+		Test(parser.Parse(smuggle.data(), smuggle.size()) == HttpRequestParser::INVALID);
+
+		std::string large("POST / HTTP/1.1\r\nContent-Length: 100\r\n\r\n");
+		parser.Reset();
+		parser.SetMaxBodySize(10);
+		Test(parser.Parse(large.data(), large.size()) == HttpRequestParser::INVALID);
+		Test(parser.GetErrorStatus() == 413);
+
+		std::string header("GET / HTTP/1.1\r\nX-Large: ");
+		header.append(128, 'x');
+		parser.Reset();
+		parser.SetMaxHeaderSize(64);
+		Test(parser.Parse(header.data(), header.size()) == HttpRequestParser::INVALID);
+		Test(parser.GetErrorStatus() == 431);
+	}
+
+};
+
+TestHttpRequestParser TEST_HTTP_REQUEST_PARSER;
@@ -0,0 +1,152 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "UnitTest.h"
+#include "utils/JsonFields.h"
+#include "services/Conversation/DataModels.h"
+#include "services/NaturalLanguageClassifier/DataModels.h"
+#include "services/SpeechToText/DataModels.h"
+
+//! Every kind of member a field may be
+struct TestFieldsObject : public ISerializable
+{
+	int							m_Int;
+	unsigned int				m_UInt;
+	float						m_Float;
+	bool						m_Bool;
+	std::string					m_String;
+	Json::Value					m_Json;
+	std::vector<std::string>	m_Strings;
+	ConversationIntent			m_Intent;		// hand written ISerializable
+	std::vector<TimeStamp>		m_Timestamps;
+
+	TestFieldsObject() : m_Int(0), m_UInt(0), m_Float(0.0f), m_Bool(false)
+	{}
+
+	WDC_FIELDS_BEGIN(TestFieldsObject)
+		WDC_FIELD("int", m_Int)
+		WDC_FIELD("uint", m_UInt)
+		WDC_FIELD("float", m_Float)
+		WDC_FIELD("bool", m_Bool)
+		WDC_FIELD("string", m_String)
+		WDC_FIELD("json", m_Json)
+		WDC_FIELD("strings", m_Strings)
+		WDC_FIELD("intent", m_Intent)
+		WDC_FIELD("timestamps", m_Timestamps)
+	WDC_FIELDS_END()
+};
+
+class TestJsonFields : UnitTest
+{
+public:
+	//! Construction
+	TestJsonFields() : UnitTest("TestJsonFields")
+	{}
+
+	virtual void RunTest()
+	{
+		Test(HasJsonFields<Classifier>::value);
+		Test(HasJsonFields<RecognizeResults>::value);
+		Test(!HasJsonFields<ConversationIntent>::value);
+		Test(!HasJsonFields<std::string>::value);
+
+		// a speech to text response with members that aren't fields..
+		const std::string stt("{\"result_index\":2,\"warnings\":[\"Unknown \\\"arguments\\\"\",{\"a\":[1,{}]}],"
+			"\"results\":[{\"final\":true,\"alternatives\":[{\"transcript\":\"hello world \",\"confidence\":0.875,"
+			"\"timestamps\":[[\"hello\",0.1,0.5],[\"world\",0.5,0.98]],\"word_confidence\":[[\"hello\",0.9],[\"world\",0.85]]},"
+			"{\"transcript\":\"hollow world \"}],\"keywords_result\":null}]}");
+
+		RecognizeResults read;
+		std::string error;
+		Test(JsonFields<RecognizeResults>::FromJson(stt, read, &error));
+		Test(read.m_ResultIndex == 2);
+		Test(read.HasFinalResult());
+		Test(read.GetConfidence() == 0.875);
+		Test(read.m_Results.size() == 1 && read.m_Results[0].m_Alternatives.size() == 2);
+		if (read.HasResult())
+		{
+			const SpeechAlt & alt = read.m_Results[0].m_Alternatives[0];
+			Test(alt.m_Transcript == "hello world ");
+			Test(alt.m_Timestamps.size() == 2 && alt.m_Timestamps[1].m_Word == "world" && alt.m_Timestamps[1].m_End == 0.98);
+			Test(alt.m_WordConfidence.size() == 2 && alt.m_WordConfidence[0].m_Confidence == 0.9);
+		}
+
+		// the same object as going through a Json::Value..
+		RecognizeResults dom;
+		Test(ISerializable::DeserializeObject(stt, &dom) != NULL);
+		Test(Json::FastWriter().write(ISerializable::SerializeObject(&dom, false))
+			== Json::FastWriter().write(ISerializable::SerializeObject(&read, false)));
+
+		// written straight to text, the same JSON as Serialize() other than the order of the members..
+		std::string written(JsonFields<RecognizeResults>::ToJson(read));
+		Json::Value writtenJson;
+		Test(Json::Reader(Json::Features::strictMode()).parse(written, writtenJson));
+		Test(Json::FastWriter().write(writtenJson) == Json::FastWriter().write(ISerializable::SerializeObject(&read, false)));
+		Test(written.find("word_confidence") != std::string::npos);
+		Test(written.find("\"timestamps\":[[\"hello\",0.10000000000000001,0.5]") != std::string::npos);
+
+		// every member type..
+		TestFieldsObject object;
+		object.m_Int = -7;
+		object.m_UInt = 4000000000u;
+		object.m_Float = 0.5f;
+		object.m_Bool = true;
+		object.m_String = "tab\there \"quoted\" \x01";
+		object.m_Json["nested"][0] = "value";
+		object.m_Strings.push_back("a");
+		object.m_Strings.push_back("b");
+		object.m_Intent.m_Intent = "weather";
+		object.m_Intent.m_fConfidence = 0.25f;
+		object.m_Timestamps.push_back(TimeStamp());
+
+		written = JsonFields<TestFieldsObject>::ToJson(object);
+		Test(Json::Reader(Json::Features::strictMode()).parse(written, writtenJson));
+		Test(Json::FastWriter().write(writtenJson) == Json::FastWriter().write(ISerializable::SerializeObject(&object, false)));
+
+		TestFieldsObject copy;
+		Test(JsonFields<TestFieldsObject>::FromJson(written, copy));
+		Test(copy.m_Int == -7 && copy.m_UInt == 4000000000u && copy.m_Float == 0.5f && copy.m_Bool);
+		Test(copy.m_String == object.m_String);
+		Test(copy.m_Json == object.m_Json);
+		Test(copy.m_Strings == object.m_Strings);
+		Test(copy.m_Intent.m_Intent == "weather" && copy.m_Intent.m_fConfidence == 0.25f);
+		Test(copy.m_Timestamps.size() == 1);
+
+		// only the members found are changed, empty vectors aren't written..
+		TestFieldsObject partial;
+		partial.m_String = "unchanged";
+		Test(JsonFields<TestFieldsObject>::FromJson("{\"int\":3,\"bool\":1}", partial));
+		Test(partial.m_Int == 3 && partial.m_Bool && partial.m_String == "unchanged");
+		Test(JsonFields<TestFieldsObject>::ToJson(partial).find("strings") == std::string::npos);
+
+		// NLC through the DOM still works..
+		ClassifyResult classify;
+		Test(ISerializable::DeserializeObject(std::string("{\"top_class\":\"temperature\",\"classes\":[{\"class_name\":\"temperature\","
+			"\"confidence\":0.9},{\"class_name\":\"conditions\",\"confidence\":0.1}]}"), &classify) != NULL);
+		Test(classify.m_TopClass == "temperature" && classify.m_Classes.size() == 2 && classify.GetTopConfidence() == 0.9);
+
+		// errors..
+		Test(!JsonFields<RecognizeResults>::FromJson("{\"results\":[{\"final\":true,]}", read, &error));
+		Test(error.size() > 0);
+		Test(!JsonFields<RecognizeResults>::FromJson("[1,2]", read, &error));
+		Test(!JsonFields<RecognizeResults>::FromJson("{\"results\":{\"final\":{}}", read, &error));
+		Test(JsonFields<RecognizeResults>::FromJson("{\"results\":5,\"result_index\":null}", read, &error));
+		Test(read.m_Results.size() == 0 && read.m_ResultIndex == 0);
+	}
+};
+
+TestJsonFields TEST_JSON_FIELDS;
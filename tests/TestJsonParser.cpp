@@ -0,0 +1,89 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "UnitTest.h"
+#include "utils/JsonParser.h"
+
+class TestJsonParser : UnitTest
+{
+public:
+	//! Construction
+	TestJsonParser() : UnitTest("TestJsonParser")
+	{}
+
+	virtual void RunTest()
+	{
+		// the same tree as Json::Reader..
+		Test(SameAsReader("{\"classifier_id\":\"10D41B-nlc-1\",\"url\":\"https://gateway.watsonplatform.net/\","
+			"\"text\":\"How hot will it be today?\",\"top_class\":\"temperature\",\"classes\":[{\"class_name\":"
+			"\"temperature\",\"confidence\":0.9998201258549781},{\"class_name\":\"conditions\",\"confidence\":"
+			"1.7987414502176904E-4}]}"));
+		Test(SameAsReader(" [ 1, -2, 0, -0, 2147483647, 2147483648, -2147483649, 9223372036854775807, "
+			"-9223372036854775808, 18446744073709551615, 18446744073709551616, 1.5, -0.25, 1e3, 2E-2, 1.7976931348623157e308, "
+			"4.9e-324, 0.1, 123456789012345678901234567890.5 ] "));
+		Test(SameAsReader("{\"a\":{\"b\":[[],{},[null,true,false]]},\"\":\"\",\"a\":\"duplicate\"}"));
+		Test(SameAsReader("{\"escapes\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\",\"unicode\":\"caf\\u00e9 \\u20AC \\ud83d\\ude00\"}"));
+		Test(SameAsReader("{\"nul\":\"a\\u0000b\"}\n\ntrailing text is ignored"));
+
+		Json::Value root;
+		JsonParser parser;
+		Test(parser.Parse("{\"text\":\"caf\\u00e9\",\"emoji\":\"\\ud83d\\ude00\"}", root));
+		Test(root["text"].asString() == "caf\xc3\xa9");
+		Test(root["emoji"].asString() == "\xf0\x9f\x98\x80");
+		Test(parser.Parse("[0.1,1e-7,3.14159]", root));
+		Test(root[0].asDouble() == 0.1 && root[1].asDouble() == 1e-7 && root[2].asDouble() == 3.14159);
+		Test(parser.Parse("[5,3000000000,-1]", root));
+		Test(root[0].type() == Json::intValue && root[1].type() == Json::uintValue && root[2].type() == Json::intValue);
+
+		// invalid documents..
+		const char * INVALID[] = {
+			"", "   ", "\"root string\"", "42", "{", "[1,]", "{\"a\":1,}", "{\"a\" 1}", "{a:1}", "[01]",
+			"[1.]", "[.5]", "[1e]", "[-]", "[\"unterminated]", "[\"bad \\x escape\"]", "[\"\\u12\"]",
+			"[\"\\ud83d\"]", "[tru]", "[nul]", "// comment\n{}", "[1e999]"
+		};
+		for (size_t i = 0; i < sizeof(INVALID) / sizeof(INVALID[0]); ++i)
+		{
+			Test(!parser.Parse(INVALID[i], root));
+			Test(root.isNull());
+			Test(parser.GetError().size() > 0);
+		}
+
+		Test(!parser.Parse("{\"a\":[1,2 3]}", root));
+		Test(parser.GetErrorOffset() == 10);
+
+		std::string deep(2000, '[');
+		deep += std::string(2000, ']');
+		Test(!parser.Parse(deep, root));
+
+		std::string error;
+		Test(JsonParser::ParseJson("{\"a\":1}", root, &error) && root["a"].asInt() == 1);
+		Test(!JsonParser::ParseJson("{\"a\":}", root, &error) && error.size() > 0);
+	}
+
+	bool SameAsReader(const std::string & a_Json)
+	{
+		Json::Value expected, parsed;
+		if (!Json::Reader(Json::Features::strictMode()).parse(a_Json, expected))
+			return false;
+		JsonParser parser;
+		if (!parser.Parse(a_Json, parsed))
+			return false;
+		return parsed == expected && Json::FastWriter().write(parsed) == Json::FastWriter().write(expected);
+	}
+};
+
+TestJsonParser TEST_JSON_PARSER;
@@ -43,7 +43,7 @@ public:
 		ThreadPool pool(1);
 
 		KafkaConsumer consumer;
-		if ( config.FindServiceConfig( consumer.GetServiceId() ) != NULL )
+		if ( config.FindServiceConfig( consumer.GetServiceId() ) )
 		{
 			Test( consumer.Start() );
 
@@ -0,0 +1,296 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+#include "UnitTest.h"
+#include "utils/Log.h"
+#include "utils/StringUtil.h"
+#include "utils/Time.h"
+
+#include "boost/thread.hpp"
+#include "boost/filesystem.hpp"
+
+#include <map>
+#include <vector>
+
+//! Reactor that keeps the records logged by this test.
+class TestLogReactor : public ILogReactor
+{
+public:
+	TestLogReactor() : m_nRecords(0), m_bOrdered(true), m_nLongestMessage(0), m_nDropWarnings(0)
+	{}
+
+	virtual void Process(const LogRecord & a_Record)
+	{
+		if (a_Record.m_SubSystem == "TestLogBlocked")
+		{
+			// blocks while TestBlocked() holds the lock
+			boost::lock_guard<boost::mutex> lock(m_BlockLock);
+			return;
+		}
+		if (a_Record.m_SubSystem == "Log" && a_Record.m_Message.find("Dropped") == 0)
+		{
+			boost::lock_guard<boost::mutex> lock(m_Lock);
+			m_nDropWarnings += 1;
+			return;
+		}
+		if (a_Record.m_SubSystem == "TestLogFields")
+		{
+			boost::lock_guard<boost::mutex> lock(m_Lock);
+			m_Records.push_back(a_Record);
+			return;
+		}
+		if (a_Record.m_SubSystem != "TestLog" || a_Record.m_Level < LL_STATUS)
+			return;
+
+		boost::lock_guard<boost::mutex> lock(m_Lock);
+		m_nRecords += 1;
+		if (a_Record.m_Message.size() > m_nLongestMessage)
+			m_nLongestMessage = a_Record.m_Message.size();
+
+		// each thread logs "<thread> <count>", the count must increase for each thread
+		int nThread = 0, nCount = 0;
+		if (sscanf(a_Record.m_Message.c_str(), "%d %d", &nThread, &nCount) == 2)
+		{
+			std::map<int, int>::iterator iLast = m_LastCount.find(nThread);
+			if (iLast != m_LastCount.end() && iLast->second + 1 != nCount)
+				m_bOrdered = false;
+			m_LastCount[nThread] = nCount;
+		}
+	}
+	virtual LogLevel GetMinLevel() const
+	{
+		return LL_STATUS;
+	}
+
+	boost::mutex		m_Lock;
+	int					m_nRecords;
+	bool				m_bOrdered;
+	size_t				m_nLongestMessage;
+	std::map<int, int>	m_LastCount;
+	std::vector<LogRecord>
+						m_Records;
+	int					m_nDropWarnings;
+	boost::mutex		m_BlockLock;
+};
+
+class TestLog : UnitTest
+{
+public:
+	//! Construction
+	TestLog() : UnitTest("TestLog")
+	{}
+
+	virtual void RunTest()
+	{
+		TestLogReactor * pReactor = new TestLogReactor();
+		Log::RegisterReactor(pReactor);
+		Test(Log::IsEnabled(LL_STATUS));
+
+		std::vector<boost::thread *> threads;
+		for (int i = 0; i < THREADS; ++i)
+			threads.push_back(new boost::thread(boost::bind(&TestLog::LogThread, this, i)));
+		for (size_t i = 0; i < threads.size(); ++i)
+		{
+			threads[i]->join();
+			delete threads[i];
+		}
+
+		// messages larger than the format buffer are truncated
+		Log::Status("TestLog", "%s", std::string(40 * 1024, 'x').c_str());
+		Log::Flush();
+
+		Test(pReactor->m_nRecords == THREADS * RECORDS + 1);
+		Test(pReactor->m_bOrdered);
+		Test(pReactor->m_nLongestMessage > 0 && pReactor->m_nLongestMessage < 40 * 1024);
+
+		TestFields(pReactor);
+		TestLimits(pReactor);
+		TestBlocked(pReactor);
+		Log::RemoveReactor(pReactor);
+
+		TestRotation();
+		TestBinary();
+	}
+
+	//! Test a thread that logs while holding a lock the log thread is waiting on isn't blocked forever
+	void TestBlocked(TestLogReactor * a_pReactor)
+	{
+		Time start;
+		{
+			boost::lock_guard<boost::mutex> lock(a_pReactor->m_BlockLock);
+			for (int i = 0; i < 4000; ++i)
+				Log::Status("TestLogBlocked", "%d %s", i, std::string(100, 'b').c_str());
+		}
+		Test((Time().GetEpochTime() - start.GetEpochTime()) < 10.0);
+
+		Log::Flush();
+		Test(a_pReactor->m_nDropWarnings > 0);
+	}
+
+	//! Test structured records keep their fields & bodies are truncated
+	void TestFields(TestLogReactor * a_pReactor)
+	{
+		Log::Write(LogEntry(LL_ERROR, "TestLogFields", "Request failed")
+			.Add("status", 500).Add("url", "http://localhost/test")
+			.AddBody("response", std::string(Log::GetMaxBodySize() * 2, 'b')));
+		Log::Flush();
+
+		Test(a_pReactor->m_Records.size() == 1);
+		const LogRecord & record = a_pReactor->m_Records[0];
+		Test(record.m_Message == "Request failed");
+		Test(record.m_Fields.size() == 3);
+		Test(record.m_Fields[0].first == "status" && record.m_Fields[0].second == "500");
+		Test(record.m_Fields[1].second == "http://localhost/test");
+		Test(record.m_Fields[2].second.size() < Log::GetMaxBodySize() + 32);
+
+		std::string text;
+		LogFields fields;
+		fields.push_back(LogFields::value_type("a", "1"));
+		fields.push_back(LogFields::value_type("b", "two words"));
+		Log::FormatFields(fields, text);
+		Test(text == " a=1 b=\"two words\"");
+
+		a_pReactor->m_Records.clear();
+	}
+
+	//! Test sampling & rate limiting
+	void TestLimits(TestLogReactor * a_pReactor)
+	{
+		Log::SetSampling("TestLogFields", 10);
+		for (int i = 0; i < 100; ++i)
+			Log::Status("TestLogFields", "Sampled %d", i);
+		Log::Error("TestLogFields", "Errors are not sampled");
+		Log::Flush();
+		Test(a_pReactor->m_Records.size() == 11);
+		Log::SetSampling("TestLogFields", 0);
+		a_pReactor->m_Records.clear();
+
+		Log::SetRateLimit("*", 1.0f, 5);
+		for (int i = 0; i < 100; ++i)
+			Log::Error("TestLogFields", "Limited %d", i);
+		Log::Critical("TestLogFields", "Critical records are never dropped");
+		Log::Flush();
+		Test(a_pReactor->m_Records.size() == 6);
+
+		// the next record let through has the number of records dropped
+		boost::this_thread::sleep(boost::posix_time::milliseconds(1100));
+		Log::Error("TestLogFields", "After the limit");
+		Log::SetRateLimit("*", 0.0f, 0);
+		Log::Flush();
+		Test(a_pReactor->m_Records.size() == 7);
+		const LogFields & fields = a_pReactor->m_Records.back().m_Fields;
+		Test(fields.size() == 1 && fields[0].first == "dropped" && fields[0].second == "95");
+
+		a_pReactor->m_Records.clear();
+	}
+
+	//! Test the binary reactor output can be read back
+	void TestBinary()
+	{
+		boost::filesystem::remove("TestLog.bin");
+
+		BinaryReactor * pBinary = new BinaryReactor("TestLog.bin", LL_STATUS, 1);
+		Log::RegisterReactor(pBinary);
+		Log::Status("TestLogFields", "Binary %d", 1);
+		Log::Write(LogEntry(LL_WARNING, "TestLogFields", "Binary 2").Add("key", "value with spaces"));
+		Log::RemoveReactor(pBinary);
+
+		std::vector<LogRecord> records;
+		Test(BinaryReactor::Read("TestLog.bin", records));
+
+		std::vector<LogRecord> binary;
+		for (size_t i = 0; i < records.size(); ++i)
+			if (records[i].m_SubSystem == "TestLogFields")
+				binary.push_back(records[i]);
+
+		Test(binary.size() == 2);
+		Test(binary[0].m_Level == LL_STATUS && binary[0].m_Message == "Binary 1");
+		Test(binary[1].m_Level == LL_WARNING && binary[1].m_Message == "Binary 2");
+		Test(binary[1].m_Fields.size() == 1 && binary[1].m_Fields[0].second == "value with spaces");
+		Test(binary[1].m_TimeEpoch > 0 && binary[1].m_Time.size() > 0);
+
+		// a truncated record is not returned
+		std::string data;
+		LogRecord record;
+		size_t nOffset = 0;
+		FILE * pFile = fopen("TestLog.bin", "rb");
+		Test(pFile != NULL);
+		char buffer[1024];
+		size_t nRead = 0;
+		while ((nRead = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+			data.append(buffer, nRead);
+		fclose(pFile);
+		data.resize(data.size() - 1);
+
+		size_t nRecords = 0;
+		while (BinaryReactor::Decode(data, nOffset, record))
+			nRecords += 1;
+		Test(nRecords == records.size() - 1);
+
+		boost::filesystem::remove("TestLog.bin");
+	}
+
+	//! Test the file reactor rotates & compresses the log while running
+	void TestRotation()
+	{
+		RemoveLogs();
+
+		FileReactor * pFile = new FileReactor("TestLog.log", LL_STATUS, 3);
+		pFile->SetRotation(16 * 1024);
+		pFile->SetCompress(true);
+		Log::RegisterReactor(pFile);
+
+		for (int i = 0; i < 600; ++i)
+		{
+			Log::Status("TestLog", "Rotation %d %s", i, std::string(100, 'r').c_str());
+			if ((i % 20) == 0)
+				boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+		}
+		Log::RemoveReactor(pFile);
+
+		Test(boost::filesystem::exists("TestLog.log"));
+		Test(boost::filesystem::file_size("TestLog.log") < 32 * 1024);
+		Test(boost::filesystem::exists("TestLog.log.0.gz"));
+		Test(boost::filesystem::exists("TestLog.log.1.gz"));
+		Test(!boost::filesystem::exists("TestLog.log.3.gz"));
+
+		RemoveLogs();
+	}
+
+	void RemoveLogs()
+	{
+		boost::filesystem::remove("TestLog.log");
+		for (int i = 0; i < 4; ++i)
+		{
+			boost::filesystem::remove(StringUtil::Format("TestLog.log.%d", i));
+			boost::filesystem::remove(StringUtil::Format("TestLog.log.%d.gz", i));
+		}
+	}
+
+	void LogThread(int a_nThread)
+	{
+		for (int i = 0; i < RECORDS; ++i)
+		{
+			Log::Status("TestLog", "%d %d", a_nThread, i);
+			Log::DebugLow("TestLog", "%d %d", a_nThread, i);
+		}
+	}
+
+	static const int THREADS = 4;
+	static const int RECORDS = 5000;
+};
+
+TestLog TEST_LOG;
@@ -0,0 +1,164 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+#include "UnitTest.h"
+#include "utils/Metrics.h"
+#include "utils/PrometheusExporter.h"
+#include "utils/Log.h"
+
+#include "boost/thread.hpp"
+
+#include <vector>
+
+class TestMetrics : UnitTest
+{
+public:
+	//! Construction
+	TestMetrics() : UnitTest("TestMetrics")
+	{}
+
+	virtual void RunTest()
+	{
+		TestBuckets();
+		TestQuantiles();
+		TestThreads();
+		TestSeries();
+		TestPrometheus();
+	}
+
+	void TestBuckets()
+	{
+		// every value falls inside the bucket it's counted in..
+		for (boost::uint64_t v = 0; v < (((boost::uint64_t)1) << 41); v = v < 100 ? v + 1 : v + v / 7)
+		{
+			int nBucket = Metrics::Histogram::GetBucket(v);
+			Test(nBucket >= 0 && nBucket < Metrics::Histogram::BUCKET_COUNT);
+			boost::uint64_t nStart = Metrics::Histogram::GetBucketStart(nBucket);
+			boost::uint64_t nWidth = Metrics::Histogram::GetBucketWidth(nBucket);
+			Test(v >= nStart && v < nStart + nWidth);
+			Test(nWidth <= 1 || nWidth * Metrics::Histogram::SUB_BUCKETS <= nStart);
+		}
+		Test(Metrics::Histogram::GetBucket(~((boost::uint64_t)0)) == Metrics::Histogram::BUCKET_COUNT - 1);
+	}
+
+	void TestQuantiles()
+	{
+		Metrics::Histogram histogram;
+		Test(histogram.GetQuantile(0.5) == 0.0);
+
+		// 1ms to 1000ms
+		for (int i = 1; i <= 1000; ++i)
+			histogram.Record(i / 1000.0);
+
+		Test(histogram.GetCount() == 1000);
+		Test(histogram.GetMax() > 0.999 && histogram.GetMax() < 1.001);
+		Test(histogram.GetSum() > 500.0 && histogram.GetSum() < 500.6);
+		Test(Near(histogram.GetQuantile(0.5), 0.5));
+		Test(Near(histogram.GetQuantile(0.9), 0.9));
+		Test(Near(histogram.GetQuantile(0.99), 0.99));
+		Test(histogram.GetQuantile(1.0) <= histogram.GetMax());
+	}
+
+	void TestThreads()
+	{
+		Metrics::Counter * pCounter = Metrics::Instance()->GetCounter("test_metrics_threads_total");
+		Metrics::Histogram * pHistogram = Metrics::Instance()->GetHistogram("test_metrics_threads_seconds");
+
+		std::vector<boost::thread *> threads;
+		for (int i = 0; i < THREADS; ++i)
+			threads.push_back(new boost::thread(boost::bind(&TestMetrics::RecordThread, this, pCounter, pHistogram)));
+		for (size_t i = 0; i < threads.size(); ++i)
+		{
+			threads[i]->join();
+			delete threads[i];
+		}
+
+		Test(pCounter->Get() == THREADS * RECORDS);
+		Test(pHistogram->GetCount() == THREADS * RECORDS);
+		Test(pHistogram->GetMax() > 0.0009 && pHistogram->GetMax() < 0.0011);
+	}
+
+	void TestSeries()
+	{
+		Metrics metrics;
+		metrics.SetMaxSeries(3);
+
+		Metrics::Tags tags;
+		tags["status"] = "200";
+		Metrics::Counter * pOK = metrics.GetCounter("requests_total", tags);
+		Test(pOK == metrics.GetCounter("requests_total", tags));
+		Test(pOK != metrics.GetCounter("requests_total"));
+
+		tags["status"] = "404";
+		Test(metrics.GetCounter("requests_total", tags) != pOK);
+
+		// over the limit, new tags are recorded without any tags..
+		Metrics::Counter * pUntagged = metrics.GetCounter("requests_total");
+		tags["status"] = "500";
+		Test(metrics.GetCounter("requests_total", tags) == pUntagged);
+		tags["status"] = "200";
+		Test(metrics.GetCounter("requests_total", tags) == pOK);
+
+		// the same name with a different type can't be exported..
+		Test(metrics.GetGauge("requests_total") != NULL);
+
+		Metrics::Gauge * pGauge = metrics.GetGauge("connections");
+		pGauge->Add(5);
+		pGauge->Add(-2);
+		Test(pGauge->Get() == 3);
+	}
+
+	void TestPrometheus()
+	{
+		Metrics metrics;
+
+		Metrics::Tags tags;
+		tags["service"] = "TestService";
+		tags["endpoint"] = "/v1/\"quoted\"";
+		metrics.GetCounter("wdc_test_requests_total", tags)->Increment(3);
+		metrics.GetGauge("wdc_test_pending")->Set(2);
+		metrics.GetHistogram("wdc_test_seconds", tags)->Record(0.25);
+
+		std::string text(PrometheusExporter::Format(&metrics));
+		Log::Debug("TestMetrics", "Prometheus:\n%s", text.c_str());
+
+		Test(text.find("# TYPE wdc_test_requests_total counter\n") != std::string::npos);
+		Test(text.find("wdc_test_requests_total{endpoint=\"/v1/\\\"quoted\\\"\",service=\"TestService\"} 3\n") != std::string::npos);
+		Test(text.find("# TYPE wdc_test_pending gauge\nwdc_test_pending 2\n") != std::string::npos);
+		Test(text.find("# TYPE wdc_test_seconds summary\n") != std::string::npos);
+		Test(text.find("quantile=\"0.99\"} 0.25") != std::string::npos);
+		Test(text.find("wdc_test_seconds_count{endpoint=\"/v1/\\\"quoted\\\"\",service=\"TestService\"} 1\n") != std::string::npos);
+	}
+
+	void RecordThread(Metrics::Counter * a_pCounter, Metrics::Histogram * a_pHistogram)
+	{
+		for (int i = 0; i < RECORDS; ++i)
+		{
+			a_pCounter->Increment();
+			a_pHistogram->RecordMicroseconds(i % 1000 + 1);
+		}
+	}
+
+	static bool Near(double a_fValue, double a_fExpected)
+	{
+		return a_fValue > a_fExpected * 0.9 && a_fValue < a_fExpected * 1.1;
+	}
+
+	static const int THREADS = 4;
+	static const int RECORDS = 100000;
+};
+
+TestMetrics TEST_METRICS;
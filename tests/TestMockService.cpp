@@ -0,0 +1,284 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Config.h"
+#include "utils/Log.h"
+#include "utils/Metrics.h"
+#include "utils/Sound.h"
+#include "utils/ThreadPool.h"
+#include "utils/TimerPool.h"
+#include "testing/LoadGenerator.h"
+#include "testing/MockService.h"
+
+#include "services/NaturalLanguageClassifier/NaturalLanguageClassifier.h"
+#include "services/SpeechToText/SpeechToText.h"
+#include "services/TextToSpeech/TextToSpeech.h"
+
+class TestMockService : UnitTest
+{
+public:
+	//! Construction
+	TestMockService() : UnitTest("TestMockService"),
+		m_pNLC(NULL),
+		m_bGetClassifiersTested(false),
+		m_bFindTested(false),
+		m_bClassifyTested(false),
+		m_bClassifyError(false),
+		m_nResults(0),
+		m_bSoundTested(false),
+		m_bStreamClosed(false),
+		m_nStreamBytes(0),
+		m_nWords(0)
+	{}
+
+	virtual void RunTest()
+	{
+		ThreadPool pool(4);
+		TimerPool timers;
+		Config config;
+
+		MockService mock(PORT);
+		mock.AddResponse("GET", "/natural-language-classifier/api/v1/classifiers", 200,
+			"{\"classifiers\":[{\"classifier_id\":\"mock-id\",\"name\":\"mock\",\"language\":\"en\"}]}");
+		mock.AddResponse("POST", "/natural-language-classifier/api/v1/classifiers/:id/classify", 200,
+			"{\"classifier_id\":\"mock-id\",\"top_class\":\"temperature\",\"classes\":[{\"class_name\":\"temperature\",\"confidence\":0.9}]}");
+		mock.AddResponse("GET", "/natural-language-classifier/api/v1/classifiers/:id", 200,
+			"{\"classifier_id\":\"mock-id\",\"name\":\"mock\",\"language\":\"en\",\"status\":\"Available\"}");
+		mock.AddSpeechToText();
+		mock.AddTextToSpeech();
+		Test(mock.Start());
+
+		Test(mock.AddServiceConfig("NaturalLanguageClassifierV1", "/natural-language-classifier/api"));
+		Test(mock.AddServiceConfig("SpeechToTextV1", "/speech-to-text/api"));
+		Test(mock.AddServiceConfig("TextToSpeechV1", "/text-to-speech/api"));
+
+		// canned responses..
+		NaturalLanguageClassifier nlc;
+		nlc.SetCacheEnabled(false);
+		Test(nlc.Start());
+		m_pNLC = &nlc;
+
+		nlc.GetClassifiers(DELEGATE(TestMockService, OnGetClassifiers, Classifiers *, this));
+		Spin(m_bGetClassifiersTested);
+		Test(m_bGetClassifiersTested);
+
+		nlc.Classify("mock-id", "How hot is it", DELEGATE(TestMockService, OnClassify, const Json::Value &, this));
+		Spin(m_bClassifyTested);
+		Test(m_bClassifyTested);
+
+		// a fan-out of requests through futures..
+		nlc.FindClassifiers("mo*", DELEGATE(TestMockService, OnFindClassifiers, Classifiers *, this));
+		Spin(m_bFindTested);
+		Test(m_bFindTested);
+
+		// canceling a future closes the request..
+		Metrics::Tags tags;
+		tags["service"] = "NaturalLanguageClassifierV1";
+		tags["endpoint"] = "/v1/classifiers";
+		tags["method"] = "GET";
+		tags["status"] = "canceled";
+		Metrics::Counter * pCanceled = Metrics::Instance()->GetCounter("wdc_service_requests_total", tags);
+		boost::int64_t canceled = pCanceled->Get();
+
+		mock.SetLatency(1.0f, 1.0f);
+		Future<NaturalLanguageClassifier::ClassifiersSP> find = nlc.FindClassifiers("mo*");
+		Test(find.Cancel());
+		Test(find.IsCanceled());
+		for (int i = 0; i < 200 && pCanceled->Get() == canceled; ++i)
+		{
+			ThreadPool::Instance()->ProcessMainThread();
+			boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+		}
+		Test(pCanceled->Get() == canceled + 1);
+		mock.SetLatency(0.0f, 0.0f);
+
+		// a request with no response..
+		m_bClassifyTested = false;
+		nlc.DeleteClassifer("mock-id", DELEGATE(TestMockService, OnClassifyError, const Json::Value &, this));
+		Spin(m_bClassifyTested);
+		Test(m_bClassifyTested && m_bClassifyError);
+		Test(mock.GetNotFoundCount() == 1);
+
+		// injected errors..
+		mock.SetErrorRate(1.0f, 503);
+		m_bClassifyTested = m_bClassifyError = false;
+		nlc.Classify("mock-id", "How hot is it", DELEGATE(TestMockService, OnClassifyError, const Json::Value &, this));
+		Spin(m_bClassifyTested);
+		Test(m_bClassifyTested && m_bClassifyError);
+		Test(mock.GetErrorCount() == 1);
+		mock.SetErrorRate(0.0f);
+
+		// saved responses can be loaded into another mock..
+		Test(mock.SaveResponses("./mock_responses.json"));
+		{
+			MockService loaded(PORT + 1);
+			Test(loaded.LoadResponses("./mock_responses.json"));
+			Test(loaded.Start());
+			Test(loaded.AddServiceConfig("NaturalLanguageClassifierV1", "/natural-language-classifier/api"));
+			// nlc isn't in the Config, so start it again to pick up the new URL..
+			Test(nlc.Start());
+
+			m_bGetClassifiersTested = false;
+			nlc.GetClassifiers(DELEGATE(TestMockService, OnGetClassifiers, Classifiers *, this));
+			Spin(m_bGetClassifiersTested);
+			Test(m_bGetClassifiersTested);
+			Test(loaded.GetRequestCount() == 1);
+			Test(mock.AddServiceConfig("NaturalLanguageClassifierV1", "/natural-language-classifier/api"));
+			Test(nlc.Start());
+		}
+
+		// concurrent clients with latency..
+		mock.SetLatency(0.001f, 0.005f);
+		LoadGenerator load(8, DELEGATE(TestMockService, SendClassify, LoadGenerator::Client *, this));
+		Test(load.Run(200));
+		Log::Status("TestMockService", "Load: %s", load.GetReport().c_str());
+		Test(load.GetCompleted() == 200);
+		Test(load.GetErrors() == 0);
+		Test(load.GetLatency().GetCount() == 200);
+		Test(load.GetLatency().GetQuantile(0.5) >= 0.001);
+		Test(load.GetThroughput() > 0.0);
+		mock.SetLatency(0.0f, 0.0f);
+		Test(nlc.Stop());
+
+		// speech to text web socket..
+		SpeechToText stt;
+		SpeechToText::ModelList models;
+		models.push_back("en-US_BroadbandModel");
+		stt.SetRecognizeModels(models);
+		Test(stt.Start());
+		Test(stt.StartListening(DELEGATE(TestMockService, OnRecognize, RecognizeResults *, this)));
+
+		SpeechAudioData clip;
+		clip.m_PCM.resize(16000);
+		clip.m_Rate = 16000;
+		clip.m_Channels = 1;
+		clip.m_Bits = 16;
+		clip.m_Level = 1.0f;
+		for (int i = 0; i < 100 && m_nResults < 2; ++i)
+		{
+			stt.OnListen(clip);
+			Spin(m_nResults, 2, 0.05);
+		}
+		Test(m_nResults >= 2);
+		Test(stt.Stop());
+
+		// text to speech web socket & HTTP..
+		TextToSpeech tts;
+		tts.SetCacheEnabled(false);
+		Test(tts.Start());
+		tts.ToSound("hello mock world", DELEGATE(TestMockService, OnStream, std::string *, this),
+			DELEGATE(TestMockService, OnWords, Words *, this));
+		Spin(m_bStreamClosed);
+		Test(m_bStreamClosed);
+		Test(m_nWords == 3);
+		Test(m_nStreamBytes > 0);
+
+		tts.ToSound("hello mock world", DELEGATE(TestMockService, OnSound, Sound *, this));
+		Spin(m_bSoundTested);
+		Test(m_bSoundTested);
+		Test(tts.Stop());
+
+		Test(mock.Stop());
+	}
+
+	void OnGetClassifiers(Classifiers * a_pClassifiers)
+	{
+		Test(a_pClassifiers != NULL);
+		if (a_pClassifiers != NULL)
+		{
+			Test(a_pClassifiers->m_Classifiers.size() == 1);
+			Test(a_pClassifiers->m_Classifiers.size() == 1 && a_pClassifiers->m_Classifiers[0].m_ClassifierId == "mock-id");
+		}
+		delete a_pClassifiers;
+		m_bGetClassifiersTested = true;
+	}
+
+	void OnFindClassifiers(Classifiers * a_pClassifiers)
+	{
+		Test(a_pClassifiers != NULL);
+		if (a_pClassifiers != NULL)
+		{
+			Test(a_pClassifiers->m_Classifiers.size() == 1);
+			Test(a_pClassifiers->m_Classifiers.size() == 1 && a_pClassifiers->m_Classifiers[0].m_Status == "Available");
+		}
+		delete a_pClassifiers;
+		m_bFindTested = true;
+	}
+
+	void OnClassify(const Json::Value & a_Response)
+	{
+		Test(a_Response["top_class"].asString() == "temperature");
+		m_bClassifyTested = true;
+	}
+
+	void OnClassifyError(const Json::Value & a_Response)
+	{
+		m_bClassifyError = a_Response.isNull();
+		m_bClassifyTested = true;
+	}
+
+	void SendClassify(LoadGenerator::Client * a_pClient)
+	{
+		m_pNLC->Classify("mock-id", "How hot is it", DELEGATE(LoadGenerator::Client, OnJson, const Json::Value &, a_pClient));
+	}
+
+	void OnRecognize(RecognizeResults * a_pResults)
+	{
+		Test(a_pResults != NULL && a_pResults->HasFinalResult());
+		m_nResults += 1;
+		delete a_pResults;
+	}
+
+	void OnStream(std::string * a_pData)
+	{
+		if (a_pData == NULL)
+			m_bStreamClosed = true;
+		else
+			m_nStreamBytes += a_pData->size();
+		delete a_pData;
+	}
+
+	void OnWords(Words * a_pWords)
+	{
+		m_nWords += 1;
+		delete a_pWords;
+	}
+
+	void OnSound(Sound * a_pSound)
+	{
+		Test(a_pSound != NULL && a_pSound->GetRate() == 22050 && a_pSound->GetWaveData().size() > 0);
+		delete a_pSound;
+		m_bSoundTested = true;
+	}
+
+private:
+	static const int PORT = 8096;
+
+	NaturalLanguageClassifier *	m_pNLC;
+	bool						m_bGetClassifiersTested;
+	bool						m_bFindTested;
+	bool						m_bClassifyTested;
+	bool						m_bClassifyError;
+	int							m_nResults;
+	bool						m_bSoundTested;
+	bool						m_bStreamClosed;
+	size_t						m_nStreamBytes;
+	int							m_nWords;
+};
+
+TestMockService TEST_MOCK_SERVICE;
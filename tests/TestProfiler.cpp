@@ -0,0 +1,117 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+#include "UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Profiler.h"
+#include "utils/ThreadPool.h"
+
+#if defined(__GLIBC__)
+#include <signal.h>
+#endif
+
+class TestProfiler : UnitTest
+{
+public:
+	//! Construction
+	TestProfiler() : UnitTest("TestProfiler")
+	{}
+
+	virtual void RunTest()
+	{
+		ThreadPool pool(1);
+		Profiler * pProfiler = Profiler::Instance();
+		pProfiler->Reset();
+		pProfiler->SetSampleRate(1);
+		pProfiler->SetWarningTimes(0.0, 0.0);
+
+		// each delegate is recorded against the line it was made on..
+		for (int i = 0; i < 3; ++i)
+			pool.InvokeOnMain(VOID_DELEGATE(TestProfiler, OnSlow, this));
+		pool.InvokeOnMain(VOID_DELEGATE(TestProfiler, OnFast, this));
+		pool.ProcessMainThread();
+
+		Profiler::SiteStatsList sites;
+		pProfiler->GetTopSites(sites, 0, Profiler::SORT_MAX);
+		Test(sites.size() == 2);
+		Test(sites[0].m_Site.find("TestProfiler.cpp") != std::string::npos);
+		Test(sites[0].m_nCount == 3);
+		Test(sites[0].m_fMax >= 0.015);
+		Test(sites[0].m_fTotal >= 0.045);
+		Test(sites[0].m_fP50 > sites[1].m_fP50);
+		Test(sites[1].m_nCount == 1);
+
+		pProfiler->GetTopSites(sites, 1);
+		Test(sites.size() == 1);
+
+		std::string report(pProfiler->GetReport());
+		Log::Debug("TestProfiler", "Report:\n%s", report.c_str());
+		Test(report.find("TestProfiler.cpp") != std::string::npos);
+
+		// nothing is recorded while sampling is off..
+		pProfiler->Reset();
+		pProfiler->SetSampleRate(0);
+		pool.InvokeOnMain(VOID_DELEGATE(TestProfiler, OnFast, this));
+		pool.ProcessMainThread();
+		pProfiler->GetTopSites(sites);
+		Test(sites.size() == 0);
+		pProfiler->SetSampleRate(1);
+
+		// the watchdog reports a delegate that blocks the main thread, once..
+#if defined(__GLIBC__)
+		void (*pPrevHandler)(int) = signal(SIGUSR2, SIG_IGN);
+#endif
+		pProfiler->StartWatchdog(0.05);
+		pool.InvokeOnMain(VOID_DELEGATE(TestProfiler, OnStall, this));
+		pool.ProcessMainThread();
+		pProfiler->StopWatchdog();
+#if defined(__GLIBC__)
+		// the handler installed before the watchdog started is put back
+		Test(signal(SIGUSR2, pPrevHandler) == SIG_IGN);
+#endif
+
+		Profiler::StallList stalls(pProfiler->GetStalls());
+		Test(stalls.size() == 1);
+		if (stalls.size() > 0)
+		{
+			const Profiler::Stall & stall = stalls.front();
+			Test(stall.m_Site.find("TestProfiler.cpp") != std::string::npos);
+			Test(stall.m_fBlocked >= 0.05);
+#if defined(__GLIBC__)
+			Test(stall.m_Stack.size() > 0);
+#endif
+		}
+
+		pProfiler->Reset();
+		Test(pProfiler->GetStalls().size() == 0);
+		pProfiler->SetWarningTimes(0.1, 0.5);
+	}
+
+	void OnSlow()
+	{
+		boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+	}
+
+	void OnFast()
+	{}
+
+	void OnStall()
+	{
+		boost::this_thread::sleep(boost::posix_time::milliseconds(300));
+	}
+};
+
+TestProfiler TEST_PROFILER;
@@ -57,6 +57,13 @@ namespace TestRTTIClasses {
 		int m_D;
 	};
 	RTTI_IMPL(TestC, TestA);
+
+	class TestD : public TestC
+	{
+	public:
+		RTTI_DECL();
+	};
+	RTTI_IMPL(TestD, TestC);
 	
 
 };
@@ -91,6 +98,20 @@ public:
 
 		delete pA;
 		pA = NULL;
+
+		// deeper classes..
+		TestD d;
+		Test(d.GetRTTI().GetDepth() == 2);
+		Test(DynamicCast<TestD>(&d) != NULL);
+		Test(DynamicCast<TestC>(&d) != NULL);
+		Test(DynamicCast<TestA>(&d) != NULL);
+		Test(DynamicCast<TestB>(static_cast<TestA *>(&d)) == NULL);
+
+		TestC c;
+		Test(DynamicCast<TestD>(&c) == NULL);
+		Test(TestA::GetStaticRTTI().IsType(&TestA::GetStaticRTTI()));
+		Test(!TestA::GetStaticRTTI().IsType(&TestD::GetStaticRTTI()));
+		Test(!TestA::GetStaticRTTI().IsType(NULL));
 	}
 
 };
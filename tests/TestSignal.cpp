@@ -0,0 +1,202 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
+
+#include "UnitTest.h"
+#include "utils/Signal.h"
+#include "utils/ThreadPool.h"
+
+class TestSignal : UnitTest
+{
+public:
+	//! Types
+	struct Data
+	{
+		Data() : m_nValue(0)
+		{}
+		Data(const Data & a_Copy) : m_nValue(a_Copy.m_nValue)
+		{
+			sm_nCopies += 1;
+		}
+
+		int m_nValue;
+
+		static boost::atomic<int> sm_nCopies;
+	};
+
+	struct Receiver
+	{
+		typedef boost::shared_ptr<Receiver>		SP;
+
+		Receiver() : m_nTotal(0), m_nCalls(0)
+		{}
+
+		void OnInt(int a_nValue)
+		{
+			m_nTotal += a_nValue;
+			m_nCalls += 1;
+		}
+		void OnData(const Data & a_Data)
+		{
+			m_nTotal += a_Data.m_nValue;
+			m_nCalls += 1;
+		}
+
+		boost::atomic<int>	m_nTotal;
+		boost::atomic<int>	m_nCalls;
+	};
+
+	//! Construction
+	TestSignal() : UnitTest("TestSignal"), m_nID(0)
+	{}
+
+	virtual void RunTest()
+	{
+		TestInline();
+		TestDispatch();
+		TestThreads();
+	}
+
+	void TestInline()
+	{
+		Signal<int> signal;
+		signal.Emit(1);			// NOP
+
+		Receiver a, b;
+		Signal<int>::ConnectionID idA = signal.Connect(DELEGATE(Receiver, OnInt, int, &a));
+		Test(idA != 0);
+		Test(signal.Connect(DELEGATE(Receiver, OnInt, int, &b)) != 0);
+		Test(signal.Connect(Delegate<int>()) == 0);
+		Test(signal.GetCount() == 2);
+
+		signal.Emit(2);
+		Test(a.m_nTotal == 2 && b.m_nTotal == 2);
+
+		Test(signal.Disconnect(idA));
+		Test(!signal.Disconnect(idA));
+		signal(3);
+		Test(a.m_nTotal == 2 && b.m_nTotal == 5);
+
+		// a destroyed object is removed on the next emit..
+		Receiver::SP spReceiver(new Receiver());
+		signal.Connect(DELEGATE(Receiver, OnInt, int, spReceiver));
+		signal.Emit(1);
+		Test(spReceiver->m_nTotal == 1 && signal.GetCount() == 2);
+		spReceiver.reset();
+		signal.Emit(1);
+		Test(b.m_nTotal == 7 && signal.GetCount() == 1);
+
+		// subscribers may disconnect while the signal is emitted..
+		m_nID = signal.Connect(FUNCTOR_DELEGATE(int, boost::bind(&TestSignal::DisconnectSelf, this, &signal, _1)));
+		Test(signal.GetCount() == 2);
+		signal.Emit(1);
+		Test(signal.GetCount() == 1 && b.m_nTotal == 8);
+
+		Test(signal.DisconnectObject(&b) == 1);
+		Test(signal.GetCount() == 0);
+	}
+
+	void TestDispatch()
+	{
+		Signal<const Data &> signal;
+		Receiver inline1, inline2;
+		signal.Connect(DELEGATE(Receiver, OnData, const Data &, &inline1));
+		signal.Connect(DELEGATE(Receiver, OnData, const Data &, &inline2));
+
+		// with no pool, every subscriber is called inline & nothing is copied..
+		Receiver queued;
+		signal.Connect(DELEGATE(Receiver, OnData, const Data &, &queued), Signal<const Data &>::MAIN_THREAD);
+
+		Data data;
+		data.m_nValue = 5;
+		Data::sm_nCopies = 0;
+		signal.Emit(data);
+		Test(Data::sm_nCopies == 0);
+		Test(inline1.m_nTotal == 5 && inline2.m_nTotal == 5 && queued.m_nTotal == 5);
+
+		ThreadPool pool(2);
+		Receiver::SP spPooled(new Receiver());
+		signal.Connect(DELEGATE(Receiver, OnData, const Data &, spPooled), Signal<const Data &>::THREAD_POOL);
+
+		// the queued subscribers share one copy of the data..
+		data.m_nValue = 1;
+		Data::sm_nCopies = 0;
+		signal.Emit(data);
+		Test(Data::sm_nCopies == 1);
+		Test(inline1.m_nTotal == 6 && inline2.m_nTotal == 6);
+
+		for (int i = 0; i < 1000 && (queued.m_nCalls < 2 || spPooled->m_nCalls < 1); ++i)
+		{
+			pool.ProcessMainThread();
+			boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+		}
+		Test(queued.m_nTotal == 6 && spPooled->m_nTotal == 1);
+
+		// an expired subscriber is never queued..
+		spPooled.reset();
+		signal.Emit(data);
+		Test(signal.GetCount() == 3);
+	}
+
+	//! emit from the pool while subscribers come & go
+	void TestThreads()
+	{
+		ThreadPool pool(4);
+
+		Signal<int> signal;
+		Receiver fixed;
+		signal.Connect(DELEGATE(Receiver, OnInt, int, &fixed));
+
+		boost::atomic<int> done(0);
+		const int EMITTERS = 4;
+		const int EMITS = 2000;
+		for (int i = 0; i < EMITTERS; ++i)
+			pool.InvokeOnThread(VOID_FUNCTOR_DELEGATE(boost::bind(&TestSignal::EmitMany, &signal, EMITS, &done)));
+
+		Receiver changing;
+		while (done < EMITTERS)
+		{
+			Signal<int>::ConnectionID id = signal.Connect(DELEGATE(Receiver, OnInt, int, &changing));
+			Test(signal.Disconnect(id));
+		}
+
+		Test(fixed.m_nTotal == EMITTERS * EMITS);
+		Test(signal.GetCount() == 1);
+	}
+
+	static void EmitMany(Signal<int> * a_pSignal, int a_nCount, boost::atomic<int> * a_pDone)
+	{
+		for (int i = 0; i < a_nCount; ++i)
+			a_pSignal->Emit(1);
+		*a_pDone += 1;
+	}
+
+	void DisconnectSelf(Signal<int> * a_pSignal, int)
+	{
+		Test(a_pSignal->Disconnect(m_nID));
+	}
+
+private:
+	Signal<int>::ConnectionID	m_nID;
+};
+
+boost::atomic<int> TestSignal::Data::sm_nCopies(0);
+
+TestSignal TEST_SIGNAL;
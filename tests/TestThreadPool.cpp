@@ -24,12 +24,15 @@ class TestThreadPool : UnitTest
 {
 public:
 	//! Construction
-	TestThreadPool() : UnitTest("TestThreadPool")
+	TestThreadPool() : UnitTest("TestThreadPool"),
+		m_Pool(NULL),
+		m_bInvokedOnMain(false)
 	{}
 
 	virtual void RunTest()
 	{
 		m_Pool = new ThreadPool();
+		Test(m_Pool->IsMainThread());
 
 		int index = 0;
 		double startTime = Time().GetEpochTime();
@@ -39,6 +42,8 @@ public:
 			m_Pool->InvokeOnThread<int>( DELEGATE(TestThreadPool, ThreadInvoke, int, this), index++ );
 		}
 
+		Test(!m_bInvokedOnMain);
+
 		delete m_Pool;
 		m_Pool = NULL;
 	}
@@ -46,6 +51,8 @@ public:
 	void ThreadInvoke(int v )
 	{
 		Log::Debug( "TestThreadPool", "Thread arg = %d", v );
+		if ( m_Pool->IsMainThread() )
+			m_bInvokedOnMain = true;
 		m_Pool->InvokeOnMain<int>( DELEGATE(TestThreadPool, MainInvoke, int, this), v );
 	}
 
@@ -54,7 +61,8 @@ public:
 		Log::Debug( "TestThreadPool", "Main arg = %d", v );
 	}
 
-	ThreadPool * m_Pool;
+	ThreadPool *	m_Pool;
+	volatile bool	m_bInvokedOnMain;
 };
 
 TestThreadPool TEST_THREADPOOL;
@@ -0,0 +1,117 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+#include "UnitTest.h"
+#include "utils/Log.h"
+#include "utils/ThreadPool.h"
+#include "utils/Trace.h"
+#include "jsoncpp/json/json.h"
+
+#include <map>
+
+class TestTrace : UnitTest
+{
+public:
+	//! Construction
+	TestTrace() : UnitTest("TestTrace"), m_bDone(false)
+	{}
+
+	virtual void RunTest()
+	{
+		ThreadPool pool(2);
+
+		// nothing is recorded while tracing is off..
+		Trace::Clear();
+		{
+			TraceSpan span(Trace::NewTrace(), "off");
+			Test(!span.IsActive());
+		}
+		Test(Trace::GetEventCount() == 0);
+
+		Trace::Start();
+		{
+			// a span with no trace records nothing..
+			TraceSpan span("no_trace");
+			Test(!span.IsActive());
+		}
+
+		// a new trace on the main thread, which hops to a pool thread and back..
+		{
+			TraceSpan root(Trace::NewTrace(), "root", "TestTrace");
+			Test(root.IsActive());
+			root.SetDetail("detail \"quoted\"");
+			pool.InvokeOnThread(VOID_DELEGATE(TestTrace, OnThread, this));
+		}
+		Test(!Trace::GetContext().IsValid());
+
+		Spin(m_bDone);
+		Test(m_bDone);
+		pool.ProcessMainThread();
+		Trace::Stop();
+
+		// every span belongs to the same trace, and all the parents were recorded..
+		std::string json(Trace::ExportJson());
+		Log::Debug("TestTrace", "Trace: %s", json.c_str());
+
+		Json::Value root;
+		Test(Json::Reader().parse(json, root));
+		const Json::Value & events = root["traceEvents"];
+
+		std::map<std::string, Json::Value> spans;
+		std::map<unsigned int, bool> ids;
+		for (unsigned int i = 0; i < events.size(); ++i)
+		{
+			const Json::Value & e = events[i];
+			Test(e["ph"].asString() == "X");
+			Test(e["dur"].asDouble() >= 0.0);
+			Test(e["args"]["trace"].asUInt() == events[0]["args"]["trace"].asUInt());
+			spans[e["name"].asString()] = e;
+			ids[e["args"]["span"].asUInt()] = true;
+		}
+		Test(events.size() == 6);
+		Test(spans.find("root") != spans.end() && spans["root"]["args"]["parent"].asUInt() == 0);
+		Test(spans["root"]["args"]["detail"].asString() == "detail \"quoted\"");
+		Test(spans.find("thread_queue") != spans.end());
+		Test(spans.find("main_queue") != spans.end());
+		Test(spans.find("work") != spans.end());
+		for (std::map<std::string, Json::Value>::iterator iSpan = spans.begin(); iSpan != spans.end(); ++iSpan)
+		{
+			unsigned int parent = iSpan->second["args"]["parent"].asUInt();
+			Test(parent == 0 || ids.find(parent) != ids.end());
+		}
+		// the work span is recorded inside the pool thread..
+		Test(spans["work"]["tid"].asUInt() != spans["root"]["tid"].asUInt());
+
+		Trace::Clear();
+		Test(Trace::GetEventCount() == 0);
+	}
+
+	void OnThread()
+	{
+		TraceSpan span("work", "TestTrace");
+		Test(span.IsActive());
+		ThreadPool::Instance()->InvokeOnMain(VOID_DELEGATE(TestTrace, OnMain, this));
+	}
+
+	void OnMain()
+	{
+		m_bDone = true;
+	}
+
+	bool m_bDone;
+};
+
+TestTrace TEST_TRACE;
@@ -0,0 +1,174 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include <stdio.h>
+
+#include "utils/UnitTest.h"
+#include "utils/Config.h"
+#include "utils/JsonParser.h"
+#include "utils/Log.h"
+#include "utils/ThreadPool.h"
+#include "utils/TimerPool.h"
+#include "utils/Time.h"
+#include "utils/TrafficCapture.h"
+#include "testing/MockService.h"
+#include "testing/TrafficReplay.h"
+
+#include "services/NaturalLanguageClassifier/NaturalLanguageClassifier.h"
+
+class TestTrafficCapture : UnitTest
+{
+public:
+	//! Construction
+	TestTrafficCapture() : UnitTest("TestTrafficCapture"),
+		m_nClassified(0)
+	{}
+
+	virtual void RunTest()
+	{
+		ThreadPool pool(4);
+		TimerPool timers;
+		Config config;
+
+		const std::string captureFile("./traffic_capture.wdc");
+		remove(captureFile.c_str());
+
+		// responses added to the same end-point are returned in turn..
+		MockService mock(PORT);
+		mock.AddResponse("POST", "/natural-language-classifier/api/v1/classifiers/:id/classify", 200,
+			"{\"classifier_id\":\"mock-id\",\"top_class\":\"temperature\"}");
+		mock.AddResponse("POST", "/natural-language-classifier/api/v1/classifiers/:id/classify", 200,
+			"{\"classifier_id\":\"mock-id\",\"top_class\":\"time\"}");
+		Test(mock.Start());
+		Test(mock.AddServiceConfig("NaturalLanguageClassifierV1", "/natural-language-classifier/api"));
+
+		NaturalLanguageClassifier nlc;
+		nlc.SetCacheEnabled(false);
+		Test(nlc.Start());
+
+		Test(!TrafficCapture::IsCapturing(TrafficCapture::SOURCE_SERVICE));
+		Test(TrafficCapture::Start(captureFile));
+		Test(TrafficCapture::IsCapturing(TrafficCapture::SOURCE_SERVICE));
+		Test(!TrafficCapture::IsCapturing(TrafficCapture::SOURCE_WEB_CLIENT));
+
+		for (int i = 0; i < 3; ++i)
+		{
+			nlc.Classify("mock-id", "How hot is it", DELEGATE(TestTrafficCapture, OnClassify, const Json::Value &, this));
+			Spin(m_nClassified, i + 1);
+		}
+		Test(m_nClassified == 3);
+		Test(m_TopClasses.size() == 3 && m_TopClasses[0] == "temperature" && m_TopClasses[1] == "time"
+			&& m_TopClasses[2] == "temperature");
+		Test(TrafficCapture::GetRecordCount() == 3);
+		TrafficCapture::Stop();
+		Test(!TrafficCapture::IsCapturing(TrafficCapture::SOURCE_SERVICE));
+		Test(nlc.Stop());
+
+		TrafficCapture::RecordList records;
+		Test(TrafficCapture::Load(captureFile, records));
+		Test(records.size() == 3);
+		for (size_t i = 0; i < records.size(); ++i)
+		{
+			const TrafficCapture::Record & record = records[i];
+			Test(record.m_eSource == TrafficCapture::SOURCE_SERVICE);
+			Test(record.m_ServiceId == "NaturalLanguageClassifierV1");
+			Test(record.m_RequestType == "POST");
+			Test(record.m_nStatusCode == 200);
+			Test(record.m_fTime > 0.0 && record.m_fDuration >= 0.0);
+			Test(record.m_URL.find("/v1/classifiers/mock-id/classify") != std::string::npos);
+			Test(record.m_RequestBody.find("How hot is it") != std::string::npos);
+			Test(record.m_ResponseBody.find("top_class") != std::string::npos);
+
+			IWebClient::Headers::const_iterator iAuth = record.m_RequestHeaders.find("Authorization");
+			Test(iAuth != record.m_RequestHeaders.end() && iAuth->second == "<redacted>");
+		}
+
+		// replay the captured requests against a mock loaded with the captured responses..
+		TrafficReplay replay;
+		Test(replay.Load(captureFile));
+		Test(replay.GetRecords().size() == 3);
+
+		MockService replayed(PORT + 1);
+		replay.AddResponses(replayed);
+		Test(replayed.Start());
+
+		replay.SetSpeed(10.0);
+		Test(replay.Run(replayed.GetURL()));
+		Log::Status("TestTrafficCapture", "Replay: %s", replay.GetReport().c_str());
+		Test(replay.GetCompleted() == 3);
+		Test(replay.GetErrors() == 0);
+		Test(replay.GetLatency().GetCount() == 3);
+		Test(replayed.GetRequestCount() == 3);
+		Test(replayed.GetNotFoundCount() == 0);
+
+		Test(replayed.Stop());
+		Test(mock.Stop());
+		remove(captureFile.c_str());
+
+		// cookies, session headers & tokens in a body are redacted in both directions..
+		TrafficCapture::Record secret;
+		secret.m_fTime = Time().GetEpochTime();
+		secret.m_nStatusCode = 200;
+		secret.m_ServiceId = "GraphV1";
+		secret.m_RequestType = "GET";
+		secret.m_URL = "http://localhost/v1/session";
+		secret.m_RequestHeaders["Cookie"] = "session=secret";
+		secret.m_RequestHeaders["Accept"] = "application/json";
+		secret.m_RequestBody = "not json, token";
+		secret.m_ResponseHeaders["Set-Cookie"] = "session=secret";
+		secret.m_ResponseHeaders["X-Session-Id"] = "secret";
+		secret.m_ResponseBody = "{\"gds-token\":\"secret\",\"session\":{\"access_token\":\"secret\",\"ttl\":60}}";
+		Test(TrafficCapture::Start(captureFile));
+		TrafficCapture::Capture(secret);
+		TrafficCapture::Stop();
+
+		records.clear();
+		Test(TrafficCapture::Load(captureFile, records));
+		Test(records.size() == 1);
+		if (records.size() == 1)
+		{
+			const TrafficCapture::Record & record = records[0];
+			Test(record.m_RequestHeaders.find("Cookie")->second == "<redacted>");
+			Test(record.m_RequestHeaders.find("Accept")->second == "application/json");
+			Test(record.m_RequestBody == secret.m_RequestBody);
+			Test(record.m_ResponseHeaders.find("Set-Cookie")->second == "<redacted>");
+			Test(record.m_ResponseHeaders.find("X-Session-Id")->second == "<redacted>");
+			Test(record.m_ResponseBody.find("secret") == std::string::npos);
+
+			Json::Value body;
+			Test(JsonParser::ParseJson(record.m_ResponseBody, body));
+			Test(body["gds-token"].asString() == "<redacted>");
+			Test(body["session"]["access_token"].asString() == "<redacted>");
+			Test(body["session"]["ttl"].asInt() == 60);
+		}
+		remove(captureFile.c_str());
+	}
+
+	void OnClassify(const Json::Value & a_Response)
+	{
+		m_TopClasses.push_back(a_Response["top_class"].asString());
+		m_nClassified += 1;
+	}
+
+private:
+	static const int PORT = 8098;
+
+	int							m_nClassified;
+	std::vector<std::string>	m_TopClasses;
+};
+
+TestTrafficCapture TEST_TRAFFIC_CAPTURE;
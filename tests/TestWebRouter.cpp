@@ -0,0 +1,71 @@
+/**
+* Copyright 2016 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "UnitTest.h"
+#include "utils/WebRouter.h"
+
+class TestWebRouter : UnitTest
+{
+public:
+	//! Construction
+	TestWebRouter() : UnitTest("TestWebRouter")
+	{}
+
+	virtual void RunTest()
+	{
+		WebRouter router;
+		router.AddRoute( "", "/test_http", 0 );
+		router.AddRoute( "GET", "/v1/things/:id", 1 );
+		router.AddRoute( "DELETE", "/v1/things/:id", 2 );
+		router.AddRoute( "GET", "/v1/things/new", 3 );
+		router.AddRoute( "GET", "/v1/things/:id/parts/:part", 4 );
+		router.AddRoute( "", "/files/*", 5 );
+		router.AddRoute( "", "/v?/status", 6 );
+		router.AddRoute( "", "/test", 7 );
+		Test( router.GetRouteCount() == 8 );
+
+		size_t id = 0;
+		WebRouter::Parameters params;
+		Test( router.Find( "GET", "/test_http", id, params ) == WebRouter::MATCHED && id == 0 );
+		Test( router.Find( "GET", "/test", id, params ) == WebRouter::MATCHED && id == 7 );
+		Test( router.Find( "GET", "/test_", id, params ) == WebRouter::NOT_FOUND );
+
+		// parameters and request types..
+		Test( router.Find( "GET", "/v1/things/42", id, params ) == WebRouter::MATCHED && id == 1 );
+		Test( params["id"] == "42" );
+		Test( router.Find( "DELETE", "/v1/things/42", id, params ) == WebRouter::MATCHED && id == 2 );
+		Test( router.Find( "POST", "/v1/things/42", id, params ) == WebRouter::METHOD_NOT_ALLOWED );
+		Test( router.Find( "GET", "/v1/things/", id, params ) == WebRouter::NOT_FOUND );
+
+		// static segments win over parameters, but we fall back to the parameter if the static path fails
+		Test( router.Find( "GET", "/v1/things/new", id, params ) == WebRouter::MATCHED && id == 3 );
+		Test( params.size() == 0 );
+		Test( router.Find( "DELETE", "/v1/things/new", id, params ) == WebRouter::MATCHED && id == 2 );
+		Test( params["id"] == "new" );
+		Test( router.Find( "GET", "/v1/things/new/parts/7", id, params ) == WebRouter::MATCHED && id == 4 );
+		Test( params["id"] == "new" && params["part"] == "7" );
+
+		// wildcards
+		Test( router.Find( "GET", "/files/audio/hello.wav", id, params ) == WebRouter::MATCHED && id == 5 );
+		Test( router.Find( "GET", "/files/", id, params ) == WebRouter::MATCHED && id == 5 );
+		Test( router.Find( "GET", "/v2/status", id, params ) == WebRouter::MATCHED && id == 6 );
+		Test( router.Find( "GET", "/v22/status", id, params ) == WebRouter::NOT_FOUND );
+	}
+
+};
+
+TestWebRouter TEST_WEB_ROUTER;
@@ -22,6 +22,8 @@
 #include "utils/ThreadPool.h"
 #include "utils/Time.h"
 
+#include "boost/asio.hpp"
+
 class TestWebServer : UnitTest
 {
 public:
@@ -29,7 +31,14 @@ public:
 	TestWebServer() : UnitTest("TestWebServer"), 
 		m_bHTTPTested(false), 
 		m_bWSTested(false),
-		m_bClientClosed( false )
+		m_bClientClosed( false ),
+		m_bTemplateTested( false ),
+		m_nPushed(0),
+		m_bPushRefused(false),
+		m_bPushDone(false),
+		m_bDrained(false),
+		m_bDrainedOnMain(false),
+		m_nDrainQueued(0)
 	{}
 
 	virtual void RunTest()
@@ -41,6 +50,10 @@ public:
 		IWebServer * pServer = IWebServer::Create( "", 8080 );
 		pServer->AddEndpoint("/test_http", DELEGATE(TestWebServer, OnTestHTTP, IWebServer::RequestSP, this));
 		pServer->AddEndpoint("/test_ws", DELEGATE(TestWebServer, OnTestWS, IWebServer::RequestSP, this));
+		pServer->AddEndpoint("/test_keep_alive", DELEGATE(TestWebServer, OnTestKeepAlive, IWebServer::RequestSP, this), false);
+		pServer->AddEndpoint("/test_chunked", DELEGATE(TestWebServer, OnTestChunked, IWebServer::RequestSP, this), false);
+		pServer->AddEndpoint("/test_file", DELEGATE(TestWebServer, OnTestFile, IWebServer::RequestSP, this), false);
+		pServer->AddEndpoint("/test_template", DELEGATE(TestWebServer, OnTestTemplate, IWebServer::RequestSP, this), false);
 		Test(pServer->Start());
 
 		// test web requests
@@ -56,6 +69,96 @@ public:
 		}
 		Test(m_bHTTPTested);
 
+		// test a request template, the headers of the request replace those of the template..
+		{
+			IWebClient::Headers shared;
+			shared["Authorization"] = "Basic dGVzdDp0ZXN0";
+			shared["Accept"] = "text/plain";
+			IWebClient::Headers headers;
+			headers["accept"] = "application/json";
+
+			IWebClient::SP spTemplateClient = IWebClient::Create(URL("http://127.0.0.1:8080/test_template"));
+			spTemplateClient->SetTemplate(IWebClient::CreateTemplate(shared, "127.0.0.1"));
+			spTemplateClient->SetHeaders(headers);
+			spTemplateClient->SetRequestType("POST");
+			spTemplateClient->SetBody("body");
+			spTemplateClient->SetDataReceiver(DELEGATE(TestWebServer, OnTemplateResponse, IWebClient::RequestData *, this));
+			Test(spTemplateClient->Send());
+			Spin(m_bTemplateTested);
+			Test(m_bTemplateTested);
+			Test(m_TemplateResponse == "Basic dGVzdDp0ZXN0|application/json|127.0.0.1|body");
+			Test(spTemplateClient->GetRequestHeaders()["Authorization"] == "Basic dGVzdDp0ZXN0");
+			spTemplateClient->Close();
+		}
+
+		// test pipelined requests on a persistent connection, the responses must come back in order and
+		// the connection should be closed after the request asking for it.
+		{
+			boost::asio::io_service service;
+			boost::asio::ip::tcp::socket socket(service);
+			socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 8080));
+
+			std::string requests("GET /test_keep_alive?n=1 HTTP/1.1\r\n\r\n"
+				"POST /test_keep_alive?n=2 HTTP/1.1\r\nContent-Length: 4\r\n\r\nbody"
+				"GET /test_keep_alive?n=3 HTTP/1.1\r\nConnection: close\r\n\r\n");
+			boost::asio::write(socket, boost::asio::buffer(requests));
+
+			std::string responses;
+			boost::system::error_code ec;
+			char buffer[1024];
+			while (!ec)
+			{
+				size_t bytes = socket.read_some(boost::asio::buffer(buffer), ec);
+				responses.append(buffer, bytes);
+			}
+			Log::Debug("TestWebServer", "Keep-alive responses: %s", responses.c_str());
+
+			size_t first = responses.find("Request 1");
+			size_t second = responses.find("Request 2 body");
+			size_t third = responses.find("Request 3");
+			Test(first != std::string::npos && second != std::string::npos && third != std::string::npos);
+			Test(first < second && second < third);
+			Test(responses.find("Connection: close") > second);
+		}
+
+		// test streaming a chunked response followed by a file response
+		{
+			m_FileData.resize(300 * 1024);
+			for (size_t i = 0; i < m_FileData.size(); ++i)
+				m_FileData[i] = (char)('a' + (i % 26));
+			FILE * pFile = fopen("TestWebServer.tmp", "wb");
+			Test(pFile != NULL);
+			fwrite(m_FileData.data(), 1, m_FileData.size(), pFile);
+			fclose(pFile);
+
+			boost::asio::io_service service;
+			boost::asio::ip::tcp::socket socket(service);
+			socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 8080));
+
+			std::string requests("GET /test_chunked HTTP/1.1\r\n\r\n"
+				"GET /test_file HTTP/1.1\r\nConnection: close\r\n\r\n");
+			boost::asio::write(socket, boost::asio::buffer(requests));
+
+			std::string responses;
+			boost::system::error_code ec;
+			char buffer[16 * 1024];
+			while (!ec)
+			{
+				size_t bytes = socket.read_some(boost::asio::buffer(buffer), ec);
+				responses.append(buffer, bytes);
+			}
+
+			size_t chunked = responses.find("Transfer-Encoding: chunked\r\n");
+			size_t body = responses.find("6\r\nHello \r\n5\r\nWorld\r\n0\r\n\r\n");
+			size_t file = responses.find(StringUtil::Format("Content-Length: %u\r\n", m_FileData.size()));
+			Test(chunked != std::string::npos && body > chunked);
+			Test(file != std::string::npos && file > body);
+			Test(responses.size() > m_FileData.size()
+				&& responses.compare(responses.size() - m_FileData.size(), m_FileData.size(), m_FileData) == 0);
+
+			remove("TestWebServer.tmp");
+		}
+
 		m_bClientClosed = false;
 		spClient->SetURL("ws://127.0.0.1:8080/test_ws");
 		spClient->SetStateReceiver(DELEGATE(TestWebServer, OnState, IWebClient *, this));
@@ -90,6 +193,148 @@ public:
 
 		spClient.reset();
 		delete pServer;
+
+		TestLimits(pool);
+		TestSlowClient();
+		TestBackpressure(pool);
+	}
+
+	//! Test connection limits & load shedding on a separate server
+	void TestLimits(ThreadPool & a_Pool)
+	{
+		IWebServer * pServer = IWebServer::Create("", 8081);
+		pServer->SetConnectionLimits(0, 2);
+		pServer->SetLoadShedding(0.1f, 2);
+		pServer->AddEndpoint("/test_busy", DELEGATE(TestWebServer, OnTestKeepAlive, IWebServer::RequestSP, this));
+		Test(pServer->Start());
+
+		boost::asio::io_service service;
+		boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 8081);
+
+		// the first request is queued for the main thread, which we don't process yet..
+		boost::asio::ip::tcp::socket queued(service);
+		queued.connect(endpoint);
+		boost::asio::write(queued, boost::asio::buffer(std::string("GET /test_busy?n=1 HTTP/1.1\r\n\r\n")));
+		boost::asio::ip::tcp::socket idle(service);
+		idle.connect(endpoint);
+		// connections are admitted on the io threads, make sure both are counted before the next one..
+		boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+
+		// a third connection from the same address is rejected
+		std::string response(Exchange(NULL, service, endpoint, "GET /test_busy?n=2 HTTP/1.1\r\n\r\n"));
+		Test(response.find("HTTP/1.1 503") == 0);
+
+		// once the first request has waited long enough, requests are shed until the main thread catches up
+		idle.close();
+		boost::this_thread::sleep(boost::posix_time::milliseconds(250));
+		response = Exchange(NULL, service, endpoint, "GET /test_busy?n=3 HTTP/1.1\r\n\r\n");
+		Test(response.find("HTTP/1.1 503") == 0);
+		Test(response.find("Retry-After: 2\r\n") != std::string::npos);
+
+		a_Pool.ProcessMainThread();
+		boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+		response = Exchange(&a_Pool, service, endpoint, "GET /test_busy?n=4 HTTP/1.1\r\nConnection: close\r\n\r\n");
+		Test(response.find("HTTP/1.1 503") == std::string::npos);
+
+		queued.close();
+		delete pServer;
+	}
+
+	//! Test that a client that stops sending part way through a request is dropped, this must work
+	//! without the main thread.
+	void TestSlowClient()
+	{
+		IWebServer * pServer = IWebServer::Create("", 8082);
+		pServer->SetRequestLimits(64 * 1024, 1024, 128);
+		pServer->AddEndpoint("/test_slow", DELEGATE(TestWebServer, OnTestKeepAlive, IWebServer::RequestSP, this));
+		Test(pServer->Start());
+
+		boost::asio::io_service service;
+		boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 8082);
+
+		Time start;
+		std::string response(Exchange(NULL, service, endpoint, "GET /test_slow HTTP/1.1\r\nHost: "));
+		Test(response.find("HTTP/1.1 408") == 0);
+		Test((Time().GetEpochTime() - start.GetEpochTime()) < 10.0);
+
+		delete pServer;
+	}
+
+	//! Test that SendChunk() pushes back on a client that isn't reading, and the drain handler is invoked on
+	//! the main thread once the queue has drained.
+	void TestBackpressure(ThreadPool & a_Pool)
+	{
+		IWebServer * pServer = IWebServer::Create("", 8083);
+		pServer->AddEndpoint("/test_push", DELEGATE(TestWebServer, OnTestPush, IWebServer::RequestSP, this), false);
+		Test(pServer->Start());
+
+		boost::asio::io_service service;
+		boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 8083);
+		boost::asio::ip::tcp::socket socket(service);
+		socket.open(endpoint.protocol());
+		socket.set_option(boost::asio::socket_base::receive_buffer_size(16 * 1024));
+		socket.connect(endpoint);
+		boost::asio::write(socket, boost::asio::buffer(std::string("GET /test_push HTTP/1.1\r\n\r\n")));
+		socket.non_blocking(true);
+
+		// the end-point pushes from the main thread, so nothing is read until it gives up..
+		Time start;
+		while (!m_bPushDone && (Time().GetEpochTime() - start.GetEpochTime()) < 10.0)
+		{
+			a_Pool.ProcessMainThread();
+			boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+		}
+		Test(m_bPushDone && m_bPushRefused);
+		Test(m_nPushed >= SEND_HIGH_WATER);
+		Test(!m_bDrained);
+
+		// read slowly, the drain handler ends the response once the queue is down to the low water mark
+		std::string response;
+		boost::system::error_code ec;
+		char buffer[4 * 1024];
+		start = Time();
+		while ((!ec || ec == boost::asio::error::would_block) && (Time().GetEpochTime() - start.GetEpochTime()) < 30.0)
+		{
+			size_t bytes = socket.read_some(boost::asio::buffer(buffer), ec);
+			response.append(buffer, bytes);
+			a_Pool.ProcessMainThread();
+			boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+		}
+		Test(m_bDrained && m_bDrainedOnMain);
+		Test(m_nDrainQueued <= SEND_LOW_WATER);
+		Test(response.find("HTTP/1.1 200 OK\r\n") == 0);
+		Test(response.size() > m_nPushed);
+		Test(response.size() >= 5 && response.compare(response.size() - 5, 5, "0\r\n\r\n") == 0);
+
+		delete pServer;
+	}
+
+	//! Send a request on a new connection and return everything received until the server closes it, if a_pPool
+	//! is provided the main thread is processed while waiting. Gives up after 30 seconds.
+	std::string Exchange(ThreadPool * a_pPool, boost::asio::io_service & a_Service,
+		const boost::asio::ip::tcp::endpoint & a_EndPoint, const std::string & a_Request)
+	{
+		boost::asio::ip::tcp::socket socket(a_Service);
+		socket.connect(a_EndPoint);
+		boost::asio::write(socket, boost::asio::buffer(a_Request));
+		socket.non_blocking(true);
+
+		std::string response;
+		boost::system::error_code ec;
+		char buffer[1024];
+		Time start;
+		while ((!ec || ec == boost::asio::error::would_block) && (Time().GetEpochTime() - start.GetEpochTime()) < 30.0)
+		{
+			size_t bytes = socket.read_some(boost::asio::buffer(buffer), ec);
+			response.append(buffer, bytes);
+			if (ec == boost::asio::error::would_block)
+			{
+				if (a_pPool != NULL)
+					a_pPool->ProcessMainThread();
+				boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+			}
+		}
+		return response;
 	}
 
 	void OnTestHTTP(IWebServer::RequestSP a_spRequest)
@@ -101,6 +346,62 @@ public:
 		a_spRequest->m_spConnection->SendAsync("HTTP/1.1 200 Hello World\r\nConnection: close\r\n\r\n");
 	}
 
+	void OnTestKeepAlive(IWebServer::RequestSP a_spRequest)
+	{
+		a_spRequest->m_spConnection->SendResponse(200, "OK",
+			"Request " + a_spRequest->m_Headers["n"] + " " + a_spRequest->m_Content);
+	}
+
+	void OnTestTemplate(IWebServer::RequestSP a_spRequest)
+	{
+		a_spRequest->m_spConnection->SendResponse(200, "OK", a_spRequest->m_Headers["Authorization"] + "|"
+			+ a_spRequest->m_Headers["Accept"] + "|" + a_spRequest->m_Headers["Host"] + "|" + a_spRequest->m_Content);
+	}
+
+	void OnTemplateResponse(IWebClient::RequestData * a_pResponse)
+	{
+		m_TemplateResponse += a_pResponse->m_Content;
+		if (a_pResponse->m_bDone)
+			m_bTemplateTested = true;
+	}
+
+	void OnTestChunked(IWebServer::RequestSP a_spRequest)
+	{
+		a_spRequest->m_spConnection->BeginChunkedResponse(200, "OK", IWebServer::Headers());
+		Test(a_spRequest->m_spConnection->SendChunk("Hello "));
+		Test(a_spRequest->m_spConnection->SendChunk("World"));
+		a_spRequest->m_spConnection->EndChunkedResponse();
+	}
+
+	void OnTestPush(IWebServer::RequestSP a_spRequest)
+	{
+		IWebServer::ConnectionSP spConnection = a_spRequest->m_spConnection;
+		spConnection->SetDrainHandler(DELEGATE(TestWebServer, OnTestDrain, IWebServer::ConnectionSP, this));
+		spConnection->BeginChunkedResponse(200, "OK", IWebServer::Headers());
+
+		// stop at 64MB in case the data never backs up
+		std::string chunk(16 * 1024, 'x');
+		while (!m_bPushRefused && m_nPushed < 64 * 1024 * 1024)
+		{
+			m_nPushed += chunk.size();
+			m_bPushRefused = !spConnection->SendChunk(chunk);
+		}
+		m_bPushDone = true;
+	}
+
+	void OnTestDrain(IWebServer::ConnectionSP a_spConnection)
+	{
+		m_bDrained = true;
+		m_bDrainedOnMain = ThreadPool::Instance()->IsMainThread();
+		m_nDrainQueued = a_spConnection->GetSendQueued();
+		a_spConnection->EndChunkedResponse(true);
+	}
+
+	void OnTestFile(IWebServer::RequestSP a_spRequest)
+	{
+		Test(a_spRequest->m_spConnection->SendFile(200, "OK", IWebServer::Headers(), "TestWebServer.tmp"));
+	}
+
 	void OnTestWS(IWebServer::RequestSP a_spRequest)
 	{
 		Log::Debug("TestWebServer", "OnTestWS()");
@@ -172,6 +473,19 @@ public:
 	bool m_bHTTPTested;
 	bool m_bWSTested;
 	bool m_bClientClosed;
+	bool m_bTemplateTested;
+	std::string m_TemplateResponse;
+	std::string m_FileData;
+
+	static const size_t SEND_HIGH_WATER = 256 * 1024;	// must match WebServer.cpp
+	static const size_t SEND_LOW_WATER = 64 * 1024;
+
+	size_t m_nPushed;
+	bool m_bPushRefused;
+	bool m_bPushDone;
+	bool m_bDrained;
+	bool m_bDrainedOnMain;
+	size_t m_nDrainQueued;
 };
 
 TestWebServer TEST_WEB_SERVER;